@@ -1,4 +1,5 @@
 #include "sfr62p.h"
+#include "hal62p.h"
 
 void main(void)
 {
@@ -6,25 +7,12 @@ long int x;
 unsigned int Time;
     long long t;
 
-	p7   = 0xff;
-    pd7= 0xff;
+	hal_port_init();
 
-	 adcon0=0x98;
-    adcon1=0x22;
-   adcon2=0x01;
+	 hal_adc_init(0x98,0x22);
     adst   =0x01;
- ta3mr= 0x00;
-    ir_ta3ic= 0;
-    trgsr =0x80;
-   ta4mr =0x01;
-   udf= 0x10;
-   ir_ta4ic= 0;
-    ta3 = 0xEA60;
-    ta4= 0;
-u1mr = 0x05;
-  	u1c0 = 0x10;
-u1brg = 0x26;
-  	te_u1c1 = 1;
+ hal_timer_init();
+hal_uart_init(1,0x10,0x26,0);
   	_asm("fset I");
 
 while (1)
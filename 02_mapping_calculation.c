@@ -13,64 +13,540 @@
  * Include file
  */
 #include "sfr62p.h"
-
-/**
- * Data type definition refer to MISRA
- */
-typedef unsigned char        u1;
-typedef unsigned short       u2;
-typedef unsigned long        u4;
-typedef unsigned long long   u8;
-typedef signed char          s1;
-typedef signed short         s2;
-typedef signed long          s4;
-typedef signed long long     s8;
-typedef float                f4;
-typedef double               f8;
-typedef unsigned char        BOOL;
+#include "com62p.h"
+#include "hal62p.h"
+#include "cfg62p.h"
 
 /**
  * Data definition
  */
-/* char 1 byte */
-#define S1_MIN              (-128)
-#define S1_MAX              (127)
-#define U1_MIN              (0)
-#define U1_MAX              (255)
-/* short 1 byte */
-#define S2_MIN              (-32768)
-#define S2_MAX              (32767)
-#define U2_MIN              (0)
-#define U2_MAX              (65535)
 /* Analog input channel */
-#define ADC_CH0             (0)
+#define ADC_CH_MAX          (6)     /* AN0 to AN5 swept                   */
 #define ADC_MIN             (2)
 #define ADC_MAX             (254)
-/* LED0 */
-#define LED0_ON             (p7_0 = 0)
-#define LED0_OFF            (p7_0 = 1)
-/* ftoa data definition */
-#define MAX_PRECISION       (10)
+#if (CFG_CMD != 0) || (CFG_CH_MASK > 0x0F)
+#define ADC_SWEEP           (HAL_ADC_AN0_AN5)
+#elif (CFG_CH_MASK > 0x03)
+#define ADC_SWEEP           (HAL_ADC_AN0_AN3)
+#else
+#define ADC_SWEEP           (HAL_ADC_AN0_AN1)
+#endif
 /* mapping table */
 #define TABLE_MAX           (256)
+#define CONV_ON             (CFG_TEXT_ON || CFG_DB_ON) /* else raw codes only */
+#if (CFG_CONV == CFG_CONV_TABLE)
+#define CONV_TEMP(code)     (s2g_glmap1b_s2pt((code), &adc_table[0]))
+#else
+#define CONV_TEMP(code)     (conv_calc(code))
+#endif
+/* Scheduler tick : ta3 underflow of the time base (hal62p.h) */
+#define TICK_MS             (10)
+/* Sampling */
+#define SAMPLE_PERIOD_MS    (CFG_PERIOD_MS)
+#define SAMPLE_PERIOD_TICK  (SAMPLE_PERIOD_MS / TICK_MS)
+#define SAMPLE_PERIOD_MAX   (255 * TICK_MS)
+#define POWER_REPORT_SAMPLE (100)
+/* UART1 transmit queue (size must be power of 2) */
+#define UART_TXQ_SIZE       (64)
+#define UART_TXQ_MASK       (UART_TXQ_SIZE - 1)
+/* UART1 urgent lane, sent ahead of the queue at a line or frame end (power of 2) */
+#define UART_URGQ_SIZE      (64)
+#define UART_URGQ_MASK      (UART_URGQ_SIZE - 1)
+/* UART1 receive queue (size must be power of 2) */
+#define UART_RXQ_SIZE       (32)
+#define UART_RXQ_MASK       (UART_RXQ_SIZE - 1)
+#define UART_RB_ERR         (0xF000) /* SUM, PER, FER, OER bits of u1rb   */
+#define UART_BAUD_SAFE      (9600)  /* used when the default is rejected  */
+#define UART_C0_DEFAULT     (0x10)  /* CTS/RTS disabled, clock f1         */
+/* UART1 transmit by DMA0 (CFG_TX_DMA) */
+#define DMA_SL_U1TX         (0x0F)  /* dm0sl : request UART1 transmit     */
+#define DMA_CON_TX          (0x19)  /* dm0con : 8 bit, single, DMAE, SAR++ */
+#define DMA_RUN_MAX         (UART_TXQ_SIZE / 4) /* queue space returns per run */
+#ifndef DMA0_SRC
+#define DMA0_SRC(p)         (sar0 = (u4)(p))
+#define DMA0_DST(p)         (dar0 = (u4)(p))
+#endif
+/* Binary frames striped over UART1 / UART2 / UART0 (CFG_STRIPE) */
+#define STRIPE_ON           (CFG_STRIPE > 1)
+#define STRIPE_U1           (0)     /* link 0 : UART1, also text and replies */
+#define STRIPE_U2           (1)     /* link 1 : UART2                     */
+#define STRIPE_U0           (2)     /* link 2 : UART0                     */
+#define STRIPE_Q_SIZE       (64)    /* per link, UART2 / UART0            */
+#define STRIPE_Q_MASK       (STRIPE_Q_SIZE - 1)
+#define STRIPE_PENDING(p)   ((u1)(((p)->u1_head - (p)->u1_tail) & STRIPE_Q_MASK))
+/* Output */
+#define OUT_FMT_TEXT        (CFG_FMT_TEXT)
+#define OUT_FMT_BIN         (CFG_FMT_BIN)
+#define OUT_PREC_DEFAULT    (CFG_PREC)
+#define OUT_PREC_MAX        (4)
+#define OUT_BUF_SIZE        (16)
+#define OUT_TEMP_DIGIT      (5)     /* integer digits, table max 45000    */
+#define OUT_TIME_DIGIT      (4)     /* integer digits of ms               */
+#define OUT_LINE_MAX        (208)   /* 6 * (14 + 11 + 1) + 13 + 9 + 3 + 25 */
+/* Setting read by the sample path, constant without the command interface */
+#if (CFG_CMD != 0)
+#define RUN_TICK            (st_cfg.u1_sample_tick)
+#define RUN_CH_MASK         (st_cfg.u1_ch_mask)
+#define RUN_FORMAT          (st_cfg.u1_format)
+#define RUN_PREC            (st_cfg.s2_precision)
+#define RUN_DEADBAND        (st_cfg.s4_deadband)
+#define RUN_STATS           (st_cfg.u1_stats_every)
+#else
+#define RUN_TICK            (SAMPLE_PERIOD_TICK)
+#define RUN_CH_MASK         (CFG_CH_MASK)
+#define RUN_FORMAT          (CFG_FMT)
+#define RUN_PREC            (CFG_PREC)
+#define RUN_DEADBAND        (CFG_DEADBAND)
+#define RUN_STATS           (CFG_STATS_EVERY)
+#endif
+/* Sample record pool : indices handed between ad_isr, main and transmit */
+#define POOL_MASK           (POOL_REC_MAX - 1)
+#define POOL_NONE           (0xFF)  /* no record                          */
+#define POOL_TX_ON          ((CFG_POOL != 0) && CFG_TEXT_ON) /* lines sent from the record */
+#if (CFG_POOL != 0)
+#define SAMPLE_READY        (st_pool_acq.u1_head != st_pool_acq.u1_tail)
+#else
+#define SAMPLE_READY        (b_adc_done != 0)
+#endif
+/* Bytes given to the transmitter and not yet taken by it */
+#define TX_PENDING          ((u2)(u2_tx_queued - u2_tx_taken))
+/* Urgent lane : alarm messages, taken ahead of TX_PENDING at a unit end */
+#define URG_ON              ((CFG_ALARM != 0) && (CFG_URGENT != 0))
+#define URG_PENDING         (u1_urgq_head != u1_urgq_tail)
+#define TXQ_END(i)          ((u1_txq_end[(i) >> 3] >> ((i) & 7)) & 0x01)
+#define TXQ_END_SET(i, b)   (u1_txq_end[(i) >> 3] = (u1)((u1_txq_end[(i) >> 3] & ~(1 << ((i) & 7))) | \
+                                                         ((b) << ((i) & 7))))
+/* Threshold alarm */
+#define ALARM_NONE          (0)
+#define ALARM_HIGH          (1)
+#define ALARM_LOW           (2)
+#define ALARM_HYST          (100)   /* table unit back inside to clear    */
+#define ALARM_MSG_MAX       (32)    /* "Alarm : AN5 clear -12345\n", 'A' */
+/* Host time sync : host us = anchor + ta3 counts since it * u4_rate / 2^32 */
+#define SYNC_RATE_NOM       (715827883UL) /* 2^32 / 6, us per ta3 count   */
+#define SYNC_DRIFT_MAX      (SYNC_RATE_NOM / 2000) /* 500 ppm, else no fit */
+#define SYNC_RATE_GAIN      (4)     /* rate moves 1/4 of the way to a fit */
+#define SYNC_PHASE_GAIN     (2)     /* anchor moves 1/2 of the ping error */
+#define SYNC_STEP_US        (10000) /* larger error : anchor on the ping  */
+#define SYNC_FIT_MIN        (100UL * TA3_PERIOD)  /* 1 s between pings     */
+#define SYNC_FIT_MAX        (60000UL * TA3_PERIOD) /* 600 s                */
+#define SYNC_FIT_SEC        (600)   /* SYNC_FIT_MAX in host seconds       */
+#define SYNC_ROLL           (30000UL * TA3_PERIOD) /* anchor moved after 300 s */
+#define SYNC_SEC_DIGIT      (10)    /* text field "ssssssssss.uuuuuu", u4 */
+#define SYNC_US_DIGIT       (6)
+#define US_PER_SEC          (1000000L)
+/* Command line */
+#define CMD_LINE_MAX        (32)
+/* Interrupt priority level */
+#define IPL_UART_RX         (4)
+#define IPL_TICK            (3)
+#define IPL_ADC             (2)
+#define IPL_UART_TX         (1)
+#define IPL_DMA_TX          (5)     /* rearms DMA0 within one character   */
+/* Critical section for data shared with interrupt */
+#define ENTER_CRITICAL      _asm("FCLR I")
+#define EXIT_CRITICAL       _asm("FSET I")
+/* Sample latency trace stage */
+#define TRACE_ADC           (0)     /* A/D sweep complete (ad_isr)        */
+#define TRACE_CONV          (1)     /* temperature converted              */
+#define TRACE_FMT           (2)     /* strings formatted                  */
+#define TRACE_ENQ           (3)     /* line queued for transmission       */
+#define TRACE_SENT          (4)     /* last byte shifted out              */
+#define TRACE_STAGE_MAX     (5)
+#define TRACE_DIST_MAX      (TRACE_STAGE_MAX) /* 4 stages + end to end    */
+#define TRACE_DEPTH         (4)     /* samples in flight (power of 2)     */
+#define TRACE_MASK          (TRACE_DEPTH - 1)
+#define TRACE_BIN_MAX       (20)    /* log2 bins of ta3 counts            */
+#define TRACE_REPORT_SAMPLE (100)
+/* Burst capture : channels AN0.. (BURST_CH), raw 8 bit codes */
+#define BURST_BUF_SIZE      (1024)
+#define BURST_FRAME_MAX     (BURST_BUF_SIZE / BURST_CH)
+#define BURST_PRE_DEFAULT   (256)   /* frames kept before the trigger     */
+#define BURST_POST_DEFAULT  (512)   /* frames captured after the trigger  */
+#define BURST_LEVEL_DEFAULT (128)   /* raw code of AN0                    */
+#define BURST_EDGE_RISE     (0)
+#define BURST_EDGE_FALL     (1)
+#define BURST_TIMEOUT       (1000UL * TA3_PERIOD) /* 10 s, then forced    */
+/* Code histogram : one-shot conversions of one channel, one counter per code */
+#define HIST_MS_DEFAULT     (1000)  /* window                             */
+#define HIST_MS_MAX         (60000)
+#define HIST_POLL_MASK      (0xFF)  /* time stamp read every 256 conversions */
+#define HIST_SAT            (0x01)  /* 'H' flags : a counter saturated    */
+#if (HIST_CNT_BITS == 16)
+#define HIST_CNT_MAX        (U2_MAX)
+#else
+#define HIST_CNT_MAX        (0xFFFFFFFFUL)
+#endif
+/*
+ * STOP / RUN : CAL SAVE and BURST block interrupts for up to 0.3 s and a
+ * capture, they are accepted only while the stream is stopped
+ */
+#define APP_STOP_ON         ((CFG_CMD != 0) && ((CFG_CAL != 0) || (CFG_BURST != 0)))
+#if (CFG_BURST != 0) || (CFG_HIST != 0) || APP_STOP_ON
+#define APP_MODE_NOW        (u1_app_mode)
+#else
+#define APP_MODE_NOW        (APP_MODE_STREAM)
+#endif
+/* Binary frame */
+#define FRAME_SYNC0         (0xA5)
+#define FRAME_SYNC1         (0x5A)
+#define FRAME_TYPE_BURST    ('B')
+#define FRAME_TYPE_SAMPLE   ('S')
+#define FRAME_TYPE_LOG      ('L')
+#define FRAME_TYPE_STATS    ('W')
+#define FRAME_TYPE_HIST     ('H')
+#define FRAME_TYPE_ALARM    ('A')
+#define FRAME_TYPE_SYNC     ('Y')   /* 'S' with the host time of the sweep */
+#define FRAME_TYPE_RATE     ('R')   /* sample period changed by ADAPT      */
+#define FRAME_ON            (CFG_BIN_ON || (CFG_LOG != 0) || (CFG_BURST != 0))
+#if STRIPE_ON
+#define FRAME_OUT(c)        ((u1_frame_link == STRIPE_U1) ? uart_putc(c) : stripe_putc(u1_frame_link, (c)))
+#else
+#define FRAME_OUT(c)        (uart_putc(c))
+#endif
+/* Sample log : RAM ring of 4 byte records, one per channel and sample */
+#define LOG_MASK            (LOG_REC_MAX - 1)
+#define LOG_CH_MASK         (0x07)  /* u1_ch bits 0-2 : channel           */
+#define LOG_LIVE            (0x80)  /* u1_ch bit 7 : sent live or dumped  */
+#define LOG_FRAME_REC       (8)     /* records per 'L' frame              */
+#define LOG_FRAME_BYTES     (3 + 1 + (LOG_FRAME_REC * 4) + 2)
+#define LOG_GAP_LEVEL       (UART_TXQ_SIZE / 2) /* sample bytes queued at sample time */
+/* Filter stage between A/D and conversion, integer only, per channel */
+#define FILT_NONE           (0)
+#define FILT_AVG            (1)     /* moving average of 2^n samples      */
+#define FILT_MED            (2)     /* median of 3 or 5 samples           */
+#define FILT_IIR            (3)     /* y += (x - y) / 2^k                 */
+#define FILT_HIST_SIZE      (16)    /* sample history, largest window     */
+#define FILT_HIST_MASK      (FILT_HIST_SIZE - 1)
+#define FILT_AVG_SHIFT_MAX  (4)     /* window 16                          */
+#define FILT_IIR_SHIFT_MAX  (6)
+#define FILT_IIR_FRAC       (8)     /* fraction bits, 255 << 8 fits in u2 */
+#define FILT_COST_RUN       (64)    /* samples timed by the FILT command  */
+/* Adaptive sample period */
+#define ADAPT_QUIET         (8)     /* quiet samples before backing off   */
+#define ADAPT_LSB           (1)     /* code change taken as quantization  */
+#define ADAPT_TICK_PER_S    (1000 / TICK_MS)
+/* Sliding window statistics of the last STATS_WIN samples, per channel */
+#define STATS_MASK          (STATS_WIN - 1)
+#if (CFG_STATS != 0) && !CONV_ON
+#error "CFG_STATS works on temperatures, it needs text output or a deadband"
+#endif
+/* Stack high-water mark : free user stack painted at reset, MEM scans it */
+#define STACK_PAINT         (0xA5)
+#define STACK_PAINT_SIZE    (STACK_SIZE - STACK_TOP_USE - STACK_GUARD)
+/* Calibration, T' = T * gain / CAL_GAIN_ONE + offset, record in data flash */
+#define CAL_GAIN_SHIFT      (14)
+#define CAL_GAIN_ONE        (1U << CAL_GAIN_SHIFT)
+#define CAL_GAIN_HALF       (1L << (CAL_GAIN_SHIFT - 1))
+#define CAL_GAIN_MIN        (CAL_GAIN_ONE / 2)  /* 0.5                    */
+#define CAL_GAIN_MAX        (CAL_GAIN_ONE * 2 - 1) /* < 2.0, T * gain < 2^31 */
+#define CAL_GAIN_UNIT       (10000) /* command gain unit, 10000 = 1.0     */
+#define CAL_OFFSET_MAX      (5000)  /* table unit                         */
+#define CAL_MAGIC           (0xCA1B)
+#define CAL_SUM_INIT        (0x5A5A)
+#define CAL_REC_WORDS       (sizeof(CAL_REC) / sizeof(u2))
+#define CAL_REC_MAX         (DFLASH_WORDS / CAL_REC_WORDS) /* saves per erase */
+/* Data flash block A (0F000h - 0FFFFh), EW1 mode commands */
+#define DFLASH_WORDS        (2048)
+#define DFLASH_CMD_PROGRAM  (0x40)
+#define DFLASH_CMD_ERASE    (0x20)
+#define DFLASH_CMD_CONFIRM  (0xD0)
+#define DFLASH_CMD_CLEAR    (0x50)
+#define DFLASH_CMD_READ     (0xFF)
+#ifndef DFLASH_RD
+#define DFLASH_RD(i)        (((volatile u2*)0x0F000)[i])
+#define DFLASH_WR(i, d)     (((volatile u2*)0x0F000)[i] = (d))
+#endif
+/* Compare and swap of the median sorting network */
+#define FILT_CSWAP(a, b)                         \
+	do                                           \
+	{                                            \
+		if ((a) > (b))                           \
+		{                                        \
+			u1 u1_t = (a);                       \
+			(a) = (b);                           \
+			(b) = u1_t;                          \
+		}                                        \
+	} while (0)
+/* Raw time stamp, two reads of ta4 and one of ta3 (no call, no multiply) */
+#define TRACE_STAMP(rec, stage)                  \
+	do                                           \
+	{                                            \
+		(rec).u2_hi[stage] = ta4;                \
+		(rec).u2_lo[stage] = ta3;                \
+	} while ((rec).u2_hi[stage] != ta4)
 
 /**
- * Global Variable Definition
- * Constant data for ftoa fucntion
- */
-static const double rounders[MAX_PRECISION + 1] = {
-	0.5,          /* 0 */
-	0.05,         /* 1 */
-	0.005,        /* 2 */
-	0.0005,       /* 3 */
-	0.00005,      /* 4 */
-	0.000005,     /* 5 */
-	0.0000005,    /* 6 */
-	0.00000005,   /* 7 */
-	0.000000005,  /* 8 */
-	0.0000000005, /* 9 */
-	0.00000000005 /* 10 */
-};
+ * Trace record of one sample, raw ta4/ta3 pair per stage
+ */
+typedef struct
+{
+	u2 u2_hi[TRACE_STAGE_MAX];
+	u2 u2_lo[TRACE_STAGE_MAX];
+	u2 u2_tx_last;                  /* ordinal of the last byte of the line */
+} TRACE_REC;
+
+/**
+ * Text output line template, numeric fields patched in place
+ */
+typedef struct
+{
+	char s1_line[OUT_LINE_MAX];
+	u1   u1_len;                    /* line length including '\n'         */
+	u1   u1_temp_pos[ADC_CH_MAX];   /* field offset of each channel       */
+	u1   u1_temp_width;
+	u1   u1_time_pos;
+	u1   u1_time_width;
+	u1   u1_sync_pos;               /* 0 : no host time field             */
+	u1   u1_gen;                    /* changed by every out_line_build    */
+} OUT_LINE;
+
+/**
+ * Run time setting, changed by command
+ */
+typedef struct
+{
+	u1 u1_sample_tick;              /* sample period in ticks             */
+	u1 u1_ch_mask;                  /* bit n : ANn is output              */
+	u1 u1_format;                   /* OUT_FMT_TEXT / OUT_FMT_BIN         */
+	s2 s2_precision;                /* decimals of text output            */
+	s4 s4_deadband;                 /* table unit, 0 : output every sample*/
+	u4 u4_baud;                     /* UART1 requested bit rate           */
+	u4 u4_baud_real;                /* UART1 bit rate after u1brg rounding*/
+	u1 u1_stats_every;              /* samples per statistics record, 0 : */
+	                                /* every sample is output             */
+} RUN_CFG;
+
+/**
+ * Filter of one channel, state primed with the first sample
+ */
+typedef struct
+{
+	u1   u1_type;                   /* FILT_NONE / AVG / MED / IIR        */
+	u1   u1_param;                  /* AVG shift, MED length, IIR shift   */
+	BOOL b_primed;                  /* history holds a sample             */
+	u1   u1_pos;                    /* next history slot                  */
+	u2   u2_sum;                    /* AVG : sum of the window            */
+	u2   u2_iir;                    /* IIR : output << FILT_IIR_FRAC      */
+	u1   u1_hist[FILT_HIST_SIZE];
+} FILT_CH;
+
+/**
+ * Sample log record
+ */
+typedef struct
+{
+	u2 u2_tick;                     /* ta4 at the A/D sweep, 10 ms        */
+	u1 u1_ch;                       /* channel | LOG_LIVE                 */
+	u1 u1_code;                     /* A/D code after the filter          */
+} LOG_REC;
+
+/**
+ * Sample log ring, indices free running
+ */
+typedef struct
+{
+	u2   u2_head;                   /* next record written                */
+	u2   u2_fill;                   /* records held                       */
+	u2   u2_unsent;                 /* records held without LOG_LIVE      */
+	u2   u2_dump;                   /* next record looked at by the dump  */
+	u2   u2_dump_end;
+	BOOL b_dump;                    /* dump in progress                   */
+	BOOL b_dump_all;                /* 1 : LOG command, 0 : gap backfill  */
+	BOOL b_gap;                     /* live output skipped since the dump */
+	u2   u2_gap_from;               /* first record of the gap            */
+	u2   u2_tx_mark;                /* u2_tx_queued after the last sample */
+	u4   u4_skip;                   /* samples not sent live              */
+	u4   u4_lost;                   /* records overwritten unsent         */
+} LOG_CTRL;
+
+/**
+ * Adaptive sample period setting and statistic
+ */
+typedef struct
+{
+	BOOL b_on;
+	BOOL b_primed;                  /* u1_code_ref holds a sample         */
+	u1   u1_tick_min;               /* shortest period, ticks             */
+	u1   u1_tick_max;               /* longest period, ticks              */
+	u1   u1_level;                  /* codes per second                   */
+	u1   u1_quiet;                  /* quiet samples since the reference  */
+	u2   u2_ref_tick;               /* ticks since the reference          */
+	u1   u1_code_ref[ADC_CH_MAX];   /* reference code of each channel     */
+	u2   u2_up;                     /* changes to the shortest period     */
+	u2   u2_down;                   /* period doublings                   */
+	u4   u4_samples;                /* samples since adapt_set            */
+	u4   u4_ticks;                  /* sum of their periods               */
+} ADAPT_CTRL;
+
+/**
+ * Sliding window statistics, running sums of one channel
+ */
+typedef struct
+{
+	s4 s4_win[STATS_WIN];           /* samples, st_stats.u1_pos oldest    */
+	s4 s4_sum;                      /* sum(y)                             */
+	s8 s8_sum_iy;                   /* sum(i * y), i = 0 oldest           */
+	u8 u8_sum_yy;                   /* sum(y * y)                         */
+} STATS_CH;
+
+typedef struct
+{
+	STATS_CH st_ch[ADC_CH_MAX];
+	u1 u1_pos;                      /* next slot, oldest when full        */
+	u1 u1_n;                        /* samples in the window              */
+	u1 u1_cnt;                      /* samples since the last record      */
+} STATS_CTRL;
+
+/**
+ * Calibration record, appended to data flash block A on every save
+ */
+typedef struct
+{
+	u2 u2_magic;                    /* CAL_MAGIC, programmed first        */
+	u2 u2_seq;                      /* save count                         */
+	s2 s2_offset[ADC_CH_MAX];       /* table unit, added after the gain   */
+	u2 u2_gain[ADC_CH_MAX];         /* CAL_GAIN_ONE = 1.0                 */
+	u2 u2_rsv;
+	u2 u2_sum;                      /* cal_sum(), programmed last         */
+} CAL_REC;
+
+/**
+ * Burst capture setting and result
+ */
+typedef struct
+{
+	u2 u2_pre;                      /* frames before the trigger frame    */
+	u2 u2_post;                     /* frames after the trigger frame     */
+	u1 u1_level;                    /* trigger level, raw code of AN0     */
+	u1 u1_edge;                     /* BURST_EDGE_RISE / BURST_EDGE_FALL  */
+	u2 u2_trig;                     /* ring index of the trigger frame    */
+	u2 u2_frames;                   /* frames converted                   */
+	u4 u4_elapsed;                  /* ta3 counts for u2_frames           */
+	BOOL b_forced;                  /* no trigger before BURST_TIMEOUT    */
+} BURST_CTRL;
+
+/**
+ * Code histogram setting and counters, saturating
+ */
+#if (HIST_CNT_BITS == 16)
+typedef u2 HIST_CNT;
+#else
+typedef u4 HIST_CNT;
+#endif
+
+typedef struct
+{
+	HIST_CNT u_bin[TABLE_MAX];      /* conversions of each code           */
+	u4   u4_window;                 /* ta3 counts per histogram           */
+	u4   u4_samples;                /* conversions of the last window     */
+	u4   u4_elapsed;                /* ta3 counts of the last window      */
+	u1   u1_ch;                     /* ANn converted                      */
+	u1   u1_seq;                    /* windows sent                       */
+	BOOL b_sat;                     /* a counter reached HIST_CNT_MAX     */
+} HIST_CTRL;
+
+/**
+ * Threshold alarm setting, state and latency, queued to last byte taken
+ */
+typedef struct
+{
+	s4   s4_lo[ADC_CH_MAX];         /* table unit                         */
+	s4   s4_hi[ADC_CH_MAX];
+	u1   u1_on;                     /* bit n : ANn checked                */
+	u1   u1_state[ADC_CH_MAX];      /* ALARM_NONE / HIGH / LOW            */
+	u1   u1_seq;                    /* messages queued                    */
+	u2   u2_timed;                  /* latencies measured                 */
+	u4   u4_lat_sum;                /* ta3 counts                         */
+	u4   u4_lat_max;
+} ALARM_CTRL;
+
+/**
+ * Host time sync : anchor, rate and ping statistic
+ */
+typedef struct
+{
+	u4   u4_loc;                    /* anchor, hal_time_stamp             */
+	u4   u4_sec;                    /* anchor, host time                  */
+	u4   u4_us;                     /* 0 to 999999                        */
+	u4   u4_rate;                   /* us per ta3 count, 2^-32 unit       */
+	u4   u4_ping_loc;               /* rate fit base ping, as received    */
+	u4   u4_ping_sec;
+	u4   u4_ping_us;
+	s4   s4_err;                    /* last ping - prediction, us         */
+	u4   u4_err_max;                /* largest, steps excluded            */
+	u2   u2_pings;
+	u2   u2_fits;                   /* rate updates                       */
+	u2   u2_steps;                  /* anchored on the ping               */
+	u2   u2_stale;                  /* line start not known, ignored      */
+	BOOL b_lock;                    /* a ping was taken                   */
+} SYNC_CTRL;
+
+/**
+ * Striped output : transmit queue of UART2 or UART0
+ */
+typedef struct
+{
+	volatile char s1_q[STRIPE_Q_SIZE];
+	volatile u1   u1_head;
+	volatile u1   u1_tail;
+	volatile BOOL b_busy;           /* byte in UiTB or shifting           */
+	BOOL          b_init;           /* UART set up by stripe_set          */
+} STRIPE_LINK;
+
+/**
+ * Latency distribution of one stage
+ */
+typedef struct
+{
+	u2 u2_bin[TRACE_BIN_MAX];       /* bin n : 2^(n-1) <= counts < 2^n    */
+	u4 u4_sum;
+	u4 u4_max;
+} TRACE_DIST;
+
+/**
+ * Sample record, owned by one stage at a time : ad_isr fills the codes,
+ * main converts and formats, the transmitter sends the line
+ */
+typedef struct
+{
+	u2   u2_adc_hi;                 /* ta4/ta3 at the A/D sweep           */
+	u2   u2_adc_lo;
+	u1   u1_code[ADC_CH_MAX];       /* A/D code, filtered in place        */
+#if (CFG_CMD != 0)
+	u1   u1_mask;                   /* RUN_CH_MASK at the sweep           */
+#endif
+#if CFG_TEXT_ON
+	u1   u1_len;                    /* bytes of s1_line to send           */
+	u1   u1_gen;                    /* st_out_line.u1_gen copied in       */
+	u2   u2_mark;                   /* u2_tx_queued before the line       */
+	char s1_line[OUT_LINE_MAX];
+#endif
+} POOL_REC;
+
+/**
+ * Record index queue, single producer and single consumer : the head is
+ * written by the producer only, the tail by the consumer only
+ */
+typedef struct
+{
+	volatile u1 u1_head;            /* free running                       */
+	volatile u1 u1_tail;            /* free running                       */
+	volatile u1 u1_idx[POOL_REC_MAX];
+} POOL_Q;
+
+#if (CFG_MEM != 0)
+/**
+ * RAM of one subsystem, MEM report
+ */
+typedef struct
+{
+	const char* s1_name;
+	u2 u2_bytes;
+} RAM_USE;
+#endif
+
+#if CONV_ON && (CFG_CONV == CFG_CONV_TABLE)
 /**
  * Global Variable Definition
  * Temperature data mapping table
@@ -103,23 +579,450 @@ const s4 adc_table[TABLE_MAX] = {
      42059,  42255,  42451,  42647,  42843,  43039,  43235,  43431,  43627,  43824,
      44020,  44216,  44412,  44608,  44804,  45000
 };
+#endif
+
+/**
+ * Global Variable Definition
+ * Scheduler and power statistic, shared with interrupt
+ */
+static volatile u1   u1_tick_cnt     = 0;
+#if (CFG_POOL == 0)
+static volatile BOOL b_adc_done      = 0;
+#endif
+static volatile BOOL b_sleeping      = 0;
+static volatile BOOL b_wake          = 0; /* set by every interrupt      */
+static volatile u2   u2_wake_lat_max = 0; /* ta3 counts from tick to ISR */
+static u4            u4_sleep_cnt    = 0; /* ta3 counts spent in WAIT    */
+static u4            u4_tick_stamp   = 0;
+static u4            u4_tock_stamp   = 0;
+/**
+ * Global Variable Definition
+ * Startup time, ta3 counts from hal_timer_init
+ */
+static BOOL          b_boot_done     = 0;
+static u4            u4_boot_adc     = 0; /* first A/D sweep complete  */
+static u4            u4_boot_out     = 0; /* first sample handled      */
+/**
+ * Global Variable Definition
+ * Run time setting and counter
+ */
+static u4            u4_sample_cnt   = 0; /* samples converted         */
+static u4            u4_out_cnt      = 0; /* samples output            */
+#if (CFG_CMD != 0)
+static RUN_CFG       st_cfg          = {
+	SAMPLE_PERIOD_TICK, CFG_CH_MASK, CFG_FMT, OUT_PREC_DEFAULT, CFG_DEADBAND, 0, 0, CFG_STATS_EVERY
+};
+static u2            u2_cmd_err      = 0; /* rejected command lines    */
+#if (CFG_SYNC != 0)
+static u1            u1_cmd_starts   = 0; /* lines started, cmd_poll    */
+#endif
+#endif
+#if CFG_DB_ON
+static u4            u4_suppress_cnt = 0; /* samples inside deadband   */
+static s4            s4_last_out[ADC_CH_MAX];
+#endif
+#if CFG_TEXT_ON
+static OUT_LINE      st_out_line;
+#endif
+#if (CFG_FILT != 0)
+static FILT_CH       st_filt[ADC_CH_MAX]; /* FILT_NONE at reset        */
+#endif
+#if (CFG_CAL != 0)
+static CAL_REC       st_cal;              /* cal_load at start         */
+static u2            u2_cal_next     = 0; /* free record slot in flash */
+#endif
+#if (CFG_LOG != 0)
+static LOG_REC       st_log_rec[LOG_REC_MAX];
+static LOG_CTRL      st_log;
+#endif
+#if (CFG_ADAPT != 0)
+static ADAPT_CTRL    st_adapt;
+#endif
+#if (CFG_STATS != 0)
+static STATS_CTRL    st_stats;
+#endif
+#if FRAME_ON
+/**
+ * Global Variable Definition
+ * Checksum of the binary frame being sent
+ */
+static u1            u1_frame_sum0   = 0;
+static u1            u1_frame_sum1   = 0;
+#endif
+
+#if (CFG_CMD != 0)
+/**
+ * Global Variable Definition
+ * UART1 receive queue, head written by interrupt, tail written by main
+ */
+static volatile char s1_rxq[UART_RXQ_SIZE];
+static volatile u1   u1_rxq_head     = 0;
+static volatile u1   u1_rxq_tail     = 0;
+static volatile u2   u2_rx_err       = 0; /* framing / parity / overrun */
+static volatile u2   u2_rx_drop      = 0; /* receive queue full         */
+#if (CFG_SYNC != 0)
+static volatile u4   u4_rx_start     = 0; /* stamp of the latest line start */
+static volatile u1   u1_rx_starts    = 0; /* lines started in s1_rxq     */
+static volatile BOOL b_rx_eol        = 1; /* last byte queued ended a line */
+#endif
+#endif
+/**
+ * Global Variable Definition
+ * UART1 transmit queue, head written by main, tail written by interrupt
+ */
+static volatile char s1_txq[UART_TXQ_SIZE];
+static volatile u1   u1_txq_head     = 0;
+static volatile u1   u1_txq_tail     = 0;
+static volatile BOOL b_tx_busy       = 0;
+static volatile u1   u1_tx_inflight  = 0; /* bytes in u1tb and shift register */
+static volatile u2   u2_tx_queued    = 0; /* bytes given to uart_putc         */
+static volatile u2   u2_tx_sent      = 0; /* bytes completely shifted out     */
+static volatile u2   u2_tx_taken     = 0; /* bytes taken by the transmitter   */
+#if (CFG_TX == CFG_TX_DMA)
+static volatile u1   u1_tx_dma       = 0; /* queued bytes handed to DMA0      */
+#endif
+#if URG_ON
+/*
+ * UART1 urgent lane : main writes whole messages, the transmitter takes
+ * them once the queue and records are taken up to the end of a line or frame
+ */
+static volatile char s1_urgq[UART_URGQ_SIZE];
+static volatile u1   u1_urgq_head    = 0;
+static volatile u1   u1_urgq_tail    = 0;
+static u2            u2_urg_queued   = 0; /* bytes given to urg_write        */
+static volatile u2   u2_urg_taken    = 0; /* bytes taken by the transmitter   */
+static volatile u1   u1_txq_end[UART_TXQ_SIZE / 8]; /* bit : a unit ends at the byte */
+static volatile BOOL b_tx_bound      = 1; /* last byte taken ended a unit     */
+static volatile BOOL b_tx_urg        = 0; /* tx_run found an urgent run       */
+static BOOL          b_frame_open    = 0; /* frame_begin to frame_end         */
+static BOOL          b_frame_last    = 0; /* uart_putc of the last frame byte */
+#endif
+#if (CFG_POOL != 0)
+/**
+ * Global Variable Definition
+ * Sample record pool and its queues :
+ *   free : main -> ad_isr, acq : ad_isr -> main,
+ *   tx : main -> transmitter, done : transmitter -> main
+ */
+static POOL_REC      st_pool_rec[POOL_REC_MAX];
+static POOL_Q        st_pool_free;
+static POOL_Q        st_pool_acq;
+static volatile u2   u2_pool_drop    = 0; /* sweeps lost, no free record     */
+static volatile u1   u1_pool_low     = POOL_REC_MAX; /* fewest free records  */
+#if (CFG_CMD != 0)
+static u2            u2_pool_stale   = 0; /* sweeps before a CH change    */
+#endif
+#if POOL_TX_ON
+static POOL_Q        st_pool_tx;
+static POOL_Q        st_pool_done;
+static volatile u1   u1_tx_rec       = POOL_NONE; /* record being sent       */
+static volatile u1   u1_tx_pos       = 0; /* its next byte                   */
+#endif
+#endif
+/**
+ * Global Variable Definition
+ * Sample latency trace, record ring written by main (wr, done) and
+ * uart1_tx_isr (sent)
+ */
+static TRACE_REC     st_trace_adc;        /* stamped by ad_isr               */
+#if (CFG_REPORT != 0)
+static TRACE_REC     st_trace_rec[TRACE_DEPTH];
+static volatile u1   u1_trace_wr     = 0;
+static volatile u1   u1_trace_sent   = 0;
+static u1            u1_trace_done   = 0;
+static u2            u2_trace_drop   = 0;
+static u2            u2_trace_cnt    = 0;
+static u2            u2_trace_cost   = 0; /* ta3 counts of one TRACE_STAMP   */
+static u4            u4_tx_irq       = 0; /* transmit interrupts             */
+static u4            u4_tx_cost      = 0; /* ta3 counts spent in them        */
+static TRACE_DIST    st_trace_dist[TRACE_DIST_MAX];
+static const char* const trace_name[TRACE_DIST_MAX] = {
+	"ADC>conv",
+	"conv>fmt",
+	"fmt>enq",
+	"enq>sent",
+	"ADC>sent"
+};
+#endif
+#if (CFG_ALARM != 0)
+static ALARM_CTRL    st_alarm;
+static volatile BOOL b_alarm_wait    = 0; /* message being timed             */
+static u4            u4_alarm_t0     = 0; /* its time stamp when queued      */
+static u2            u2_alarm_end    = 0; /* lane count after its last byte  */
+#endif
+#if (CFG_SYNC != 0)
+static SYNC_CTRL     st_sync         = {
+	0, 0, 0, SYNC_RATE_NOM, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+#endif
+#if STRIPE_ON
+static STRIPE_LINK   st_stripe[CFG_STRIPE - 1]; /* UART2, UART0           */
+static u1            u1_stripe_n     = 1; /* links in use, STRIPE n      */
+static u1            u1_stripe_next  = STRIPE_U1; /* first tried on a tie */
+static u1            u1_frame_link   = STRIPE_U1; /* link of the open frame */
+static u1            u1_stripe_last  = STRIPE_U1; /* link of this sample's frame */
+static u4            u4_stripe_frames[CFG_STRIPE];
+#endif
+#if (CFG_BURST != 0) || (CFG_HIST != 0) || APP_STOP_ON
+/**
+ * Global Variable Definition
+ * Application mode, burst capture ring and code histogram
+ */
+static volatile u1   u1_app_mode     = APP_MODE_DEFAULT;
+#endif
+#if (CFG_HIST != 0)
+static HIST_CTRL     st_hist         = {
+	{ 0 }, (u4)HIST_MS_DEFAULT * (TA3_PERIOD / TICK_MS), 0, 0, 0, 0, 0
+};
+#endif
+#if (CFG_BURST != 0)
+static u1            u1_burst_buf[BURST_BUF_SIZE];
+static BURST_CTRL    st_burst        = {
+	BURST_PRE_DEFAULT, BURST_POST_DEFAULT, BURST_LEVEL_DEFAULT, BURST_EDGE_RISE, 0, 0, 0, 0
+};
+#endif
+#if (CFG_MEM != 0)
+/**
+ * Global Variable Definition
+ * Painted stack range and RAM buffers of each subsystem (static size)
+ */
+static volatile u1*  pu1_stack_low   = 0; /* lowest painted byte             */
+static volatile u1* volatile pu1_stack_mark = 0; /* main frame, depth 0 */
+static const RAM_USE st_ram_use[] = {
+	{ "txq",   sizeof(s1_txq) },
+#if URG_ON
+	{ "urgq",  sizeof(s1_urgq) + sizeof(u1_txq_end) },
+#endif
+#if (CFG_POOL != 0)
+	{ "pool",  sizeof(st_pool_rec) + (sizeof(POOL_Q) * (2 + (2 * POOL_TX_ON))) },
+#endif
+	{ "rxq",   sizeof(s1_rxq) },
+	{ "cmd",   CMD_LINE_MAX },
+#if CFG_TEXT_ON
+	{ "out",   sizeof(st_out_line) },
+#endif
+#if (CFG_FILT != 0)
+	{ "filt",  sizeof(st_filt) },
+#endif
+#if (CFG_CAL != 0)
+	{ "cal",   sizeof(st_cal) },
+#endif
+#if (CFG_LOG != 0)
+	{ "log",   sizeof(st_log_rec) + sizeof(st_log) },
+#endif
+#if (CFG_ADAPT != 0)
+	{ "adapt", sizeof(st_adapt) },
+#endif
+#if (CFG_STATS != 0)
+	{ "stats", sizeof(st_stats) },
+#endif
+#if (CFG_REPORT != 0)
+	{ "trace", sizeof(st_trace_rec) + sizeof(st_trace_dist) },
+#endif
+#if (CFG_BURST != 0)
+	{ "burst", sizeof(u1_burst_buf) + sizeof(st_burst) },
+#endif
+#if (CFG_HIST != 0)
+	{ "hist",  sizeof(st_hist) },
+#endif
+#if (CFG_ALARM != 0)
+	{ "alarm", sizeof(st_alarm) },
+#endif
+#if (CFG_SYNC != 0)
+	{ "sync",  sizeof(st_sync) },
+#endif
+#if STRIPE_ON
+	{ "stripe", sizeof(st_stripe) },
+#endif
+};
+#endif
 
 /**
  * fucntion prototype declaration
  */
-static void init_hw(void);
-static void init_adc(void);
-static u2 adc_read(u1 ch);
-static void init_timers(void);
 static void time_tick(void);
 static void time_tock(void);
+#if CFG_TEXT_ON
 static u8 read_time(void);
+#endif
 static void init_uart(void);
 static void uart_putc(const char s1_c);
+#if CFG_TEXT_ON
 static void uart_puts(const char* s1_s);
-static f8 read_temp(u4 u4_val);
-char*  ftoa(f8 f8_f, char* buf, s2 s2_precision);
-static s4 s2g_glmap1b_s2pt(s2 X, const s4* MAP);
+#endif
+#if CFG_TEXT_ON && !POOL_TX_ON
+static void uart_write(const char* s1_buf, u2 u2_len);
+#endif
+static u1 tx_run(const volatile char** pps1_src, u1 u1_max);
+static void tx_done(u1 u1_n);
+#if (CFG_TX != CFG_TX_DMA) && CFG_TEXT_ON
+static void tx_start(void);
+#endif
+#if URG_ON
+static void urg_write(const char* s1_buf, u1 u1_len);
+#endif
+#if (CFG_POOL != 0)
+static void pool_init(void);
+static BOOL pool_q_put(POOL_Q* pst_q, u1 u1_rec);
+static BOOL pool_q_get(POOL_Q* pst_q, u1* pu1_rec);
+#if POOL_TX_ON
+static void pool_recycle(void);
+static void pool_send(u1 u1_rec);
+#endif
+#endif
+#if (CFG_FILT != 0)
+static u1 filt_apply(FILT_CH* pst_f, u1 u1_x);
+static u1 filt_median(const FILT_CH* pst_f);
+static void filt_set(FILT_CH* pst_f, u1 u1_type, u1 u1_param);
+static u4 filt_cost(u1 u1_type, u1 u1_param);
+#endif
+#if (CFG_LOG != 0)
+static BOOL log_link_busy(void);
+static void log_write(u2 u2_tick, const u1* pu1_code, BOOL b_live);
+static void log_dump(BOOL b_all, u2 u2_from);
+static void log_service(void);
+#endif
+#if (CFG_ADAPT != 0)
+static void adapt_update(const u1* pu1_code);
+static void adapt_set(u1 u1_tick_min, u1 u1_tick_max, u1 u1_level);
+#endif
+#if (CFG_STATS != 0)
+#if (CFG_CMD != 0)
+static void stats_reset(void);
+#endif
+static BOOL stats_update(const s4* ps4_temp);
+static void stats_calc(u1 u1_ch, u1 u1_frac, s4* ps4_out);
+static u4 stats_isqrt(u8 u8_x);
+static void stats_record(TRACE_REC* pst_trace);
+#if CFG_TEXT_ON
+static void stats_put(const char* s1_label, u1 u1_ch, s4 s4_val);
+#endif
+#endif
+#if (CFG_CAL != 0)
+static void cal_load(void);
+static u2 cal_sum(const CAL_REC* pst_rec);
+#if CONV_ON
+static s4 cal_apply(u1 u1_ch, s4 s4_temp);
+#endif
+#if (CFG_CMD != 0)
+static BOOL cal_save(void);
+static void dflash_mode(BOOL b_rewrite);
+static BOOL dflash_program(u2 u2_idx, u2 u2_data);
+static BOOL dflash_erase(void);
+#endif
+#endif
+static void cpu_idle(void);
+#if (CFG_MEM != 0)
+static void stack_paint(volatile u1* pu1_mark);
+static u2 stack_scan(void);
+static void mem_report(void);
+#endif
+static TRACE_REC* trace_begin(void);
+static void trace_commit(TRACE_REC* pst_rec);
+#if (CFG_TX == CFG_TX_DMA)
+static void tx_dma_start(void);
+static void tx_dma_arm(void);
+#endif
+#if (CFG_REPORT != 0)
+static void trace_sent(void);
+static void tx_cost(u4 u4_start);
+static void power_report(void);
+static void trace_init(void);
+static void trace_collect(void);
+static void trace_report(void);
+#endif
+#if (CFG_BURST != 0)
+static void burst_capture(void);
+static void burst_dump(void);
+#endif
+#if (CFG_HIST != 0)
+static void hist_capture(void);
+static void hist_dump(void);
+#endif
+#if (CFG_SYNC != 0)
+static void sync_ping(u4 u4_sec, u4 u4_us, u4 u4_loc);
+static void sync_at(u4 u4_loc, u4* pu4_sec, u4* pu4_us);
+#if CFG_TEXT_ON
+static void sync_field(char* s1_dst, u4 u4_loc);
+#endif
+#endif
+#if (CFG_ALARM != 0)
+static void alarm_check(const s4* ps4_temp);
+static void alarm_send(u1 u1_ch, u1 u1_state, s4 s4_temp);
+static void alarm_taken(u2 u2_taken);
+#endif
+#if CFG_DB_ON
+static BOOL out_deadband(const s4* ps4_temp);
+#endif
+#if CFG_TEXT_ON
+static void out_line_build(void);
+static void out_line_text(const char* s1_s);
+static void out_field(char* s1_dst, u1 u1_width, s4 s4_val, u1 u1_frac);
+static void out_line_fill(char* s1_line, const s4* ps4_temp, u8 u8_pro_time);
+#if !POOL_TX_ON
+static void out_text(const s4* ps4_temp, u8 u8_pro_time, TRACE_REC* pst_trace);
+#endif
+#if POOL_TX_ON
+static void out_text_rec(u1 u1_rec, const s4* ps4_temp, u8 u8_pro_time, TRACE_REC* pst_trace);
+#endif
+#endif
+#if CFG_BIN_ON
+static void out_frame(const u1* pu1_code, TRACE_REC* pst_trace);
+#endif
+#if FRAME_ON
+static void frame_begin(u1 u1_type);
+static void frame_put(u1 u1_data);
+static void frame_end(void);
+#endif
+#if STRIPE_ON
+static void stripe_set(u1 u1_n);
+static u1 stripe_pick(u2* pu2_pend);
+static void stripe_putc(u1 u1_link, const char s1_c);
+static void stripe_tx(u1 u1_link);
+#endif
+static BOOL uart_set_baud(u4 u4_baud);
+#if (CFG_CMD != 0)
+static void cmd_poll(void);
+static void cmd_exec(char* s1_line);
+static BOOL cmd_word(char** pps1_s, const char* s1_word);
+static BOOL cmd_num(char** pps1_s, s4* ps4_val);
+#if (CFG_SYNC != 0)
+static BOOL cmd_unum(char** pps1_s, u4* pu4_val);
+#endif
+static void cmd_stat(void);
+#endif
+#if (CFG_CMD != 0) || (CFG_STATS != 0) || ((CFG_HIST != 0) && CFG_TEXT_ON)
+static void uart_put_num(const char* s1_label, u4 u4_val);
+#endif
+
+/**
+ * Interrupt function declaration
+ * Vector table (sect30.inc) : DMA0 = 11 (CFG_TX_DMA), A/D = 14, UART1 transmit = 19,
+ * UART1 receive = 20 (dummy without CFG_CMD), Timer A3 = 24,
+ * UART2 transmit = 15 (CFG_STRIPE > 1), UART0 transmit = 17 (CFG_STRIPE > 2)
+ */
+#pragma INTERRUPT ta3_isr
+void ta3_isr(void);
+#pragma INTERRUPT ad_isr
+void ad_isr(void);
+#pragma INTERRUPT uart1_tx_isr
+void uart1_tx_isr(void);
+#if (CFG_TX == CFG_TX_DMA)
+#pragma INTERRUPT dma0_isr
+void dma0_isr(void);
+#endif
+#if (CFG_CMD != 0)
+#pragma INTERRUPT uart1_rx_isr
+void uart1_rx_isr(void);
+#endif
+#if STRIPE_ON
+#pragma INTERRUPT uart2_tx_isr
+void uart2_tx_isr(void);
+#endif
+#if (CFG_STRIPE > 2)
+#pragma INTERRUPT uart0_tx_isr
+void uart0_tx_isr(void);
+#endif
 
 /**
  * Main function
@@ -129,31 +1032,164 @@ void main(void)
 	/*
 	 * Local Variable Definition
 	 */
+#if CFG_TEXT_ON
 	const char program_text[] = "01 Temperature Calculation ver 00.01\n";
-	char  temp_buf[10]        = { 0 };
-	char  time_buf[10]        = { 0 };
-	u4    u4_adc_val          = 0;
-	f8    f8_temp_val         = 0.0;
-	f8    f8_pro_time         = 0.0;
-
-	init_hw();      /* Initialize hardware peripheral */
-	init_adc();     /* Initialize ADC mode.           */
-	init_timers();  /* Initialize Timer mode.         */
-	init_uart();    /* Initialize UART mode.          */
-	_asm("fset I"); /* Enable global interrupt        */
+#endif
+	u1    u1_code[ADC_CH_MAX] = { 0 };
+	u1*   pu1_code            = u1_code;
+#if (CFG_POOL != 0)
+	u1    u1_rec              = POOL_NONE;
+#endif
+#if CONV_ON
+	s4    s4_temp[ADC_CH_MAX] = { 0 };
+#endif
+	u1    u1_ch               = 0;
+	u1    u1_mask             = RUN_CH_MASK; /* channels of this sweep */
+#if CFG_TEXT_ON
+	u8    u8_pro_time         = 0;
+#endif
+	TRACE_REC* pst_trace      = 0;
+
+#if (CFG_MEM != 0)
+	stack_paint(u1_code); /* Paint free stack, before any call */
+#endif
 
 	/*
-	 * Printing program information
-	 * to serial port
+	 * Time base first, so that the startup is measured from here,
+	 * then the first A/D sweep, the rest runs while it converts
 	 */
-	uart_puts(program_text);
+	hal_timer_init(); /* Initialize Timer mode.         */
+	ta3ic = IPL_TICK; /* ta3 underflow is the scheduler tick */
+#if (CFG_POOL != 0)
+	pool_init();    /* Every record free, before ad_isr */
+#endif
+	hal_port_init(); /* Initialize hardware peripheral */
+	hal_adc_init(HAL_ADC_SINGLE_SWEEP, ADC_SWEEP); /* Single sweep, ta3_isr starts it */
+	adic = IPL_ADC; /* Conversion complete wakes up main */
+	adst = 1;       /* First sweep, not at the first sample period */
+	init_uart();    /* Initialize UART mode.          */
+#if (CFG_REPORT != 0)
+	trace_init();   /* Measure trace stamp cost.      */
+#endif
+#if (CFG_CAL != 0)
+	cal_load();     /* Load calibration from flash.   */
+#endif
+#if CFG_TEXT_ON
+	out_line_build(); /* Build output line template.  */
+#endif
+	_asm("fset I"); /* Enable global interrupt        */
 
 	while (1)
 	{
+#if (CFG_BURST != 0)
+		/*
+		 * Burst capture, ring frozen by the trigger then dumped
+		 */
+		if (u1_app_mode == APP_MODE_BURST)
+		{
+			burst_capture();
+			burst_dump();
+#if APP_STOP_ON
+			u1_app_mode = APP_MODE_STOP; /* BURST is taken stopped, RUN resumes */
+#else
+			u1_app_mode = APP_MODE_STREAM;
+#endif
+		}
+#endif
+#if APP_STOP_ON
+		/*
+		 * Stopped by STOP, commands only until RUN
+		 */
+		if (u1_app_mode == APP_MODE_STOP)
+		{
+			cmd_poll();
+#if (CFG_LOG != 0)
+			log_service();
+#endif
+			cpu_idle();
+			continue;
+		}
+#endif
+#if (CFG_HIST != 0)
+		/*
+		 * Code histogram, one window at the maximum rate then its
+		 * non-zero bins, until HIST OFF
+		 */
+		if (u1_app_mode == APP_MODE_HIST)
+		{
+			hist_capture();
+			hist_dump();
+#if (CFG_CMD != 0)
+			cmd_poll();
+#endif
+			continue;
+		}
+#endif
+
+		/*
+		 * Waiting for sample tick and A/D sweep complete,
+		 * ta3_isr starts the sweep so that sample timing
+		 * does not depend on the run mode.
+		 * Commands are served while waiting.
+		 */
+		while ((SAMPLE_READY == 0) && (APP_MODE_NOW == APP_MODE_STREAM))
+		{
+#if POOL_TX_ON
+			pool_recycle();
+#endif
+#if (CFG_CMD != 0)
+			cmd_poll();
+#endif
+#if (CFG_LOG != 0)
+			log_service();
+#endif
+			cpu_idle();
+		}
+		if (SAMPLE_READY == 0)
+		{
+			continue; /* mode changed by command */
+		}
+#if (CFG_POOL != 0)
+		/*
+		 * Taking the record ad_isr filled, the codes are used in place
+		 */
+		(void)pool_q_get(&st_pool_acq, &u1_rec);
+#if (CFG_CMD != 0)
+		/*
+		 * The record holds the channels of the mask at its sweep, one
+		 * without a channel CH added since has no code for it
+		 */
+		u1_mask = st_pool_rec[u1_rec].u1_mask;
+		if ((RUN_CH_MASK & (u1)~u1_mask) != 0)
+		{
+			(void)pool_q_put(&st_pool_free, u1_rec);
+			u1_rec = POOL_NONE;
+			u2_pool_stale++;
+			continue;
+		}
+#endif
+		pu1_code = st_pool_rec[u1_rec].u1_code;
+		st_trace_adc.u2_hi[TRACE_ADC] = st_pool_rec[u1_rec].u2_adc_hi;
+		st_trace_adc.u2_lo[TRACE_ADC] = st_pool_rec[u1_rec].u2_adc_lo;
+		pst_trace  = trace_begin();
+		u4_sample_cnt++;
+#else
+		b_adc_done = 0;
+		pst_trace  = trace_begin();
+		u4_sample_cnt++;
+		u1_mask    = RUN_CH_MASK;
+
 		/*
 		 * Reading analog value
 		 */
-		u4_adc_val = adc_read(ADC_CH0);
+		for (u1_ch = 0; u1_ch < ADC_CH_MAX; u1_ch++)
+		{
+			if ((u1_mask >> u1_ch) & 0x01)
+			{
+				u1_code[u1_ch] = (u1)hal_adc_read(u1_ch);
+			}
+		}
+#endif
 
 		/*
 		 * Start checking processing time
@@ -162,182 +1198,165 @@ void main(void)
 		time_tick();
 
 		/*
-		 * Reading temperature data
+		 * Filtering A/D code then reading temperature data
 		 */
-		/* f8_temp_val = read_temp(u4_adc_val); */
-		f8_temp_val = s2g_glmap1b_s2pt(u4_adc_val, &adc_table[0]);
+		for (u1_ch = 0; u1_ch < ADC_CH_MAX; u1_ch++)
+		{
+			if ((u1_mask >> u1_ch) & 0x01)
+			{
+#if (CFG_FILT != 0)
+				pu1_code[u1_ch] = filt_apply(&st_filt[u1_ch], pu1_code[u1_ch]);
+#endif
+				/* s4_temp[u1_ch] = read_temp(pu1_code[u1_ch]); */
+#if CONV_ON && (CFG_CAL != 0)
+				s4_temp[u1_ch] = cal_apply(u1_ch, CONV_TEMP(pu1_code[u1_ch]));
+#elif CONV_ON
+				s4_temp[u1_ch] = CONV_TEMP(pu1_code[u1_ch]);
+#endif
+			}
+		}
 
 		/*
 		 * Stop checking process time
 		 */
 		time_tock();
 		LED0_OFF;
+		TRACE_STAMP(*pst_trace, TRACE_CONV);
 
-		/*
-		 * Reading process time
-		 * convert time from nanasecond to millisecond
-		 */
-		f8_pro_time = (double)read_time();
-		f8_pro_time = f8_pro_time / 1000000;
+#if (CFG_ADAPT != 0)
+		/* Sample period from the signal activity */
+		adapt_update(pu1_code);
+#endif
+#if (CFG_ALARM != 0)
+		/* Threshold crossings, ahead of the sample output */
+		alarm_check(s4_temp);
+#endif
 
 		/*
-		 * Convert double to string.
-		 * precision = 2 (0.12)
+		 * One statistics record per RUN_STATS samples instead of every
+		 * sample, else skip samples inside the deadband, and the live
+		 * output while the link is behind (the sample log keeps the codes)
 		 */
-		ftoa(f8_temp_val, temp_buf, 2);
-		ftoa(f8_pro_time, time_buf, 2);
-
-		/* Printing data to serial port */
-		uart_puts("Teperature : ");
-		uart_puts(temp_buf);
-		uart_putc('\t');
-		uart_puts("Time stamp : ");
-		uart_puts(time_buf);;
-		uart_puts("ms");
-		uart_putc('\n');
-	}
-}
-
-/**
- * @fn              static void init_hw(void)
- * @fid             [FID001]-[init_hw]
- * @fnbrf           Initialize Hardware
- * @param[in]       -
- * @param[in,out]   -
- * @retval          -
- * @warning         -
- * @remark          -
- */
-static void init_hw(void)
-{
-	pd7 = 0xFF; /* Set port 7 direction as output */
-	p7  = 0xFF; /* Set port 7 outpt off           */
-}
-
-/**
- * @fn              static void init_adc(void)
- * @fid             [FID002]-[init_adc]
- * @fnbrf           Initialize A/D
- * @param[in]       -
- * @param[in,out]   -
- * @retval          -
- * @warning         -
- * @remark          -
- */
-static void init_adc(void)
-{
-	/*
-	 * Objective: Repeat Sweep Mode 0
-	 */
+#if (CFG_STATS != 0)
+		if (RUN_STATS != 0)
+		{
+			if (stats_update(s4_temp) != 0)
+			{
+				stats_record(pst_trace);
+				TRACE_STAMP(*pst_trace, TRACE_ENQ);
+				trace_commit(pst_trace);
+				u4_out_cnt++;
+			}
+#if (CFG_LOG != 0)
+			/* covered by the record, not backfilled */
+			log_write(pst_trace->u2_hi[TRACE_ADC], pu1_code, 1);
+#endif
+		}
+		else
+#endif
+#if CFG_DB_ON
+		if (out_deadband(s4_temp) != 0)
+		{
+			u4_suppress_cnt++;
+#if (CFG_LOG != 0)
+			log_write(pst_trace->u2_hi[TRACE_ADC], pu1_code, 1);
+#endif
+		}
+		else
+#endif
+#if (CFG_LOG != 0)
+		if (log_link_busy() != 0)
+		{
+			log_write(pst_trace->u2_hi[TRACE_ADC], pu1_code, 0);
+		}
+		else
+#endif
+		{
+#if CFG_TEXT_ON
+			/*
+			 * Reading process time (nanosecond)
+			 */
+			u8_pro_time = read_time();
+#endif
 
-	adcon0 = 0x98;
-	/* setting ADC control register adcon0 mode register                           */
-	/* 10011000                                                                    */
-	/* |||||+++---- ADC channel                                                    */
-	/* |||++------- ADC Mode "11" is Repeat sweep mode 0 and mode 1                */
-	/* ||+--------- Trigger ('0' is software trigger / '1' is extenal pin trigger) */
-	/* |+---------- ADC start bit       */
-	/* +----------- Freq divider selection ('1' is freq/2 / '0' is freq/4)         */
-	/* Be careful !! , to use Freq divider, the bit ck of adcon1 have to be set    */
-
-	adcon1 = 0x22;
-	/* setting ADC control register adcon1 mode register                           */
-	/* 00100010                                      		                       */
-	/* ||||||++---- Sweep mode selection AN0 to AN5   		                       */
-	/* |||||+------ '0' for repeat sweep mode 0 only 		                       */
-	/* ||||+------- Resolution ('0' : 8 bit / '1' : 10 bit)                        */
-	/* |||+-------- Vref connected '1'                                             */
-	/* ||+--------  Freq divider select ('0' not use freq div / '1' use freq div)  */
-	/* ++----------                                                                */
-
-	adcon2 = 0x01;
-	/* setting ADC control register adcon2 mode register                           */
-	/* 00000001                                                                    */
-	/* ||||||++---- timer  mode                                                    */
-	/* |||||+------ pulse is not output                                            */
-	/* |||++------- gate function not availble                                     */
-	/* ||+--------- timer mode                                                     */
-	/* ++----------  count source is f32                                           */
+			/* Printing data to serial port */
+			if (RUN_FORMAT == OUT_FMT_BIN)
+			{
+#if CFG_BIN_ON
+				out_frame(pu1_code, pst_trace);
+#endif
+			}
+			else
+			{
+#if POOL_TX_ON
+				out_text_rec(u1_rec, s4_temp, u8_pro_time, pst_trace);
+				u1_rec = POOL_NONE; /* the transmitter gives it back */
+#elif CFG_TEXT_ON
+				out_text(s4_temp, u8_pro_time, pst_trace);
+#endif
+			}
+			TRACE_STAMP(*pst_trace, TRACE_ENQ);
+			trace_commit(pst_trace);
+			u4_out_cnt++;
+#if (CFG_LOG != 0)
+			log_write(pst_trace->u2_hi[TRACE_ADC], pu1_code, 1);
+#endif
+		}
+#if (CFG_POOL != 0)
+		if (u1_rec != POOL_NONE)
+		{
+			(void)pool_q_put(&st_pool_free, u1_rec); /* not sent, free again */
+			u1_rec = POOL_NONE;
+		}
+#endif
 
-	/*
-	 * May not need this interupt control
-	 * because of repeat mode
-	 */
-	/* adic = 0x01; */
+		/*
+		 * Printing program information to serial port,
+		 * after the first sample so that it does not delay it,
+		 * a binary stream carries frames only
+		 */
+		if (b_boot_done == 0)
+		{
+			u4_boot_out = hal_time_stamp();
+			u4_boot_adc = TIME_COUNT(pst_trace->u2_hi[TRACE_ADC], pst_trace->u2_lo[TRACE_ADC]);
+			b_boot_done = 1;
+#if CFG_TEXT_ON
+			if (RUN_FORMAT != OUT_FMT_BIN)
+			{
+				uart_puts(program_text);
+			}
+#endif
+		}
 
-	/*
-	 * ADC conversion start
-	 */
-	adst = 0x01;
-}
+#if (CFG_REPORT != 0)
+		/* Printing duty cycle and wake-up latency */
+		power_report();
 
-/**
- * @fn              static u2 adc_read(u1 ch)
- * @fid             [FID003]-[adc_read]
- * @fnbrf           Initialize A/D
- * @param[in]       ch ; u1 ; adc channel
- * @param[in,out]   -
- * @retval          u2_vla ; u2 ; adc data
- * @warning         -
- * @remark          -
- */
-static u2 adc_read(u1 ch)
-{
-	u2 u2_val = 0;
-	switch (ch)
-	{
-		case 0:
-			while (adst == 0); /* waiting conversion complete */
-			u2_val = ad0;
-			break;
-		default:
-			break;
+		/* Collecting and printing sample latency trace */
+		trace_collect();
+#endif
 	}
-	return u2_val;
-}
-
-/**
- * @fn              static void init_timers(void)
- * @fid             [FID004]-[init_timers]
- * @fnbrf           Initialize timer for tick/tock
- * @param[in]       -
- * @param[in,out]   -
- * @retval          -
- * @warning         -
- * @remark          -
- */
-static void init_timers(void)
-{
-	ta3mr    = 0x00;   /* ta3 clock source not divided where f = 6 mhz , set as timer mode */
-	ir_ta3ic = 0;      /* Clear interupt for ta3 (set to 0)                                */
-	trgsr    = 0x80;   /* trigger register select to ta3                                   */
-	ta4mr    = 0x01;   /* set ta4 as event mode to monitor overflow of ta3                 */
-	udf      = 0x10;   /* set ta4 to count up                                              */
-	ir_ta4ic = 0;      /* Clear interupt for ta4 (set to 0)                                */
-	ta3      = 0xEA60; /* Hex value equivalent to 60000, ta3 start at 60000                */
-	ta4      = 0;      /* set ta4 to start at 0                                            */
 }
 
 /**
  * @fn              static void time_tick(void)
  * @fid             [FID005]-[time_tick]
- * @fnbrf           Start timer counter
+ * @fnbrf           Take start time stamp
  * @param[in]       -
  * @param[in,out]   -
  * @retval          -
  * @warning         -
- * @remark          -
+ * @remark          ta3/ta4 run free, they can not be stopped for measuring
  */
 static void time_tick(void)
 {
-	ta3s = 1; /* Timer a3 start count */
-	ta4s = 1; /* Timer a4 start count */
+	u4_tick_stamp = hal_time_stamp();
 }
 
 /**
  * @fn              static void time_tock(void)
  * @fid             [FID006]-[time_tock]
- * @fnbrf           Stop timer counter
+ * @fnbrf           Take stop time stamp
  * @param[in]       -
  * @param[in,out]   -
  * @retval          -
@@ -346,10 +1365,10 @@ static void time_tick(void)
  */
 static void time_tock(void)
 {
-	ta3s = 0; /* Timer a3 stop count */
-	ta4s = 0; /* Timer a4 stop count */
+	u4_tock_stamp = hal_time_stamp();
 }
 
+#if CFG_TEXT_ON
 /**
  * @fn              static u8 read_time(void)
  * @fid             [FID007]-[read_time]
@@ -362,17 +1381,13 @@ static void time_tock(void)
  */
 static u8 read_time(void)
 {
-	u4 u4_time_old = 0;
 	u8 u8_time_new = 0;
 	u8 u8_time     = 0;
 
 	/*
-	 * Revert time value so that with increasing time,
-	 * time can be displayed in ascending order
+	 * Time between time_tick and time_tock
 	 */
-	u4_time_old = 60000 - ta3;
-	/* u8_time_new = (ta4 * 60000); */
-	u8_time_new = u8_time_new + u4_time_old;
+	u8_time_new = hal_time_elapsed(u4_tick_stamp, u4_tock_stamp);
 
 	/*
 	 * Calcuate time in nanosecond.
@@ -381,11 +1396,11 @@ static u8 read_time(void)
 	u8_time = u8_time_new * 166;
 
 	/* clear data */
-	u4_time_old = 0;
 	u8_time_new = 0;
 
 	return u8_time;
 }
+#endif
 
 /**
  * @fn              static void init_uart(void)
@@ -400,16 +1415,28 @@ static u8 read_time(void)
 static void init_uart(void)
 {
 	/*
-	 * Configure Uart0 for buad : 9600
-	 * Buad rate : 9600
+	 * Configure Uart1
+	 * Buad rate : UART_BAUD_DEFAULT (9600)
 	 * Data bits : 8
 	 * Stop bits : 1
 	 * Parity    : NONE
 	 */
-	u1mr    = 0x05; /* Set mode register      */
-	u1c0    = 0x10; /* Set control register   */
-	u1brg   = 0x26; /* Set bit rate generator */
-	te_u1c1 = 0x01; /* Enable transmission    */
+#if (CFG_TX == CFG_TX_DMA)
+	hal_uart_init(HAL_UART1, UART_C0_DEFAULT, 0, 0); /* Transmit request triggers DMA0 only */
+	dm0sl   = DMA_SL_U1TX;
+	DMA0_DST(&u1tb);
+	dm0ic   = IPL_DMA_TX; /* DMA0 end hands over the next run */
+#else
+	hal_uart_init(HAL_UART1, UART_C0_DEFAULT, 0, IPL_UART_TX); /* Transmit interrupt feeds the queue */
+#endif
+	if (uart_set_baud(UART_BAUD_DEFAULT) == 0) /* Set bit rate generator */
+	{
+		(void)uart_set_baud(UART_BAUD_SAFE);
+	}
+#if (CFG_CMD != 0)
+	s1ric   = IPL_UART_RX; /* Receive interrupt fills the command queue */
+	re_u1c1 = 0x01; /* Enable reception       */
+#endif
 }
 
 /**
@@ -420,14 +1447,59 @@ static void init_uart(void)
  * @param[in,out]   -
  * @retval          -
  * @warning         -
- * @remark          -
+ * @remark          Queued, uart1_tx_isr (CFG_TX_DMA : DMA0) sends it.
+ *                  Sleeps while the queue is full.
+ *                  URG_ON : a '\n' outside a frame, or the last byte of a
+ *                  frame, ends a unit, after which the urgent lane may go.
  */
 static void uart_putc(const char s1_c)
 {
-	while (ti_u1c1 == 0);
-	u1tb = s1_c;
+	u1   u1_next = (u1)((u1_txq_head + 1) & UART_TXQ_MASK);
+#if URG_ON
+	BOOL b_end   = (BOOL)(((s1_c == '\n') && (b_frame_open == 0)) || (b_frame_last != 0));
+#endif
+
+	while (u1_next == u1_txq_tail)
+	{
+		cpu_idle();
+	}
+
+	ENTER_CRITICAL;
+	u2_tx_queued++;
+#if (CFG_TX == CFG_TX_DMA)
+	s1_txq[u1_txq_head] = s1_c;
+#if URG_ON
+	TXQ_END_SET(u1_txq_head, b_end);
+#endif
+	u1_txq_head = u1_next;
+	if (b_tx_busy == 0)
+	{
+		tx_dma_start();
+	}
+#else
+	if (b_tx_busy == 0)
+	{
+		b_tx_busy      = 1;
+		u1_tx_inflight = 1;
+		u2_tx_taken++;
+#if URG_ON
+		b_tx_bound     = b_end;
+#endif
+		u1tb = s1_c;
+	}
+	else
+	{
+		s1_txq[u1_txq_head] = s1_c;
+#if URG_ON
+		TXQ_END_SET(u1_txq_head, b_end);
+#endif
+		u1_txq_head = u1_next;
+	}
+#endif
+	EXIT_CRITICAL;
 }
 
+#if CFG_TEXT_ON
 /**
  * @fn              static void uart_puts(const char* s1_s)
  * @fid             [FID010]-[uart_puts]
@@ -442,162 +1514,4351 @@ static void uart_puts(const char* s1_s)
 {
 	while (*s1_s != '\0')
 	{
-		while (ti_u1c1 == 0);
-		u1tb = *s1_s;
+		uart_putc(*s1_s);
 		s1_s++;
 	}
 }
+#endif
 
+#if CFG_TEXT_ON && !POOL_TX_ON
 /**
- * @fn              static f8 read_temp(u4 u4_val)
- * @fid             [FID011]-[read_temp]
- * @fnbrf           Read temperature sensor.
- * @param[in]       u4_val ; u4 ; adc data (mV)
+ * @fn              static void uart_write(const char* s1_buf, u2 u2_len)
+ * @fid             [FID043]-[uart_write]
+ * @fnbrf           UART block transmit.
+ * @param[in]       s1_buf ; const char* ; data
+ * @param[in]       u2_len ; u2 ; number of bytes
  * @param[in,out]   -
- * @retval          f8_temp ; f8 ; temperature data
+ * @retval          -
  * @warning         -
- * @remark          -
+ * @remark          Copies as much as fits into the queue outside the critical
+ *                  section (only main writes the head), then publishes the new
+ *                  head once. Sleeps while the queue is full.
  */
-static f8 read_temp(u4 u4_val)
+static void uart_write(const char* s1_buf, u2 u2_len)
 {
-	f8 f8_temp = 0.0;
+	u1 u1_head = u1_txq_head;
+	u1 u1_free = 0;
+	u1 u1_n    = 0;
 
-	/*
-	 * This formula converts the number 0-255
-	 * from the ADC into 0-5000mV (= 5V)
-	 */
-	f8_temp = ((u4_val * 5000) / 255);
+	while (u2_len != 0)
+	{
+		u1_free = (u1)((u1_txq_tail - u1_head - 1) & UART_TXQ_MASK);
+		if (u1_free == 0)
+		{
+			cpu_idle();
+			continue;
+		}
+		for (u1_n = 0; (u1_n < u1_free) && (u2_len != 0); u1_n++)
+		{
+			s1_txq[u1_head] = *s1_buf;
+#if URG_ON
+			TXQ_END_SET(u1_head, (BOOL)(*s1_buf == '\n'));
+#endif
+			u1_head = (u1)((u1_head + 1) & UART_TXQ_MASK);
+			s1_buf++;
+			u2_len--;
+		}
 
-	/*
-	 * This formula convertsmillivolts into temperature
-	 */
-	f8_temp = (f8_temp - 500) / 10;
+		ENTER_CRITICAL;
+		u1_txq_head  = u1_head;
+		u2_tx_queued = (u2)(u2_tx_queued + u1_n);
+		if (b_tx_busy == 0)
+		{
+#if (CFG_TX == CFG_TX_DMA)
+			tx_dma_start();
+#else
+			tx_start();
+#endif
+		}
+		EXIT_CRITICAL;
+	}
 }
+#endif
 
 /**
- * @fn              char* ftoa(f8 f8_f, char* buf, s2 s2_precision)
- * @fid             [FID012]-[ftoa]
- * @fnbrf           Convert floating point to string.
- * @param[in]       f8_f ; f8 ; floating point input 
- * @param[in,out]   *buf ; char ; buffer output
- * @retval			*ftoa ; char ; pointer
- * @warning         May side effect with s1 (signed char) 
- * @remark          -
+ * @fn              static u1 tx_run(const volatile char** pps1_src, u1 u1_max)
+ * @fid             [FID082]-[tx_run]
+ * @fnbrf           Find the next bytes to send, in the order they were given
+ * @param[in]       u1_max ; u1 ; most bytes wanted
+ * @param[in,out]   pps1_src ; const volatile char** ; first byte of the run
+ * @retval          u1_n ; u1 ; bytes from *pps1_src on, 0 : nothing to send
+ * @warning         Called by the transmit interrupt functions, or with
+ *                  interrupts disabled.
+ * @remark          Queued bytes end at the queue end and, with POOL_TX_ON,
+ *                  at the mark of the next record : the record line follows
+ *                  the bytes queued before it and is sent from the record.
+ *                  URG_ON : urgent bytes go first once the last byte taken
+ *                  ended a line or frame, and while they wait queued bytes
+ *                  end at the next unit end.
+ *                  Nothing is taken until tx_done.
  */
-char* ftoa(f8 f8_f, char* buf, s2 s2_precision)
+static u1 tx_run(const volatile char** pps1_src, u1 u1_max)
 {
-	char* ptr = buf;
-	char* p = ptr;
-	char* ptr1;
-	char c;
-	s4 intPart;
+	u1 u1_end = (u1_txq_head < u1_txq_tail) ? (u1)UART_TXQ_SIZE : u1_txq_head;
+	u1 u1_n   = (u1)(u1_end - u1_txq_tail);
+#if POOL_TX_ON
+	u1 u1_rec = POOL_NONE;
+#endif
+#if URG_ON
+	u1 u1_i   = 0;
 
-	if (s2_precision > MAX_PRECISION)
+	b_tx_urg = (BOOL)(URG_PENDING && (b_tx_bound != 0));
+	if (b_tx_urg != 0)
 	{
-		s2_precision = MAX_PRECISION;
+		u1_end    = (u1_urgq_head < u1_urgq_tail) ? (u1)UART_URGQ_SIZE : u1_urgq_head;
+		u1_n      = (u1)(u1_end - u1_urgq_tail);
+		*pps1_src = &s1_urgq[u1_urgq_tail];
+		return (u1_n > u1_max) ? u1_max : u1_n;
 	}
+#endif
+#if POOL_TX_ON
 
-	if (f8_f < 0)
+	if ((u1_tx_rec == POOL_NONE) && (st_pool_tx.u1_head != st_pool_tx.u1_tail))
 	{
-		f8_f = -f8_f;
-		*ptr++ = '-';
-	}
-
-	if (s2_precision < 0)
-	{
-		if (f8_f < 1.0)
+		u1_rec = st_pool_tx.u1_idx[st_pool_tx.u1_tail & POOL_MASK];
+		if (st_pool_rec[u1_rec].u2_mark == u2_tx_taken)
 		{
-			s2_precision = 6;
+			(void)pool_q_get(&st_pool_tx, &u1_rec);
+			u1_tx_rec = u1_rec;
+			u1_tx_pos = 0;
 		}
-		else if (f8_f < 10.0)
+		else if ((u2)(st_pool_rec[u1_rec].u2_mark - u2_tx_taken) < u1_n)
 		{
-			s2_precision = 5;
+			u1_n = (u1)(st_pool_rec[u1_rec].u2_mark - u2_tx_taken);
 		}
-		else if (f8_f < 100.0)
+	}
+	if (u1_tx_rec != POOL_NONE)
+	{
+		*pps1_src = &st_pool_rec[u1_tx_rec].s1_line[u1_tx_pos];
+		u1_n      = (u1)(st_pool_rec[u1_tx_rec].u1_len - u1_tx_pos);
+		return (u1_n > u1_max) ? u1_max : u1_n;
+	}
+#endif
+#if URG_ON
+	if (URG_PENDING && (u1_n > 1))
+	{
+		while ((u1_i < (u1)(u1_n - 1)) && (TXQ_END(u1_txq_tail + u1_i) == 0))
 		{
-			s2_precision = 4;
+			u1_i++;
 		}
-		else if (f8_f < 1000.0)
+		u1_n = (u1)(u1_i + 1);
+	}
+#endif
+	*pps1_src = &s1_txq[u1_txq_tail];
+	return (u1_n > u1_max) ? u1_max : u1_n;
+}
+
+/**
+ * @fn              static void tx_done(u1 u1_n)
+ * @fid             [FID083]-[tx_done]
+ * @fnbrf           Take the bytes of the run found by tx_run
+ * @param[in]       u1_n ; u1 ; bytes moved to u1tb
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         Same context as tx_run.
+ * @remark          A record whose last byte is taken goes to st_pool_done,
+ *                  main frees it, the line is no longer read.
+ *                  CFG_ALARM : times the alarm message in its lane.
+ */
+static void tx_done(u1 u1_n)
+{
+#if URG_ON
+	if (b_tx_urg != 0)
+	{
+		u2_urg_taken = (u2)(u2_urg_taken + u1_n);
+		u1_urgq_tail = (u1)((u1_urgq_tail + u1_n) & UART_URGQ_MASK);
+		alarm_taken(u2_urg_taken);
+		return;
+	}
+#endif
+	u2_tx_taken = (u2)(u2_tx_taken + u1_n);
+#if (CFG_ALARM != 0) && !URG_ON
+	alarm_taken(u2_tx_taken);
+#endif
+#if POOL_TX_ON
+	if (u1_tx_rec != POOL_NONE)
+	{
+		u1_tx_pos = (u1)(u1_tx_pos + u1_n);
+#if URG_ON
+		b_tx_bound = (BOOL)(u1_tx_pos >= st_pool_rec[u1_tx_rec].u1_len);
+#endif
+		if (u1_tx_pos >= st_pool_rec[u1_tx_rec].u1_len)
 		{
-			s2_precision = 3;
+			(void)pool_q_put(&st_pool_done, u1_tx_rec);
+			u1_tx_rec = POOL_NONE;
 		}
-		else if (f8_f < 10000.0)
+		return;
+	}
+#endif
+#if URG_ON
+	b_tx_bound  = (BOOL)TXQ_END((u1)((u1_txq_tail + u1_n - 1) & UART_TXQ_MASK));
+#endif
+	u1_txq_tail = (u1)((u1_txq_tail + u1_n) & UART_TXQ_MASK);
+}
+
+#if URG_ON
+/**
+ * @fn              static void urg_write(const char* s1_buf, u1 u1_len)
+ * @fid             [FID091]-[urg_write]
+ * @fnbrf           Queue a whole message on the urgent lane
+ * @param[in]       s1_buf ; const char* ; message, a line or a frame
+ * @param[in]       u1_len ; u1 ; bytes, less than UART_URGQ_SIZE
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          Sleeps until the whole message fits, then publishes the
+ *                  head once : the transmitter never sees part of a message
+ *                  and can take the urgent lane until it is empty.
+ */
+static void urg_write(const char* s1_buf, u1 u1_len)
+{
+	u1 u1_head = u1_urgq_head;
+	u1 u1_i    = 0;
+
+	while ((u1)((u1_urgq_tail - u1_head - 1) & UART_URGQ_MASK) < u1_len)
+	{
+		cpu_idle();
+	}
+	for (u1_i = 0; u1_i < u1_len; u1_i++)
+	{
+		s1_urgq[u1_head] = s1_buf[u1_i];
+		u1_head = (u1)((u1_head + 1) & UART_URGQ_MASK);
+	}
+
+	ENTER_CRITICAL;
+	u1_urgq_head  = u1_head;
+	u2_urg_queued = (u2)(u2_urg_queued + u1_len);
+	if (b_tx_busy == 0)
+	{
+#if (CFG_TX == CFG_TX_DMA)
+		tx_dma_start();
+#else
+		tx_start();
+#endif
+	}
+	EXIT_CRITICAL;
+}
+#endif
+
+#if (CFG_POOL != 0)
+/**
+ * @fn              static void pool_init(void)
+ * @fid             [FID084]-[pool_init]
+ * @fnbrf           Put every record on the free queue
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         Before the A/D interrupt is enabled.
+ * @remark          -
+ */
+static void pool_init(void)
+{
+	u1 u1_rec = 0;
+
+	for (u1_rec = 0; u1_rec < POOL_REC_MAX; u1_rec++)
+	{
+		(void)pool_q_put(&st_pool_free, u1_rec);
+	}
+}
+
+/**
+ * @fn              static BOOL pool_q_put(POOL_Q* pst_q, u1 u1_rec)
+ * @fid             [FID085]-[pool_q_put]
+ * @fnbrf           Hand a record index to the consumer of the queue
+ * @param[in]       u1_rec ; u1 ; record index
+ * @param[in,out]   pst_q ; POOL_Q* ; queue, called by its producer only
+ * @retval          1 : queued, 0 : full
+ * @warning         -
+ * @remark          No critical section : the index is stored before the
+ *                  head that publishes it, u1 stores are single writes.
+ *                  A queue holds every record, so full is never expected.
+ */
+static BOOL pool_q_put(POOL_Q* pst_q, u1 u1_rec)
+{
+	u1 u1_head = pst_q->u1_head;
+
+	if ((u1)(u1_head - pst_q->u1_tail) >= POOL_REC_MAX)
+	{
+		return 0;
+	}
+	pst_q->u1_idx[u1_head & POOL_MASK] = u1_rec;
+	pst_q->u1_head = (u1)(u1_head + 1);
+	return 1;
+}
+
+/**
+ * @fn              static BOOL pool_q_get(POOL_Q* pst_q, u1* pu1_rec)
+ * @fid             [FID086]-[pool_q_get]
+ * @fnbrf           Take the oldest record index of the queue
+ * @param[in]       -
+ * @param[in,out]   pst_q ; POOL_Q* ; queue, called by its consumer only
+ * @param[in,out]   pu1_rec ; u1* ; record index
+ * @retval          1 : taken, 0 : empty
+ * @warning         -
+ * @remark          The index is read before the tail that frees its slot.
+ */
+static BOOL pool_q_get(POOL_Q* pst_q, u1* pu1_rec)
+{
+	u1 u1_tail = pst_q->u1_tail;
+
+	if (u1_tail == pst_q->u1_head)
+	{
+		return 0;
+	}
+	*pu1_rec = pst_q->u1_idx[u1_tail & POOL_MASK];
+	pst_q->u1_tail = (u1)(u1_tail + 1);
+	return 1;
+}
+
+#if POOL_TX_ON
+/**
+ * @fn              static void pool_recycle(void)
+ * @fid             [FID087]-[pool_recycle]
+ * @fnbrf           Free the records the transmitter is done with
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          The transmitter gives records to main, not to ad_isr, so
+ *                  that every queue keeps a single producer.
+ */
+static void pool_recycle(void)
+{
+	u1 u1_rec = 0;
+
+	while (pool_q_get(&st_pool_done, &u1_rec) != 0)
+	{
+		(void)pool_q_put(&st_pool_free, u1_rec);
+	}
+}
+
+/**
+ * @fn              static void pool_send(u1 u1_rec)
+ * @fid             [FID088]-[pool_send]
+ * @fnbrf           Hand a formatted record to the transmitter
+ * @param[in]       u1_rec ; u1 ; record with s1_line and u1_len set
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         The record belongs to the transmitter from here on.
+ * @remark          The mark orders the line after the bytes queued before.
+ *                  Never waits : the line is not copied into the queue.
+ */
+static void pool_send(u1 u1_rec)
+{
+	ENTER_CRITICAL;
+	st_pool_rec[u1_rec].u2_mark = u2_tx_queued;
+	u2_tx_queued = (u2)(u2_tx_queued + st_pool_rec[u1_rec].u1_len);
+	(void)pool_q_put(&st_pool_tx, u1_rec);
+	if (b_tx_busy == 0)
+	{
+#if (CFG_TX == CFG_TX_DMA)
+		tx_dma_start();
+#else
+		tx_start();
+#endif
+	}
+	EXIT_CRITICAL;
+}
+#endif
+#endif
+
+#if (CFG_FILT != 0)
+/**
+ * @fn              static u1 filt_apply(FILT_CH* pst_f, u1 u1_x)
+ * @fid             [FID048]-[filt_apply]
+ * @fnbrf           Filter one A/D code
+ * @param[in]       u1_x ; u1 ; A/D code
+ * @param[in,out]   pst_f ; FILT_CH* ; filter of the channel
+ * @retval          u1_y ; u1 ; filtered code
+ * @warning         -
+ * @remark          AVG keeps the window sum (one add, one subtract), MED
+ *                  sorts a copy of the last 3 or 5 codes, IIR keeps the
+ *                  output with FILT_IIR_FRAC fraction bits. No division.
+ */
+static u1 filt_apply(FILT_CH* pst_f, u1 u1_x)
+{
+	u1 u1_i    = 0;
+	u1 u1_old  = 0;
+	u2 u2_step = 0;
+
+	if (pst_f->u1_type == FILT_NONE)
+	{
+		return u1_x;
+	}
+	if (pst_f->b_primed == 0)
+	{
+		/* start as if the input had been u1_x forever */
+		for (u1_i = 0; u1_i < FILT_HIST_SIZE; u1_i++)
 		{
-			s2_precision = 2;
+			pst_f->u1_hist[u1_i] = u1_x;
 		}
-		else if (f8_f < 100000.0)
+		pst_f->u2_sum   = (u2)((u2)u1_x << pst_f->u1_param);
+		pst_f->u2_iir   = (u2)((u2)u1_x << FILT_IIR_FRAC);
+		pst_f->b_primed = 1;
+	}
+
+	switch (pst_f->u1_type)
+	{
+	case FILT_AVG:
+		u1_old = pst_f->u1_hist[(u1)(pst_f->u1_pos - (1 << pst_f->u1_param)) & FILT_HIST_MASK];
+		pst_f->u1_hist[pst_f->u1_pos] = u1_x;
+		pst_f->u1_pos = (u1)((pst_f->u1_pos + 1) & FILT_HIST_MASK);
+		pst_f->u2_sum = (u2)(pst_f->u2_sum + u1_x - u1_old);
+		return (u1)((pst_f->u2_sum + ((1 << pst_f->u1_param) >> 1)) >> pst_f->u1_param);
+
+	case FILT_MED:
+		pst_f->u1_hist[pst_f->u1_pos] = u1_x;
+		pst_f->u1_pos = (u1)((pst_f->u1_pos + 1) & FILT_HIST_MASK);
+		return filt_median(pst_f);
+
+	case FILT_IIR:
+		/* unsigned step both ways, shift of a negative value is avoided */
+		if (((u2)u1_x << FILT_IIR_FRAC) >= pst_f->u2_iir)
 		{
-			s2_precision = 1;
+			u2_step = (u2)((((u2)u1_x << FILT_IIR_FRAC) - pst_f->u2_iir) >> pst_f->u1_param);
+			pst_f->u2_iir = (u2)(pst_f->u2_iir + u2_step);
 		}
 		else
 		{
-			s2_precision = 0;
+			u2_step = (u2)((pst_f->u2_iir - ((u2)u1_x << FILT_IIR_FRAC)) >> pst_f->u1_param);
+			pst_f->u2_iir = (u2)(pst_f->u2_iir - u2_step);
 		}
+		return (u1)((pst_f->u2_iir + (1 << (FILT_IIR_FRAC - 1))) >> FILT_IIR_FRAC);
+
+	default:
+		return u1_x;
 	}
+}
+
+/**
+ * @fn              static u1 filt_median(const FILT_CH* pst_f)
+ * @fid             [FID049]-[filt_median]
+ * @fnbrf           Median of the last 3 or 5 codes
+ * @param[in]       pst_f ; const FILT_CH* ; filter of the channel
+ * @param[in,out]   -
+ * @retval          u1_med ; u1 ; median code
+ * @warning         -
+ * @remark          Fixed compare and swap network, 3 for 3 codes and 7 for
+ *                  5 codes, same path for every input.
+ */
+static u1 filt_median(const FILT_CH* pst_f)
+{
+	u1 u1_a = pst_f->u1_hist[(u1)(pst_f->u1_pos - 1) & FILT_HIST_MASK];
+	u1 u1_b = pst_f->u1_hist[(u1)(pst_f->u1_pos - 2) & FILT_HIST_MASK];
+	u1 u1_c = pst_f->u1_hist[(u1)(pst_f->u1_pos - 3) & FILT_HIST_MASK];
+	u1 u1_d = 0;
+	u1 u1_e = 0;
 
-	if (s2_precision)
+	if (pst_f->u1_param == 3)
 	{
-		f8_f += rounders[s2_precision];
+		FILT_CSWAP(u1_a, u1_b);
+		FILT_CSWAP(u1_b, u1_c);
+		FILT_CSWAP(u1_a, u1_b);
+		return u1_b;
 	}
+	u1_d = pst_f->u1_hist[(u1)(pst_f->u1_pos - 4) & FILT_HIST_MASK];
+	u1_e = pst_f->u1_hist[(u1)(pst_f->u1_pos - 5) & FILT_HIST_MASK];
+	FILT_CSWAP(u1_a, u1_b);
+	FILT_CSWAP(u1_d, u1_e);
+	FILT_CSWAP(u1_a, u1_d);
+	FILT_CSWAP(u1_b, u1_e);
+	FILT_CSWAP(u1_b, u1_c);
+	FILT_CSWAP(u1_c, u1_d);
+	FILT_CSWAP(u1_b, u1_c);
+	return u1_c;
+}
+
+/**
+ * @fn              static void filt_set(FILT_CH* pst_f, u1 u1_type, u1 u1_param)
+ * @fid             [FID050]-[filt_set]
+ * @fnbrf           Select the filter of a channel
+ * @param[in]       u1_type ; u1 ; FILT_NONE / AVG / MED / IIR
+ * @param[in]       u1_param ; u1 ; AVG shift, MED length, IIR shift
+ * @param[in,out]   pst_f ; FILT_CH* ; filter of the channel
+ * @retval          -
+ * @warning         Parameter is checked by the caller
+ * @remark          The state is primed again by the next sample.
+ */
+static void filt_set(FILT_CH* pst_f, u1 u1_type, u1 u1_param)
+{
+	pst_f->u1_type  = u1_type;
+	pst_f->u1_param = u1_param;
+	pst_f->u1_pos   = 0;
+	pst_f->b_primed = 0;
+}
 
-	intPart = f8_f;
-	f8_f -= intPart;
+/**
+ * @fn              static u4 filt_cost(u1 u1_type, u1 u1_param)
+ * @fid             [FID051]-[filt_cost]
+ * @fnbrf           Measure the cost of a filter
+ * @param[in]       u1_type ; u1 ; FILT_NONE / AVG / MED / IIR
+ * @param[in]       u1_param ; u1 ; AVG shift, MED length, IIR shift
+ * @param[in,out]   -
+ * @retval          u4_ns ; u4 ; ns per sample
+ * @warning         -
+ * @remark          FILT_COST_RUN codes of a ramp through a scratch filter,
+ *                  ta3/ta4 must be running.
+ */
+static u4 filt_cost(u1 u1_type, u1 u1_param)
+{
+	FILT_CH st_f;
+	u4      u4_from = 0;
+	u4      u4_to   = 0;
+	u1      u1_i    = 0;
+	u1      u1_sink = 0;
 
-	if (!intPart)
+	filt_set(&st_f, u1_type, u1_param);
+	u4_from = hal_time_stamp();
+	for (u1_i = 0; u1_i < FILT_COST_RUN; u1_i++)
 	{
-		*ptr++ = '0';
+		u1_sink ^= filt_apply(&st_f, (u1)(u1_i * 37));
 	}
-	else
+	u4_to = hal_time_stamp();
+	(void)u1_sink;
+
+	return hal_time_elapsed(u4_from, u4_to) * 166 / FILT_COST_RUN; /* counts to ns */
+}
+#endif
+
+#if (CFG_LOG != 0)
+/**
+ * @fn              static BOOL log_link_busy(void)
+ * @fid             [FID059]-[log_link_busy]
+ * @fnbrf           Tell whether the link is behind the samples
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          1 : more than LOG_GAP_LEVEL sample bytes still to send
+ * @warning         -
+ * @remark          Bytes queued since the last sample (reports, replies, log
+ *                  frames) are at the tail of the queue and do not count.
+ *                  FMT BIN only : a text reader cannot take the 'L' frames
+ *                  of the backfill, so text output waits for the link.
+ *                  The first busy sample opens a gap, backfilled by
+ *                  log_service once the transmit queue is empty.
+ *                  Striped frames : the least loaded link.
+ */
+static BOOL log_link_busy(void)
+{
+	u2 u2_pend  = TX_PENDING;
+	u2 u2_other = (u2)(u2_tx_queued - st_log.u2_tx_mark);
+
+#if STRIPE_ON
+	if ((RUN_FORMAT == OUT_FMT_BIN) && (u1_stripe_n > 1) && (stripe_pick(&u2_pend) != STRIPE_U1))
+	{
+		u2_other = 0; /* reports and replies are UART1 only */
+	}
+#endif
+	if ((RUN_FORMAT != OUT_FMT_BIN) || (u2_pend <= (u2)(u2_other + LOG_GAP_LEVEL)))
+	{
+		return 0;
+	}
+	if (st_log.b_gap == 0)
 	{
-		p = ptr;
+		st_log.b_gap       = 1;
+		st_log.u2_gap_from = st_log.u2_head;
+	}
+	st_log.u4_skip++;
+	return 1;
+}
+
+/**
+ * @fn              static void log_write(u2 u2_tick, const u1* pu1_code, BOOL b_live)
+ * @fid             [FID060]-[log_write]
+ * @fnbrf           Log one sample, one record per output channel
+ * @param[in]       u2_tick ; u2 ; ta4 at the A/D sweep
+ * @param[in]       pu1_code ; const u1* ; code of each channel
+ * @param[in]       b_live ; BOOL ; 1 : sent live or inside the deadband
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          The oldest record is overwritten when the ring is full,
+ *                  counted as lost when it was never sent. Called after the
+ *                  output of the sample, marks where the sample bytes end.
+ */
+static void log_write(u2 u2_tick, const u1* pu1_code, BOOL b_live)
+{
+	LOG_REC* pst_rec = 0;
+	u1       u1_ch   = 0;
 
-		while (intPart)
+	for (u1_ch = 0; u1_ch < ADC_CH_MAX; u1_ch++)
+	{
+		if (((RUN_CH_MASK >> u1_ch) & 0x01) == 0)
+		{
+			continue;
+		}
+		pst_rec = &st_log_rec[st_log.u2_head & LOG_MASK];
+		if (st_log.u2_fill < LOG_REC_MAX)
+		{
+			st_log.u2_fill++;
+		}
+		else if ((pst_rec->u1_ch & LOG_LIVE) == 0)
+		{
+			st_log.u2_unsent--;
+			st_log.u4_lost++;
+		}
+		pst_rec->u2_tick = u2_tick;
+		pst_rec->u1_ch   = (u1)(u1_ch | ((b_live != 0) ? LOG_LIVE : 0));
+		pst_rec->u1_code = pu1_code[u1_ch];
+		if (b_live == 0)
 		{
-			*p++ = '0' + intPart % 10;
-			intPart /= 10;
+			st_log.u2_unsent++;
 		}
+		st_log.u2_head++;
+	}
+	st_log.u2_tx_mark = u2_tx_queued;
+}
+
+/**
+ * @fn              static void log_dump(BOOL b_all, u2 u2_from)
+ * @fid             [FID061]-[log_dump]
+ * @fnbrf           Start a dump of the sample log
+ * @param[in]       b_all ; BOOL ; 1 : every record, 0 : records not sent live
+ * @param[in]       u2_from ; u2 ; first record
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          The records up to now are sent by log_service, a few
+ *                  at a time, so sampling goes on during the dump.
+ */
+static void log_dump(BOOL b_all, u2 u2_from)
+{
+	st_log.u2_dump     = u2_from;
+	st_log.u2_dump_end = st_log.u2_head;
+	st_log.b_dump_all  = b_all;
+	st_log.b_dump      = 1;
+	st_log.b_gap       = 0;
+}
+
+/**
+ * @fn              static void log_service(void)
+ * @fid             [FID062]-[log_service]
+ * @fnbrf           Send the next log frame when the link has room
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          A5 5A 'L' n (tick(2) ch code)*n sum(2), n <= LOG_FRAME_REC.
+ *                  ch bit 7 : the record was sent live before (LOG dump).
+ *                  One frame per call and only when it fits in the transmit
+ *                  queue, so the main loop never waits for the link.
+ */
+static void log_service(void)
+{
+	LOG_REC* pst_rec = 0;
+	u2       u2_i    = 0;
+	u1       u1_n    = 0;
 
-		ptr1 = p;
+	if ((st_log.b_dump == 0) && (st_log.b_gap != 0) && (TX_PENDING == 0) &&
+	    (RUN_FORMAT == OUT_FMT_BIN))
+	{
+		log_dump(0, st_log.u2_gap_from); /* link caught up, backfill the gap */
+	}
+	if (st_log.b_dump == 0)
+	{
+		return;
+	}
+	/* records overwritten since the dump started are gone */
+	if ((u2)(st_log.u2_head - st_log.u2_dump) > st_log.u2_fill)
+	{
+		st_log.u2_dump = (u2)(st_log.u2_head - st_log.u2_fill);
+	}
+	if ((u1)((u1_txq_tail - u1_txq_head - 1) & UART_TXQ_MASK) < LOG_FRAME_BYTES)
+	{
+		return;
+	}
 
-		while (p > ptr)
+	/* count the records of the next frame, then send them */
+	for (u2_i = st_log.u2_dump; (u2_i != st_log.u2_dump_end) && (u1_n < LOG_FRAME_REC); u2_i++)
+	{
+		if ((st_log.b_dump_all != 0) || ((st_log_rec[u2_i & LOG_MASK].u1_ch & LOG_LIVE) == 0))
+		{
+			u1_n++;
+		}
+	}
+	if (u1_n != 0)
+	{
+		frame_begin(FRAME_TYPE_LOG);
+		frame_put(u1_n);
+		for (; st_log.u2_dump != u2_i; st_log.u2_dump++)
 		{
-			c = *--p;
-			*p = *ptr;
-			*ptr++ = c;
+			pst_rec = &st_log_rec[st_log.u2_dump & LOG_MASK];
+			if ((st_log.b_dump_all == 0) && ((pst_rec->u1_ch & LOG_LIVE) != 0))
+			{
+				continue;
+			}
+			frame_put((u1)(pst_rec->u2_tick & 0xFF));
+			frame_put((u1)(pst_rec->u2_tick >> 8));
+			frame_put(pst_rec->u1_ch);
+			frame_put(pst_rec->u1_code);
+			if ((pst_rec->u1_ch & LOG_LIVE) == 0)
+			{
+				pst_rec->u1_ch |= LOG_LIVE;
+				st_log.u2_unsent--;
+			}
 		}
+		frame_end();
+	}
+	st_log.u2_dump = u2_i;
+	if (st_log.u2_dump == st_log.u2_dump_end)
+	{
+		st_log.b_dump = 0;
+	}
+}
+#endif
+
+#if (CFG_ADAPT != 0)
+/**
+ * @fn              static void adapt_update(const u1* pu1_code)
+ * @fid             [FID063]-[adapt_update]
+ * @fnbrf           Adapt the sample period to the signal activity
+ * @param[in]       pu1_code ; const u1* ; code of each channel
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          Activity = largest code change of the output channels
+ *                  since the reference sample, less ADAPT_LSB, per second.
+ *                  At u1_level or above the period drops to the shortest at
+ *                  once. After ADAPT_QUIET samples below half of it the
+ *                  period doubles, up to the longest. Both take a new
+ *                  reference. ta3_isr picks the new period at the next tick.
+ *                  A change is reported as "Rate : n ms", in FMT BIN as
+ *                  A5 5A 'R' ms(2) sum(2) so the stream stays binary.
+ */
+static void adapt_update(const u1* pu1_code)
+{
+	u1 u1_ch   = 0;
+	u1 u1_d    = 0;
+	u1 u1_act  = 0;
+	u1 u1_tick = st_cfg.u1_sample_tick;
+	u4 u4_act  = 0;
+	u4 u4_lim  = 0;
 
-		ptr = ptr1;
+	if (st_adapt.b_on == 0)
+	{
+		return;
 	}
+	st_adapt.u4_samples++;
+	st_adapt.u4_ticks += u1_tick;
 
-	if (s2_precision)
+	if (st_adapt.b_primed != 0)
 	{
-		*ptr++ = '.';
+		st_adapt.u2_ref_tick = (u2)(st_adapt.u2_ref_tick + u1_tick);
+		for (u1_ch = 0; u1_ch < ADC_CH_MAX; u1_ch++)
+		{
+			if ((st_cfg.u1_ch_mask >> u1_ch) & 0x01)
+			{
+				u1_d = (pu1_code[u1_ch] > st_adapt.u1_code_ref[u1_ch]) ?
+				       (u1)(pu1_code[u1_ch] - st_adapt.u1_code_ref[u1_ch]) :
+				       (u1)(st_adapt.u1_code_ref[u1_ch] - pu1_code[u1_ch]);
+				u1_act = (u1_d > u1_act) ? u1_d : u1_act;
+			}
+		}
+		/* (change - LSB) / time >= level, without the division */
+		u4_act = (u1_act > ADAPT_LSB) ? ((u4)(u1_act - ADAPT_LSB) * ADAPT_TICK_PER_S) : 0;
+		u4_lim = (u4)st_adapt.u1_level * st_adapt.u2_ref_tick;
 
-		while (s2_precision--)
+		if (u4_act >= u4_lim)
+		{
+			if (u1_tick != st_adapt.u1_tick_min)
+			{
+				u1_tick = st_adapt.u1_tick_min;
+				st_adapt.u2_up++;
+			}
+			st_adapt.b_primed = 0;
+		}
+		else if (++st_adapt.u1_quiet >= ADAPT_QUIET)
+		{
+			if ((u4_act < (u4_lim >> 1)) && (u1_tick != st_adapt.u1_tick_max))
+			{
+				u1_tick = (u1_tick > (st_adapt.u1_tick_max >> 1)) ?
+				          st_adapt.u1_tick_max : (u1)(u1_tick << 1);
+				st_adapt.u2_down++;
+			}
+			st_adapt.b_primed = 0;
+		}
+	}
+	if (st_adapt.b_primed == 0)
+	{
+		/* new reference */
+		for (u1_ch = 0; u1_ch < ADC_CH_MAX; u1_ch++)
 		{
-			f8_f *= 10.0;
-			c = f8_f;
-			*ptr++ = '0' + c;
-			f8_f -= c;
+			st_adapt.u1_code_ref[u1_ch] = pu1_code[u1_ch];
 		}
+		st_adapt.u2_ref_tick = 0;
+		st_adapt.u1_quiet    = 0;
+		st_adapt.b_primed    = 1;
 	}
 
-	*ptr = 0;
+	if (u1_tick != st_cfg.u1_sample_tick)
+	{
+		st_cfg.u1_sample_tick = u1_tick;
+		if (RUN_FORMAT == OUT_FMT_BIN)
+		{
+#if CFG_BIN_ON
+			frame_begin(FRAME_TYPE_RATE);
+			frame_put((u1)(((u2)u1_tick * TICK_MS) & 0xFF));
+			frame_put((u1)(((u2)u1_tick * TICK_MS) >> 8));
+			frame_end();
+#endif
+		}
+		else
+		{
+			uart_put_num("Rate : ", (u4)u1_tick * TICK_MS);
+			uart_puts("ms\n");
+		}
+	}
+}
 
-	return buf;
+/**
+ * @fn              static void adapt_set(u1 u1_tick_min, u1 u1_tick_max, u1 u1_level)
+ * @fid             [FID064]-[adapt_set]
+ * @fnbrf           Start the adaptive sample period
+ * @param[in]       u1_tick_min ; u1 ; shortest period, ticks
+ * @param[in]       u1_tick_max ; u1 ; longest period, ticks
+ * @param[in]       u1_level ; u1 ; codes per second, 0 : off
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         Parameter is checked by the caller
+ * @remark          Starts at the shortest period, statistics restart.
+ */
+static void adapt_set(u1 u1_tick_min, u1 u1_tick_max, u1 u1_level)
+{
+	st_adapt.b_on        = (BOOL)(u1_level != 0);
+	st_adapt.b_primed    = 0;
+	st_adapt.u1_tick_min = u1_tick_min;
+	st_adapt.u1_tick_max = u1_tick_max;
+	st_adapt.u1_level    = u1_level;
+	st_adapt.u1_quiet    = 0;
+	st_adapt.u2_ref_tick = 0;
+	st_adapt.u2_up       = 0;
+	st_adapt.u2_down     = 0;
+	st_adapt.u4_samples  = 0;
+	st_adapt.u4_ticks    = 0;
+	if (st_adapt.b_on != 0)
+	{
+		st_cfg.u1_sample_tick = u1_tick_min;
+	}
 }
+#endif
 
+#if (CFG_STATS != 0)
+#if (CFG_CMD != 0)
 /**
- * @fn              static s4 s2g_glmap1b_s2pt(s2 X, const s4* MAP)
- * @fid             [FID013]-[s2g_glmap1b_s2pt]
- * @fnbrf           Temperature data mapping table
- * @param[in]       X ; s2 ; adc data
+ * @fn              static void stats_reset(void)
+ * @fid             [FID074]-[stats_reset]
+ * @fnbrf           Empty the statistics windows
+ * @param[in]       -
  * @param[in,out]   -
- * @retval          Y ; s4 ; temperature data
+ * @retval          -
  * @warning         -
- * @remark          -
+ * @remark          After STATS, RATE and CH : the window must hold one
+ *                  period and the channels of the mask only.
+ */
+static void stats_reset(void)
+{
+	u1 u1_ch = 0;
+
+	for (u1_ch = 0; u1_ch < ADC_CH_MAX; u1_ch++)
+	{
+		st_stats.st_ch[u1_ch].s4_sum    = 0;
+		st_stats.st_ch[u1_ch].s8_sum_iy = 0;
+		st_stats.st_ch[u1_ch].u8_sum_yy = 0;
+	}
+	st_stats.u1_pos = 0;
+	st_stats.u1_n   = 0;
+	st_stats.u1_cnt = 0;
+}
+#endif
+
+/**
+ * @fn              static BOOL stats_update(const s4* ps4_temp)
+ * @fid             [FID075]-[stats_update]
+ * @fnbrf           Slide the window of every output channel by one sample
+ * @param[in]       ps4_temp ; const s4* ; temperature of each channel
+ * @param[in,out]   -
+ * @retval          1 : RUN_STATS samples since the last record
+ * @warning         -
+ * @remark          O(1) per channel, i = 0 is the oldest sample :
+ *                  sum(i*y)' = sum(i*y) - sum(y) + y_old + (n-1)*y_new
+ */
+static BOOL stats_update(const s4* ps4_temp)
+{
+	STATS_CH* pst_ch = 0;
+	s4        s4_y   = 0;
+	s4        s4_old = 0;
+	u1        u1_ch  = 0;
+
+	for (u1_ch = 0; u1_ch < ADC_CH_MAX; u1_ch++)
+	{
+		if (((RUN_CH_MASK >> u1_ch) & 0x01) == 0)
+		{
+			continue;
+		}
+		pst_ch = &st_stats.st_ch[u1_ch];
+		s4_y   = ps4_temp[u1_ch];
+		if (st_stats.u1_n < STATS_WIN)
+		{
+			pst_ch->s8_sum_iy += (s8)st_stats.u1_n * s4_y;
+		}
+		else
+		{
+			s4_old = pst_ch->s4_win[st_stats.u1_pos];
+			pst_ch->s8_sum_iy += ((s8)(STATS_WIN - 1) * s4_y) - pst_ch->s4_sum + s4_old;
+			pst_ch->s4_sum    -= s4_old;
+			pst_ch->u8_sum_yy -= (u8)((s8)s4_old * s4_old);
+		}
+		pst_ch->s4_sum    += s4_y;
+		pst_ch->u8_sum_yy += (u8)((s8)s4_y * s4_y);
+		pst_ch->s4_win[st_stats.u1_pos] = s4_y;
+	}
+	st_stats.u1_pos = (u1)((st_stats.u1_pos + 1) & STATS_MASK);
+	if (st_stats.u1_n < STATS_WIN)
+	{
+		st_stats.u1_n++;
+	}
+
+	st_stats.u1_cnt++;
+	if (st_stats.u1_cnt < RUN_STATS)
+	{
+		return 0;
+	}
+	st_stats.u1_cnt = 0;
+	return 1;
+}
+
+/**
+ * @fn              static void stats_calc(u1 u1_ch, u1 u1_frac, s4* ps4_out)
+ * @fid             [FID076]-[stats_calc]
+ * @fnbrf           Mean, standard deviation and slope of one channel window
+ * @param[in]       u1_ch ; u1 ; channel
+ * @param[in]       u1_frac ; u1 ; decimals of the results (0 - 4)
+ * @param[in,out]   ps4_out ; s4* ; [0] mean, [1] deviation (table unit),
+ *                  [2] slope (table unit per second), each * 10^u1_frac
+ * @retval          -
+ * @warning         The slope takes the current period for every sample of
+ *                  the window, ADAPT changes the period within it.
+ * @remark          Least squares over i = 0..n-1 :
+ *                  slope = (12 sum(i*y) - 6 (n-1) sum(y)) / (n (n^2 - 1))
+ *                  variance = (n sum(y^2) - sum(y)^2) / n^2
+ *                  The only divisions of the module, once per record.
  */
-static s4 s2g_glmap1b_s2pt(s2 X, const s4* MAP)
+static void stats_calc(u1 u1_ch, u1 u1_frac, s4* ps4_out)
 {
-    return (MAP[X]);
+	static const s4 pow10_tbl[] = { 1, 10, 100, 1000, 10000 };
+	const STATS_CH* pst_ch  = &st_stats.st_ch[u1_ch];
+	s8              s8_n    = (s8)st_stats.u1_n;
+	s8              s8_sum  = (s8)pst_ch->s4_sum;
+	s8              s8_pow  = (s8)pow10_tbl[u1_frac];
+	u8              u8_var  = 0;
+	s8              s8_num  = 0;
+
+	ps4_out[0] = 0;
+	ps4_out[1] = 0;
+	ps4_out[2] = 0;
+	if (s8_n == 0)
+	{
+		return;
+	}
+	ps4_out[0] = (s4)((s8_sum * s8_pow) / s8_n);
+	if (s8_n < 2)
+	{
+		return;
+	}
+
+	u8_var = (((u8)s8_n * pst_ch->u8_sum_yy) - (u8)(s8_sum * s8_sum)) / (u8)s8_n;
+	ps4_out[1] = (s4)stats_isqrt((u8_var * (u8)(s8_pow * s8_pow)) / (u8)s8_n);
+
+	s8_num = (12 * pst_ch->s8_sum_iy) - (6 * (s8_n - 1) * s8_sum);
+	ps4_out[2] = (s4)((s8_num * s8_pow * 1000) /
+	                  (s8_n * ((s8_n * s8_n) - 1) * ((s8)RUN_TICK * TICK_MS)));
+}
+
+/**
+ * @fn              static u4 stats_isqrt(u8 u8_x)
+ * @fid             [FID077]-[stats_isqrt]
+ * @fnbrf           Integer square root, rounded down
+ * @param[in]       u8_x ; u8 ; value
+ * @param[in,out]   -
+ * @retval          u4_root ; u4 ; floor(sqrt(u8_x))
+ * @warning         -
+ * @remark          Bit by bit, 32 iterations, no division.
+ */
+static u4 stats_isqrt(u8 u8_x)
+{
+	u8 u8_root = 0;
+	u8 u8_bit  = 1ULL << 62;
+
+	while (u8_bit > u8_x)
+	{
+		u8_bit >>= 2;
+	}
+	while (u8_bit != 0)
+	{
+		if (u8_x >= (u8_root + u8_bit))
+		{
+			u8_x   -= u8_root + u8_bit;
+			u8_root = (u8_root >> 1) + u8_bit;
+		}
+		else
+		{
+			u8_root >>= 1;
+		}
+		u8_bit >>= 2;
+	}
+	return (u4)u8_root;
+}
+
+/**
+ * @fn              static void stats_record(TRACE_REC* pst_trace)
+ * @fid             [FID078]-[stats_record]
+ * @fnbrf           Send one statistics record of the output channels
+ * @param[in]       -
+ * @param[in,out]   pst_trace ; TRACE_REC* ; stamped when formatted
+ * @retval          -
+ * @warning         -
+ * @remark          Text : "Stats : n\tMean : m\tSD : d\tSlope : s/s\tMean1 : ..",
+ *                  RUN_PREC decimals.
+ *                  Binary : A5 5A 'W' seq mask n (mean sd slope)*ch sum(2),
+ *                  s4 little endian in 1/100 table unit (per second).
+ */
+static void stats_record(TRACE_REC* pst_trace)
+{
+	s4 s4_out[3] = { 0 };
+	u1 u1_ch     = 0;
+#if CFG_BIN_ON
+	u1 u1_i      = 0;
+	u1 u1_b      = 0;
+#endif
+
+	if (RUN_FORMAT == OUT_FMT_BIN)
+	{
+#if CFG_BIN_ON
+		TRACE_STAMP(*pst_trace, TRACE_FMT);
+		frame_begin(FRAME_TYPE_STATS);
+		frame_put((u1)u4_sample_cnt);
+		frame_put(RUN_CH_MASK);
+		frame_put(st_stats.u1_n);
+		for (u1_ch = 0; u1_ch < ADC_CH_MAX; u1_ch++)
+		{
+			if ((RUN_CH_MASK >> u1_ch) & 0x01)
+			{
+				stats_calc(u1_ch, 2, s4_out);
+				for (u1_i = 0; u1_i < 3; u1_i++)
+				{
+					for (u1_b = 0; u1_b < 4; u1_b++)
+					{
+						frame_put((u1)((u4)s4_out[u1_i] >> (u1_b * 8)));
+					}
+				}
+			}
+		}
+		frame_end();
+#endif
+	}
+	else
+	{
+#if CFG_TEXT_ON
+		TRACE_STAMP(*pst_trace, TRACE_FMT);
+		uart_put_num("Stats : ", st_stats.u1_n);
+		for (u1_ch = 0; u1_ch < ADC_CH_MAX; u1_ch++)
+		{
+			if ((RUN_CH_MASK >> u1_ch) & 0x01)
+			{
+				stats_calc(u1_ch, (u1)RUN_PREC, s4_out);
+				stats_put("\tMean", u1_ch, s4_out[0]);
+				stats_put("\tSD", u1_ch, s4_out[1]);
+				stats_put("\tSlope", u1_ch, s4_out[2]);
+				uart_puts("/s");
+			}
+		}
+		uart_putc('\n');
+#endif
+	}
+}
+
+#if CFG_TEXT_ON
+/**
+ * @fn              static void stats_put(const char* s1_label, u1 u1_ch, s4 s4_val)
+ * @fid             [FID079]-[stats_put]
+ * @fnbrf           Print "label[ch] : value" with RUN_PREC decimals
+ * @param[in]       s1_label ; const char* ; label
+ * @param[in]       u1_ch ; u1 ; channel, no number for AN0
+ * @param[in]       s4_val ; s4 ; value * 10^RUN_PREC
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void stats_put(const char* s1_label, u1 u1_ch, s4 s4_val)
+{
+	char s1_buf[OUT_BUF_SIZE] = { 0 };
+	u1   u1_i                 = 0;
+
+	out_field(s1_buf, OUT_BUF_SIZE - 1, s4_val, (u1)RUN_PREC);
+	while (s1_buf[u1_i] == ' ')
+	{
+		u1_i++;
+	}
+	uart_puts(s1_label);
+	if (u1_ch != 0)
+	{
+		uart_putc((char)('0' + u1_ch));
+	}
+	uart_puts(" : ");
+	uart_puts(&s1_buf[u1_i]);
+}
+#endif
+#endif
+
+#if (CFG_CAL != 0)
+/**
+ * @fn              static void cal_load(void)
+ * @fid             [FID052]-[cal_load]
+ * @fnbrf           Load the calibration from data flash block A
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          Records are appended, the last one with a good checksum
+ *                  wins, the first erased slot ends the scan. Unity gain and
+ *                  no offset when there is none.
+ */
+static void cal_load(void)
+{
+	CAL_REC st_rec;
+	u2*     pu2_w   = (u2*)&st_rec;
+	u2      u2_slot = 0;
+	u2      u2_i    = 0;
+	u1      u1_ch   = 0;
+
+	prc1 = 1;       /* PM1 write enable                    */
+	pm10 = 1;       /* 0E000h - 0FFFFh is data flash       */
+	prc1 = 0;
+
+	for (u1_ch = 0; u1_ch < ADC_CH_MAX; u1_ch++)
+	{
+		st_cal.s2_offset[u1_ch] = 0;
+		st_cal.u2_gain[u1_ch]   = CAL_GAIN_ONE;
+	}
+	st_cal.u2_seq = 0;
+
+	for (u2_slot = 0; u2_slot < CAL_REC_MAX; u2_slot++)
+	{
+		for (u2_i = 0; u2_i < CAL_REC_WORDS; u2_i++)
+		{
+			pu2_w[u2_i] = DFLASH_RD((u2_slot * CAL_REC_WORDS) + u2_i);
+		}
+		if (st_rec.u2_magic == 0xFFFF)
+		{
+			break;
+		}
+		if ((st_rec.u2_magic == CAL_MAGIC) && (st_rec.u2_sum == cal_sum(&st_rec)))
+		{
+			st_cal = st_rec;
+		}
+	}
+	u2_cal_next = u2_slot;
+}
+
+#if (CFG_CMD != 0)
+/**
+ * @fn              static BOOL cal_save(void)
+ * @fid             [FID053]-[cal_save]
+ * @fnbrf           Append the calibration to data flash block A
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          1 : programmed and read back
+ * @warning         The block is erased when it is full (every CAL_REC_MAX
+ *                  saves, 0.3 s with interrupts disabled). A reset before
+ *                  the new record is programmed loses the calibration.
+ *                  CAL SAVE is refused while streaming and replies the
+ *                  blackout.
+ * @remark          A failed slot is not used again until the next erase.
+ */
+static BOOL cal_save(void)
+{
+	const u2* pu2_w   = (const u2*)&st_cal;
+	u2        u2_base = 0;
+	u2        u2_i    = 0;
+	BOOL      b_ok    = 1;
+
+	st_cal.u2_magic = CAL_MAGIC;
+	st_cal.u2_seq++;
+	st_cal.u2_rsv   = 0;
+	st_cal.u2_sum   = cal_sum(&st_cal);
+
+	dflash_mode(1);
+	if (u2_cal_next >= CAL_REC_MAX)
+	{
+		b_ok        = dflash_erase();
+		u2_cal_next = 0;
+	}
+	u2_base = u2_cal_next * CAL_REC_WORDS;
+	u2_cal_next++;
+	for (u2_i = 0; (u2_i < CAL_REC_WORDS) && (b_ok != 0); u2_i++)
+	{
+		b_ok = dflash_program(u2_base + u2_i, pu2_w[u2_i]);
+	}
+	dflash_mode(0);
+
+	for (u2_i = 0; (u2_i < CAL_REC_WORDS) && (b_ok != 0); u2_i++)
+	{
+		b_ok = (BOOL)(DFLASH_RD(u2_base + u2_i) == pu2_w[u2_i]);
+	}
+	return b_ok;
+}
+#endif
+
+/**
+ * @fn              static u2 cal_sum(const CAL_REC* pst_rec)
+ * @fid             [FID054]-[cal_sum]
+ * @fnbrf           Checksum of a calibration record
+ * @param[in]       pst_rec ; const CAL_REC* ; record
+ * @param[in,out]   -
+ * @retval          u2_sum ; u2 ; rotate and add of the words before u2_sum
+ * @warning         -
+ * @remark          CAL_SUM_INIT so that an all zero record does not pass.
+ */
+static u2 cal_sum(const CAL_REC* pst_rec)
+{
+	const u2* pu2_w  = (const u2*)pst_rec;
+	u2        u2_sum = CAL_SUM_INIT;
+	u2        u2_i   = 0;
+
+	for (u2_i = 0; u2_i < (CAL_REC_WORDS - 1); u2_i++)
+	{
+		u2_sum = (u2)(((u2_sum << 1) | (u2_sum >> 15)) + pu2_w[u2_i]);
+	}
+	return u2_sum;
+}
+
+#if CONV_ON
+/**
+ * @fn              static s4 cal_apply(u1 u1_ch, s4 s4_temp)
+ * @fid             [FID055]-[cal_apply]
+ * @fnbrf           Apply the gain and offset of a channel
+ * @param[in]       u1_ch ; u1 ; channel
+ * @param[in]       s4_temp ; s4 ; temperature, table unit
+ * @param[in,out]   -
+ * @retval          s4_temp ; s4 ; calibrated temperature
+ * @warning         -
+ * @remark          One multiply and shift, skipped at unity gain, then one
+ *                  add. Rounded half away from zero without shifting a
+ *                  negative value.
+ */
+static s4 cal_apply(u1 u1_ch, s4 s4_temp)
+{
+	s4 s4_y = s4_temp;
+
+	if (st_cal.u2_gain[u1_ch] != CAL_GAIN_ONE)
+	{
+		s4_y *= (s4)st_cal.u2_gain[u1_ch];
+		s4_y  = (s4_y >= 0) ? ((s4_y + CAL_GAIN_HALF) >> CAL_GAIN_SHIFT) :
+		                      -((CAL_GAIN_HALF - s4_y) >> CAL_GAIN_SHIFT);
+	}
+	return s4_y + st_cal.s2_offset[u1_ch];
+}
+#endif
+
+#if (CFG_CMD != 0)
+/**
+ * @fn              static void dflash_mode(BOOL b_rewrite)
+ * @fid             [FID056]-[dflash_mode]
+ * @fnbrf           Enter or leave CPU rewrite mode (EW1)
+ * @param[in]       b_rewrite ; BOOL ; 1 : enter, 0 : back to read array
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          FMR01 and FMR11 are set by writing 0 then 1 in
+ *                  succession, no interrupt in between. EW1 mode runs
+ *                  this code from flash, the CPU is held while the data
+ *                  block is busy.
+ */
+static void dflash_mode(BOOL b_rewrite)
+{
+	ENTER_CRITICAL;
+	if (b_rewrite != 0)
+	{
+		fmr01 = 0;
+		fmr01 = 1;  /* CPU rewrite mode */
+		fmr11 = 0;
+		fmr11 = 1;  /* EW1 mode         */
+	}
+	else
+	{
+		DFLASH_WR(0, DFLASH_CMD_READ);
+		fmr01 = 0;
+	}
+	EXIT_CRITICAL;
+}
+
+/**
+ * @fn              static BOOL dflash_program(u2 u2_idx, u2 u2_data)
+ * @fid             [FID057]-[dflash_program]
+ * @fnbrf           Program one word of data flash block A
+ * @param[in]       u2_idx ; u2 ; word index from 0F000h
+ * @param[in]       u2_data ; u2 ; data
+ * @param[in,out]   -
+ * @retval          1 : programmed
+ * @warning         CPU rewrite mode only (dflash_mode)
+ * @remark          Interrupts are served between words.
+ */
+static BOOL dflash_program(u2 u2_idx, u2 u2_data)
+{
+	BOOL b_ok = 0;
+
+	ENTER_CRITICAL;
+	DFLASH_WR(u2_idx, DFLASH_CMD_PROGRAM);
+	DFLASH_WR(u2_idx, u2_data);
+	while (fmr00 == 0)
+	{
+	}
+	b_ok = (BOOL)(fmr06 == 0);
+	if (b_ok == 0)
+	{
+		DFLASH_WR(u2_idx, DFLASH_CMD_CLEAR);
+	}
+	EXIT_CRITICAL;
+	return b_ok;
+}
+
+/**
+ * @fn              static BOOL dflash_erase(void)
+ * @fid             [FID058]-[dflash_erase]
+ * @fnbrf           Erase data flash block A
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          1 : erased
+ * @warning         CPU rewrite mode only (dflash_mode)
+ * @remark          -
+ */
+static BOOL dflash_erase(void)
+{
+	BOOL b_ok = 0;
+
+	ENTER_CRITICAL;
+	DFLASH_WR(0, DFLASH_CMD_ERASE);
+	DFLASH_WR(0, DFLASH_CMD_CONFIRM);
+	while (fmr00 == 0)
+	{
+	}
+	b_ok = (BOOL)(fmr07 == 0);
+	if (b_ok == 0)
+	{
+		DFLASH_WR(0, DFLASH_CMD_CLEAR);
+	}
+	EXIT_CRITICAL;
+	return b_ok;
+}
+#endif
+#endif
+
+/**
+ * @fn              static void cpu_idle(void)
+ * @fid             [FID016]-[cpu_idle]
+ * @fnbrf           Idle until the next interrupt
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          Wake-up sources : every interrupt (tick, A/D, UART, DMA).
+ *                  b_wake is checked with interrupts disabled : an interrupt
+ *                  accepted after the caller's check and before the check
+ *                  here returns at once, so the caller looks again. FSET I
+ *                  is the instruction just before WAIT, the M16C accepts a
+ *                  pending interrupt only after the next instruction, so
+ *                  none is accepted between the check and WAIT.
+ */
+static void cpu_idle(void)
+{
+#if (RUN_MODE == RUN_MODE_WAIT)
+	u4 u4_sleep = 0;
+
+	u4_sleep = hal_time_stamp();
+	ENTER_CRITICAL;
+	if (b_wake == 0)
+	{
+		b_sleeping = 1;
+		EXIT_CRITICAL;
+		_asm("WAIT");
+		_asm("NOP");    /* NOPs after WAIT as the hardware manual requires */
+		_asm("NOP");
+		_asm("NOP");
+		_asm("NOP");
+		b_sleeping = 0;
+		u4_sleep_cnt += hal_time_elapsed(u4_sleep, hal_time_stamp());
+	}
+	else
+	{
+		EXIT_CRITICAL;
+	}
+	b_wake = 0;
+#else
+	_asm("NOP");
+#endif
+}
+
+#if (CFG_MEM != 0)
+/**
+ * @fn              static void stack_paint(volatile u1* pu1_mark)
+ * @fid             [FID066]-[stack_paint]
+ * @fnbrf           Fill the free user stack with STACK_PAINT
+ * @param[in]       pu1_mark ; volatile u1* ; local of main, depth 0
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         Called first in main, nothing below the mark is live
+ *                  except this frame, which STACK_GUARD keeps clear.
+ * @remark          The range ends STACK_TOP_USE below the stack top
+ *                  (STACK_SIZE above the lowest byte), so it never reaches
+ *                  the section under the stack. Interrupts run on the ISP
+ *                  stack (ISTACKSIZE) and are not measured.
+ *                  The range is outside any C object, it is taken from the
+ *                  mark read back through the volatile pointer.
+ */
+static void stack_paint(volatile u1* pu1_mark)
+{
+	volatile u1* pu1_p = 0;
+
+	pu1_stack_mark = pu1_mark;
+	pu1_stack_low  = pu1_stack_mark - (STACK_SIZE - STACK_TOP_USE);
+	for (pu1_p = pu1_stack_low; pu1_p < (pu1_stack_mark - STACK_GUARD); pu1_p++)
+	{
+		*pu1_p = STACK_PAINT;
+	}
+}
+
+/**
+ * @fn              static u2 stack_scan(void)
+ * @fid             [FID067]-[stack_scan]
+ * @fnbrf           Count the painted bytes the stack never reached
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          bytes ; u2 ; untouched bytes from the lowest painted one
+ * @warning         A local that happens to hold STACK_PAINT at the deepest
+ *                  point reads as untouched, off by a few bytes at most.
+ * @remark          -
+ */
+static u2 stack_scan(void)
+{
+	volatile u1* pu1_p = pu1_stack_low;
+
+	while ((pu1_p < (pu1_stack_mark - STACK_GUARD)) && (*pu1_p == STACK_PAINT))
+	{
+		pu1_p++;
+	}
+	return (u2)(pu1_p - pu1_stack_low);
+}
+
+/**
+ * @fn              static void mem_report(void)
+ * @fid             [FID068]-[mem_report]
+ * @fnbrf           Print the RAM of each subsystem and the stack high-water mark
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          "RAM : txq 64 .. total n" static buffers, then
+ *                  "Stack : used/STACK_SIZE free : n", used counts
+ *                  STACK_TOP_USE and the guard as used.
+ */
+static void mem_report(void)
+{
+	u4 u4_total = 0;
+	u2 u2_free  = 0;
+	u1 u1_i     = 0;
+
+	for (u1_i = 0; u1_i < (sizeof(st_ram_use) / sizeof(st_ram_use[0])); u1_i++)
+	{
+		uart_puts((u1_i == 0) ? "RAM : " : "\t");
+		uart_puts(st_ram_use[u1_i].s1_name);
+		uart_put_num(" ", st_ram_use[u1_i].u2_bytes);
+		u4_total += st_ram_use[u1_i].u2_bytes;
+	}
+	uart_put_num("\ttotal ", u4_total);
+	uart_putc('\n');
+
+	u2_free = stack_scan();
+	uart_put_num("Stack : ", (u4)STACK_SIZE - u2_free);
+	uart_put_num("/", STACK_SIZE);
+	uart_put_num("\tfree : ", u2_free);
+	uart_putc('\n');
+}
+#endif
+
+#if (CFG_REPORT != 0)
+/**
+ * @fn              static void power_report(void)
+ * @fid             [FID017]-[power_report]
+ * @fnbrf           Print duty cycle and wake-up latency every POWER_REPORT_SAMPLE
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         Printed in FMT TXT only, the interval restarts in both formats.
+ * @remark          Duty cycle = awake / total time of the report interval
+ */
+static void power_report(void)
+{
+	static u2 u2_sample_cnt = 0;
+	static u4 u4_report_stamp = 0;
+	char  duty_buf[10]        = { 0 };
+	char  lat_buf[10]         = { 0 };
+	u4    u4_now              = 0;
+	u4    u4_total            = 0;
+	f8    f8_duty             = 0.0;
+	f8    f8_lat              = 0.0;
+
+	u2_sample_cnt++;
+	if (u2_sample_cnt < POWER_REPORT_SAMPLE)
+	{
+		return;
+	}
+
+	u4_now   = hal_time_stamp();
+	u4_total = hal_time_elapsed(u4_report_stamp, u4_now);
+	if (u4_total > u4_sleep_cnt)
+	{
+		f8_duty = (f8)(u4_total - u4_sleep_cnt) * 100.0 / (f8)u4_total;
+	}
+	f8_lat = (f8)u2_wake_lat_max * 166 / 1000; /* counts to us */
+
+	if (RUN_FORMAT != OUT_FMT_BIN)
+	{
+		ftoa(f8_duty, duty_buf, 2);
+		ftoa(f8_lat, lat_buf, 2);
+		uart_puts("Duty cycle : ");
+		uart_puts(duty_buf);
+		uart_puts("%\tWake latency : ");
+		uart_puts(lat_buf);
+		uart_puts("us\n");
+	}
+
+	u2_sample_cnt   = 0;
+	u4_report_stamp = u4_now;
+	u4_sleep_cnt    = 0;
+	u2_wake_lat_max = 0;
+}
+#endif
+
+/**
+ * @fn              void ta3_isr(void)
+ * @fid             [FID018]-[ta3_isr]
+ * @fnbrf           Scheduler tick, starts the A/D sweep every sample period
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          ta3 reloaded at underflow, so counts gone = wake-up latency
+ */
+void ta3_isr(void)
+{
+	u2 u2_lat = 0;
+
+	if (b_sleeping != 0)
+	{
+		u2_lat = (u2)((TA3_PERIOD - 1) - ta3);
+		if (u2_lat > u2_wake_lat_max)
+		{
+			u2_wake_lat_max = u2_lat;
+		}
+		b_sleeping = 0;
+	}
+	b_wake = 1;
+
+	u1_tick_cnt++;
+	if ((u1_tick_cnt >= RUN_TICK) && (APP_MODE_NOW == APP_MODE_STREAM))
+	{
+		u1_tick_cnt = 0;
+		adst = 1; /* A/D sweep start */
+	}
+}
+
+/**
+ * @fn              void ad_isr(void)
+ * @fid             [FID019]-[ad_isr]
+ * @fnbrf           A/D sweep complete
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          CFG_POOL : the codes go into a free record handed to main,
+ *                  so a sweep waits in the pool while main is busy. No free
+ *                  record : the sweep is lost and counted. CFG_CMD : the
+ *                  record keeps the channel mask it was swept with.
+ */
+void ad_isr(void)
+{
+#if (CFG_POOL != 0)
+	POOL_REC* pst_rec = 0;
+	u1        u1_rec  = 0;
+	u1        u1_ch   = 0;
+
+	b_wake = 1;
+	if (pool_q_get(&st_pool_free, &u1_rec) == 0)
+	{
+		u2_pool_drop++;
+		return;
+	}
+	pst_rec = &st_pool_rec[u1_rec];
+	do
+	{
+		pst_rec->u2_adc_hi = ta4;
+		pst_rec->u2_adc_lo = ta3;
+	} while (pst_rec->u2_adc_hi != ta4);
+#if (CFG_CMD != 0)
+	pst_rec->u1_mask = RUN_CH_MASK;
+#endif
+	for (u1_ch = 0; u1_ch < ADC_CH_MAX; u1_ch++)
+	{
+		if ((RUN_CH_MASK >> u1_ch) & 0x01)
+		{
+			pst_rec->u1_code[u1_ch] = (u1)hal_adc_read(u1_ch);
+		}
+	}
+	if ((u1)(st_pool_free.u1_head - st_pool_free.u1_tail) < u1_pool_low)
+	{
+		u1_pool_low = (u1)(st_pool_free.u1_head - st_pool_free.u1_tail);
+	}
+	(void)pool_q_put(&st_pool_acq, u1_rec);
+#else
+	b_wake = 1;
+	TRACE_STAMP(st_trace_adc, TRACE_ADC);
+	b_adc_done = 1;
+#endif
+}
+
+#if (CFG_TX == CFG_TX_DMA)
+/**
+ * @fn              void uart1_tx_isr(void)
+ * @fid             [FID020]-[uart1_tx_isr]
+ * @fnbrf           UART1 transmission complete, start the bytes queued since
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          CFG_TX_DMA : DMA0 moves the bytes, this interrupt is only
+ *                  enabled (u1irs = 1) once the queue ran empty, to learn
+ *                  when the last byte is out.
+ */
+void uart1_tx_isr(void)
+{
+#if (CFG_REPORT != 0)
+	u4 u4_start = hal_time_stamp();
+
+#endif
+	b_wake = 1;
+	u2_tx_sent     = (u2)(u2_tx_sent + u1_tx_inflight);
+	u1_tx_inflight = 0;
+	s1tic          = 0; /* transmit requests trigger DMA0 only */
+	u1irs          = 0;
+
+#if (CFG_REPORT != 0)
+	trace_sent();
+#endif
+
+#if URG_ON
+	if ((TX_PENDING != 0) || URG_PENDING)
+#else
+	if (TX_PENDING != 0)
+#endif
+	{
+		tx_dma_start();
+	}
+	else
+	{
+		b_tx_busy = 0;
+	}
+#if (CFG_REPORT != 0)
+	tx_cost(u4_start);
+#endif
+}
+
+/**
+ * @fn              void dma0_isr(void)
+ * @fid             [FID071]-[dma0_isr]
+ * @fnbrf           DMA0 moved its run into u1tb, release it and hand over the next
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         The next run must be armed before u1tb empties, one
+ *                  character time, or its first request is lost :
+ *                  IPL_DMA_TX is the highest level.
+ * @remark          The last byte of the run waits in u1tb and the one before
+ *                  is shifting, every byte before them is out.
+ */
+void dma0_isr(void)
+{
+#if (CFG_REPORT != 0)
+	u4 u4_start = hal_time_stamp();
+
+#endif
+	b_wake = 1;
+	tx_done(u1_tx_dma);
+	u1_tx_inflight = (u1)(u1_tx_inflight + u1_tx_dma);
+	u1_tx_dma      = 0;
+	if (u1_tx_inflight > 2)
+	{
+		u2_tx_sent     = (u2)(u2_tx_sent + u1_tx_inflight - 2);
+		u1_tx_inflight = 2;
+	}
+
+#if (CFG_REPORT != 0)
+	trace_sent();
+#endif
+
+	tx_dma_arm();
+#if (CFG_REPORT != 0)
+	tx_cost(u4_start);
+#endif
+}
+
+/**
+ * @fn              static void tx_dma_start(void)
+ * @fid             [FID069]-[tx_dma_start]
+ * @fnbrf           Start an idle transmitter : first byte by the CPU, the rest by DMA0
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         Called with interrupts disabled or from uart1_tx_isr.
+ * @remark          An idle UART1 raises no transmit request until u1tb is
+ *                  written, so DMA0 is armed first and the write makes the
+ *                  request that starts it.
+ *                  Stays idle when only urgent bytes wait behind part of a
+ *                  line, the uart_putc that follows starts it.
+ */
+static void tx_dma_start(void)
+{
+	const volatile char* ps1_src  = 0;
+	char                 s1_first = 0;
+
+	if (tx_run(&ps1_src, 1) == 0)
+	{
+		b_tx_busy = 0;
+		return;
+	}
+	s1_first       = *ps1_src;
+	tx_done(1);
+	b_tx_busy      = 1;
+	u1_tx_inflight = 1;
+	tx_dma_arm();
+	u1tb = s1_first;
+}
+
+/**
+ * @fn              static void tx_dma_arm(void)
+ * @fid             [FID070]-[tx_dma_arm]
+ * @fnbrf           Hand the next run (tx_run) to DMA0
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          Queued bytes : up to DMA_RUN_MAX, ending at the queue end.
+ *                  They stay in the queue (tail unchanged) until dma0_isr,
+ *                  so uart_putc / uart_write do not overwrite them.
+ *                  Record line (POOL_TX_ON) : the whole rest in one run, from
+ *                  the record, which nothing writes until it is freed.
+ *                  Nothing queued : UART1 interrupts when the last byte is out.
+ */
+static void tx_dma_arm(void)
+{
+	const volatile char* ps1_src = 0;
+
+#if POOL_TX_ON
+	u1_tx_dma = tx_run(&ps1_src, U1_MAX);
+	if ((u1_tx_rec == POOL_NONE) && (u1_tx_dma > DMA_RUN_MAX))
+	{
+		u1_tx_dma = DMA_RUN_MAX;
+	}
+#else
+	u1_tx_dma = tx_run(&ps1_src, DMA_RUN_MAX);
+#endif
+	if (u1_tx_dma != 0)
+	{
+		DMA0_SRC(ps1_src);
+		tcr0   = (u2)(u1_tx_dma - 1);
+		dm0con = DMA_CON_TX;
+	}
+	else
+	{
+		u1irs = 1;
+		s1tic = IPL_UART_TX;
+	}
+}
+#else
+/**
+ * @fn              void uart1_tx_isr(void)
+ * @fid             [FID020]-[uart1_tx_isr]
+ * @fnbrf           UART1 transmit buffer empty, send next queued character
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          u1irs = 0 : byte moved from u1tb to the shift register, so
+ *                  the byte shifting before it is done.
+ *                  u1irs = 1 : used once the queue is empty, to learn when the
+ *                  last byte is done.
+ */
+void uart1_tx_isr(void)
+{
+	const volatile char* ps1_src = 0;
+#if (CFG_REPORT != 0)
+	u4 u4_start = hal_time_stamp();
+
+#endif
+	b_wake = 1;
+	if (u1irs != 0)
+	{
+		u2_tx_sent     = (u2)(u2_tx_sent + u1_tx_inflight);
+		u1_tx_inflight = 0;
+		u1irs          = 0;
+		ir_s1tic       = 0;
+	}
+	else if (u1_tx_inflight > 1)
+	{
+		u2_tx_sent++;
+		u1_tx_inflight--;
+	}
+
+#if (CFG_REPORT != 0)
+	trace_sent();
+#endif
+
+	if (tx_run(&ps1_src, 1) != 0)
+	{
+		u1tb = *ps1_src;
+		tx_done(1);
+		u1_tx_inflight++;
+	}
+	else if (u1_tx_inflight != 0)
+	{
+		u1irs = 1; /* interrupt again when transmission completes */
+	}
+	else
+	{
+		b_tx_busy = 0;
+	}
+#if (CFG_REPORT != 0)
+	tx_cost(u4_start);
+#endif
+}
+
+#if CFG_TEXT_ON
+/**
+ * @fn              static void tx_start(void)
+ * @fid             [FID089]-[tx_start]
+ * @fnbrf           Start an idle transmitter with the next byte
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         Called with interrupts disabled.
+ * @remark          Stays idle when only urgent bytes wait behind part of a
+ *                  line, the uart_putc that follows starts it.
+ */
+static void tx_start(void)
+{
+	const volatile char* ps1_src = 0;
+
+	if (tx_run(&ps1_src, 1) == 0)
+	{
+		return;
+	}
+	b_tx_busy      = 1;
+	u1_tx_inflight = 1;
+	u1tb = *ps1_src;
+	tx_done(1);
+}
+#endif
+#endif
+
+#if (CFG_REPORT != 0)
+/**
+ * @fn              static void trace_sent(void)
+ * @fid             [FID072]-[trace_sent]
+ * @fnbrf           Stamp TRACE_SENT of the traced lines whose last byte is out
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         Called from the transmit interrupt functions.
+ * @remark          URG_ON : u2_tx_last counts queued bytes only, the urgent
+ *                  bytes taken are left out of u2_tx_sent (late by the
+ *                  urgent bytes still shifting, 2 at most).
+ */
+static void trace_sent(void)
+{
+#if URG_ON
+	u2 u2_sent = (u2)(u2_tx_sent - u2_urg_taken);
+#else
+	u2 u2_sent = u2_tx_sent;
+#endif
+
+	while ((u1_trace_sent != u1_trace_wr) &&
+	       ((s2)(u2_sent - st_trace_rec[u1_trace_sent & TRACE_MASK].u2_tx_last) >= 0))
+	{
+		TRACE_STAMP(st_trace_rec[u1_trace_sent & TRACE_MASK], TRACE_SENT);
+		u1_trace_sent++;
+	}
+}
+
+/**
+ * @fn              static void tx_cost(u4 u4_start)
+ * @fid             [FID073]-[tx_cost]
+ * @fnbrf           Count one transmit interrupt and the time spent in it
+ * @param[in]       u4_start ; u4 ; hal_time_stamp at the interrupt entry
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          Interrupt entry and REIT are not included, STAT reports
+ *                  the interrupt count next to it.
+ */
+static void tx_cost(u4 u4_start)
+{
+	u4_tx_irq++;
+	u4_tx_cost += hal_time_elapsed(u4_start, hal_time_stamp());
+}
+#endif
+
+#if (CFG_REPORT != 0)
+/**
+ * @fn              static void trace_init(void)
+ * @fid             [FID021]-[trace_init]
+ * @fnbrf           Measure the cost of one trace stamp
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          Two stamps back to back, ta3/ta4 must be running
+ */
+static void trace_init(void)
+{
+	TRACE_REC st_rec;
+
+	TRACE_STAMP(st_rec, 0);
+	TRACE_STAMP(st_rec, 1);
+	u2_trace_cost = (u2)hal_time_elapsed(TIME_COUNT(st_rec.u2_hi[0], st_rec.u2_lo[0]),
+	                                 TIME_COUNT(st_rec.u2_hi[1], st_rec.u2_lo[1]));
+}
+#endif
+
+/**
+ * @fn              static TRACE_REC* trace_begin(void)
+ * @fid             [FID022]-[trace_begin]
+ * @fnbrf           Take the trace record for the sample just converted
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          pst_rec ; TRACE_REC* ; record to stamp
+ * @warning         -
+ * @remark          If all records are still in flight the sample is not
+ *                  traced, a scratch record absorbs its stamps.
+ *                  Without CFG_REPORT every sample uses the scratch record.
+ */
+static TRACE_REC* trace_begin(void)
+{
+	static TRACE_REC st_scratch;
+	TRACE_REC* pst_rec = &st_scratch;
+
+#if (CFG_REPORT != 0)
+	if ((u1)(u1_trace_wr - u1_trace_done) < TRACE_DEPTH)
+	{
+		pst_rec = &st_trace_rec[u1_trace_wr & TRACE_MASK];
+	}
+	else
+	{
+		u2_trace_drop++;
+	}
+#endif
+	pst_rec->u2_hi[TRACE_ADC] = st_trace_adc.u2_hi[TRACE_ADC];
+	pst_rec->u2_lo[TRACE_ADC] = st_trace_adc.u2_lo[TRACE_ADC];
+#if STRIPE_ON
+	u1_stripe_last = STRIPE_U1;
+#endif
+	return pst_rec;
+}
+
+/**
+ * @fn              static void trace_commit(TRACE_REC* pst_rec)
+ * @fid             [FID023]-[trace_commit]
+ * @fnbrf           Hand the record to uart1_tx_isr for the last stamp
+ * @param[in]       pst_rec ; TRACE_REC* ; record from trace_begin
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          A frame striped to UART2 / UART0 is not traced, its end
+ *                  is not seen by uart1_tx_isr.
+ */
+static void trace_commit(TRACE_REC* pst_rec)
+{
+#if (CFG_REPORT != 0)
+	if (pst_rec != &st_trace_rec[u1_trace_wr & TRACE_MASK])
+	{
+		return;
+	}
+#if STRIPE_ON
+	if (u1_stripe_last != STRIPE_U1)
+	{
+		return;
+	}
+#endif
+	ENTER_CRITICAL;
+	pst_rec->u2_tx_last = u2_tx_queued;
+	u1_trace_wr++;
+	EXIT_CRITICAL;
+#else
+	(void)pst_rec;
+#endif
+}
+
+#if (CFG_REPORT != 0)
+/**
+ * @fn              static void trace_collect(void)
+ * @fid             [FID024]-[trace_collect]
+ * @fnbrf           Fold finished records into the stage distributions
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void trace_collect(void)
+{
+	TRACE_REC*  pst_rec  = 0;
+	TRACE_DIST* pst_dist = 0;
+	u4          u4_from  = 0;
+	u4          u4_to    = 0;
+	u4          u4_lat   = 0;
+	u1          u1_stage = 0;
+	u1          u1_bin   = 0;
+
+	while (u1_trace_done != u1_trace_sent)
+	{
+		pst_rec = &st_trace_rec[u1_trace_done & TRACE_MASK];
+
+		for (u1_stage = 0; u1_stage < TRACE_DIST_MAX; u1_stage++)
+		{
+			if (u1_stage < TRACE_SENT)
+			{
+				u4_from = TIME_COUNT(pst_rec->u2_hi[u1_stage], pst_rec->u2_lo[u1_stage]);
+				u4_to   = TIME_COUNT(pst_rec->u2_hi[u1_stage + 1], pst_rec->u2_lo[u1_stage + 1]);
+			}
+			else
+			{
+				/* end to end */
+				u4_from = TIME_COUNT(pst_rec->u2_hi[TRACE_ADC], pst_rec->u2_lo[TRACE_ADC]);
+				u4_to   = TIME_COUNT(pst_rec->u2_hi[TRACE_SENT], pst_rec->u2_lo[TRACE_SENT]);
+			}
+			u4_lat = hal_time_elapsed(u4_from, u4_to);
+
+			pst_dist = &st_trace_dist[u1_stage];
+			for (u1_bin = 0; (u1_bin < TRACE_BIN_MAX - 1) && ((u4_lat >> u1_bin) != 0); u1_bin++)
+			{
+			}
+			if (pst_dist->u2_bin[u1_bin] < U2_MAX)
+			{
+				pst_dist->u2_bin[u1_bin]++;
+			}
+			pst_dist->u4_sum += u4_lat;
+			if (u4_lat > pst_dist->u4_max)
+			{
+				pst_dist->u4_max = u4_lat;
+			}
+		}
+		u1_trace_done++;
+
+		u2_trace_cnt++;
+		if (u2_trace_cnt >= TRACE_REPORT_SAMPLE)
+		{
+			trace_report();
+		}
+	}
+}
+
+/**
+ * @fn              static void trace_report(void)
+ * @fid             [FID025]-[trace_report]
+ * @fnbrf           Print mean, 99th percentile and maximum of each stage
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         Printed in FMT TXT only, the statistics are cleared in both formats.
+ * @remark          p99 is the upper edge of the bin holding the 99th percentile
+ */
+static void trace_report(void)
+{
+	char        num_buf[12] = { 0 };
+	TRACE_DIST* pst_dist    = 0;
+	u2          u2_rank     = 0;
+	u2          u2_acc      = 0;
+	u1          u1_stage    = 0;
+	u1          u1_bin      = 0;
+
+	if (RUN_FORMAT != OUT_FMT_BIN)
+	{
+		uart_puts("Trace samples : ");
+		ftoa((f8)u2_trace_cnt, num_buf, 0);
+		uart_puts(num_buf);
+		uart_puts("\tdrop : ");
+		ftoa((f8)u2_trace_drop, num_buf, 0);
+		uart_puts(num_buf);
+		uart_puts("\tstamp : ");
+		ftoa((f8)u2_trace_cost * 166 / 1000, num_buf, 2);
+		uart_puts(num_buf);
+		uart_puts("us\n");
+
+		u2_rank = (u2)(u2_trace_cnt - (u2_trace_cnt / 100));
+		for (u1_stage = 0; u1_stage < TRACE_DIST_MAX; u1_stage++)
+		{
+			pst_dist = &st_trace_dist[u1_stage];
+
+			u2_acc = 0;
+			for (u1_bin = 0; u1_bin < TRACE_BIN_MAX - 1; u1_bin++)
+			{
+				u2_acc = (u2)(u2_acc + pst_dist->u2_bin[u1_bin]);
+				if (u2_acc >= u2_rank)
+				{
+					break;
+				}
+			}
+
+			uart_puts("Trace ");
+			uart_puts(trace_name[u1_stage]);
+			uart_puts(" : mean ");
+			ftoa((f8)(pst_dist->u4_sum / u2_trace_cnt) * 166 / 1000, num_buf, 2);
+			uart_puts(num_buf);
+			uart_puts("us\tp99 < ");
+			ftoa((f8)(1UL << u1_bin) * 166 / 1000, num_buf, 2);
+			uart_puts(num_buf);
+			uart_puts("us\tmax ");
+			ftoa((f8)pst_dist->u4_max * 166 / 1000, num_buf, 2);
+			uart_puts(num_buf);
+			uart_puts("us\n");
+		}
+	}
+
+	/* clear data */
+	for (u1_stage = 0; u1_stage < TRACE_DIST_MAX; u1_stage++)
+	{
+		pst_dist = &st_trace_dist[u1_stage];
+		for (u1_bin = 0; u1_bin < TRACE_BIN_MAX; u1_bin++)
+		{
+			pst_dist->u2_bin[u1_bin] = 0;
+		}
+		pst_dist->u4_sum = 0;
+		pst_dist->u4_max = 0;
+	}
+	u2_trace_cnt  = 0;
+	u2_trace_drop = 0;
+}
+#endif
+
+#if (CFG_BURST != 0)
+/**
+ * @fn              static void burst_capture(void)
+ * @fid             [FID026]-[burst_capture]
+ * @fnbrf           Convert at the maximum rate into the ring until the
+ *                  trigger frame plus u2_post frames are captured
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         Tick and A/D interrupt are masked during the capture,
+ *                  the ta3/ta4 time base keeps counting. BURST is refused
+ *                  while streaming, the summary line reports the blackout.
+ * @remark          Trigger is armed once u2_pre frames are in the ring.
+ */
+static void burst_capture(void)
+{
+	u1   u1_adcon0  = 0;
+	u1   u1_adcon1  = 0;
+	u2   u2_wr      = 0;
+	u2   u2_left    = 0;
+	u1   u1_prev    = 0;
+	u1   u1_code    = 0;
+	u1   u1_ch      = 0;
+	BOOL b_trig     = 0;
+	u4   u4_start   = 0;
+
+	if ((u4)st_burst.u2_pre + st_burst.u2_post + 1 > BURST_FRAME_MAX)
+	{
+		st_burst.u2_post = (u2)(BURST_FRAME_MAX - 1 - st_burst.u2_pre);
+	}
+
+	/* wait for the queued text to go out, then mask tick and A/D interrupt */
+	while (b_tx_busy != 0)
+	{
+		cpu_idle();
+	}
+	ta3ic     = 0;
+	adic      = 0;
+	u1_adcon0 = adcon0;
+	u1_adcon1 = adcon1;
+#if (BURST_CH == 1)
+	adcon0 = 0x80; /* One-shot mode AN0, freq/2   */
+#else
+	adcon0 = 0x90; /* Single sweep mode           */
+	adcon1 = (u1)((u1_adcon1 & 0xFC) | ((BURST_CH / 2) - 1)); /* AN0 to AN(BURST_CH - 1) */
+#endif
+
+	st_burst.u2_frames = 0;
+	st_burst.b_forced  = 0;
+	u2_left            = st_burst.u2_post;
+	u4_start           = hal_time_stamp();
+
+	while (1)
+	{
+		adst = 1;
+		while (adst != 0); /* waiting conversion complete */
+
+		for (u1_ch = 0; u1_ch < BURST_CH; u1_ch++)
+		{
+			u1_burst_buf[(u2_wr * BURST_CH) + u1_ch] = (u1)hal_adc_read(u1_ch);
+		}
+		u1_code = u1_burst_buf[u2_wr * BURST_CH];
+		st_burst.u2_frames++;
+
+		if (b_trig == 0)
+		{
+			if (st_burst.u2_frames > st_burst.u2_pre)
+			{
+				if (((st_burst.u1_edge == BURST_EDGE_RISE) &&
+				     (u1_prev < st_burst.u1_level) && (u1_code >= st_burst.u1_level)) ||
+				    ((st_burst.u1_edge == BURST_EDGE_FALL) &&
+				     (u1_prev > st_burst.u1_level) && (u1_code <= st_burst.u1_level)))
+				{
+					b_trig = 1;
+				}
+				else if ((u2_wr == 0) &&
+				         (hal_time_elapsed(u4_start, hal_time_stamp()) > BURST_TIMEOUT))
+				{
+					b_trig            = 1;
+					st_burst.b_forced = 1;
+				}
+				if (b_trig != 0)
+				{
+					st_burst.u2_trig = u2_wr;
+				}
+			}
+		}
+		else
+		{
+			u2_left--;
+		}
+		u1_prev = u1_code;
+
+		if ((b_trig != 0) && (u2_left == 0))
+		{
+			break;
+		}
+		u2_wr++;
+		if (u2_wr >= BURST_FRAME_MAX)
+		{
+			u2_wr = 0;
+		}
+	}
+
+	st_burst.u4_elapsed = hal_time_elapsed(u4_start, hal_time_stamp());
+
+	/* restore sampling */
+	adcon0 = u1_adcon0;
+	adcon1 = u1_adcon1;
+	ir_adic = 0;
+	adic   = IPL_ADC;
+	ta3ic  = IPL_TICK;
+}
+
+/**
+ * @fn              static void burst_dump(void)
+ * @fid             [FID027]-[burst_dump]
+ * @fnbrf           Send the frozen capture as one binary frame and a summary line
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         The summary line is sent in FMT TXT only, it is compiled
+ *                  out without CFG_TEXT_ON.
+ * @remark          A5 5A 'B' ch frames(2) pre(2) elapsed(4) flags codes.. sum(2)
+ *                  Multi-byte fields little endian, see frame_begin.
+ *                  Sample period = elapsed * 166 ns / frames converted.
+ */
+static void burst_dump(void)
+{
+#if CFG_TEXT_ON
+	char num_buf[12] = { 0 };
+	f8   f8_rate     = 0.0;
+#endif
+	u2   u2_frames   = 0;
+	u2   u2_rd       = 0;
+	u2   u2_i        = 0;
+	u1   u1_ch       = 0;
+
+	u2_frames = (u2)(st_burst.u2_pre + 1 + st_burst.u2_post);
+	u2_rd     = (u2)((st_burst.u2_trig + BURST_FRAME_MAX - st_burst.u2_pre) % BURST_FRAME_MAX);
+
+	frame_begin(FRAME_TYPE_BURST);
+	frame_put((u1)BURST_CH);
+	frame_put((u1)(u2_frames & 0xFF));
+	frame_put((u1)(u2_frames >> 8));
+	frame_put((u1)(st_burst.u2_pre & 0xFF));
+	frame_put((u1)(st_burst.u2_pre >> 8));
+	frame_put((u1)(st_burst.u4_elapsed & 0xFF));
+	frame_put((u1)((st_burst.u4_elapsed >> 8) & 0xFF));
+	frame_put((u1)((st_burst.u4_elapsed >> 16) & 0xFF));
+	frame_put((u1)((st_burst.u4_elapsed >> 24) & 0xFF));
+	frame_put((u1)st_burst.b_forced);
+
+	for (u2_i = 0; u2_i < u2_frames; u2_i++)
+	{
+		for (u1_ch = 0; u1_ch < BURST_CH; u1_ch++)
+		{
+			frame_put(u1_burst_buf[(u2_rd * BURST_CH) + u1_ch]);
+		}
+		u2_rd++;
+		if (u2_rd >= BURST_FRAME_MAX)
+		{
+			u2_rd = 0;
+		}
+	}
+	frame_end();
+
+#if CFG_TEXT_ON
+	/* Printing capture rate and buffer use */
+	if (RUN_FORMAT != OUT_FMT_BIN)
+	{
+		if (st_burst.u4_elapsed != 0)
+		{
+			f8_rate = (f8)st_burst.u2_frames * 1000000.0 / ((f8)st_burst.u4_elapsed * 166);
+		}
+		uart_puts("\nBurst rate : ");
+		ftoa(f8_rate, num_buf, 2);
+		uart_puts(num_buf);
+		uart_puts("kS/s\tframes : ");
+		ftoa((f8)u2_frames, num_buf, 0);
+		uart_puts(num_buf);
+		uart_puts("\tbuffer : ");
+		ftoa((f8)(sizeof(u1_burst_buf) + sizeof(st_burst)), num_buf, 0);
+		uart_puts(num_buf);
+		uart_puts("bytes\tblackout : ");
+		ftoa((f8)st_burst.u4_elapsed / (TA3_PERIOD / TICK_MS), num_buf, 0);
+		uart_puts(num_buf);
+		uart_puts("ms\n");
+	}
+#endif
+}
+#endif
+
+#if (CFG_HIST != 0)
+/**
+ * @fn              static void hist_capture(void)
+ * @fid             [FID080]-[hist_capture]
+ * @fnbrf           Convert one channel at the maximum rate for one window,
+ *                  counting each code
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         Tick and A/D interrupt are masked during the window, the
+ *                  ta3/ta4 time base keeps counting and UART1 keeps sending.
+ * @remark          One compare and one increment per conversion, the time
+ *                  stamp is read every HIST_POLL_MASK + 1 conversions.
+ *                  A received character ends the window early so that
+ *                  commands are not held for up to HIST_MS_MAX.
+ */
+static void hist_capture(void)
+{
+	u1   u1_adcon0 = 0;
+	u1   u1_code   = 0;
+	u4   u4_n      = 0;
+	u4   u4_start  = 0;
+	u4   u4_time   = 0;
+	BOOL b_end     = 0;
+
+	ta3ic     = 0;
+	adic      = 0;
+	u1_adcon0 = adcon0;
+	adcon0    = (u1)(0x80 | st_hist.u1_ch); /* One-shot mode ANn, freq/2 */
+	u4_start  = hal_time_stamp();
+
+	while (b_end == 0)
+	{
+		adst = 1;
+		while (adst != 0); /* waiting conversion complete */
+
+		u1_code = (u1)hal_adc_read(st_hist.u1_ch);
+		if (st_hist.u_bin[u1_code] != HIST_CNT_MAX)
+		{
+			st_hist.u_bin[u1_code]++;
+		}
+		else
+		{
+			st_hist.b_sat = 1;
+		}
+		u4_n++;
+
+		if ((u4_n & HIST_POLL_MASK) == 0)
+		{
+			u4_time = hal_time_elapsed(u4_start, hal_time_stamp());
+			b_end   = (BOOL)(u4_time >= st_hist.u4_window);
+#if (CFG_CMD != 0)
+			if (u1_rxq_tail != u1_rxq_head)
+			{
+				b_end = 1;
+			}
+#endif
+		}
+	}
+
+	st_hist.u4_samples = u4_n;
+	st_hist.u4_elapsed = u4_time;
+
+	/* restore sampling */
+	adcon0  = u1_adcon0;
+	ir_adic = 0;
+	adic    = IPL_ADC;
+	ta3ic   = IPL_TICK;
+}
+
+/**
+ * @fn              static void hist_dump(void)
+ * @fid             [FID081]-[hist_dump]
+ * @fnbrf           Send the non-zero bins of the window and clear them
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         Waits for queue space, the next window starts once the
+ *                  bins are queued.
+ * @remark          Text : "Hist : ANn\tsamples : s\tbins : b\trate : r/s",
+ *                  then "temperature\tcount" per bin, table unit.
+ *                  Binary : A5 5A 'H' seq ch samples(4) elapsed(4) flags
+ *                  bins(2) (code count(HIST_CNT_BITS / 8))*bins sum(2).
+ *                  Codes go through adc_table here only, never per sample.
+ */
+static void hist_dump(void)
+{
+#if CFG_TEXT_ON
+	char     s1_buf[OUT_BUF_SIZE] = { 0 };
+	s4       s4_temp   = 0;
+	u1       u1_i      = 0;
+#endif
+#if CFG_BIN_ON
+	u1       u1_b      = 0;
+#endif
+	HIST_CNT u_cnt     = 0;
+	u2       u2_bins   = 0;
+	u2       u2_code   = 0;
+
+	for (u2_code = 0; u2_code < TABLE_MAX; u2_code++)
+	{
+		if (st_hist.u_bin[u2_code] != 0)
+		{
+			u2_bins++;
+		}
+	}
+
+	if (RUN_FORMAT == OUT_FMT_BIN)
+	{
+#if CFG_BIN_ON
+		frame_begin(FRAME_TYPE_HIST);
+		frame_put(st_hist.u1_seq);
+		frame_put(st_hist.u1_ch);
+		for (u1_b = 0; u1_b < 4; u1_b++)
+		{
+			frame_put((u1)(st_hist.u4_samples >> (u1_b * 8)));
+		}
+		for (u1_b = 0; u1_b < 4; u1_b++)
+		{
+			frame_put((u1)(st_hist.u4_elapsed >> (u1_b * 8)));
+		}
+		frame_put((u1)((st_hist.b_sat != 0) ? HIST_SAT : 0));
+		frame_put((u1)(u2_bins & 0xFF));
+		frame_put((u1)(u2_bins >> 8));
+		for (u2_code = 0; u2_code < TABLE_MAX; u2_code++)
+		{
+			u_cnt = st_hist.u_bin[u2_code];
+			if (u_cnt != 0)
+			{
+				frame_put((u1)u2_code);
+				for (u1_b = 0; u1_b < sizeof(HIST_CNT); u1_b++)
+				{
+					frame_put((u1)((u4)u_cnt >> (u1_b * 8)));
+				}
+				st_hist.u_bin[u2_code] = 0;
+			}
+		}
+		frame_end();
+#endif
+	}
+	else
+	{
+#if CFG_TEXT_ON
+		uart_put_num("Hist : AN", st_hist.u1_ch);
+		uart_put_num("\tsamples : ", st_hist.u4_samples);
+		uart_put_num("\tbins : ", u2_bins);
+		if (st_hist.u4_elapsed != 0)
+		{
+			uart_put_num("\trate : ", (u4)(((u8)st_hist.u4_samples * TA3_PERIOD *
+			                                 (1000 / TICK_MS)) / st_hist.u4_elapsed));
+			uart_puts("/s");
+		}
+		if (st_hist.b_sat != 0)
+		{
+			uart_puts("\tsaturated");
+		}
+		uart_putc('\n');
+		for (u2_code = 0; u2_code < TABLE_MAX; u2_code++)
+		{
+			u_cnt = st_hist.u_bin[u2_code];
+			if (u_cnt != 0)
+			{
+#if (CFG_CAL != 0)
+				s4_temp = cal_apply(st_hist.u1_ch, CONV_TEMP((u1)u2_code));
+#else
+				s4_temp = CONV_TEMP((u1)u2_code);
+#endif
+				out_field(s1_buf, OUT_BUF_SIZE - 1, s4_temp, 0);
+				u1_i = 0;
+				while (s1_buf[u1_i] == ' ')
+				{
+					u1_i++;
+				}
+				uart_puts(&s1_buf[u1_i]);
+				uart_put_num("\t", (u4)u_cnt);
+				uart_putc('\n');
+				st_hist.u_bin[u2_code] = 0;
+			}
+		}
+#endif
+	}
+	st_hist.b_sat = 0;
+	st_hist.u1_seq++;
+}
+#endif
+
+#if (CFG_ALARM != 0)
+/**
+ * @fn              static void alarm_check(const s4* ps4_temp)
+ * @fid             [FID092]-[alarm_check]
+ * @fnbrf           Compare the channels against their thresholds
+ * @param[in]       ps4_temp ; const s4* ; temperature of each channel
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          One message per change : above s4_hi, below s4_lo, and
+ *                  clear once ALARM_HYST back inside both.
+ */
+static void alarm_check(const s4* ps4_temp)
+{
+	u1 u1_ch    = 0;
+	u1 u1_state = ALARM_NONE;
+	s4 s4_t     = 0;
+
+	for (u1_ch = 0; u1_ch < ADC_CH_MAX; u1_ch++)
+	{
+		if ((((st_alarm.u1_on & RUN_CH_MASK) >> u1_ch) & 0x01) == 0)
+		{
+			continue;
+		}
+		s4_t     = ps4_temp[u1_ch];
+		u1_state = st_alarm.u1_state[u1_ch];
+		if (s4_t > st_alarm.s4_hi[u1_ch])
+		{
+			u1_state = ALARM_HIGH;
+		}
+		else if (s4_t < st_alarm.s4_lo[u1_ch])
+		{
+			u1_state = ALARM_LOW;
+		}
+		else if ((s4_t <= (st_alarm.s4_hi[u1_ch] - ALARM_HYST)) &&
+		         (s4_t >= (st_alarm.s4_lo[u1_ch] + ALARM_HYST)))
+		{
+			u1_state = ALARM_NONE;
+		}
+		if (u1_state != st_alarm.u1_state[u1_ch])
+		{
+			st_alarm.u1_state[u1_ch] = u1_state;
+			alarm_send(u1_ch, u1_state, s4_t);
+		}
+	}
+}
+
+/**
+ * @fn              static void alarm_send(u1 u1_ch, u1 u1_state, s4 s4_temp)
+ * @fid             [FID093]-[alarm_send]
+ * @fnbrf           Send one alarm message, text line or 'A' frame
+ * @param[in]       u1_ch ; u1 ; ANn
+ * @param[in]       u1_state ; u1 ; ALARM_NONE / HIGH / LOW
+ * @param[in]       s4_temp ; s4 ; temperature, table unit
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          "Alarm : ANn high|low|clear temp" or
+ *                  'A' : seq ch state temp(4).
+ *                  Built whole, then URG_ON : urg_write, else queued behind
+ *                  the sample output. One message at a time is timed.
+ */
+static void alarm_send(u1 u1_ch, u1 u1_state, s4 s4_temp)
+{
+	char s1_msg[ALARM_MSG_MAX] = { 0 };
+	char s1_buf[OUT_BUF_SIZE]  = { 0 };
+	const char* s1_word = (u1_state == ALARM_HIGH) ? " high " :
+	                      (u1_state == ALARM_LOW) ? " low " : " clear ";
+	u1   u1_len  = 0;
+	u1   u1_i    = 0;
+	u1   u1_sum0 = 0;
+	u1   u1_sum1 = 0;
+
+	if (RUN_FORMAT == OUT_FMT_BIN)
+	{
+		s1_msg[u1_len++] = (char)FRAME_SYNC0;
+		s1_msg[u1_len++] = (char)FRAME_SYNC1;
+		s1_msg[u1_len++] = (char)FRAME_TYPE_ALARM;
+		s1_msg[u1_len++] = (char)st_alarm.u1_seq;
+		s1_msg[u1_len++] = (char)u1_ch;
+		s1_msg[u1_len++] = (char)u1_state;
+		for (u1_i = 0; u1_i < 4; u1_i++)
+		{
+			s1_msg[u1_len++] = (char)((u4)s4_temp >> (u1_i * 8));
+		}
+		for (u1_i = 2; u1_i < u1_len; u1_i++)
+		{
+			u1_sum0 = (u1)((u1_sum0 + (u1)s1_msg[u1_i]) % 255);
+			u1_sum1 = (u1)((u1_sum1 + u1_sum0) % 255);
+		}
+		s1_msg[u1_len++] = (char)u1_sum0;
+		s1_msg[u1_len++] = (char)u1_sum1;
+	}
+	else
+	{
+		for (u1_i = 0; "Alarm : AN"[u1_i] != '\0'; u1_i++)
+		{
+			s1_msg[u1_len++] = "Alarm : AN"[u1_i];
+		}
+		s1_msg[u1_len++] = (char)('0' + u1_ch);
+		for (u1_i = 0; s1_word[u1_i] != '\0'; u1_i++)
+		{
+			s1_msg[u1_len++] = s1_word[u1_i];
+		}
+		out_field(s1_buf, OUT_BUF_SIZE - 1, s4_temp, 0);
+		u1_i = 0;
+		while (s1_buf[u1_i] == ' ')
+		{
+			u1_i++;
+		}
+		while (s1_buf[u1_i] != '\0')
+		{
+			s1_msg[u1_len++] = s1_buf[u1_i++];
+		}
+		s1_msg[u1_len++] = '\n';
+	}
+	st_alarm.u1_seq++;
+
+	if (b_alarm_wait == 0)
+	{
+		u4_alarm_t0  = hal_time_stamp();
+#if URG_ON
+		u2_alarm_end = (u2)(u2_urg_queued + u1_len);
+#else
+		u2_alarm_end = (u2)(u2_tx_queued + u1_len);
+#endif
+		b_alarm_wait = 1;
+	}
+#if URG_ON
+	urg_write(s1_msg, u1_len);
+#else
+	for (u1_i = 0; u1_i < u1_len; u1_i++)
+	{
+		uart_putc(s1_msg[u1_i]);
+	}
+#endif
+}
+
+/**
+ * @fn              static void alarm_taken(u2 u2_taken)
+ * @fid             [FID094]-[alarm_taken]
+ * @fnbrf           Time the alarm message once its last byte is taken
+ * @param[in]       u2_taken ; u2 ; bytes taken from its lane
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         Called by tx_done.
+ * @remark          Queued to moved into u1tb : one character more is out.
+ */
+static void alarm_taken(u2 u2_taken)
+{
+	u4 u4_lat = 0;
+
+	if ((b_alarm_wait != 0) && ((s2)(u2_taken - u2_alarm_end) >= 0))
+	{
+		u4_lat = hal_time_elapsed(u4_alarm_t0, hal_time_stamp());
+		st_alarm.u2_timed++;
+		st_alarm.u4_lat_sum += u4_lat;
+		if (u4_lat > st_alarm.u4_lat_max)
+		{
+			st_alarm.u4_lat_max = u4_lat;
+		}
+		b_alarm_wait = 0;
+	}
+}
+#endif
+
+#if (CFG_SYNC != 0)
+/**
+ * @fn              static void sync_ping(u4 u4_sec, u4 u4_us, u4 u4_loc)
+ * @fid             [FID095]-[sync_ping]
+ * @fnbrf           Take one host time ping
+ * @param[in]       u4_sec ; u4 ; host time when it started sending the line
+ * @param[in]       u4_us ; u4 ; 0 to 999999
+ * @param[in]       u4_loc ; u4 ; hal_time_stamp of the first byte received
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          The first ping anchors the host time. Later ones move the
+ *                  anchor 1/SYNC_PHASE_GAIN of their error, and the rate
+ *                  1/SYNC_RATE_GAIN of the way to the rate since the fit base
+ *                  ping, SYNC_FIT_MIN or more back (offset and drift, no
+ *                  division per sample).
+ *                  The first rate fit and an error above SYNC_STEP_US anchor
+ *                  on the ping.
+ */
+static void sync_ping(u4 u4_sec, u4 u4_us, u4 u4_loc)
+{
+	u4   u4_psec = 0;
+	u4   u4_pus  = 0;
+	u4   u4_dl   = 0;
+	u4   u4_fit  = 0;
+	s4   s4_dh   = 0;
+	s4   s4_us   = (s4)u4_us;
+	BOOL b_snap  = 1;               /* anchor on the ping                 */
+	BOOL b_base  = 1;               /* ping is the next fit base          */
+
+	/* first byte received one character (10 bits) after it started */
+	u4_dl  = (10 * UART_F1_HZ) / st_cfg.u4_baud_real;
+	u4_loc = (u4_loc >= u4_dl) ? (u4_loc - u4_dl) : (u4_loc + TIME_STAMP_WRAP - u4_dl);
+	st_sync.u2_pings++;
+	st_sync.s4_err = 0;
+
+	if (st_sync.b_lock != 0)
+	{
+		/* error against the prediction, before the rate moves */
+		sync_at(u4_loc, &u4_psec, &u4_pus);
+		s4_dh = (s4)(u4_sec - u4_psec);
+		if ((s4_dh <= 1) && (s4_dh >= -1))
+		{
+			st_sync.s4_err = (s4_dh * US_PER_SEC) + (s4)u4_us - (s4)u4_pus;
+		}
+		if ((s4_dh > 1) || (s4_dh < -1) ||
+		    (st_sync.s4_err > SYNC_STEP_US) || (st_sync.s4_err < -SYNC_STEP_US))
+		{
+			st_sync.u2_steps++;
+		}
+		else
+		{
+			if ((u4)((st_sync.s4_err < 0) ? -st_sync.s4_err : st_sync.s4_err) > st_sync.u4_err_max)
+			{
+				st_sync.u4_err_max = (u4)((st_sync.s4_err < 0) ? -st_sync.s4_err : st_sync.s4_err);
+			}
+			b_snap = 0;
+		}
+
+		/* rate between this ping and the fit base, at least SYNC_FIT_MIN back,
+		   a host clock jump gives a rate out of SYNC_DRIFT_MAX, one of more
+		   than SYNC_FIT_SEC (s4 us overflow) makes the ping the fit base */
+		u4_dl = hal_time_elapsed(st_sync.u4_ping_loc, u4_loc);
+		if (u4_dl < SYNC_FIT_MIN)
+		{
+			b_base = 0;
+		}
+		else if ((u4_dl <= SYNC_FIT_MAX) && ((u4_sec - st_sync.u4_ping_sec) <= SYNC_FIT_SEC))
+		{
+			s4_dh  = ((s4)(u4_sec - st_sync.u4_ping_sec) * US_PER_SEC) +
+			         (s4)u4_us - (s4)st_sync.u4_ping_us;
+			u4_fit = (s4_dh > 0) ? (u4)(((u8)s4_dh << 32) / u4_dl) : 0;
+			if ((u4_fit > SYNC_RATE_NOM - SYNC_DRIFT_MAX) && (u4_fit < SYNC_RATE_NOM + SYNC_DRIFT_MAX))
+			{
+				if (st_sync.u2_fits == 0)
+				{
+					/* the error so far came from the nominal rate */
+					st_sync.u4_rate = u4_fit;
+					b_snap = 1;
+				}
+				else
+				{
+					st_sync.u4_rate = (u4)((s4)st_sync.u4_rate +
+					                       ((s4)(u4_fit - st_sync.u4_rate) / SYNC_RATE_GAIN));
+				}
+				st_sync.u2_fits++;
+			}
+		}
+	}
+
+	if (b_base != 0)
+	{
+		st_sync.u4_ping_loc = u4_loc;
+		st_sync.u4_ping_sec = u4_sec;
+		st_sync.u4_ping_us  = u4_us;
+	}
+	if (b_snap == 0)
+	{
+		s4_us  = (s4)u4_pus + (st_sync.s4_err / SYNC_PHASE_GAIN);
+		u4_sec = u4_psec;
+		if (s4_us < 0)
+		{
+			s4_us += US_PER_SEC;
+			u4_sec--;
+		}
+		else if (s4_us >= US_PER_SEC)
+		{
+			s4_us -= US_PER_SEC;
+			u4_sec++;
+		}
+	}
+	st_sync.u4_loc = u4_loc;
+	st_sync.u4_sec = u4_sec;
+	st_sync.u4_us  = (u4)s4_us;
+
+	if (st_sync.b_lock == 0)
+	{
+		st_sync.b_lock = 1;
+#if CFG_TEXT_ON
+		out_line_build(); /* host time field from the next line on */
+#endif
+	}
+}
+
+/**
+ * @fn              static void sync_at(u4 u4_loc, u4* pu4_sec, u4* pu4_us)
+ * @fid             [FID096]-[sync_at]
+ * @fnbrf           Host time of a time stamp
+ * @param[in]       u4_loc ; u4 ; hal_time_stamp, before or after the anchor
+ * @param[in,out]   pu4_sec ; u4* ; host seconds
+ * @param[in,out]   pu4_us ; u4* ; 0 to 999999
+ * @retval          -
+ * @warning         Main only, it may move the anchor.
+ * @remark          One 32 x 32 multiply and one division by 10^6.
+ *                  The anchor follows after SYNC_ROLL so that the time stamp
+ *                  difference stays within TIME_STAMP_WRAP without pings.
+ */
+static void sync_at(u4 u4_loc, u4* pu4_sec, u4* pu4_us)
+{
+	u4 u4_dt = hal_time_elapsed(st_sync.u4_loc, u4_loc);
+	u4 u4_sec = st_sync.u4_sec;
+	s4 s4_us = 0;
+
+	if (u4_dt < (TIME_STAMP_WRAP / 2))
+	{
+		s4_us = (s4)st_sync.u4_us + (s4)(((u8)u4_dt * st_sync.u4_rate) >> 32);
+	}
+	else
+	{
+		u4_dt = TIME_STAMP_WRAP - u4_dt;
+		s4_us = (s4)st_sync.u4_us - (s4)(((u8)u4_dt * st_sync.u4_rate) >> 32);
+		while (s4_us < 0)
+		{
+			s4_us += US_PER_SEC;
+			u4_sec--;
+		}
+		u4_dt = 0;
+	}
+	u4_sec  += (u4)s4_us / US_PER_SEC;
+	*pu4_sec = u4_sec;
+	*pu4_us  = (u4)s4_us % US_PER_SEC;
+
+	if (u4_dt > SYNC_ROLL)
+	{
+		st_sync.u4_loc = u4_loc;
+		st_sync.u4_sec = *pu4_sec;
+		st_sync.u4_us  = *pu4_us;
+	}
+}
+
+#if CFG_TEXT_ON
+/**
+ * @fn              static void sync_field(char* s1_dst, u4 u4_loc)
+ * @fid             [FID097]-[sync_field]
+ * @fnbrf           Write the host time of a time stamp into the line
+ * @param[in]       u4_loc ; u4 ; hal_time_stamp
+ * @param[in,out]   s1_dst ; char* ; "ssssssssss.uuuuuu" field
+ * @retval          -
+ * @warning         -
+ * @remark          Seconds space padded, any u4 (Unix time) fits.
+ */
+static void sync_field(char* s1_dst, u4 u4_loc)
+{
+	u4 u4_sec = 0;
+	u4 u4_us  = 0;
+	u1 u1_i   = 0;
+
+	sync_at(u4_loc, &u4_sec, &u4_us);
+	u1_i = SYNC_SEC_DIGIT;
+	do
+	{
+		s1_dst[--u1_i] = (char)('0' + (u4_sec % 10));
+		u4_sec /= 10;
+	} while ((u4_sec != 0) && (u1_i != 0));
+	while (u1_i != 0)
+	{
+		s1_dst[--u1_i] = ' ';
+	}
+	s1_dst[SYNC_SEC_DIGIT] = '.';
+	for (u1_i = SYNC_SEC_DIGIT + SYNC_US_DIGIT; u1_i > SYNC_SEC_DIGIT; u1_i--)
+	{
+		s1_dst[u1_i] = (char)('0' + (u4_us % 10));
+		u4_us /= 10;
+	}
+}
+#endif
+#endif
+
+#if CFG_DB_ON
+/**
+ * @fn              static BOOL out_deadband(const s4* ps4_temp)
+ * @fid             [FID028]-[out_deadband]
+ * @fnbrf           Check whether the sample stays inside the deadband
+ * @param[in]       ps4_temp ; const s4* ; temperature of each channel
+ * @param[in,out]   -
+ * @retval          1 : every output channel moved less than s4_deadband
+ * @warning         -
+ * @remark          The last output value is updated when the sample is output.
+ */
+static BOOL out_deadband(const s4* ps4_temp)
+{
+	static BOOL b_first = 1;
+	BOOL b_inside = 1;
+	s4   s4_diff  = 0;
+	u1   u1_ch    = 0;
+
+	for (u1_ch = 0; u1_ch < ADC_CH_MAX; u1_ch++)
+	{
+		if ((RUN_CH_MASK >> u1_ch) & 0x01)
+		{
+			s4_diff = ps4_temp[u1_ch] - s4_last_out[u1_ch];
+			if (s4_diff < 0)
+			{
+				s4_diff = -s4_diff;
+			}
+			if (s4_diff > RUN_DEADBAND)
+			{
+				b_inside = 0;
+			}
+		}
+	}
+	if ((RUN_DEADBAND == 0) || (b_first != 0))
+	{
+		b_inside = 0;
+	}
+	if (b_inside == 0)
+	{
+		for (u1_ch = 0; u1_ch < ADC_CH_MAX; u1_ch++)
+		{
+			s4_last_out[u1_ch] = ps4_temp[u1_ch];
+		}
+		b_first = 0;
+	}
+	return b_inside;
+}
+#endif
+
+#if CFG_TEXT_ON
+/**
+ * @fn              static void out_line_build(void)
+ * @fid             [FID044]-[out_line_build]
+ * @fnbrf           Build the text output line template
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         Call again after the channel mask or precision changes.
+ * @remark          Labels and separators are written once, numeric fields are
+ *                  left blank at fixed width and patched by out_text :
+ *                  "Teperature : -dddd.pp\tTeperature<n> : ..\tTime stamp : dddd.ppms\n"
+ */
+static void out_line_build(void)
+{
+	char label_buf[] = "Teperature0 : ";
+	u1   u1_ch       = 0;
+	u1   u1_frac     = (u1)RUN_PREC;
+
+	st_out_line.u1_len        = 0;
+	st_out_line.u1_gen++;
+	st_out_line.u1_temp_width = (u1)(1 + OUT_TEMP_DIGIT + ((u1_frac != 0) ? (1 + u1_frac) : 0));
+	st_out_line.u1_time_width = (u1)(OUT_TIME_DIGIT + ((u1_frac != 0) ? (1 + u1_frac) : 0));
+
+	for (u1_ch = 0; u1_ch < ADC_CH_MAX; u1_ch++)
+	{
+		if ((RUN_CH_MASK >> u1_ch) & 0x01)
+		{
+			if (u1_ch == ADC_CH0)
+			{
+				out_line_text("Teperature : ");
+			}
+			else
+			{
+				label_buf[10] = (char)('0' + u1_ch);
+				out_line_text(label_buf);
+			}
+			st_out_line.u1_temp_pos[u1_ch] = st_out_line.u1_len;
+			st_out_line.u1_len = (u1)(st_out_line.u1_len + st_out_line.u1_temp_width);
+			out_line_text("\t");
+		}
+	}
+	out_line_text("Time stamp : ");
+	st_out_line.u1_time_pos = st_out_line.u1_len;
+	st_out_line.u1_len = (u1)(st_out_line.u1_len + st_out_line.u1_time_width);
+	out_line_text("ms");
+	st_out_line.u1_sync_pos = 0;
+#if (CFG_SYNC != 0)
+	if (st_sync.b_lock != 0)
+	{
+		out_line_text("\tSync : ");
+		st_out_line.u1_sync_pos = st_out_line.u1_len;
+		st_out_line.u1_len = (u1)(st_out_line.u1_len + SYNC_SEC_DIGIT + 1 + SYNC_US_DIGIT);
+	}
+#endif
+	out_line_text("\n");
+}
+
+/**
+ * @fn              static void out_line_text(const char* s1_s)
+ * @fid             [FID045]-[out_line_text]
+ * @fnbrf           Append a fixed text to the line template
+ * @param[in]       s1_s ; const char* ; text
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void out_line_text(const char* s1_s)
+{
+	while ((*s1_s != '\0') && (st_out_line.u1_len < OUT_LINE_MAX))
+	{
+		st_out_line.s1_line[st_out_line.u1_len] = *s1_s;
+		st_out_line.u1_len++;
+		s1_s++;
+	}
+}
+
+/**
+ * @fn              static void out_field(char* s1_dst, u1 u1_width, s4 s4_val, u1 u1_frac)
+ * @fid             [FID046]-[out_field]
+ * @fnbrf           Write a fixed point number right aligned into a field
+ * @param[in]       u1_width ; u1 ; field width
+ * @param[in]       s4_val ; s4 ; value * 10^u1_frac
+ * @param[in]       u1_frac ; u1 ; digits after the decimal point
+ * @param[in,out]   s1_dst ; char* ; first character of the field
+ * @retval          -
+ * @warning         -
+ * @remark          Filled from the right, space padded, '#' when it does not fit.
+ */
+static void out_field(char* s1_dst, u1 u1_width, s4 s4_val, u1 u1_frac)
+{
+	u4 u4_val = (s4_val < 0) ? (u4)(-s4_val) : (u4)s4_val;
+	u1 u1_pos = u1_width;
+	u1 u1_dig = 0;
+
+	/* digits, the integer part has at least one */
+	while ((u1_pos != 0) && ((u4_val != 0) || (u1_dig <= u1_frac)))
+	{
+		if ((u1_dig == u1_frac) && (u1_frac != 0))
+		{
+			s1_dst[--u1_pos] = '.';
+			if (u1_pos == 0)
+			{
+				break;
+			}
+		}
+		s1_dst[--u1_pos] = (char)('0' + (u4_val % 10));
+		u4_val /= 10;
+		u1_dig++;
+	}
+	if ((s4_val < 0) && (u1_pos != 0))
+	{
+		s1_dst[--u1_pos] = '-';
+	}
+	else if ((s4_val < 0) || (u4_val != 0) || (u1_dig <= u1_frac))
+	{
+		u1_pos = u1_width; /* overflow */
+		while (u1_pos != 0)
+		{
+			s1_dst[--u1_pos] = '#';
+		}
+	}
+	while (u1_pos != 0)
+	{
+		s1_dst[--u1_pos] = ' ';
+	}
+}
+
+/**
+ * @fn              static void out_line_fill(char* s1_line, const s4* ps4_temp, u8 u8_pro_time)
+ * @fid             [FID047]-[out_line_fill]
+ * @fnbrf           Patch the numeric fields of a copy of the line template
+ * @param[in]       ps4_temp ; const s4* ; temperature of each channel
+ * @param[in]       u8_pro_time ; u8 ; processing time (ns)
+ * @param[in,out]   s1_line ; char* ; st_out_line.s1_line or a record line
+ * @retval          -
+ * @warning         -
+ * @remark          Also used by host/replay.c, keep free of register access.
+ */
+static void out_line_fill(char* s1_line, const s4* ps4_temp, u8 u8_pro_time)
+{
+	static const s4 pow10_tbl[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+	u1    u1_frac = (u1)RUN_PREC;
+	u4    u4_div  = (u4)pow10_tbl[6 - u1_frac];
+	u1    u1_ch   = 0;
+
+	for (u1_ch = 0; u1_ch < ADC_CH_MAX; u1_ch++)
+	{
+		if ((RUN_CH_MASK >> u1_ch) & 0x01)
+		{
+			out_field(&s1_line[st_out_line.u1_temp_pos[u1_ch]], st_out_line.u1_temp_width,
+			          ps4_temp[u1_ch] * pow10_tbl[u1_frac], u1_frac);
+		}
+	}
+
+	/* ns to ms with u1_frac decimals, rounded */
+	u8_pro_time = (u8_pro_time + (u4_div / 2)) / u4_div;
+	out_field(&s1_line[st_out_line.u1_time_pos], st_out_line.u1_time_width,
+	          (u8_pro_time > 0x7FFFFFFFUL) ? 0x7FFFFFFFL : (s4)u8_pro_time, u1_frac);
+}
+
+#if !POOL_TX_ON
+/**
+ * @fn              static void out_text(const s4* ps4_temp, u8 u8_pro_time, TRACE_REC* pst_trace)
+ * @fid             [FID029]-[out_text]
+ * @fnbrf           Print one text line of the output channels
+ * @param[in]       ps4_temp ; const s4* ; temperature of each channel
+ * @param[in]       u8_pro_time ; u8 ; processing time (ns)
+ * @param[in,out]   pst_trace ; TRACE_REC* ; stamped when formatted
+ * @retval          -
+ * @warning         -
+ * @remark          Patches the numeric fields of st_out_line and sends the
+ *                  whole line with one uart_write.
+ *                  CFG_SYNC : host time of the A/D sweep once synchronized.
+ */
+static void out_text(const s4* ps4_temp, u8 u8_pro_time, TRACE_REC* pst_trace)
+{
+	out_line_fill(st_out_line.s1_line, ps4_temp, u8_pro_time);
+#if (CFG_SYNC != 0)
+	if (st_out_line.u1_sync_pos != 0)
+	{
+		sync_field(&st_out_line.s1_line[st_out_line.u1_sync_pos],
+		           TIME_COUNT(pst_trace->u2_hi[TRACE_ADC], pst_trace->u2_lo[TRACE_ADC]));
+	}
+#endif
+	TRACE_STAMP(*pst_trace, TRACE_FMT);
+
+	uart_write(st_out_line.s1_line, st_out_line.u1_len);
+}
+#endif
+#endif
+
+#if POOL_TX_ON
+/**
+ * @fn              static void out_text_rec(u1 u1_rec, const s4* ps4_temp, u8 u8_pro_time, TRACE_REC* pst_trace)
+ * @fid             [FID090]-[out_text_rec]
+ * @fnbrf           Format the text line in the sample record and send it from there
+ * @param[in]       u1_rec ; u1 ; record of the sample
+ * @param[in]       ps4_temp ; const s4* ; temperature of each channel
+ * @param[in]       u8_pro_time ; u8 ; processing time (ns)
+ * @param[in,out]   pst_trace ; TRACE_REC* ; stamped when formatted
+ * @retval          -
+ * @warning         The record belongs to the transmitter afterwards.
+ * @remark          The template is copied into a record only after
+ *                  out_line_build changed it, then only the numeric fields
+ *                  are patched : no per sample copy into the transmit queue.
+ *                  CFG_SYNC : host time of the A/D sweep once synchronized.
+ */
+static void out_text_rec(u1 u1_rec, const s4* ps4_temp, u8 u8_pro_time, TRACE_REC* pst_trace)
+{
+	POOL_REC* pst_rec = &st_pool_rec[u1_rec];
+	u1        u1_i    = 0;
+
+	if (pst_rec->u1_gen != st_out_line.u1_gen)
+	{
+		for (u1_i = 0; u1_i < st_out_line.u1_len; u1_i++)
+		{
+			pst_rec->s1_line[u1_i] = st_out_line.s1_line[u1_i];
+		}
+		pst_rec->u1_len = st_out_line.u1_len;
+		pst_rec->u1_gen = st_out_line.u1_gen;
+	}
+	out_line_fill(pst_rec->s1_line, ps4_temp, u8_pro_time);
+#if (CFG_SYNC != 0)
+	if (st_out_line.u1_sync_pos != 0)
+	{
+		sync_field(&pst_rec->s1_line[st_out_line.u1_sync_pos],
+		           TIME_COUNT(pst_trace->u2_hi[TRACE_ADC], pst_trace->u2_lo[TRACE_ADC]));
+	}
+#endif
+	TRACE_STAMP(*pst_trace, TRACE_FMT);
+
+	pool_send(u1_rec);
+}
+#endif
+
+#if CFG_BIN_ON
+/**
+ * @fn              static void out_frame(const u1* pu1_code, TRACE_REC* pst_trace)
+ * @fid             [FID030]-[out_frame]
+ * @fnbrf           Send one binary sample frame
+ * @param[in]       pu1_code ; const u1* ; raw code of each channel
+ * @param[in,out]   pst_trace ; TRACE_REC* ; stamped when formatted
+ * @retval          -
+ * @warning         -
+ * @remark          A5 5A 'S' seq mask code.. sum(2), one code per mask bit
+ *                  CFG_SYNC, once synchronized : 'Y' seq mask code.. sec(4)
+ *                  us(4) sum(2), host time of the A/D sweep.
+ *                  STRIPE n : on the least loaded of n links, in turn on a
+ *                  tie. Each link keeps seq order, the host merges by seq.
+ */
+static void out_frame(const u1* pu1_code, TRACE_REC* pst_trace)
+{
+	u1 u1_ch  = 0;
+#if (CFG_SYNC != 0)
+	u4 u4_sec = 0;
+	u4 u4_us  = 0;
+	u1 u1_b   = 0;
+#endif
+
+	TRACE_STAMP(*pst_trace, TRACE_FMT);
+#if STRIPE_ON
+	if (u1_stripe_n > 1)
+	{
+		u1_frame_link  = stripe_pick(0);
+		u1_stripe_last = u1_frame_link;
+		u1_stripe_next = (u1)((u1_frame_link + 1) % u1_stripe_n);
+		u4_stripe_frames[u1_frame_link]++;
+	}
+#endif
+#if (CFG_SYNC != 0)
+	frame_begin((st_sync.b_lock != 0) ? FRAME_TYPE_SYNC : FRAME_TYPE_SAMPLE);
+#else
+	frame_begin(FRAME_TYPE_SAMPLE);
+#endif
+	frame_put((u1)u4_sample_cnt);
+	frame_put(RUN_CH_MASK);
+	for (u1_ch = 0; u1_ch < ADC_CH_MAX; u1_ch++)
+	{
+		if ((RUN_CH_MASK >> u1_ch) & 0x01)
+		{
+			frame_put(pu1_code[u1_ch]);
+		}
+	}
+#if (CFG_SYNC != 0)
+	if (st_sync.b_lock != 0)
+	{
+		sync_at(TIME_COUNT(pst_trace->u2_hi[TRACE_ADC], pst_trace->u2_lo[TRACE_ADC]),
+		        &u4_sec, &u4_us);
+		for (u1_b = 0; u1_b < 4; u1_b++)
+		{
+			frame_put((u1)(u4_sec >> (u1_b * 8)));
+		}
+		for (u1_b = 0; u1_b < 4; u1_b++)
+		{
+			frame_put((u1)(u4_us >> (u1_b * 8)));
+		}
+	}
+#endif
+	frame_end();
+#if STRIPE_ON
+	u1_frame_link = STRIPE_U1;
+#endif
+}
+#endif
+
+#if FRAME_ON
+/**
+ * @fn              static void frame_begin(u1 u1_type)
+ * @fid             [FID031]-[frame_begin]
+ * @fnbrf           Start a binary frame
+ * @param[in]       u1_type ; u1 ; FRAME_TYPE_xxx
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          Frame : A5 5A type payload.. sum0 sum1
+ *                  sum0/sum1 = Fletcher-16 of type and payload.
+ *                  Sent on u1_frame_link (UART1 but for striped frames).
+ */
+static void frame_begin(u1 u1_type)
+{
+#if URG_ON
+	b_frame_open  = 1;
+#endif
+	FRAME_OUT((char)FRAME_SYNC0);
+	FRAME_OUT((char)FRAME_SYNC1);
+	u1_frame_sum0 = 0;
+	u1_frame_sum1 = 0;
+	frame_put(u1_type);
+}
+
+/**
+ * @fn              static void frame_put(u1 u1_data)
+ * @fid             [FID032]-[frame_put]
+ * @fnbrf           Send one frame byte
+ * @param[in]       u1_data ; u1 ; byte
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void frame_put(u1 u1_data)
+{
+	u1_frame_sum0 = (u1)((u1_frame_sum0 + u1_data) % 255);
+	u1_frame_sum1 = (u1)((u1_frame_sum1 + u1_frame_sum0) % 255);
+	FRAME_OUT((char)u1_data);
+}
+
+/**
+ * @fn              static void frame_end(void)
+ * @fid             [FID033]-[frame_end]
+ * @fnbrf           Send the frame checksum
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void frame_end(void)
+{
+	FRAME_OUT((char)u1_frame_sum0);
+#if URG_ON
+	b_frame_open  = 0;
+	b_frame_last  = 1;
+#endif
+	FRAME_OUT((char)u1_frame_sum1);
+#if URG_ON
+	b_frame_last  = 0;
+#endif
+}
+#endif
+
+#if STRIPE_ON
+/**
+ * @fn              static void stripe_set(u1 u1_n)
+ * @fid             [FID098]-[stripe_set]
+ * @fnbrf           Stripe sample frames over n links
+ * @param[in]       u1_n ; u1 ; 1 (UART1 only) to CFG_STRIPE
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          UART2, then UART0, set up at first use like UART1 (8N1,
+ *                  same count source and u1brg). A link left keeps sending
+ *                  what it has queued.
+ */
+static void stripe_set(u1 u1_n)
+{
+	u1 u1_link = 0;
+
+	for (u1_link = STRIPE_U2; u1_link < u1_n; u1_link++)
+	{
+		if (st_stripe[u1_link - 1].b_init != 0)
+		{
+			continue;
+		}
+		st_stripe[u1_link - 1].b_init = 1;
+		hal_uart_init((u1_link == STRIPE_U2) ? HAL_UART2 : HAL_UART0, u1c0, u1brg, IPL_UART_TX);
+	}
+	u1_stripe_n    = u1_n;
+	u1_stripe_next = STRIPE_U1;
+}
+
+/**
+ * @fn              static u1 stripe_pick(u2* pu2_pend)
+ * @fid             [FID099]-[stripe_pick]
+ * @fnbrf           Least loaded link
+ * @param[in]       -
+ * @param[in,out]   pu2_pend ; u2* ; bytes queued on it (0 : not wanted)
+ * @retval          link ; u1 ; STRIPE_U1, STRIPE_U2 or STRIPE_U0
+ * @warning         -
+ * @remark          Queued bytes not yet taken by the transmitter, from
+ *                  u1_stripe_next on so that a tie goes to the next link.
+ */
+static u1 stripe_pick(u2* pu2_pend)
+{
+	u1 u1_best = u1_stripe_next;
+	u2 u2_min  = 0xFFFF;
+	u2 u2_pend = 0;
+	u1 u1_i    = 0;
+	u1 u1_link = u1_stripe_next;
+
+	for (u1_i = 0; u1_i < u1_stripe_n; u1_i++)
+	{
+		u2_pend = (u1_link == STRIPE_U1) ? TX_PENDING : STRIPE_PENDING(&st_stripe[u1_link - 1]);
+		if (u2_pend < u2_min)
+		{
+			u2_min  = u2_pend;
+			u1_best = u1_link;
+		}
+		u1_link = (u1)((u1_link + 1) % u1_stripe_n);
+	}
+	if (pu2_pend != 0)
+	{
+		*pu2_pend = u2_min;
+	}
+	return u1_best;
+}
+
+/**
+ * @fn              static void stripe_putc(u1 u1_link, const char s1_c)
+ * @fid             [FID100]-[stripe_putc]
+ * @fnbrf           Character transmit on UART2 or UART0
+ * @param[in]       u1_link ; u1 ; STRIPE_U2 or STRIPE_U0
+ * @param[in]       s1_c ; const char ; character
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          As uart_putc (interrupt backend) : written to UiTB when
+ *                  the link is idle, else queued. Sleeps while it is full.
+ */
+static void stripe_putc(u1 u1_link, const char s1_c)
+{
+	STRIPE_LINK* pst_l   = &st_stripe[u1_link - 1];
+	u1           u1_next = (u1)((pst_l->u1_head + 1) & STRIPE_Q_MASK);
+
+	while (u1_next == pst_l->u1_tail)
+	{
+		cpu_idle();
+	}
+
+	ENTER_CRITICAL;
+	if (pst_l->b_busy == 0)
+	{
+		pst_l->b_busy = 1;
+		if (u1_link == STRIPE_U2)
+		{
+			u2tb = s1_c;
+		}
+		else
+		{
+			u0tb = s1_c;
+		}
+	}
+	else
+	{
+		pst_l->s1_q[pst_l->u1_head] = s1_c;
+		pst_l->u1_head = u1_next;
+	}
+	EXIT_CRITICAL;
+}
+
+/**
+ * @fn              static void stripe_tx(u1 u1_link)
+ * @fid             [FID101]-[stripe_tx]
+ * @fnbrf           Transmit interrupt of a striped link
+ * @param[in]       u1_link ; u1 ; STRIPE_U2 or STRIPE_U0
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         Called from uart2_tx_isr / uart0_tx_isr.
+ * @remark          UiIRS = 0 : next byte into UiTB. An empty queue switches
+ *                  to UiIRS = 1, whose interrupt tells that the last byte is
+ *                  out and the link idle (uart_set_baud waits for it).
+ */
+static void stripe_tx(u1 u1_link)
+{
+	STRIPE_LINK* pst_l = &st_stripe[u1_link - 1];
+	char         s1_c  = 0;
+
+	b_wake = 1;
+
+	if ((u1_link == STRIPE_U2) ? (u2irs != 0) : (u0irs != 0))
+	{
+		/* the last byte is out */
+		if (u1_link == STRIPE_U2)
+		{
+			u2irs    = 0;
+			ir_s2tic = 0;
+		}
+		else
+		{
+			u0irs    = 0;
+			ir_s0tic = 0;
+		}
+		if (pst_l->u1_tail == pst_l->u1_head)
+		{
+			pst_l->b_busy = 0;
+			return;
+		}
+	}
+
+	if (pst_l->u1_tail != pst_l->u1_head)
+	{
+		s1_c = pst_l->s1_q[pst_l->u1_tail];
+		pst_l->u1_tail = (u1)((pst_l->u1_tail + 1) & STRIPE_Q_MASK);
+		if (u1_link == STRIPE_U2)
+		{
+			u2tb = s1_c;
+		}
+		else
+		{
+			u0tb = s1_c;
+		}
+	}
+	else if (u1_link == STRIPE_U2)
+	{
+		u2irs = 1; /* interrupt again when transmission completes */
+	}
+	else
+	{
+		u0irs = 1;
+	}
+}
+
+/**
+ * @fn              void uart2_tx_isr(void)
+ * @fid             [FID102]-[uart2_tx_isr]
+ * @fnbrf           UART2 transmit interrupt
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+void uart2_tx_isr(void)
+{
+	stripe_tx(STRIPE_U2);
+}
+#endif
+
+#if (CFG_STRIPE > 2)
+/**
+ * @fn              void uart0_tx_isr(void)
+ * @fid             [FID103]-[uart0_tx_isr]
+ * @fnbrf           UART0 transmit interrupt
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+void uart0_tx_isr(void)
+{
+	stripe_tx(STRIPE_U0);
+}
+#endif
+
+/**
+ * @fn              static BOOL uart_set_baud(u4 u4_baud)
+ * @fid             [FID034]-[uart_set_baud]
+ * @fnbrf           Change UART1 bit rate
+ * @param[in]       u4_baud ; u4 ; bit rate
+ * @param[in,out]   -
+ * @retval          1 : changed, 0 : rate rejected, setting kept
+ * @warning         Waits until the transmit queue is empty.
+ * @remark          See hal_uart_baud for the supported rates.
+ *                  STRIPE_ON : UART2 / UART0 follow, once idle too.
+ */
+static BOOL uart_set_baud(u4 u4_baud)
+{
+	u1 u1_clk  = 0;
+	u1 u1_brg  = 0;
+	u4 u4_real = 0;
+#if STRIPE_ON
+	u1 u1_link = 0;
+#endif
+
+	if (hal_uart_baud(u4_baud, UART_BAUD_ERR_MAX, &u1_clk, &u1_brg, &u4_real) == 0)
+	{
+		return 0;
+	}
+	while (b_tx_busy != 0)
+	{
+		cpu_idle();
+	}
+#if STRIPE_ON
+	for (u1_link = 0; u1_link < (CFG_STRIPE - 1); u1_link++)
+	{
+		while (st_stripe[u1_link].b_busy != 0)
+		{
+			cpu_idle();
+		}
+	}
+#endif
+	hal_uart_rate(HAL_UART1, (u1)(UART_C0_DEFAULT | u1_clk), u1_brg);
+#if STRIPE_ON
+	hal_uart_rate(HAL_UART2, (u1)(UART_C0_DEFAULT | u1_clk), u1_brg);
+#if (CFG_STRIPE > 2)
+	hal_uart_rate(HAL_UART0, (u1)(UART_C0_DEFAULT | u1_clk), u1_brg);
+#endif
+#endif
+#if (CFG_CMD != 0)
+	st_cfg.u4_baud      = u4_baud;
+	st_cfg.u4_baud_real = u4_real;
+#endif
+	return 1;
+}
+
+#if (CFG_CMD != 0)
+/**
+ * @fn              static void cmd_poll(void)
+ * @fid             [FID035]-[cmd_poll]
+ * @fnbrf           Collect received characters into a line and execute it
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          Lines end with CR or LF, too long lines are dropped.
+ *                  CFG_SYNC : u1_cmd_starts counts the line starts the way
+ *                  uart1_rx_isr does, equal counts : u4_rx_start is the
+ *                  first byte of the line executed.
+ */
+static void cmd_poll(void)
+{
+	static char cmd_buf[CMD_LINE_MAX];
+	static u1   u1_len = 0;
+#if (CFG_SYNC != 0)
+	static BOOL b_eol  = 1;
+#endif
+	char c = 0;
+
+	while (u1_rxq_tail != u1_rxq_head)
+	{
+		c = s1_rxq[u1_rxq_tail];
+		u1_rxq_tail = (u1)((u1_rxq_tail + 1) & UART_RXQ_MASK);
+#if (CFG_SYNC != 0)
+		if (b_eol != 0)
+		{
+			u1_cmd_starts++;
+		}
+		b_eol = (BOOL)((c == '\r') || (c == '\n'));
+#endif
+
+		if ((c == '\r') || (c == '\n'))
+		{
+			if (u1_len > CMD_LINE_MAX - 1)
+			{
+				u2_cmd_err++;
+				uart_puts("ERR\n");
+			}
+			else if (u1_len != 0)
+			{
+				cmd_buf[u1_len] = '\0';
+				cmd_exec(cmd_buf);
+			}
+			u1_len = 0;
+		}
+		else if (u1_len < CMD_LINE_MAX - 1)
+		{
+			if ((c >= 'a') && (c <= 'z'))
+			{
+				c = (char)(c - 'a' + 'A');
+			}
+			cmd_buf[u1_len++] = c;
+		}
+		else
+		{
+			u1_len = CMD_LINE_MAX; /* drop until end of line */
+		}
+	}
+}
+
+/**
+ * @fn              static void cmd_exec(char* s1_line)
+ * @fid             [FID036]-[cmd_exec]
+ * @fnbrf           Execute one command line
+ * @param[in]       s1_line ; char* ; upper case command line
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          RATE ms | CH mask | PREC n | FMT TXT/BIN | DB value |
+ *                  BAUD rate | BURST [pre post level edge] |
+ *                  FILT ch NONE/AVG n/MED n/IIR k |
+ *                  CAL ch offset gain | CAL SAVE | LOG |
+ *                  ADAPT min_ms max_ms level | ADAPT OFF | STATS n |
+ *                  HIST [ms [ch]] | HIST OFF | ALARM ch lo hi | ALARM ch OFF |
+ *                  SYNC sec us | SYNC OFF | STRIPE n | STOP | RUN | STAT | MEM
+ *                  RATE turns ADAPT off. CAL SAVE and BURST only after
+ *                  STOP (ticks and UART receive are lost meanwhile), BURST
+ *                  ends stopped.
+ *                  Reply "OK" or "ERR".
+ */
+static void cmd_exec(char* s1_line)
+{
+	char* s1_p      = s1_line;
+	s4    s4_arg[4] = { 0 };
+	BOOL  b_ok      = 0;
+	u1    u1_clk    = 0;
+	u1    u1_brg    = 0;
+	u4    u4_real   = 0;
+#if (CFG_FILT != 0)
+	u1    u1_type   = FILT_NONE;
+#endif
+#if (CFG_FILT != 0) || (CFG_ALARM != 0)
+	u1    u1_ch     = 0;
+#endif
+#if (CFG_CAL != 0)
+	u4    u4_start  = 0;
+#endif
+#if (CFG_SYNC != 0)
+	u4    u4_sec    = 0;
+#endif
+
+	if (cmd_word(&s1_p, "RATE") && cmd_num(&s1_p, &s4_arg[0]))
+	{
+		if ((s4_arg[0] >= TICK_MS) && (s4_arg[0] <= SAMPLE_PERIOD_MAX) && ((s4_arg[0] % TICK_MS) == 0))
+		{
+#if (CFG_ADAPT != 0)
+			adapt_set(0, 0, 0);
+#endif
+			st_cfg.u1_sample_tick = (u1)(s4_arg[0] / TICK_MS);
+#if (CFG_STATS != 0)
+			stats_reset();
+#endif
+			b_ok = 1;
+		}
+	}
+	else if (cmd_word(&s1_p, "CH") && cmd_num(&s1_p, &s4_arg[0]))
+	{
+		if ((s4_arg[0] > 0) && (s4_arg[0] < (1 << ADC_CH_MAX)))
+		{
+			st_cfg.u1_ch_mask = (u1)s4_arg[0];
+			out_line_build();
+#if (CFG_STATS != 0)
+			stats_reset();
+#endif
+#if (CFG_FILT != 0)
+			for (u1_ch = 0; u1_ch < ADC_CH_MAX; u1_ch++)
+			{
+				st_filt[u1_ch].b_primed = 0; /* history may be stale */
+			}
+#endif
+			b_ok = 1;
+		}
+	}
+	else if (cmd_word(&s1_p, "PREC") && cmd_num(&s1_p, &s4_arg[0]))
+	{
+		if ((s4_arg[0] >= 0) && (s4_arg[0] <= OUT_PREC_MAX))
+		{
+			st_cfg.s2_precision = (s2)s4_arg[0];
+			out_line_build();
+			b_ok = 1;
+		}
+	}
+	else if (cmd_word(&s1_p, "FMT"))
+	{
+		if (cmd_word(&s1_p, "TXT"))
+		{
+			st_cfg.u1_format = OUT_FMT_TEXT;
+			b_ok = 1;
+		}
+		else if (cmd_word(&s1_p, "BIN"))
+		{
+			st_cfg.u1_format = OUT_FMT_BIN;
+			b_ok = 1;
+		}
+	}
+	else if (cmd_word(&s1_p, "DB") && cmd_num(&s1_p, &s4_arg[0]))
+	{
+		if (s4_arg[0] >= 0)
+		{
+			st_cfg.s4_deadband = s4_arg[0];
+			b_ok = 1;
+		}
+	}
+	else if (cmd_word(&s1_p, "BAUD") && cmd_num(&s1_p, &s4_arg[0]))
+	{
+		if ((s4_arg[0] > 0) && (*s1_p == '\0') &&
+		    (hal_uart_baud((u4)s4_arg[0], UART_BAUD_ERR_MAX, &u1_clk, &u1_brg, &u4_real) != 0))
+		{
+			/* reply at the old rate, then switch */
+			uart_puts("OK\n");
+			(void)uart_set_baud((u4)s4_arg[0]);
+			return;
+		}
+	}
+#if (CFG_BURST != 0)
+	else if (cmd_word(&s1_p, "BURST"))
+	{
+		b_ok = (BOOL)(u1_app_mode == APP_MODE_STOP);
+		if ((b_ok != 0) && cmd_num(&s1_p, &s4_arg[0]))
+		{
+			b_ok = (BOOL)(cmd_num(&s1_p, &s4_arg[1]) && cmd_num(&s1_p, &s4_arg[2]) &&
+			              cmd_num(&s1_p, &s4_arg[3]) &&
+			              (s4_arg[0] >= 0) && (s4_arg[1] >= 0) &&
+			              ((s4_arg[0] + s4_arg[1]) < BURST_FRAME_MAX) &&
+			              (s4_arg[2] >= 0) && (s4_arg[2] <= U1_MAX) &&
+			              ((s4_arg[3] == BURST_EDGE_RISE) || (s4_arg[3] == BURST_EDGE_FALL)));
+			if (b_ok != 0)
+			{
+				st_burst.u2_pre   = (u2)s4_arg[0];
+				st_burst.u2_post  = (u2)s4_arg[1];
+				st_burst.u1_level = (u1)s4_arg[2];
+				st_burst.u1_edge  = (u1)s4_arg[3];
+			}
+		}
+		if (b_ok != 0)
+		{
+			u1_app_mode = APP_MODE_BURST;
+		}
+	}
+#endif
+#if (CFG_HIST != 0)
+	else if (cmd_word(&s1_p, "HIST"))
+	{
+		if (cmd_word(&s1_p, "OFF"))
+		{
+			if (u1_app_mode == APP_MODE_HIST)
+			{
+				u1_app_mode = APP_MODE_STREAM;
+			}
+			b_ok = 1;
+		}
+		else
+		{
+			b_ok = 1;
+			if (cmd_num(&s1_p, &s4_arg[0]))
+			{
+				s4_arg[1] = 0;
+				(void)cmd_num(&s1_p, &s4_arg[1]);
+				b_ok = (BOOL)((s4_arg[0] >= TICK_MS) && (s4_arg[0] <= HIST_MS_MAX) &&
+				              (s4_arg[1] >= 0) && (s4_arg[1] < ADC_CH_MAX));
+				if (b_ok != 0)
+				{
+					st_hist.u4_window = (u4)s4_arg[0] * (TA3_PERIOD / TICK_MS);
+					st_hist.u1_ch     = (u1)s4_arg[1];
+				}
+			}
+			if (b_ok != 0)
+			{
+				u1_app_mode = APP_MODE_HIST;
+			}
+		}
+	}
+#endif
+#if (CFG_SYNC != 0)
+	else if (cmd_word(&s1_p, "SYNC"))
+	{
+		if (cmd_word(&s1_p, "OFF"))
+		{
+			st_sync.b_lock  = 0;
+			st_sync.u4_rate = SYNC_RATE_NOM;
+			st_sync.u2_fits = 0;
+#if CFG_TEXT_ON
+			out_line_build();
+#endif
+			b_ok = 1;
+		}
+		else if (cmd_unum(&s1_p, &u4_sec) && cmd_num(&s1_p, &s4_arg[1]) &&
+		         (s4_arg[1] >= 0) && (s4_arg[1] < US_PER_SEC))
+		{
+			if (u1_rx_starts == u1_cmd_starts)
+			{
+				sync_ping(u4_sec, (u4)s4_arg[1], u4_rx_start);
+			}
+			else
+			{
+				st_sync.u2_stale++; /* a later line started, its stamp is gone */
+			}
+			b_ok = 1;
+		}
+	}
+#endif
+#if STRIPE_ON
+	else if (cmd_word(&s1_p, "STRIPE") && cmd_num(&s1_p, &s4_arg[0]))
+	{
+		if ((s4_arg[0] >= 1) && (s4_arg[0] <= CFG_STRIPE))
+		{
+			stripe_set((u1)s4_arg[0]);
+			b_ok = 1;
+		}
+	}
+#endif
+#if (CFG_ALARM != 0)
+	else if (cmd_word(&s1_p, "ALARM") && cmd_num(&s1_p, &s4_arg[0]) &&
+	         (s4_arg[0] >= 0) && (s4_arg[0] < ADC_CH_MAX))
+	{
+		u1_ch = (u1)s4_arg[0];
+		if (cmd_word(&s1_p, "OFF"))
+		{
+			st_alarm.u1_on = (u1)(st_alarm.u1_on & ~(1 << u1_ch));
+			b_ok = 1;
+		}
+		else if (cmd_num(&s1_p, &s4_arg[1]) && cmd_num(&s1_p, &s4_arg[2]) &&
+		         (s4_arg[2] - s4_arg[1] >= 2 * ALARM_HYST))
+		{
+			st_alarm.s4_lo[u1_ch] = s4_arg[1];
+			st_alarm.s4_hi[u1_ch] = s4_arg[2];
+			st_alarm.u1_on = (u1)(st_alarm.u1_on | (1 << u1_ch));
+			b_ok = 1;
+		}
+		st_alarm.u1_state[u1_ch] = ALARM_NONE;
+	}
+#endif
+#if (CFG_FILT != 0)
+	else if (cmd_word(&s1_p, "FILT") && cmd_num(&s1_p, &s4_arg[0]) &&
+	         (s4_arg[0] >= 0) && (s4_arg[0] < ADC_CH_MAX))
+	{
+		/* s4_arg[1] : filter parameter, window / length / shift */
+		if (cmd_word(&s1_p, "NONE"))
+		{
+			u1_type = FILT_NONE;
+			b_ok    = 1;
+		}
+		else if (cmd_word(&s1_p, "AVG") && cmd_num(&s1_p, &s4_arg[2]))
+		{
+			for (s4_arg[1] = 1; (s4_arg[1] <= FILT_AVG_SHIFT_MAX) && ((1L << s4_arg[1]) != s4_arg[2]); s4_arg[1]++)
+			{
+			}
+			u1_type = FILT_AVG;
+			b_ok    = (BOOL)(s4_arg[1] <= FILT_AVG_SHIFT_MAX);
+		}
+		else if (cmd_word(&s1_p, "MED") && cmd_num(&s1_p, &s4_arg[1]))
+		{
+			u1_type = FILT_MED;
+			b_ok    = (BOOL)((s4_arg[1] == 3) || (s4_arg[1] == 5));
+		}
+		else if (cmd_word(&s1_p, "IIR") && cmd_num(&s1_p, &s4_arg[1]))
+		{
+			u1_type = FILT_IIR;
+			b_ok    = (BOOL)((s4_arg[1] >= 1) && (s4_arg[1] <= FILT_IIR_SHIFT_MAX));
+		}
+		if ((b_ok != 0) && (*s1_p == '\0'))
+		{
+			filt_set(&st_filt[s4_arg[0]], u1_type, (u1)s4_arg[1]);
+			uart_put_num("Filter : ", filt_cost(u1_type, (u1)s4_arg[1]));
+			uart_puts(" ns\n");
+		}
+	}
+#endif
+#if (CFG_CAL != 0)
+	else if (cmd_word(&s1_p, "CAL"))
+	{
+		/* s4_arg[0..2] : channel, offset (table unit), gain (CAL_GAIN_UNIT) */
+		if (cmd_word(&s1_p, "SAVE"))
+		{
+			if ((*s1_p == '\0') && (u1_app_mode == APP_MODE_STOP))
+			{
+				u4_start = hal_time_stamp();
+				b_ok     = cal_save();
+				uart_put_num("Blackout : ", hal_time_elapsed(u4_start, hal_time_stamp()) / (TA3_PERIOD / TICK_MS));
+				uart_puts(" ms\n");
+			}
+		}
+		else if (cmd_num(&s1_p, &s4_arg[0]) && cmd_num(&s1_p, &s4_arg[1]) &&
+		         cmd_num(&s1_p, &s4_arg[2]) &&
+		         (s4_arg[0] >= 0) && (s4_arg[0] < ADC_CH_MAX) &&
+		         (s4_arg[1] >= -CAL_OFFSET_MAX) && (s4_arg[1] <= CAL_OFFSET_MAX) &&
+		         (s4_arg[2] > 0) && (s4_arg[2] <= (2 * CAL_GAIN_UNIT)))
+		{
+			s4_arg[2] = ((s4_arg[2] * (s4)CAL_GAIN_ONE) + (CAL_GAIN_UNIT / 2)) / CAL_GAIN_UNIT;
+			if ((s4_arg[2] >= CAL_GAIN_MIN) && (s4_arg[2] <= CAL_GAIN_MAX))
+			{
+				st_cal.s2_offset[s4_arg[0]] = (s2)s4_arg[1];
+				st_cal.u2_gain[s4_arg[0]]   = (u2)s4_arg[2];
+				b_ok = 1;
+			}
+		}
+	}
+#endif
+#if (CFG_STATS != 0)
+	else if (cmd_word(&s1_p, "STATS") && cmd_num(&s1_p, &s4_arg[0]))
+	{
+		if ((s4_arg[0] >= 0) && (s4_arg[0] <= U1_MAX))
+		{
+			st_cfg.u1_stats_every = (u1)s4_arg[0];
+			stats_reset();
+			b_ok = 1;
+		}
+	}
+#endif
+#if (CFG_ADAPT != 0)
+	else if (cmd_word(&s1_p, "ADAPT"))
+	{
+		if (cmd_word(&s1_p, "OFF"))
+		{
+			adapt_set(0, 0, 0);
+			b_ok = 1;
+		}
+		else if (cmd_num(&s1_p, &s4_arg[0]) && cmd_num(&s1_p, &s4_arg[1]) &&
+		         cmd_num(&s1_p, &s4_arg[2]) &&
+		         (s4_arg[0] >= TICK_MS) && ((s4_arg[0] % TICK_MS) == 0) &&
+		         (s4_arg[1] >= s4_arg[0]) && (s4_arg[1] <= SAMPLE_PERIOD_MAX) &&
+		         ((s4_arg[1] % TICK_MS) == 0) &&
+		         (s4_arg[2] > 0) && (s4_arg[2] <= U1_MAX))
+		{
+			adapt_set((u1)(s4_arg[0] / TICK_MS), (u1)(s4_arg[1] / TICK_MS), (u1)s4_arg[2]);
+			b_ok = 1;
+		}
+	}
+#endif
+#if (CFG_LOG != 0)
+	else if (cmd_word(&s1_p, "LOG"))
+	{
+		/* whole ring, frames follow the reply */
+		log_dump(1, (u2)(st_log.u2_head - st_log.u2_fill));
+		b_ok = 1;
+	}
+#endif
+#if APP_STOP_ON
+	else if (cmd_word(&s1_p, "STOP"))
+	{
+		u1_app_mode = APP_MODE_STOP;
+		b_ok = 1;
+	}
+	else if (cmd_word(&s1_p, "RUN"))
+	{
+		u1_app_mode = APP_MODE_STREAM;
+		b_ok = 1;
+	}
+#endif
+	else if (cmd_word(&s1_p, "STAT"))
+	{
+		cmd_stat();
+		b_ok = 1;
+	}
+#if (CFG_MEM != 0)
+	else if (cmd_word(&s1_p, "MEM"))
+	{
+		mem_report();
+		b_ok = 1;
+	}
+#endif
+
+	if ((b_ok != 0) && (*s1_p == '\0'))
+	{
+		uart_puts("OK\n");
+	}
+	else
+	{
+		u2_cmd_err++;
+		uart_puts("ERR\n");
+	}
+}
+
+/**
+ * @fn              static BOOL cmd_word(char** pps1_s, const char* s1_word)
+ * @fid             [FID037]-[cmd_word]
+ * @fnbrf           Match a word and skip the spaces after it
+ * @param[in]       s1_word ; const char* ; expected word
+ * @param[in,out]   pps1_s ; char** ; parse position, moved on match
+ * @retval          1 : matched
+ * @warning         -
+ * @remark          -
+ */
+static BOOL cmd_word(char** pps1_s, const char* s1_word)
+{
+	char* s1_p = *pps1_s;
+
+	while ((*s1_word != '\0') && (*s1_p == *s1_word))
+	{
+		s1_p++;
+		s1_word++;
+	}
+	if ((*s1_word != '\0') || ((*s1_p != ' ') && (*s1_p != '\0')))
+	{
+		return 0;
+	}
+	while (*s1_p == ' ')
+	{
+		s1_p++;
+	}
+	*pps1_s = s1_p;
+	return 1;
+}
+
+/**
+ * @fn              static BOOL cmd_num(char** pps1_s, s4* ps4_val)
+ * @fid             [FID038]-[cmd_num]
+ * @fnbrf           Parse a signed decimal number and skip the spaces after it
+ * @param[in]       -
+ * @param[in,out]   pps1_s ; char** ; parse position, moved on success
+ * @param[in,out]   ps4_val ; s4* ; number
+ * @retval          1 : parsed
+ * @warning         -
+ * @remark          -
+ */
+static BOOL cmd_num(char** pps1_s, s4* ps4_val)
+{
+	char* s1_p    = *pps1_s;
+	BOOL  b_neg   = 0;
+	s4    s4_val  = 0;
+	u1    u1_dig  = 0;
+
+	if (*s1_p == '-')
+	{
+		b_neg = 1;
+		s1_p++;
+	}
+	while ((*s1_p >= '0') && (*s1_p <= '9') && (u1_dig < 9))
+	{
+		s4_val = (s4_val * 10) + (*s1_p - '0');
+		s1_p++;
+		u1_dig++;
+	}
+	if ((u1_dig == 0) || ((*s1_p != ' ') && (*s1_p != '\0')))
+	{
+		return 0;
+	}
+	while (*s1_p == ' ')
+	{
+		s1_p++;
+	}
+	*ps4_val = (b_neg != 0) ? -s4_val : s4_val;
+	*pps1_s  = s1_p;
+	return 1;
+}
+
+#if (CFG_SYNC != 0)
+/**
+ * @fn              static BOOL cmd_unum(char** pps1_s, u4* pu4_val)
+ * @fid             [FID108]-[cmd_unum]
+ * @fnbrf           Parse an unsigned decimal number and skip the spaces after it
+ * @param[in]       -
+ * @param[in,out]   pps1_s ; char** ; parse position, moved on success
+ * @param[in,out]   pu4_val ; u4* ; number
+ * @retval          1 : parsed
+ * @warning         -
+ * @remark          Up to 10 digits (Unix time seconds), 0 above 0xFFFFFFFF.
+ */
+static BOOL cmd_unum(char** pps1_s, u4* pu4_val)
+{
+	char* s1_p    = *pps1_s;
+	u8    u8_val  = 0;
+	u1    u1_dig  = 0;
+
+	while ((*s1_p >= '0') && (*s1_p <= '9') && (u1_dig < 10))
+	{
+		u8_val = (u8_val * 10) + (u8)(*s1_p - '0');
+		s1_p++;
+		u1_dig++;
+	}
+	if ((u1_dig == 0) || (u8_val > 0xFFFFFFFFUL) || ((*s1_p != ' ') && (*s1_p != '\0')))
+	{
+		return 0;
+	}
+	while (*s1_p == ' ')
+	{
+		s1_p++;
+	}
+	*pu4_val = (u4)u8_val;
+	*pps1_s  = s1_p;
+	return 1;
+}
+#endif
+
+/**
+ * @fn              static void cmd_stat(void)
+ * @fid             [FID039]-[cmd_stat]
+ * @fnbrf           Print setting and counters
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void cmd_stat(void)
+{
+#if (CFG_ADAPT != 0)
+	char num_buf[12] = { 0 };
+#endif
+#if (CFG_FILT != 0) || (CFG_CAL != 0)
+	u1   u1_ch       = 0;
+#endif
+
+	uart_put_num("Rate : ", (u4)st_cfg.u1_sample_tick * TICK_MS);
+	uart_put_num("ms\tCH : ", st_cfg.u1_ch_mask);
+	uart_put_num("\tFMT : ", st_cfg.u1_format);
+	uart_put_num("\tPREC : ", (u4)st_cfg.s2_precision);
+	uart_put_num("\tDB : ", (u4)st_cfg.s4_deadband);
+	uart_put_num("\tBAUD : ", st_cfg.u4_baud);
+	uart_put_num(" (", st_cfg.u4_baud_real);
+	uart_putc(')');
+	uart_putc('\n');
+	uart_put_num("Samples : ", u4_sample_cnt);
+	uart_put_num("\tout : ", u4_out_cnt);
+	uart_put_num("\tsuppressed : ", u4_suppress_cnt);
+	uart_put_num("\trx err : ", u2_rx_err);
+	uart_put_num("\trx drop : ", u2_rx_drop);
+	uart_put_num("\tcmd err : ", u2_cmd_err);
+	uart_putc('\n');
+#if (CFG_FILT != 0)
+	for (u1_ch = 0; u1_ch < ADC_CH_MAX; u1_ch++)
+	{
+		uart_put_num((u1_ch == 0) ? "Filter : " : "\t", st_filt[u1_ch].u1_type);
+		uart_put_num("/", (st_filt[u1_ch].u1_type == FILT_AVG) ?
+		                  (1UL << st_filt[u1_ch].u1_param) : st_filt[u1_ch].u1_param);
+	}
+	uart_putc('\n');
+#endif
+#if (CFG_CAL != 0)
+	for (u1_ch = 0; u1_ch < ADC_CH_MAX; u1_ch++)
+	{
+		uart_puts((u1_ch == 0) ? "Cal : " : "\t");
+		if (st_cal.s2_offset[u1_ch] < 0)
+		{
+			uart_putc('-');
+		}
+		uart_put_num("", (u4)((st_cal.s2_offset[u1_ch] < 0) ? -st_cal.s2_offset[u1_ch] : st_cal.s2_offset[u1_ch]));
+		uart_put_num("/", (((u4)st_cal.u2_gain[u1_ch] * CAL_GAIN_UNIT) + (CAL_GAIN_ONE / 2)) >> CAL_GAIN_SHIFT);
+	}
+	uart_put_num("\tsaves : ", st_cal.u2_seq);
+	uart_putc('\n');
+#endif
+#if (CFG_LOG != 0)
+	uart_put_num("Log : ", st_log.u2_fill);
+	uart_put_num("/", LOG_REC_MAX);
+	uart_put_num("\tunsent : ", st_log.u2_unsent);
+	uart_put_num("\tlost : ", st_log.u4_lost);
+	uart_put_num("\tskipped : ", st_log.u4_skip);
+	uart_putc('\n');
+#endif
+#if (CFG_STATS != 0)
+	uart_put_num("Stats : every ", RUN_STATS);
+	uart_put_num("\twin : ", st_stats.u1_n);
+	uart_put_num("/", STATS_WIN);
+	uart_putc('\n');
+#endif
+#if (CFG_POOL != 0)
+	uart_put_num("Pool : free ", (u1)(st_pool_free.u1_head - st_pool_free.u1_tail));
+	uart_put_num("/", POOL_REC_MAX);
+	uart_put_num("\tlow : ", u1_pool_low);
+	uart_put_num("\tdrop : ", u2_pool_drop);
+#if (CFG_CMD != 0)
+	uart_put_num("\tstale : ", u2_pool_stale);
+#endif
+	uart_putc('\n');
+#endif
+#if (CFG_SYNC != 0)
+	uart_put_num("Sync : pings ", st_sync.u2_pings);
+	uart_put_num("\tfits : ", st_sync.u2_fits);
+	uart_put_num("\tsteps : ", st_sync.u2_steps);
+	uart_put_num("\tstale : ", st_sync.u2_stale);
+	uart_puts("\terr : ");
+	if (st_sync.s4_err < 0)
+	{
+		uart_putc('-');
+	}
+	uart_put_num("", (u4)((st_sync.s4_err < 0) ? -st_sync.s4_err : st_sync.s4_err));
+	uart_put_num("us\tmax : ", st_sync.u4_err_max);
+	uart_puts("us\tdrift : ");
+	if (st_sync.u4_rate < SYNC_RATE_NOM)
+	{
+		uart_putc('-');
+	}
+	uart_put_num("", (u4)(((u8)((st_sync.u4_rate < SYNC_RATE_NOM) ? (SYNC_RATE_NOM - st_sync.u4_rate) :
+	                                (st_sync.u4_rate - SYNC_RATE_NOM)) * 1000000000UL) / SYNC_RATE_NOM));
+	uart_puts("ppb\n");
+#endif
+#if STRIPE_ON
+	uart_put_num("Stripe : links ", u1_stripe_n);
+	uart_put_num("\tUART1 : ", u4_stripe_frames[STRIPE_U1]);
+	uart_put_num("\tUART2 : ", u4_stripe_frames[STRIPE_U2]);
+#if (CFG_STRIPE > 2)
+	uart_put_num("\tUART0 : ", u4_stripe_frames[STRIPE_U0]);
+#endif
+	uart_puts(" frames\n");
+#endif
+#if (CFG_ALARM != 0)
+	uart_put_num(URG_ON ? "Alarm : urgent\ton : " : "Alarm : bulk\ton : ", st_alarm.u1_on);
+	uart_put_num("\tsent : ", st_alarm.u1_seq);
+	uart_put_num("\ttimed : ", st_alarm.u2_timed);
+	if (st_alarm.u2_timed != 0)
+	{
+		uart_put_num("\tmean : ", (st_alarm.u4_lat_sum / st_alarm.u2_timed) / 6);
+		uart_put_num("us\tmax : ", st_alarm.u4_lat_max / 6);
+		uart_puts("us");
+	}
+	uart_putc('\n');
+#endif
+#if (CFG_HIST != 0)
+	uart_put_num("Hist : ", st_hist.u4_window / (TA3_PERIOD / TICK_MS));
+	uart_put_num("ms\tAN", st_hist.u1_ch);
+	uart_put_num("\twindows : ", st_hist.u1_seq);
+	uart_putc('\n');
+#endif
+	uart_put_num("Boot : sample ", u4_boot_adc * 166 / 1000);
+	uart_put_num("us\tout ", u4_boot_out * 166 / 1000);
+	uart_puts("us\n");
+#if (CFG_REPORT != 0)
+	uart_puts((CFG_TX == CFG_TX_DMA) ? "TX : dma" : "TX : isr");
+	uart_put_num("\tirq : ", u4_tx_irq);
+	uart_put_num("\tcpu : ", u4_tx_cost / 6);
+	if (u4_out_cnt != 0)
+	{
+		uart_put_num("us\tper line : ", u4_tx_irq / u4_out_cnt);
+		uart_put_num(" irq ", (u4_tx_cost / u4_out_cnt) * 166);
+		uart_puts("ns\n");
+	}
+	else
+	{
+		uart_puts("us\n");
+	}
+#endif
+#if (CFG_ADAPT != 0)
+	if (st_adapt.b_on != 0)
+	{
+		uart_put_num("Adapt : ", (u4)st_adapt.u1_tick_min * TICK_MS);
+		uart_put_num("-", (u4)st_adapt.u1_tick_max * TICK_MS);
+		uart_put_num("ms\tlevel : ", st_adapt.u1_level);
+		uart_put_num("\tup : ", st_adapt.u2_up);
+		uart_put_num("\tdown : ", st_adapt.u2_down);
+		uart_puts("\tmean : ");
+		ftoa((st_adapt.u4_samples != 0) ?
+		     ((f8)st_adapt.u4_ticks * TICK_MS / (f8)st_adapt.u4_samples) : 0.0, num_buf, 1);
+		uart_puts(num_buf);
+		uart_puts("ms\n");
+	}
+#endif
+}
+#endif
+
+#if (CFG_CMD != 0) || (CFG_STATS != 0) || ((CFG_HIST != 0) && CFG_TEXT_ON)
+/**
+ * @fn              static void uart_put_num(const char* s1_label, u4 u4_val)
+ * @fid             [FID040]-[uart_put_num]
+ * @fnbrf           Print a label and an unsigned decimal number
+ * @param[in]       s1_label ; const char* ; label
+ * @param[in]       u4_val ; u4 ; number
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void uart_put_num(const char* s1_label, u4 u4_val)
+{
+	char num_buf[11] = { 0 };
+	u1   u1_i        = sizeof(num_buf) - 1;
+
+	do
+	{
+		num_buf[--u1_i] = (char)('0' + (u4_val % 10));
+		u4_val /= 10;
+	} while ((u4_val != 0) && (u1_i != 0));
+
+	uart_puts(s1_label);
+	uart_puts(&num_buf[u1_i]);
+}
+#endif
+
+#if (CFG_CMD != 0)
+/**
+ * @fn              void uart1_rx_isr(void)
+ * @fid             [FID041]-[uart1_rx_isr]
+ * @fnbrf           UART1 receive, queue the character for cmd_poll
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          Never blocks, a full queue drops the character.
+ *                  CFG_SYNC : stamps the first byte of every line.
+ */
+void uart1_rx_isr(void)
+{
+	u2 u2_rb   = u1rb;
+	u1 u1_next = (u1)((u1_rxq_head + 1) & UART_RXQ_MASK);
+
+	b_wake = 1;
+
+	if ((u2_rb & UART_RB_ERR) != 0)
+	{
+		u2_rx_err++;
+	}
+	else if (u1_next == u1_rxq_tail)
+	{
+		u2_rx_drop++;
+	}
+	else
+	{
+#if (CFG_SYNC != 0)
+		if (b_rx_eol != 0)
+		{
+			u4_rx_start = hal_time_stamp();
+			u1_rx_starts++;
+		}
+		b_rx_eol = (BOOL)(((char)u2_rb == '\r') || ((char)u2_rb == '\n'));
+#endif
+		s1_rxq[u1_rxq_head] = (char)u2_rb;
+		u1_rxq_head = u1_next;
+	}
 }
+#endif
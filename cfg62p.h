@@ -0,0 +1,287 @@
+/**
+ * @file       cfg62p.h
+ * @brief      [MID003]-[cfg62p]
+ * @details    Compile time configuration of 02_mapping_calculation.c.
+ * @details    CFG_PRESET selects a set of choices, each one can still be
+ * @details    overridden with -D :
+ * @details      CFG_PRESET_FULL  (0) : command interface and every feature (default)
+ * @details      CFG_PRESET_TEXT  (1) : text line of AN0, fixed setting
+ * @details      CFG_PRESET_FRAME (2) : binary frame of AN0-AN5, fixed setting
+ * @details    Without the command interface the channel mask, format, precision,
+ * @details    deadband and sample period are constants, the sample loop folds to
+ * @details    the configured channels and format, and code and data of the
+ * @details    features, formats and engine not selected are not compiled.
+ * @details    Build (simulator, Makefile targets sim02 / sim02t / sim02f / sim02d) :
+ * @details      gcc -O2 -Ihost -o sim02 02_mapping_calculation.c com62p.c hal62p.c host/sim62p.c
+ * @details      gcc -O2 -Ihost -DCFG_PRESET=1 -o sim02t 02_mapping_calculation.c com62p.c hal62p.c
+ * @details        host/sim62p.c
+ * @details    ROM/RAM/cycle report of a preset (host/bench.c, variant CFG_NAME) :
+ * @details      make report, or by hand for CFG_PRESET=1 :
+ * @details      gcc -Os -fno-asynchronous-unwind-tables -Ihost -DCFG_PRESET=1 -r -o 02t.o
+ * @details        02_mapping_calculation.c com62p.c hal62p.c
+ * @details      gcc -O2 -Wno-unknown-pragmas -Ihost -DCFG_PRESET=1 -o bench_t host/bench.c
+ * @details        host/bench_v01b.c host/bench_v01g.c host/bench_v02.c host/sim_stub.c
+ * @details        com62p.c hal62p.c
+ * @details      bench_t -f 02_text=02t.o -S 02_text=sim02t
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+#ifndef CFG62P_H
+#define CFG62P_H
+
+/**
+ * Data definition
+ */
+/* Preset */
+#define CFG_PRESET_FULL     (0)
+#define CFG_PRESET_TEXT     (1)
+#define CFG_PRESET_FRAME    (2)
+#ifndef CFG_PRESET
+#define CFG_PRESET          (CFG_PRESET_FULL)
+#endif
+/* Output format */
+#define CFG_FMT_TEXT        (0)     /* "Teperature : .." line             */
+#define CFG_FMT_BIN         (1)     /* binary sample frame                */
+/* Conversion engine */
+#define CFG_CONV_TABLE      (0)     /* adc_table lookup, 1 KB of ROM      */
+#define CFG_CONV_CALC       (1)     /* integer formula, one division      */
+/* UART1 transmit backend */
+#define CFG_TX_ISR          (0)     /* one interrupt per byte             */
+#define CFG_TX_DMA          (1)     /* DMA0, one interrupt per queued run */
+/* Run mode between samples */
+#define RUN_MODE_ACTIVE     (0)     /* busy loop                          */
+#define RUN_MODE_WAIT       (1)     /* WAIT mode, wake up by interrupt    */
+/* Application mode */
+#define APP_MODE_STREAM     (0)     /* one text line per sample           */
+#define APP_MODE_BURST      (1)     /* one capture, then stream or STOP   */
+#define APP_MODE_STOP       (2)     /* no sampling, commands only         */
+#define APP_MODE_HIST       (3)     /* code histogram windows, no stream  */
+
+/*
+ * Preset choices
+ *   CFG_CMD    : UART1 receive and command interface (RATE, CH, FMT ..)
+ *   CFG_FILT   : filter stage, set by FILT      (needs CFG_CMD)
+ *   CFG_CAL    : calibration in data flash, CAL sets it
+ *   CFG_LOG    : sample log ring, gap backfill, LOG dumps it
+ *   CFG_ADAPT  : adaptive sample period, ADAPT  (needs CFG_CMD)
+ *   CFG_STATS  : sliding window mean, deviation and slope per channel,
+ *                one record per CFG_STATS_EVERY samples, STATS
+ *   CFG_BURST  : burst capture, BURST or APP_MODE_DEFAULT
+ *   CFG_HIST   : A/D code histogram at the maximum rate, HIST or
+ *                APP_MODE_DEFAULT
+ *   CFG_POOL   : sample records handed by index from ad_isr to main to the
+ *                transmitter, the text line is sent from its record
+ *   CFG_ALARM  : threshold alarm per channel, ALARM (needs CFG_CMD)
+ *   CFG_URGENT : alarms on the urgent UART1 lane, sent ahead of the queued
+ *                output at the end of a line or frame (0 : behind it)
+ *   CFG_SYNC   : host time of every sample from SYNC pings, offset and
+ *                drift (needs CFG_CMD)
+ *   CFG_STRIPE : UARTs the binary sample frames can be striped over,
+ *                STRIPE n (1 : UART1 only, 2 : + UART2, 3 : + UART0)
+ *   CFG_REPORT : duty cycle and latency trace lines (needs CFG_TEXT_ON)
+ *   CFG_MEM    : stack high-water mark and RAM of each subsystem, MEM
+ *                (needs CFG_CMD)
+ *   CFG_CONV   : conversion engine
+ *   CFG_TX     : UART1 transmit backend, same queue and uart_puts / uart_write
+ *   CFG_FMT, CFG_CH_MASK, CFG_PREC, CFG_DEADBAND, CFG_PERIOD_MS,
+ *   CFG_STATS_EVERY :
+ *                setting at reset, constant without CFG_CMD
+ */
+#if (CFG_PRESET == CFG_PRESET_FULL)
+#define CFG_NAME            "02_map"
+#define CFG_PRESET_CMD      (1)
+#define CFG_PRESET_FMT      (CFG_FMT_TEXT)
+#define CFG_PRESET_CH_MASK  (0x01)
+#elif (CFG_PRESET == CFG_PRESET_TEXT)
+#define CFG_NAME            "02_text"
+#define CFG_PRESET_CMD      (0)
+#define CFG_PRESET_FMT      (CFG_FMT_TEXT)
+#define CFG_PRESET_CH_MASK  (0x01)
+#elif (CFG_PRESET == CFG_PRESET_FRAME)
+#define CFG_NAME            "02_frame"
+#define CFG_PRESET_CMD      (0)
+#define CFG_PRESET_FMT      (CFG_FMT_BIN)
+#define CFG_PRESET_CH_MASK  (0x3F)
+#else
+#error "CFG_PRESET : unknown preset"
+#endif
+
+#ifndef CFG_CMD
+#define CFG_CMD             (CFG_PRESET_CMD)
+#endif
+#ifndef CFG_FILT
+#define CFG_FILT            (CFG_PRESET_CMD)
+#endif
+#ifndef CFG_CAL
+#define CFG_CAL             (CFG_PRESET_CMD)
+#endif
+#ifndef CFG_LOG
+#define CFG_LOG             (CFG_PRESET_CMD)
+#endif
+#ifndef CFG_ADAPT
+#define CFG_ADAPT           (CFG_PRESET_CMD)
+#endif
+#ifndef CFG_STATS
+#define CFG_STATS           (CFG_PRESET_CMD)
+#endif
+#ifndef CFG_BURST
+#define CFG_BURST           (CFG_PRESET_CMD)
+#endif
+#ifndef CFG_HIST
+#define CFG_HIST            (CFG_PRESET_CMD)
+#endif
+#ifndef CFG_POOL
+#define CFG_POOL            (CFG_PRESET_CMD)
+#endif
+#ifndef CFG_ALARM
+#define CFG_ALARM           (CFG_PRESET_CMD)
+#endif
+#ifndef CFG_URGENT
+#define CFG_URGENT          (1)
+#endif
+#ifndef CFG_SYNC
+#define CFG_SYNC            (CFG_PRESET_CMD)
+#endif
+#ifndef CFG_STRIPE
+#define CFG_STRIPE          (1 + (2 * CFG_PRESET_CMD))
+#endif
+#ifndef CFG_REPORT
+#define CFG_REPORT          (CFG_PRESET_CMD)
+#endif
+#ifndef CFG_MEM
+#define CFG_MEM             (CFG_PRESET_CMD)
+#endif
+#ifndef CFG_CONV
+#define CFG_CONV            (CFG_CONV_TABLE)
+#endif
+#ifndef CFG_TX
+#define CFG_TX              (CFG_TX_ISR)
+#endif
+#ifndef CFG_FMT
+#define CFG_FMT             (CFG_PRESET_FMT)
+#endif
+#ifndef CFG_CH_MASK
+#define CFG_CH_MASK         (CFG_PRESET_CH_MASK) /* bit n : ANn is output   */
+#endif
+#ifndef CFG_PREC
+#define CFG_PREC            (2)     /* decimals of text output            */
+#endif
+#ifndef CFG_DEADBAND
+#define CFG_DEADBAND        (0)     /* table unit, 0 : output every sample*/
+#endif
+#ifndef CFG_PERIOD_MS
+#define CFG_PERIOD_MS       (100)
+#endif
+#ifndef CFG_STATS_EVERY
+#define CFG_STATS_EVERY     (0)     /* samples per record, 0 : stream     */
+#endif
+
+/* Settings that were -D options of 02_mapping_calculation.c */
+#ifndef RUN_MODE
+#define RUN_MODE            (RUN_MODE_WAIT)
+#endif
+#ifndef UART_BAUD_DEFAULT
+#define UART_BAUD_DEFAULT   (9600)  /* -DUART_BAUD_DEFAULT=38400 etc.     */
+#endif
+#ifndef UART_BAUD_ERR_MAX
+#define UART_BAUD_ERR_MAX   (25)    /* 0.1 % unit, about half the 8N1 budget */
+#endif
+#ifndef APP_MODE_DEFAULT
+#define APP_MODE_DEFAULT    (APP_MODE_STREAM)
+#endif
+#ifndef BURST_CH
+#define BURST_CH            (1)     /* AN0.. : 1, 2, 4, 6 or 8            */
+#endif
+#ifndef LOG_REC_MAX
+#define LOG_REC_MAX         (256)   /* power of 2, 1 KB                   */
+#endif
+#ifndef STATS_WIN
+#define STATS_WIN           (16)    /* power of 2, samples per window     */
+#endif
+#ifndef POOL_REC_MAX
+#define POOL_REC_MAX        (4)     /* power of 2, samples in flight      */
+#endif
+#ifndef HIST_CNT_BITS
+#define HIST_CNT_BITS       (16)    /* 16 : 512 bytes, 32 : 1 KB          */
+#endif
+
+/* User stack, STACKSIZE of ncrt0.a30 (CFG_MEM) */
+#ifndef STACK_SIZE
+#define STACK_SIZE          (0x300)
+#endif
+#ifndef STACK_TOP_USE
+#define STACK_TOP_USE       (128)   /* startup and main frame, not painted */
+#endif
+#ifndef STACK_GUARD
+#define STACK_GUARD         (16)    /* stack_paint frame, not painted     */
+#endif
+
+/* Derived */
+#define CFG_DB_ON           ((CFG_CMD != 0) || (CFG_DEADBAND != 0))
+#define CFG_TEXT_ON         ((CFG_CMD != 0) || (CFG_FMT != CFG_FMT_BIN))
+#define CFG_BIN_ON          ((CFG_CMD != 0) || (CFG_FMT == CFG_FMT_BIN))
+
+/*
+ * Combinations that cannot work
+ */
+#if (CFG_CMD == 0) && ((CFG_FILT != 0) || (CFG_ADAPT != 0))
+#error "CFG_FILT and CFG_ADAPT are set by command, they need CFG_CMD"
+#endif
+#if (CFG_STATS == 0) && (CFG_STATS_EVERY != 0)
+#error "CFG_STATS_EVERY needs CFG_STATS"
+#endif
+#if (CFG_STATS_EVERY < 0) || (CFG_STATS_EVERY > 255)
+#error "CFG_STATS_EVERY : 0 to 255"
+#endif
+#if (STATS_WIN < 2) || (STATS_WIN > 128) || ((STATS_WIN & (STATS_WIN - 1)) != 0)
+#error "STATS_WIN : power of 2, 2 to 128"
+#endif
+#if (CFG_CMD == 0) && (CFG_MEM != 0)
+#error "CFG_MEM is reported by command, it needs CFG_CMD"
+#endif
+#if (CFG_CMD == 0) && (CFG_ALARM != 0)
+#error "CFG_ALARM thresholds are set by command, it needs CFG_CMD"
+#endif
+#if (CFG_CMD == 0) && (CFG_SYNC != 0)
+#error "CFG_SYNC pings are commands, it needs CFG_CMD"
+#endif
+#if (CFG_STRIPE < 1) || (CFG_STRIPE > 3)
+#error "CFG_STRIPE : 1 to 3 UARTs"
+#endif
+#if (CFG_STRIPE > 1) && (CFG_CMD == 0)
+#error "CFG_STRIPE links are chosen by command, it needs CFG_CMD"
+#endif
+#if (CFG_MEM != 0) && (STACK_SIZE <= (STACK_TOP_USE + STACK_GUARD))
+#error "STACK_SIZE : larger than STACK_TOP_USE + STACK_GUARD"
+#endif
+#if (CFG_REPORT != 0) && !CFG_TEXT_ON
+#error "CFG_REPORT prints text lines, it needs CFG_TEXT_ON"
+#endif
+#if (CFG_BURST == 0) && (APP_MODE_DEFAULT == APP_MODE_BURST)
+#error "APP_MODE_BURST needs CFG_BURST"
+#endif
+#if (CFG_HIST == 0) && (APP_MODE_DEFAULT == APP_MODE_HIST)
+#error "APP_MODE_HIST needs CFG_HIST"
+#endif
+#if (CFG_CMD == 0) && (CFG_HIST != 0) && (APP_MODE_DEFAULT != APP_MODE_HIST)
+#error "CFG_HIST is started by HIST, without CFG_CMD it needs APP_MODE_HIST"
+#endif
+#if (POOL_REC_MAX < 2) || (POOL_REC_MAX > 128) || ((POOL_REC_MAX & (POOL_REC_MAX - 1)) != 0)
+#error "POOL_REC_MAX : power of 2, 2 to 128"
+#endif
+#if (HIST_CNT_BITS != 16) && (HIST_CNT_BITS != 32)
+#error "HIST_CNT_BITS : 16 or 32"
+#endif
+#if ((CFG_CH_MASK & 0x3F) == 0) || ((CFG_CH_MASK & ~0x3F) != 0)
+#error "CFG_CH_MASK : AN0 to AN5, at least one"
+#endif
+#if (CFG_PREC < 0) || (CFG_PREC > 4)
+#error "CFG_PREC : 0 to 4"
+#endif
+#if (CFG_PERIOD_MS < 10) || (CFG_PERIOD_MS > 2550) || ((CFG_PERIOD_MS % 10) != 0)
+#error "CFG_PERIOD_MS : 10 to 2550, multiple of the 10 ms tick"
+#endif
+
+#endif /* CFG62P_H */
@@ -0,0 +1,205 @@
+/**
+ * @file       com62p.c
+ * @brief      [MID002]-[com62p]
+ * @details    Conversion and formatting code shared by the firmware variants.
+ * @details    CPU GROUP = 62P
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+
+/**
+ * Include file
+ */
+#include "com62p.h"
+
+/**
+ * Global Variable Definition
+ * Constant data for ftoa fucntion
+ */
+static const double rounders[MAX_PRECISION + 1] = {
+	0.5,          /* 0 */
+	0.05,         /* 1 */
+	0.005,        /* 2 */
+	0.0005,       /* 3 */
+	0.00005,      /* 4 */
+	0.000005,     /* 5 */
+	0.0000005,    /* 6 */
+	0.00000005,   /* 7 */
+	0.000000005,  /* 8 */
+	0.0000000005, /* 9 */
+	0.00000000005 /* 10 */
+};
+
+/**
+ * @fn              char* ftoa(f8 f8_f, char* buf, s2 s2_precision)
+ * @fid             [FID012]-[ftoa]
+ * @fnbrf           Convert floating point to string.
+ * @param[in]       f8_f ; f8 ; floating point input 
+ * @param[in,out]   *buf ; char ; buffer output
+ * @retval			*ftoa ; char ; pointer
+ * @warning         May side effect with s1 (signed char) 
+ * @remark          -
+ */
+char* ftoa(f8 f8_f, char* buf, s2 s2_precision)
+{
+	char* ptr = buf;
+	char* p = ptr;
+	char* ptr1;
+	char c;
+	s4 intPart;
+
+	if (s2_precision > MAX_PRECISION)
+	{
+		s2_precision = MAX_PRECISION;
+	}
+
+	if (f8_f < 0)
+	{
+		f8_f = -f8_f;
+		*ptr++ = '-';
+	}
+
+	if (s2_precision < 0)
+	{
+		if (f8_f < 1.0)
+		{
+			s2_precision = 6;
+		}
+		else if (f8_f < 10.0)
+		{
+			s2_precision = 5;
+		}
+		else if (f8_f < 100.0)
+		{
+			s2_precision = 4;
+		}
+		else if (f8_f < 1000.0)
+		{
+			s2_precision = 3;
+		}
+		else if (f8_f < 10000.0)
+		{
+			s2_precision = 2;
+		}
+		else if (f8_f < 100000.0)
+		{
+			s2_precision = 1;
+		}
+		else
+		{
+			s2_precision = 0;
+		}
+	}
+
+	if (s2_precision)
+	{
+		f8_f += rounders[s2_precision];
+	}
+
+	intPart = f8_f;
+	f8_f -= intPart;
+
+	if (!intPart)
+	{
+		*ptr++ = '0';
+	}
+	else
+	{
+		p = ptr;
+
+		while (intPart)
+		{
+			*p++ = '0' + intPart % 10;
+			intPart /= 10;
+		}
+
+		ptr1 = p;
+
+		while (p > ptr)
+		{
+			c = *--p;
+			*p = *ptr;
+			*ptr++ = c;
+		}
+
+		ptr = ptr1;
+	}
+
+	if (s2_precision)
+	{
+		*ptr++ = '.';
+
+		while (s2_precision--)
+		{
+			f8_f *= 10.0;
+			c = f8_f;
+			*ptr++ = '0' + c;
+			f8_f -= c;
+		}
+	}
+
+	*ptr = 0;
+
+	return buf;
+}
+
+/**
+ * @fn              f8 read_temp(u4 u4_val)
+ * @fid             [FID011]-[read_temp]
+ * @fnbrf           Read temperature sensor.
+ * @param[in]       u4_val ; u4 ; adc data (mV)
+ * @param[in,out]   -
+ * @retval          f8_temp ; f8 ; temperature data
+ * @warning         -
+ * @remark          -
+ */
+f8 read_temp(u4 u4_val)
+{
+	f8 f8_temp = 0.0;
+
+	/*
+	 * This formula converts the number 0-255
+	 * from the ADC into 0-5000mV (= 5V)
+	 */
+	f8_temp = ((u4_val * 5000) / 255);
+
+	/*
+	 * This formula convertsmillivolts into temperature
+	 */
+	f8_temp = (f8_temp - 500) / 10;
+
+	return f8_temp;
+}
+
+/**
+ * @fn              s4 s2g_glmap1b_s2pt(s2 X, const s4* MAP)
+ * @fid             [FID013]-[s2g_glmap1b_s2pt]
+ * @fnbrf           Temperature data mapping table
+ * @param[in]       X ; s2 ; adc data
+ * @param[in,out]   -
+ * @retval          Y ; s4 ; temperature data
+ * @warning         -
+ * @remark          -
+ */
+s4 s2g_glmap1b_s2pt(s2 X, const s4* MAP)
+{
+    return (MAP[X]);
+}
+
+/**
+ * @fn              s4 conv_calc(u1 u1_code)
+ * @fid             [FID065]-[conv_calc]
+ * @fnbrf           Temperature from the A/D code by integer formula
+ * @param[in]       u1_code ; u1 ; adc data
+ * @param[in,out]   -
+ * @retval          s4_temp ; s4 ; temperature data, 1/100 degC
+ * @warning         -
+ * @remark          (code * 5000 / 255 - 500) / 10 in 1/100, rounded half up,
+ *                  equal to the adc_table of 02 for every code.
+ */
+s4 conv_calc(u1 u1_code)
+{
+	return ((((s4)u1_code * 50000L) + 127) / 255) - 5000;
+}
@@ -0,0 +1,58 @@
+/**
+ * @file       com62p.h
+ * @brief      [MID002]-[com62p]
+ * @details    Definitions shared by the firmware variants.
+ * @details    CPU GROUP = 62P
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+#ifndef COM62P_H
+#define COM62P_H
+
+/**
+ * Data type definition refer to MISRA
+ */
+typedef unsigned char        u1;
+typedef unsigned short       u2;
+typedef unsigned long        u4;
+typedef unsigned long long   u8;
+typedef signed char          s1;
+typedef signed short         s2;
+typedef signed long          s4;
+typedef signed long long     s8;
+typedef float                f4;
+typedef double               f8;
+typedef unsigned char        BOOL;
+
+/**
+ * Data definition
+ */
+/* char 1 byte */
+#define S1_MIN              (-128)
+#define S1_MAX              (127)
+#define U1_MIN              (0)
+#define U1_MAX              (255)
+/* short 1 byte */
+#define S2_MIN              (-32768)
+#define S2_MAX              (32767)
+#define U2_MIN              (0)
+#define U2_MAX              (65535)
+/* Analog input channel */
+#define ADC_CH0             (0)
+/* LED0 */
+#define LED0_ON             (p7_0 = 0)
+#define LED0_OFF            (p7_0 = 1)
+/* ftoa data definition */
+#define MAX_PRECISION       (10)
+
+/**
+ * fucntion prototype declaration (com62p.c)
+ */
+char*  ftoa(f8 f8_f, char* buf, s2 s2_precision);
+f8     read_temp(u4 u4_val);
+s4     s2g_glmap1b_s2pt(s2 X, const s4* MAP);
+s4     conv_calc(u1 u1_code);
+
+#endif /* COM62P_H */
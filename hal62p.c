@@ -0,0 +1,367 @@
+/**
+ * @file       hal62p.c
+ * @brief      [MID004]-[hal62p]
+ * @details    Port, A/D, timer and UART access shared by the firmware variants.
+ * @details    CPU GROUP = 62P
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+
+/**
+ * Include file
+ */
+#include "sfr62p.h"
+#include "com62p.h"
+#include "hal62p.h"
+
+/**
+ * @fn              void hal_port_init(void)
+ * @fid             [FID001]-[hal_port_init]
+ * @fnbrf           Initialize Hardware
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+HAL_API void hal_port_init(void)
+{
+	pd7 = 0xFF; /* Set port 7 direction as output */
+	p7  = 0xFF; /* Set port 7 outpt off           */
+}
+
+/**
+ * @fn              void hal_adc_init(u1 u1_con0, u1 u1_con1)
+ * @fid             [FID002]-[hal_adc_init]
+ * @fnbrf           Initialize A/D
+ * @param[in]       u1_con0 ; u1 ; adcon0, HAL_ADC_SINGLE_SWEEP / HAL_ADC_REPEAT_SWEEP
+ * @param[in]       u1_con1 ; u1 ; adcon1, HAL_ADC_AN0_AN1 / AN0_AN3 / AN0_AN5
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          The caller starts the conversion (adst) and sets adic.
+ */
+HAL_API void hal_adc_init(u1 u1_con0, u1 u1_con1)
+{
+	adcon0 = u1_con0;
+	/* setting ADC control register adcon0 mode register                           */
+	/* 10011000 (repeat sweep 0) / 10010000 (single sweep)                         */
+	/* |||||+++---- ADC channel                                                    */
+	/* |||++------- ADC Mode "11" repeat sweep mode 0 and 1, "10" single sweep     */
+	/* ||+--------- Trigger ('0' is software trigger / '1' is extenal pin trigger) */
+	/* |+---------- ADC start bit       */
+	/* +----------- Freq divider selection ('1' is freq/2 / '0' is freq/4)         */
+	/* Be careful !! , to use Freq divider, the bit ck of adcon1 have to be set    */
+
+	adcon1 = u1_con1;
+	/* setting ADC control register adcon1 mode register                           */
+	/* 001000ss                                      		                       */
+	/* ||||||++---- Sweep mode selection AN0 to AN1/3/5                            */
+	/* |||||+------ '0' for repeat sweep mode 0 only 		                       */
+	/* ||||+------- Resolution ('0' : 8 bit / '1' : 10 bit)                        */
+	/* |||+-------- Vref connected '1'                                             */
+	/* ||+--------  Freq divider select ('0' not use freq div / '1' use freq div)  */
+	/* ++----------                                                                */
+
+	adcon2 = 0x01;
+	/* setting ADC control register adcon2 mode register                           */
+	/* 00000001                                                                    */
+	/* ||||||++---- timer  mode                                                    */
+	/* |||||+------ pulse is not output                                            */
+	/* |||++------- gate function not availble                                     */
+	/* ||+--------- timer mode                                                     */
+	/* ++----------  count source is f32                                           */
+}
+
+/**
+ * @fn              u2 hal_adc_read(u1 ch)
+ * @fid             [FID003]-[hal_adc_read]
+ * @fnbrf           Read A/D result register
+ * @param[in]       ch ; u1 ; adc channel
+ * @param[in,out]   -
+ * @retval          u2_vla ; u2 ; adc data
+ * @warning         -
+ * @remark          No wait, the caller knows the sweep is complete.
+ */
+HAL_API u2 hal_adc_read(u1 ch)
+{
+	u2 u2_val = 0;
+	switch (ch)
+	{
+		case 0:
+			u2_val = ad0;
+			break;
+		case 1:
+			u2_val = ad1;
+			break;
+		case 2:
+			u2_val = ad2;
+			break;
+		case 3:
+			u2_val = ad3;
+			break;
+		case 4:
+			u2_val = ad4;
+			break;
+		case 5:
+			u2_val = ad5;
+			break;
+		case 6:
+			u2_val = ad6;
+			break;
+		case 7:
+			u2_val = ad7;
+			break;
+		default:
+			break;
+	}
+	return u2_val;
+}
+
+/**
+ * @fn              void hal_timer_init(void)
+ * @fid             [FID004]-[hal_timer_init]
+ * @fnbrf           Start the ta3/ta4 time base
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          Both run free from here, read with hal_time_stamp.
+ *                  The caller sets ta3ic when the underflow is its tick.
+ */
+HAL_API void hal_timer_init(void)
+{
+	ta3mr    = 0x00;   /* ta3 clock source not divided where f = 6 mhz , set as timer mode */
+	ir_ta3ic = 0;      /* Clear interupt for ta3 (set to 0)                                */
+	trgsr    = 0x80;   /* trigger register select to ta3                                   */
+	ta4mr    = 0x01;   /* set ta4 as event mode to monitor overflow of ta3                 */
+	udf      = 0x10;   /* set ta4 to count up                                              */
+	ir_ta4ic = 0;      /* Clear interupt for ta4 (set to 0)                                */
+	ta3      = TA3_PERIOD - 1; /* ta3 counts 59999 to 0, underflow every 10 ms             */
+	ta4      = 0;      /* set ta4 to start at 0                                            */
+	ta4s     = 1;      /* Timer a4 start count                                             */
+	ta3s     = 1;      /* Timer a3 start count, both run free as one time base             */
+}
+
+/**
+ * @fn              u4 hal_time_stamp(void)
+ * @fid             [FID014]-[hal_time_stamp]
+ * @fnbrf           Read cascaded ta3/ta4 time base
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          u4_time ; u4 ; ta3 counts (166 ns) since start
+ * @warning         Wraps at TIME_STAMP_WRAP (655 s), use hal_time_elapsed
+ * @remark          ta4 is read twice in case ta3 underflows in between
+ */
+HAL_API u4 hal_time_stamp(void)
+{
+	u2 u2_hi = 0;
+	u2 u2_lo = 0;
+
+	do
+	{
+		u2_hi = ta4;
+		u2_lo = ta3;
+	} while (u2_hi != ta4);
+
+	return TIME_COUNT(u2_hi, u2_lo);
+}
+
+/**
+ * @fn              u4 hal_time_elapsed(u4 u4_from, u4 u4_to)
+ * @fid             [FID015]-[hal_time_elapsed]
+ * @fnbrf           Difference of two time stamps
+ * @param[in]       u4_from ; u4 ; earlier time stamp
+ * @param[in]       u4_to ; u4 ; later time stamp
+ * @param[in,out]   -
+ * @retval          u4_time ; u4 ; ta3 counts
+ * @warning         -
+ * @remark          -
+ */
+HAL_API u4 hal_time_elapsed(u4 u4_from, u4 u4_to)
+{
+	if (u4_to >= u4_from)
+	{
+		return u4_to - u4_from;
+	}
+	return (TIME_STAMP_WRAP - u4_from) + u4_to;
+}
+
+/**
+ * @fn              void hal_uart_init(u1 u1_uart, u1 u1_c0, u1 u1_brg, u1 u1_ipl_tx)
+ * @fid             [FID104]-[hal_uart_init]
+ * @fnbrf           Initialize a UART for 8N1 transmission
+ * @param[in]       u1_uart ; u1 ; HAL_UART0 / HAL_UART1 / HAL_UART2
+ * @param[in]       u1_c0 ; u1 ; UiC0 (count source in CLK1-CLK0)
+ * @param[in]       u1_brg ; u1 ; UiBRG
+ * @param[in]       u1_ipl_tx ; u1 ; SiTIC, 0 : polled or DMA
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          Transmit interrupt on transmit buffer empty. Reception
+ *                  is left to the caller.
+ */
+HAL_API void hal_uart_init(u1 u1_uart, u1 u1_c0, u1 u1_brg, u1 u1_ipl_tx)
+{
+	switch (u1_uart)
+	{
+		case HAL_UART0:
+			u0mr    = 0x05; /* Set mode register      */
+			u0c0    = u1_c0; /* Set control register   */
+			u0brg   = u1_brg; /* Set bit rate generator */
+			u0irs   = 0x00; /* Interrupt on transmit buffer empty */
+			s0tic   = u1_ipl_tx;
+			te_u0c1 = 0x01; /* Enable transmission    */
+			break;
+		case HAL_UART2:
+			u2mr    = 0x05;
+			u2c0    = u1_c0;
+			u2brg   = u1_brg;
+			u2irs   = 0x00;
+			s2tic   = u1_ipl_tx;
+			te_u2c1 = 0x01;
+			break;
+		default:
+			u1mr    = 0x05;
+			u1c0    = u1_c0;
+			u1brg   = u1_brg;
+			u1irs   = 0x00;
+			s1tic   = u1_ipl_tx;
+			te_u1c1 = 0x01;
+			break;
+	}
+}
+
+/**
+ * @fn              void hal_uart_rate(u1 u1_uart, u1 u1_c0, u1 u1_brg)
+ * @fid             [FID105]-[hal_uart_rate]
+ * @fnbrf           Change the bit rate of a UART
+ * @param[in]       u1_uart ; u1 ; HAL_UART0 / HAL_UART1 / HAL_UART2
+ * @param[in]       u1_c0 ; u1 ; UiC0 (count source in CLK1-CLK0)
+ * @param[in]       u1_brg ; u1 ; UiBRG
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         The transmitter must be idle.
+ * @remark          -
+ */
+HAL_API void hal_uart_rate(u1 u1_uart, u1 u1_c0, u1 u1_brg)
+{
+	switch (u1_uart)
+	{
+		case HAL_UART0:
+			u0c0  = u1_c0;
+			u0brg = u1_brg;
+			break;
+		case HAL_UART2:
+			u2c0  = u1_c0;
+			u2brg = u1_brg;
+			break;
+		default:
+			u1c0  = u1_c0;
+			u1brg = u1_brg;
+			break;
+	}
+}
+
+/**
+ * @fn              BOOL hal_uart_baud(u4 u4_baud, u4 u4_err_max, u1* pu1_clk, u1* pu1_brg, u4* pu4_real)
+ * @fid             [FID042]-[hal_uart_baud]
+ * @fnbrf           Compute count source and UiBRG for a bit rate
+ * @param[in]       u4_baud ; u4 ; requested bit rate
+ * @param[in]       u4_err_max ; u4 ; largest error accepted, 0.1 % unit
+ * @param[in,out]   pu1_clk ; u1* ; UiC0 CLK1-CLK0 (0 : f1, 1 : f8, 2 : f32)
+ * @param[in,out]   pu1_brg ; u1* ; UiBRG value
+ * @param[in,out]   pu4_real ; u4* ; bit rate actually generated
+ * @retval          1 : error within u4_err_max, 0 : rejected
+ * @warning         -
+ * @remark          baud = f / (16 * (n + 1)), n rounded to nearest.
+ *                  The count source with the smallest error is chosen.
+ *                  f1 = 6 MHz, 8N1 (10 bits / char). Sample lines/s of
+ *                  02 from the host UART model, "RATE 10" (100 samples/s),
+ *                  10 s :
+ *                    rate     u1brg  real     error    bytes/s  lines/s
+ *                    2400     155    2403.8   +0.16 %    240      5.7
+ *                    4800     77     4807.7   +0.16 %    481     10.6
+ *                    9600     38     9615.4   +0.16 %    960     21.2
+ *                    19200    19     18750    -2.34 %   1868     41.3
+ *                    38400    9      37500    -2.34 %   3732     82.5
+ *                    62500    5      62500     0.00 %   4334     96.3 (sample bound)
+ *                    57600    -      53571    -6.99 %   rejected
+ *                    115200   -      93750   -18.62 %   rejected
+ *                  115200 needs f1 = n * 1.8432 MHz (e.g. 7.3728 MHz).
+ */
+HAL_API BOOL hal_uart_baud(u4 u4_baud, u4 u4_err_max, u1* pu1_clk, u1* pu1_brg, u4* pu4_real)
+{
+	static const u1 div_tbl[UART_CLK_MAX] = { 1, 8, 32 };
+	BOOL b_found    = 0;
+	u4   u4_err_min = 0;
+	u4   u4_div     = 0;
+	u4   u4_n       = 0;
+	u4   u4_real    = 0;
+	u4   u4_err     = 0;
+	u1   u1_clk     = 0;
+
+	if (u4_baud == 0)
+	{
+		return 0;
+	}
+	for (u1_clk = 0; u1_clk < UART_CLK_MAX; u1_clk++)
+	{
+		u4_div = 16UL * div_tbl[u1_clk];
+		u4_n   = (UART_F1_HZ + ((u4_div * u4_baud) / 2)) / (u4_div * u4_baud);
+		if ((u4_n < 1) || (u4_n > (U1_MAX + 1)))
+		{
+			continue;
+		}
+		u4_real = UART_F1_HZ / (u4_div * u4_n);
+		u4_err  = (u4_real > u4_baud) ? (u4_real - u4_baud) : (u4_baud - u4_real);
+		u4_err  = (u4_err * 1000UL) / u4_baud;
+		if ((b_found == 0) || (u4_err < u4_err_min))
+		{
+			b_found    = 1;
+			u4_err_min = u4_err;
+			*pu1_clk   = u1_clk;
+			*pu1_brg   = (u1)(u4_n - 1);
+			*pu4_real  = u4_real;
+		}
+	}
+	return (BOOL)((b_found != 0) && (u4_err_min <= u4_err_max));
+}
+
+/**
+ * @fn              void hal_uart_putc(const char s1_c)
+ * @fid             [FID106]-[hal_uart_putc]
+ * @fnbrf           UART1 character transmit, polled.
+ * @param[in]       s1_c ; const char ; character
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+HAL_API void hal_uart_putc(const char s1_c)
+{
+	while (ti_u1c1 == 0);
+	u1tb = s1_c;
+}
+
+/**
+ * @fn              void hal_uart_puts(const char* s1_s)
+ * @fid             [FID107]-[hal_uart_puts]
+ * @fnbrf           UART1 string transmit, polled.
+ * @param[in]       s1_s ; const char ; string
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         Side effect with s1 (signed char)
+ * @remark          -
+ */
+HAL_API void hal_uart_puts(const char* s1_s)
+{
+	while (*s1_s != '\0')
+	{
+		while (ti_u1c1 == 0);
+		u1tb = *s1_s;
+		s1_s++;
+	}
+}
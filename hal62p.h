@@ -0,0 +1,59 @@
+/**
+ * @file       hal62p.h
+ * @brief      [MID004]-[hal62p]
+ * @details    Port, A/D, timer and UART access shared by the firmware variants.
+ * @details    CPU GROUP = 62P
+ * @details    HAL_API is the storage class of the functions, empty (external)
+ * @details    by default. A host tool that redirects registers by macro defines
+ * @details    it static and includes hal62p.c, see host/bench_v01g.c.
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+#ifndef HAL62P_H
+#define HAL62P_H
+
+#include "com62p.h"
+
+#ifndef HAL_API
+#define HAL_API
+#endif
+
+/**
+ * Data definition
+ */
+/* A/D : adcon0 mode, software trigger, f/2 */
+#define HAL_ADC_SINGLE_SWEEP (0x90)  /* single sweep, started by adst     */
+#define HAL_ADC_REPEAT_SWEEP (0x98)  /* repeat sweep mode 0                */
+/* A/D : adcon1, 8 bit, Vref connected, f/2, sweep group */
+#define HAL_ADC_AN0_AN1      (0x20)
+#define HAL_ADC_AN0_AN3      (0x21)
+#define HAL_ADC_AN0_AN5      (0x22)
+/* Time base : ta3 (f1 = 6 MHz) underflow every 10 ms, ta4 counts underflows */
+#define TA3_PERIOD           (60000)
+#define TIME_STAMP_WRAP      (65536UL * TA3_PERIOD)
+#define TIME_COUNT(hi, lo)   (((u4)(hi) * TA3_PERIOD) + (u4)((TA3_PERIOD - 1) - (lo)))
+/* UART : 8N1 on UART0 to UART2 */
+#define HAL_UART0            (0)
+#define HAL_UART1            (1)
+#define HAL_UART2            (2)
+#define UART_F1_HZ           (6000000UL)
+#define UART_CLK_MAX         (3)     /* f1, f8, f32                        */
+
+/**
+ * fucntion prototype declaration (hal62p.c)
+ */
+HAL_API void hal_port_init(void);
+HAL_API void hal_adc_init(u1 u1_con0, u1 u1_con1);
+HAL_API u2   hal_adc_read(u1 ch);
+HAL_API void hal_timer_init(void);
+HAL_API u4   hal_time_stamp(void);
+HAL_API u4   hal_time_elapsed(u4 u4_from, u4 u4_to);
+HAL_API void hal_uart_init(u1 u1_uart, u1 u1_c0, u1 u1_brg, u1 u1_ipl_tx);
+HAL_API void hal_uart_rate(u1 u1_uart, u1 u1_c0, u1 u1_brg);
+HAL_API BOOL hal_uart_baud(u4 u4_baud, u4 u4_err_max, u1* pu1_clk, u1* pu1_brg, u4* pu4_real);
+HAL_API void hal_uart_putc(const char s1_c);
+HAL_API void hal_uart_puts(const char* s1_s);
+
+#endif /* HAL62P_H */
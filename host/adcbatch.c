@@ -0,0 +1,836 @@
+/**
+ * @file       adcbatch.c
+ * @brief      [MID106]-[adcbatch]
+ * @details    Batch A/D code to temperature conversion, see adcbatch.h.
+ * @details    The AVX2 / AVX-512F kernels are compiled with target attributes,
+ * @details    so no -m option is needed; the kernel set is chosen at run time
+ * @details    from the CPU and can be forced with adcb_isa_set().
+ * @details    Build : gcc -O2 -pthread -c host/adcbatch.c  (gcc / clang, x86-64)
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+
+/**
+ * Include file
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <immintrin.h>
+#include "adcbatch.h"
+
+/**
+ * Data definition
+ */
+#define ADCB_MV_FULL        (5000)    /* read_temp : full scale 5000 mV     */
+#define ADCB_MV_OFFSET      (500)     /* read_temp : 500 mV at 0 degC       */
+#define ADCB_MV_PER_DEG     (10)      /* read_temp : 10 mV / degC           */
+#define ADCB_FIX_PER_DEG    (100)     /* table unit 0.01 degC               */
+/*
+ * The vector kernels divide by the full scale in double precision. The exact
+ * quotient is an integer or at least 1 / 65535 away from one, the rounding
+ * error is below 1e-11, so adding ADCB_EPS and truncating gives the integer
+ * quotient of the scalar code.
+ */
+#define ADCB_EPS            (1e-7)
+#define ADCB_MT_ALIGN       (64)      /* thread chunk, elements             */
+#define ADCB_MT_MAX         (64)
+
+typedef void (*ADCB_KERNEL)(const ADCB_MAP* map, unsigned bits,
+                            const void* in, void* out, size_t n);
+
+typedef void (*ADCB_MINMAX)(const int32_t* in, size_t n, int32_t* v_min, int32_t* v_max);
+
+typedef struct
+{
+	int             op;
+	const ADCB_MAP* map;
+	unsigned        bits;
+	const void*     in;
+	void*           out;
+	size_t          n;
+} ADCB_JOB;
+
+/**
+ * fucntion prototype declaration
+ */
+static void map_fix_scalar(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n);
+static void map_flt_scalar(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n);
+static void lin_fix_scalar(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n);
+static void lin_flt_scalar(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n);
+static void map_fix_avx2(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n);
+static void map_flt_avx2(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n);
+static void lin_fix_avx2(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n);
+static void lin_flt_avx2(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n);
+static void map_fix_avx512(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n);
+static void map_flt_avx512(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n);
+static void lin_fix_avx512(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n);
+static void lin_flt_avx512(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n);
+static void* adcb_thread(void* arg);
+static void minmax_scalar(const int32_t* in, size_t n, int32_t* v_min, int32_t* v_max);
+static void minmax_avx2(const int32_t* in, size_t n, int32_t* v_min, int32_t* v_max);
+static void minmax_avx512(const int32_t* in, size_t n, int32_t* v_min, int32_t* v_max);
+
+/**
+ * Global Variable Definition
+ */
+static const ADCB_KERNEL kernel_tbl[ADCB_ISA_MAX][ADCB_OP_MAX] = {
+	{ map_fix_scalar, map_flt_scalar, lin_fix_scalar, lin_flt_scalar },
+	{ map_fix_avx2,   map_flt_avx2,   lin_fix_avx2,   lin_flt_avx2   },
+	{ map_fix_avx512, map_flt_avx512, lin_fix_avx512, lin_flt_avx512 }
+};
+static const ADCB_MINMAX minmax_tbl[ADCB_ISA_MAX] = { minmax_scalar, minmax_avx2, minmax_avx512 };
+static const char* const isa_name[ADCB_ISA_MAX] = { "scalar", "avx2", "avx512" };
+static int isa_cur = -1;
+
+/**
+ * @fn              void adcb_map_init(ADCB_MAP* map, const long* table)
+ * @fid             [FID401]-[adcb_map_init]
+ * @fnbrf           Copy adc_table into gather friendly arrays.
+ * @param[in]       table ; const long* ; adc_table, ADCB_MAP_SIZE entries
+ * @param[in,out]   map ; ADCB_MAP* ; int32 and float table
+ * @retval          -
+ * @warning         -
+ * @remark          s4 is long on the host (64 bit), the gathers use 32 bit lanes.
+ */
+void adcb_map_init(ADCB_MAP* map, const long* table)
+{
+	int i;
+
+	for (i = 0; i < ADCB_MAP_SIZE; i++)
+	{
+		map->fix[i] = (int32_t)table[i];
+		map->flt[i] = (float)((double)table[i] / ADCB_FIX_PER_DEG);
+	}
+}
+
+/**
+ * @fn              int adcb_isa_best(void)
+ * @fid             [FID402]-[adcb_isa_best]
+ * @fnbrf           Widest kernel set the CPU supports.
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          isa ; int ; ADCB_ISA_xxx
+ * @warning         -
+ * @remark          -
+ */
+int adcb_isa_best(void)
+{
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+	{
+		return ADCB_ISA_AVX512;
+	}
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return ADCB_ISA_AVX2;
+	}
+	return ADCB_ISA_SCALAR;
+}
+
+/**
+ * @fn              int adcb_isa_set(int isa)
+ * @fid             [FID403]-[adcb_isa_set]
+ * @fnbrf           Select the kernel set.
+ * @param[in]       isa ; int ; ADCB_ISA_xxx, -1 : best
+ * @param[in,out]   -
+ * @retval          isa ; int ; kernel set in use, limited to what the CPU supports
+ * @warning         Not thread safe, call before converting.
+ * @remark          -
+ */
+int adcb_isa_set(int isa)
+{
+	int best = adcb_isa_best();
+
+	isa_cur = ((isa < 0) || (isa > best)) ? best : isa;
+	return isa_cur;
+}
+
+/**
+ * @fn              const char* adcb_isa_name(int isa)
+ * @fid             [FID404]-[adcb_isa_name]
+ * @fnbrf           Name of a kernel set.
+ * @param[in]       isa ; int ; ADCB_ISA_xxx
+ * @param[in,out]   -
+ * @retval          name ; const char* ; "scalar", "avx2", "avx512"
+ * @warning         -
+ * @remark          -
+ */
+const char* adcb_isa_name(int isa)
+{
+	return ((isa >= 0) && (isa < ADCB_ISA_MAX)) ? isa_name[isa] : "?";
+}
+
+/**
+ * @fn              size_t adcb_in_size(int op)
+ * @fid             [FID405]-[adcb_in_size]
+ * @fnbrf           Input element size.
+ * @param[in]       op ; int ; ADCB_OP_xxx
+ * @param[in,out]   -
+ * @retval          size ; size_t ; bytes per code
+ * @warning         -
+ * @remark          -
+ */
+size_t adcb_in_size(int op)
+{
+	return ((op == ADCB_OP_MAP_FIX) || (op == ADCB_OP_MAP_FLT)) ? sizeof(uint8_t) : sizeof(uint16_t);
+}
+
+/**
+ * @fn              size_t adcb_out_size(int op)
+ * @fid             [FID406]-[adcb_out_size]
+ * @fnbrf           Output element size.
+ * @param[in]       op ; int ; ADCB_OP_xxx
+ * @param[in,out]   -
+ * @retval          size ; size_t ; bytes per temperature
+ * @warning         -
+ * @remark          -
+ */
+size_t adcb_out_size(int op)
+{
+	return ((op == ADCB_OP_MAP_FIX) || (op == ADCB_OP_LIN_FIX)) ? sizeof(int32_t) : sizeof(float);
+}
+
+/**
+ * @fn              void adcb_convert(int op, const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+ * @fid             [FID407]-[adcb_convert]
+ * @fnbrf           Convert n codes on the calling thread.
+ * @param[in]       op ; int ; ADCB_OP_xxx
+ * @param[in]       map ; const ADCB_MAP* ; table for ADCB_OP_MAP_xxx
+ * @param[in]       bits ; unsigned ; code width for ADCB_OP_LIN_xxx (8..16)
+ * @param[in]       in ; const void* ; codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   out ; void* ; temperatures
+ * @retval          -
+ * @warning         LIN codes above the full scale of bits are not clipped.
+ * @remark          No alignment requirement.
+ */
+void adcb_convert(int op, const ADCB_MAP* map, unsigned bits,
+                  const void* in, void* out, size_t n)
+{
+	if (isa_cur < 0)
+	{
+		(void)adcb_isa_set(-1);
+	}
+	if ((op < 0) || (op >= ADCB_OP_MAX))
+	{
+		return;
+	}
+	if (bits < ADCB_BITS_MIN)
+	{
+		bits = ADCB_BITS_MIN;
+	}
+	else if (bits > ADCB_BITS_MAX)
+	{
+		bits = ADCB_BITS_MAX;
+	}
+	kernel_tbl[isa_cur][op](map, bits, in, out, n);
+}
+
+/**
+ * @fn              void adcb_convert_mt(int op, const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n, unsigned threads)
+ * @fid             [FID408]-[adcb_convert_mt]
+ * @fnbrf           Convert n codes split over threads.
+ * @param[in]       op, map, bits, in, n ; see adcb_convert
+ * @param[in]       threads ; unsigned ; 0 : one per online CPU
+ * @param[in,out]   out ; void* ; temperatures
+ * @retval          -
+ * @warning         -
+ * @remark          Chunks are multiples of ADCB_MT_ALIGN codes so that threads
+ *                  do not share output cache lines. Falls back to the calling
+ *                  thread when a thread cannot be created.
+ */
+void adcb_convert_mt(int op, const ADCB_MAP* map, unsigned bits,
+                     const void* in, void* out, size_t n, unsigned threads)
+{
+	pthread_t thr[ADCB_MT_MAX];
+	ADCB_JOB  job[ADCB_MT_MAX];
+	int       started[ADCB_MT_MAX];
+	size_t    chunk;
+	size_t    pos = 0;
+	unsigned  t;
+
+	if (isa_cur < 0)
+	{
+		(void)adcb_isa_set(-1);
+	}
+	if (threads == 0)
+	{
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = (cpus > 0) ? (unsigned)cpus : 1;
+	}
+	if (threads > ADCB_MT_MAX)
+	{
+		threads = ADCB_MT_MAX;
+	}
+	chunk = (n + threads - 1) / threads;
+	chunk = (chunk + ADCB_MT_ALIGN - 1) & ~(size_t)(ADCB_MT_ALIGN - 1);
+	if ((threads == 1) || (chunk >= n))
+	{
+		adcb_convert(op, map, bits, in, out, n);
+		return;
+	}
+
+	for (t = 0; t < threads; t++)
+	{
+		size_t len = (n - pos < chunk) ? (n - pos) : chunk;
+
+		job[t].op   = op;
+		job[t].map  = map;
+		job[t].bits = bits;
+		job[t].in   = (const char*)in + pos * adcb_in_size(op);
+		job[t].out  = (char*)out + pos * adcb_out_size(op);
+		job[t].n    = len;
+		pos += len;
+		started[t] = (pthread_create(&thr[t], NULL, adcb_thread, &job[t]) == 0);
+		if (started[t] == 0)
+		{
+			(void)adcb_thread(&job[t]);
+		}
+	}
+	for (t = 0; t < threads; t++)
+	{
+		if (started[t] != 0)
+		{
+			pthread_join(thr[t], NULL);
+		}
+	}
+}
+
+/**
+ * @fn              static void* adcb_thread(void* arg)
+ * @fid             [FID409]-[adcb_thread]
+ * @fnbrf           Worker of adcb_convert_mt.
+ * @param[in]       arg ; void* ; ADCB_JOB
+ * @param[in,out]   -
+ * @retval          NULL
+ * @warning         -
+ * @remark          -
+ */
+static void* adcb_thread(void* arg)
+{
+	const ADCB_JOB* job = (const ADCB_JOB*)arg;
+
+	adcb_convert(job->op, job->map, job->bits, job->in, job->out, job->n);
+	return NULL;
+}
+
+/**
+ * @fn              static void map_fix_scalar(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+ * @fid             [FID410]-[map_fix_scalar]
+ * @fnbrf           8-bit codes to int32 through the table, scalar.
+ * @param[in]       map ; const ADCB_MAP* ; table
+ * @param[in]       bits ; unsigned ; code width
+ * @param[in]       in ; const void* ; codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   out ; void* ; temperatures
+ * @retval          -
+ * @warning         -
+ * @remark          Reference, also converts the tail of the vector kernels.
+ */
+static void map_fix_scalar(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+{
+	const uint8_t* c = (const uint8_t*)in;
+	int32_t*       o = (int32_t*)out;
+	size_t         i;
+
+	(void)bits;
+	for (i = 0; i < n; i++)
+	{
+		o[i] = map->fix[c[i]];
+	}
+}
+
+/**
+ * @fn              static void map_flt_scalar(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+ * @fid             [FID411]-[map_flt_scalar]
+ * @fnbrf           8-bit codes to float through the table, scalar.
+ * @param[in]       map ; const ADCB_MAP* ; table
+ * @param[in]       bits ; unsigned ; code width
+ * @param[in]       in ; const void* ; codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   out ; void* ; temperatures
+ * @retval          -
+ * @warning         -
+ * @remark          Reference, also converts the tail of the vector kernels.
+ */
+static void map_flt_scalar(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+{
+	const uint8_t* c = (const uint8_t*)in;
+	float*         o = (float*)out;
+	size_t         i;
+
+	(void)bits;
+	for (i = 0; i < n; i++)
+	{
+		o[i] = map->flt[c[i]];
+	}
+}
+
+/**
+ * @fn              static void lin_fix_scalar(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+ * @fid             [FID412]-[lin_fix_scalar]
+ * @fnbrf           u16 codes to int32 with the read_temp formula, scalar.
+ * @param[in]       map ; const ADCB_MAP* ; table
+ * @param[in]       bits ; unsigned ; code width
+ * @param[in]       in ; const void* ; codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   out ; void* ; temperatures
+ * @retval          -
+ * @warning         -
+ * @remark          Reference, also converts the tail of the vector kernels.
+ */
+static void lin_fix_scalar(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+{
+	const uint16_t* c  = (const uint16_t*)in;
+	int32_t*        o  = (int32_t*)out;
+	uint32_t        fs = (1UL << bits) - 1;
+	size_t          i;
+
+	(void)map;
+	for (i = 0; i < n; i++)
+	{
+		int32_t mv = (int32_t)(((uint32_t)c[i] * ADCB_MV_FULL) / fs);
+		o[i] = (mv - ADCB_MV_OFFSET) * (ADCB_FIX_PER_DEG / ADCB_MV_PER_DEG);
+	}
+}
+
+/**
+ * @fn              static void lin_flt_scalar(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+ * @fid             [FID413]-[lin_flt_scalar]
+ * @fnbrf           u16 codes to float with the read_temp formula, scalar.
+ * @param[in]       map ; const ADCB_MAP* ; table
+ * @param[in]       bits ; unsigned ; code width
+ * @param[in]       in ; const void* ; codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   out ; void* ; temperatures
+ * @retval          -
+ * @warning         -
+ * @remark          Reference, also converts the tail of the vector kernels.
+ */
+static void lin_flt_scalar(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+{
+	const uint16_t* c  = (const uint16_t*)in;
+	float*          o  = (float*)out;
+	uint32_t        fs = (1UL << bits) - 1;
+	size_t          i;
+
+	(void)map;
+	for (i = 0; i < n; i++)
+	{
+		int32_t mv = (int32_t)(((uint32_t)c[i] * ADCB_MV_FULL) / fs);
+		o[i] = (float)((double)(mv - ADCB_MV_OFFSET) / ADCB_MV_PER_DEG);
+	}
+}
+
+/**
+ * @fn              static void map_fix_avx2(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+ * @fid             [FID414]-[map_fix_avx2]
+ * @fnbrf           8-bit codes to int32 through the table, avx2.
+ * @param[in]       map ; const ADCB_MAP* ; table
+ * @param[in]       bits ; unsigned ; code width
+ * @param[in]       in ; const void* ; codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   out ; void* ; temperatures
+ * @retval          -
+ * @warning         -
+ * @remark          8 lanes per gather / double pair, tail done by the scalar kernel.
+ */
+__attribute__((target("avx2")))
+static void map_fix_avx2(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+{
+	const uint8_t* c = (const uint8_t*)in;
+	int32_t*       o = (int32_t*)out;
+	size_t         i = 0;
+
+	for (; i + 32 <= n; i += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)&c[i]);
+		__m128i lo = _mm256_castsi256_si128(v);
+		__m128i hi = _mm256_extracti128_si256(v, 1);
+
+		_mm256_storeu_si256((__m256i*)&o[i],
+		                    _mm256_i32gather_epi32((const int*)map->fix, _mm256_cvtepu8_epi32(lo), 4));
+		_mm256_storeu_si256((__m256i*)&o[i + 8],
+		                    _mm256_i32gather_epi32((const int*)map->fix, _mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)), 4));
+		_mm256_storeu_si256((__m256i*)&o[i + 16],
+		                    _mm256_i32gather_epi32((const int*)map->fix, _mm256_cvtepu8_epi32(hi), 4));
+		_mm256_storeu_si256((__m256i*)&o[i + 24],
+		                    _mm256_i32gather_epi32((const int*)map->fix, _mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)), 4));
+	}
+	map_fix_scalar(map, bits, &c[i], &o[i], n - i);
+}
+
+/**
+ * @fn              static void map_flt_avx2(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+ * @fid             [FID415]-[map_flt_avx2]
+ * @fnbrf           8-bit codes to float through the table, avx2.
+ * @param[in]       map ; const ADCB_MAP* ; table
+ * @param[in]       bits ; unsigned ; code width
+ * @param[in]       in ; const void* ; codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   out ; void* ; temperatures
+ * @retval          -
+ * @warning         -
+ * @remark          8 lanes per gather / double pair, tail done by the scalar kernel.
+ */
+__attribute__((target("avx2")))
+static void map_flt_avx2(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+{
+	const uint8_t* c = (const uint8_t*)in;
+	float*         o = (float*)out;
+	size_t         i = 0;
+
+	for (; i + 32 <= n; i += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)&c[i]);
+		__m128i lo = _mm256_castsi256_si128(v);
+		__m128i hi = _mm256_extracti128_si256(v, 1);
+
+		_mm256_storeu_ps(&o[i],      _mm256_i32gather_ps(map->flt, _mm256_cvtepu8_epi32(lo), 4));
+		_mm256_storeu_ps(&o[i + 8],  _mm256_i32gather_ps(map->flt, _mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)), 4));
+		_mm256_storeu_ps(&o[i + 16], _mm256_i32gather_ps(map->flt, _mm256_cvtepu8_epi32(hi), 4));
+		_mm256_storeu_ps(&o[i + 24], _mm256_i32gather_ps(map->flt, _mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)), 4));
+	}
+	map_flt_scalar(map, bits, &c[i], &o[i], n - i);
+}
+
+/**
+ * @fn              static void lin_fix_avx2(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+ * @fid             [FID416]-[lin_fix_avx2]
+ * @fnbrf           u16 codes to int32 with the read_temp formula, avx2.
+ * @param[in]       map ; const ADCB_MAP* ; table
+ * @param[in]       bits ; unsigned ; code width
+ * @param[in]       in ; const void* ; codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   out ; void* ; temperatures
+ * @retval          -
+ * @warning         -
+ * @remark          8 lanes per gather / double pair, tail done by the scalar kernel.
+ */
+__attribute__((target("avx2")))
+static void lin_fix_avx2(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+{
+	const uint16_t* c    = (const uint16_t*)in;
+	int32_t*        o    = (int32_t*)out;
+	const __m256d   inv  = _mm256_set1_pd(1.0 / (double)((1UL << bits) - 1));
+	const __m256d   eps  = _mm256_set1_pd(ADCB_EPS);
+	const __m256i   full = _mm256_set1_epi32(ADCB_MV_FULL);
+	const __m256i   mul  = _mm256_set1_epi32(ADCB_FIX_PER_DEG / ADCB_MV_PER_DEG);
+	const __m256i   off  = _mm256_set1_epi32(ADCB_MV_OFFSET * (ADCB_FIX_PER_DEG / ADCB_MV_PER_DEG));
+	size_t          i    = 0;
+
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256i v  = _mm256_mullo_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)&c[i])), full);
+		__m128i q0 = _mm256_cvttpd_epi32(_mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(v)), inv), eps));
+		__m128i q1 = _mm256_cvttpd_epi32(_mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1)), inv), eps));
+		__m256i q  = _mm256_inserti128_si256(_mm256_castsi128_si256(q0), q1, 1);
+
+		_mm256_storeu_si256((__m256i*)&o[i], _mm256_sub_epi32(_mm256_mullo_epi32(q, mul), off));
+	}
+	lin_fix_scalar(map, bits, &c[i], &o[i], n - i);
+}
+
+/**
+ * @fn              static void lin_flt_avx2(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+ * @fid             [FID417]-[lin_flt_avx2]
+ * @fnbrf           u16 codes to float with the read_temp formula, avx2.
+ * @param[in]       map ; const ADCB_MAP* ; table
+ * @param[in]       bits ; unsigned ; code width
+ * @param[in]       in ; const void* ; codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   out ; void* ; temperatures
+ * @retval          -
+ * @warning         -
+ * @remark          8 lanes per gather / double pair, tail done by the scalar kernel.
+ */
+__attribute__((target("avx2")))
+static void lin_flt_avx2(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+{
+	const uint16_t* c    = (const uint16_t*)in;
+	float*          o    = (float*)out;
+	const __m256d   inv  = _mm256_set1_pd(1.0 / (double)((1UL << bits) - 1));
+	const __m256d   eps  = _mm256_set1_pd(ADCB_EPS);
+	const __m256d   off  = _mm256_set1_pd(ADCB_MV_OFFSET);
+	const __m256d   div  = _mm256_set1_pd(ADCB_MV_PER_DEG);
+	const __m256i   full = _mm256_set1_epi32(ADCB_MV_FULL);
+	size_t          i    = 0;
+
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256i v  = _mm256_mullo_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)&c[i])), full);
+		__m256d m0 = _mm256_round_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(v)), inv), eps),
+		                             _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+		__m256d m1 = _mm256_round_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1)), inv), eps),
+		                             _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+		__m128  t0 = _mm256_cvtpd_ps(_mm256_div_pd(_mm256_sub_pd(m0, off), div));
+		__m128  t1 = _mm256_cvtpd_ps(_mm256_div_pd(_mm256_sub_pd(m1, off), div));
+
+		_mm256_storeu_ps(&o[i], _mm256_insertf128_ps(_mm256_castps128_ps256(t0), t1, 1));
+	}
+	lin_flt_scalar(map, bits, &c[i], &o[i], n - i);
+}
+
+/**
+ * @fn              static void map_fix_avx512(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+ * @fid             [FID418]-[map_fix_avx512]
+ * @fnbrf           8-bit codes to int32 through the table, avx512.
+ * @param[in]       map ; const ADCB_MAP* ; table
+ * @param[in]       bits ; unsigned ; code width
+ * @param[in]       in ; const void* ; codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   out ; void* ; temperatures
+ * @retval          -
+ * @warning         -
+ * @remark          16 lanes per gather / double pair, tail done by the scalar kernel.
+ */
+__attribute__((target("avx512f")))
+static void map_fix_avx512(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+{
+	const uint8_t* c = (const uint8_t*)in;
+	int32_t*       o = (int32_t*)out;
+	size_t         i = 0;
+
+	for (; i + 32 <= n; i += 32)
+	{
+		__m512i i0 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)&c[i]));
+		__m512i i1 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)&c[i + 16]));
+
+		_mm512_storeu_si512(&o[i],      _mm512_i32gather_epi32(i0, map->fix, 4));
+		_mm512_storeu_si512(&o[i + 16], _mm512_i32gather_epi32(i1, map->fix, 4));
+	}
+	map_fix_scalar(map, bits, &c[i], &o[i], n - i);
+}
+
+/**
+ * @fn              static void map_flt_avx512(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+ * @fid             [FID419]-[map_flt_avx512]
+ * @fnbrf           8-bit codes to float through the table, avx512.
+ * @param[in]       map ; const ADCB_MAP* ; table
+ * @param[in]       bits ; unsigned ; code width
+ * @param[in]       in ; const void* ; codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   out ; void* ; temperatures
+ * @retval          -
+ * @warning         -
+ * @remark          16 lanes per gather / double pair, tail done by the scalar kernel.
+ */
+__attribute__((target("avx512f")))
+static void map_flt_avx512(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+{
+	const uint8_t* c = (const uint8_t*)in;
+	float*         o = (float*)out;
+	size_t         i = 0;
+
+	for (; i + 32 <= n; i += 32)
+	{
+		__m512i i0 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)&c[i]));
+		__m512i i1 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)&c[i + 16]));
+
+		_mm512_storeu_ps(&o[i],      _mm512_i32gather_ps(i0, map->flt, 4));
+		_mm512_storeu_ps(&o[i + 16], _mm512_i32gather_ps(i1, map->flt, 4));
+	}
+	map_flt_scalar(map, bits, &c[i], &o[i], n - i);
+}
+
+/**
+ * @fn              static void lin_fix_avx512(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+ * @fid             [FID420]-[lin_fix_avx512]
+ * @fnbrf           u16 codes to int32 with the read_temp formula, avx512.
+ * @param[in]       map ; const ADCB_MAP* ; table
+ * @param[in]       bits ; unsigned ; code width
+ * @param[in]       in ; const void* ; codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   out ; void* ; temperatures
+ * @retval          -
+ * @warning         -
+ * @remark          16 lanes per gather / double pair, tail done by the scalar kernel.
+ */
+__attribute__((target("avx512f")))
+static void lin_fix_avx512(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+{
+	const uint16_t* c    = (const uint16_t*)in;
+	int32_t*        o    = (int32_t*)out;
+	const __m512d   inv  = _mm512_set1_pd(1.0 / (double)((1UL << bits) - 1));
+	const __m512d   eps  = _mm512_set1_pd(ADCB_EPS);
+	const __m512i   full = _mm512_set1_epi32(ADCB_MV_FULL);
+	const __m512i   mul  = _mm512_set1_epi32(ADCB_FIX_PER_DEG / ADCB_MV_PER_DEG);
+	const __m512i   off  = _mm512_set1_epi32(ADCB_MV_OFFSET * (ADCB_FIX_PER_DEG / ADCB_MV_PER_DEG));
+	size_t          i    = 0;
+
+	for (; i + 16 <= n; i += 16)
+	{
+		__m512i v  = _mm512_mullo_epi32(_mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)&c[i])), full);
+		__m256i q0 = _mm512_cvttpd_epi32(_mm512_add_pd(_mm512_mul_pd(_mm512_cvtepi32_pd(_mm512_castsi512_si256(v)), inv), eps));
+		__m256i q1 = _mm512_cvttpd_epi32(_mm512_add_pd(_mm512_mul_pd(_mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(v, 1)), inv), eps));
+		__m512i q  = _mm512_inserti64x4(_mm512_castsi256_si512(q0), q1, 1);
+
+		_mm512_storeu_si512(&o[i], _mm512_sub_epi32(_mm512_mullo_epi32(q, mul), off));
+	}
+	lin_fix_scalar(map, bits, &c[i], &o[i], n - i);
+}
+
+/**
+ * @fn              static void lin_flt_avx512(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+ * @fid             [FID421]-[lin_flt_avx512]
+ * @fnbrf           u16 codes to float with the read_temp formula, avx512.
+ * @param[in]       map ; const ADCB_MAP* ; table
+ * @param[in]       bits ; unsigned ; code width
+ * @param[in]       in ; const void* ; codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   out ; void* ; temperatures
+ * @retval          -
+ * @warning         -
+ * @remark          16 lanes per gather / double pair, tail done by the scalar kernel.
+ */
+__attribute__((target("avx512f")))
+static void lin_flt_avx512(const ADCB_MAP* map, unsigned bits, const void* in, void* out, size_t n)
+{
+	const uint16_t* c    = (const uint16_t*)in;
+	float*          o    = (float*)out;
+	const __m512d   inv  = _mm512_set1_pd(1.0 / (double)((1UL << bits) - 1));
+	const __m512d   eps  = _mm512_set1_pd(ADCB_EPS);
+	const __m512d   off  = _mm512_set1_pd(ADCB_MV_OFFSET);
+	const __m512d   div  = _mm512_set1_pd(ADCB_MV_PER_DEG);
+	const __m512i   full = _mm512_set1_epi32(ADCB_MV_FULL);
+	size_t          i    = 0;
+
+	for (; i + 16 <= n; i += 16)
+	{
+		__m512i v  = _mm512_mullo_epi32(_mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)&c[i])), full);
+		__m512d m0 = _mm512_roundscale_pd(_mm512_add_pd(_mm512_mul_pd(_mm512_cvtepi32_pd(_mm512_castsi512_si256(v)), inv), eps),
+		                                  _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+		__m512d m1 = _mm512_roundscale_pd(_mm512_add_pd(_mm512_mul_pd(_mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(v, 1)), inv), eps),
+		                                  _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+		__m256  t0 = _mm512_cvtpd_ps(_mm512_div_pd(_mm512_sub_pd(m0, off), div));
+		__m256  t1 = _mm512_cvtpd_ps(_mm512_div_pd(_mm512_sub_pd(m1, off), div));
+		__m512d t  = _mm512_insertf64x4(_mm512_castpd256_pd512(_mm256_castps_pd(t0)), _mm256_castps_pd(t1), 1);
+
+		_mm512_storeu_ps(&o[i], _mm512_castpd_ps(t));
+	}
+	lin_flt_scalar(map, bits, &c[i], &o[i], n - i);
+}
+
+/**
+ * @fn              void adcb_minmax(const int32_t* in, size_t n, int32_t* v_min, int32_t* v_max)
+ * @fid             [FID422]-[adcb_minmax]
+ * @fnbrf           Minimum and maximum of fixed point temperatures.
+ * @param[in]       in ; const int32_t* ; ADCB_OP_xxx_FIX output
+ * @param[in]       n ; size_t ; number of values, > 0
+ * @param[in,out]   v_min ; int32_t* ; minimum
+ * @param[in,out]   v_max ; int32_t* ; maximum
+ * @retval          -
+ * @warning         -
+ * @remark          Same kernel set as adcb_convert.
+ */
+void adcb_minmax(const int32_t* in, size_t n, int32_t* v_min, int32_t* v_max)
+{
+	if (isa_cur < 0)
+	{
+		(void)adcb_isa_set(-1);
+	}
+	*v_min = in[0];
+	*v_max = in[0];
+	minmax_tbl[isa_cur](in, n, v_min, v_max);
+}
+
+/**
+ * @fn              static void minmax_scalar(const int32_t* in, size_t n, int32_t* v_min, int32_t* v_max)
+ * @fid             [FID423]-[minmax_scalar]
+ * @fnbrf           Minimum and maximum, scalar.
+ * @param[in]       in ; const int32_t* ; values
+ * @param[in]       n ; size_t ; number of values
+ * @param[in,out]   v_min ; int32_t* ; minimum so far
+ * @param[in,out]   v_max ; int32_t* ; maximum so far
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void minmax_scalar(const int32_t* in, size_t n, int32_t* v_min, int32_t* v_max)
+{
+	int32_t lo = *v_min;
+	int32_t hi = *v_max;
+	size_t  i;
+
+	for (i = 0; i < n; i++)
+	{
+		lo = (in[i] < lo) ? in[i] : lo;
+		hi = (in[i] > hi) ? in[i] : hi;
+	}
+	*v_min = lo;
+	*v_max = hi;
+}
+
+/**
+ * @fn              static void minmax_avx2(const int32_t* in, size_t n, int32_t* v_min, int32_t* v_max)
+ * @fid             [FID424]-[minmax_avx2]
+ * @fnbrf           Minimum and maximum, avx2.
+ * @param[in]       in ; const int32_t* ; values
+ * @param[in]       n ; size_t ; number of values
+ * @param[in,out]   v_min ; int32_t* ; minimum so far
+ * @param[in,out]   v_max ; int32_t* ; maximum so far
+ * @retval          -
+ * @warning         -
+ * @remark          8 lanes, lanes folded at the end, tail done by the scalar kernel.
+ */
+__attribute__((target("avx2")))
+static void minmax_avx2(const int32_t* in, size_t n, int32_t* v_min, int32_t* v_max)
+{
+	__m256i lo = _mm256_set1_epi32(*v_min);
+	__m256i hi = _mm256_set1_epi32(*v_max);
+	int32_t l[8];
+	int32_t h[8];
+	size_t  i  = 0;
+	int     k;
+
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)&in[i]);
+
+		lo = _mm256_min_epi32(lo, v);
+		hi = _mm256_max_epi32(hi, v);
+	}
+	_mm256_storeu_si256((__m256i*)l, lo);
+	_mm256_storeu_si256((__m256i*)h, hi);
+	for (k = 0; k < 8; k++)
+	{
+		*v_min = (l[k] < *v_min) ? l[k] : *v_min;
+		*v_max = (h[k] > *v_max) ? h[k] : *v_max;
+	}
+	minmax_scalar(&in[i], n - i, v_min, v_max);
+}
+
+/**
+ * @fn              static void minmax_avx512(const int32_t* in, size_t n, int32_t* v_min, int32_t* v_max)
+ * @fid             [FID425]-[minmax_avx512]
+ * @fnbrf           Minimum and maximum, avx512.
+ * @param[in]       in ; const int32_t* ; values
+ * @param[in]       n ; size_t ; number of values
+ * @param[in,out]   v_min ; int32_t* ; minimum so far
+ * @param[in,out]   v_max ; int32_t* ; maximum so far
+ * @retval          -
+ * @warning         -
+ * @remark          16 lanes, tail done by the scalar kernel.
+ */
+__attribute__((target("avx512f")))
+static void minmax_avx512(const int32_t* in, size_t n, int32_t* v_min, int32_t* v_max)
+{
+	__m512i lo = _mm512_set1_epi32(*v_min);
+	__m512i hi = _mm512_set1_epi32(*v_max);
+	size_t  i  = 0;
+
+	for (; i + 16 <= n; i += 16)
+	{
+		__m512i v = _mm512_loadu_si512((const void*)&in[i]);
+
+		lo = _mm512_min_epi32(lo, v);
+		hi = _mm512_max_epi32(hi, v);
+	}
+	*v_min = _mm512_reduce_min_epi32(lo);
+	*v_max = _mm512_reduce_max_epi32(hi);
+	minmax_scalar(&in[i], n - i, v_min, v_max);
+}
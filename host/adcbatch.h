@@ -0,0 +1,66 @@
+/**
+ * @file       adcbatch.h
+ * @brief      [MID105]-[adcbatch]
+ * @details    Host batch conversion of archived A/D codes to temperature.
+ * @details    Two conversions, both matching the firmware:
+ * @details      map : 8-bit code through adc_table (s2g_glmap1b_s2pt), gathered.
+ * @details      lin : read_temp formula, mV = code * 5000 / full scale (integer),
+ * @details            temperature = (mV - 500) / 10, for 8 to 16 bit codes.
+ * @details    Fixed point output is in table unit (0.01 degC), float in degC.
+ * @details    Kernels : scalar, AVX2, AVX-512F, selected at run time.
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+#ifndef ADCBATCH_H
+#define ADCBATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Data definition
+ */
+#define ADCB_MAP_SIZE       (256)
+#define ADCB_BITS_MIN       (8)
+#define ADCB_BITS_MAX       (16)
+
+/* Instruction set of the kernels */
+#define ADCB_ISA_SCALAR     (0)
+#define ADCB_ISA_AVX2       (1)
+#define ADCB_ISA_AVX512     (2)
+#define ADCB_ISA_MAX        (3)
+
+/* Conversion */
+#define ADCB_OP_MAP_FIX     (0)     /* u8  -> int32 0.01 degC, table      */
+#define ADCB_OP_MAP_FLT     (1)     /* u8  -> float degC, table           */
+#define ADCB_OP_LIN_FIX     (2)     /* u16 -> int32 0.01 degC, formula    */
+#define ADCB_OP_LIN_FLT     (3)     /* u16 -> float degC, formula         */
+#define ADCB_OP_MAX         (4)
+
+/**
+ * Mapping table in the element types the gathers need
+ */
+typedef struct
+{
+	int32_t fix[ADCB_MAP_SIZE] __attribute__((aligned(64)));
+	float   flt[ADCB_MAP_SIZE] __attribute__((aligned(64)));
+} ADCB_MAP;
+
+/**
+ * Function declaration
+ */
+void        adcb_map_init(ADCB_MAP* map, const long* table);
+int         adcb_isa_best(void);
+int         adcb_isa_set(int isa);
+const char* adcb_isa_name(int isa);
+size_t      adcb_in_size(int op);
+size_t      adcb_out_size(int op);
+void        adcb_convert(int op, const ADCB_MAP* map, unsigned bits,
+                         const void* in, void* out, size_t n);
+void        adcb_convert_mt(int op, const ADCB_MAP* map, unsigned bits,
+                            const void* in, void* out, size_t n, unsigned threads);
+void        adcb_minmax(const int32_t* in, size_t n, int32_t* v_min, int32_t* v_max);
+
+#endif /* ADCBATCH_H */
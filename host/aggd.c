@@ -0,0 +1,1090 @@
+/**
+ * @file       aggd.c
+ * @brief      [MID108]-[aggd]
+ * @details    Multi-board serial aggregator: one epoll loop reads many serial or
+ * @details    pty endpoints, scans the firmware output in place (text lines and
+ * @details    A5 5A binary frames) and writes one merged record stream ordered by
+ * @details    host receive time.
+ * @details    Build : make aggd, or gcc -O2 -Ihost -o aggd host/aggd.c host/colstore.c
+ * @details            02_mapping_calculation.c com62p.c hal62p.c host/sim_stub.c
+ * @details    Usage : aggd [-s baud] [-b] [-o out] [-D dir] device...
+ * @details            aggd -P boards [-L lines] [-k lines_per_write] [-b] [-o out] [-D dir]
+ * @details    -P runs the benchmark: a child process emulates the boards on
+ * @details    local ptys (every 4th board sends binary sample frames).
+ * @details    Record, text : "<t_us>\t<board>\t<type>\t<mask>\t<v0>..\t<time_us>\n"
+ * @details      type T : text line, v = temperature 0.01 unit, time_us = Time stamp
+ * @details      type S : binary sample frame (S or Y), v = raw code, time_us = frame seq
+ * @details      type L : sample log record ('L' frame, one channel), v = raw code,
+ * @details               time_us = board ta4 tick (10 ms) of the sample
+ * @details    Record, -b : AGG_REC as stored in memory.
+ * @details    -D also appends every channel of every T and S record to the columnar
+ * @details    store in dir (colstore.h), L records are backfill and not in time order. adc_table of the firmware, linked in,
+ * @details    gives the value of a binary code and the code of a text value.
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+
+/**
+ * Include file
+ */
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 700
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <termios.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "colstore.h"
+
+/**
+ * Data definition
+ */
+#define AGG_BUF_SIZE        (4096)    /* per endpoint, > longest line/frame  */
+#define AGG_EVENT_MAX       (256)
+#define AGG_OUT_SIZE        (1UL << 16)
+#define AGG_CH_MAX          (6)
+#define AGG_TEMP_FRAC       (2)       /* record value 0.01 unit              */
+#define AGG_TIME_FRAC       (3)       /* ms field to us                      */
+#define AGG_SYNC0           (0xA5)
+#define AGG_SYNC1           (0x5A)
+#define AGG_TYPE_BURST      ('B')
+#define AGG_TYPE_SAMPLE     ('S')
+#define AGG_TYPE_TEXT       ('T')
+#define AGG_TYPE_LOG        ('L')
+#define AGG_TYPE_SYNC       ('Y')     /* 'S' + host time, read as 'S'       */
+#define AGG_TYPE_RATE       ('R')     /* ADAPT period ms(2), counted only   */
+#define AGG_LOG_CH          (0x07)    /* channel bits of a log record        */
+#define AGG_BURST_HEAD      (13)      /* sync .. flags                       */
+#define AGG_BENCH_LINES     (10000)
+#define AGG_BENCH_CHUNK     (8)
+
+/**
+ * Merged record
+ */
+typedef struct
+{
+	uint64_t t_ns;                    /* host receive time (CLOCK_MONOTONIC) */
+	uint16_t board;                   /* endpoint index                     */
+	uint8_t  type;                    /* AGG_TYPE_TEXT / SAMPLE / LOG       */
+	uint8_t  mask;                    /* channels present in val            */
+	int32_t  val[AGG_CH_MAX];
+	int32_t  aux;                     /* T : time stamp us, S : sequence    */
+} AGG_REC;
+
+/**
+ * Endpoint state
+ */
+typedef struct
+{
+	int            fd;
+	const char*    name;
+	unsigned char  buf[AGG_BUF_SIZE];
+	size_t         len;
+	unsigned long  bytes;
+	unsigned long  lines;
+	unsigned long  frames;
+	unsigned long  other;             /* text lines that are not samples    */
+	unsigned long  errors;            /* bad checksum or garbage            */
+	int            open;
+} AGG_EP;
+
+/**
+ * Conversion table of 02_mapping_calculation.c (s4 is long on the host)
+ */
+extern const long adc_table[CS_TABLE_SIZE];
+
+/**
+ * Global Variable Definition
+ */
+static AGG_EP*  ep_tbl;
+static unsigned ep_num;
+static FILE*    out_fp;
+static int      out_bin;
+static char     out_buf[AGG_OUT_SIZE];
+static size_t   out_len;
+static unsigned long long rec_cnt;
+static CS_STORE st_store;
+static int      store_on;
+
+/**
+ * fucntion prototype declaration
+ */
+static uint64_t agg_now(void);
+static int      agg_open(const char* path, speed_t speed);
+static void     agg_raw(int fd, speed_t speed);
+static void     agg_read(AGG_EP* ep, uint16_t board, uint64_t t_ns);
+static size_t   agg_scan(AGG_EP* ep, uint16_t board, uint64_t t_ns);
+static int      agg_text(const unsigned char* p, const unsigned char* end, AGG_REC* rec);
+static const unsigned char* agg_fixed(const unsigned char* p, const unsigned char* end,
+                                      int frac, int32_t* val);
+static long     agg_frame(const unsigned char* p, size_t len, AGG_REC* rec);
+static void     agg_log(const unsigned char* p, uint16_t board, uint64_t t_ns);
+static void     agg_emit(const AGG_REC* rec);
+static void     agg_flush(void);
+static void     agg_store(const AGG_REC* rec);
+static void     agg_loop(int efd, unsigned long long stop_after);
+static int      agg_bench(unsigned boards, unsigned long lines, unsigned chunk);
+static void     agg_board(int* master, unsigned boards, unsigned long lines,
+                          unsigned chunk, int ready_fd, int done_fd);
+
+/**
+ * @fn              static uint64_t agg_now(void)
+ * @fid             [FID601]-[agg_now]
+ * @fnbrf           Monotonic time in ns.
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          t ; uint64_t ; ns
+ * @warning         -
+ * @remark          -
+ */
+static uint64_t agg_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @fn              static void agg_raw(int fd, speed_t speed)
+ * @fid             [FID602]-[agg_raw]
+ * @fnbrf           Raw 8N1 mode, no echo.
+ * @param[in]       fd ; int ; terminal
+ * @param[in]       speed ; speed_t ; B9600 etc., 0 : keep
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          Does nothing for files and pipes.
+ */
+static void agg_raw(int fd, speed_t speed)
+{
+	struct termios tio;
+
+	if (tcgetattr(fd, &tio) != 0)
+	{
+		return;
+	}
+	cfmakeraw(&tio);
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cc[VMIN]  = 1;
+	tio.c_cc[VTIME] = 0;
+	if (speed != 0)
+	{
+		cfsetispeed(&tio, speed);
+		cfsetospeed(&tio, speed);
+	}
+	(void)tcsetattr(fd, TCSANOW, &tio);
+}
+
+/**
+ * @fn              static int agg_open(const char* path, speed_t speed)
+ * @fid             [FID603]-[agg_open]
+ * @fnbrf           Open an endpoint non-blocking.
+ * @param[in]       path ; const char* ; serial device, pty or fifo
+ * @param[in]       speed ; speed_t ; bit rate of serial devices
+ * @param[in,out]   -
+ * @retval          fd ; int ; -1 on error
+ * @warning         -
+ * @remark          -
+ */
+static int agg_open(const char* path, speed_t speed)
+{
+	int fd = open(path, O_RDONLY | O_NOCTTY | O_NONBLOCK);
+
+	if (fd < 0)
+	{
+		perror(path);
+		return -1;
+	}
+	agg_raw(fd, speed);
+	return fd;
+}
+
+/**
+ * @fn              static void agg_read(AGG_EP* ep, uint16_t board, uint64_t t_ns)
+ * @fid             [FID604]-[agg_read]
+ * @fnbrf           Drain an endpoint and emit its complete records.
+ * @param[in]       board ; uint16_t ; endpoint index
+ * @param[in]       t_ns ; uint64_t ; receive time of this wake-up
+ * @param[in,out]   ep ; AGG_EP* ; endpoint
+ * @retval          -
+ * @warning         -
+ * @remark          Reads straight into the endpoint buffer behind the partial
+ *                  record left by the previous read; only that remainder is moved.
+ */
+static void agg_read(AGG_EP* ep, uint16_t board, uint64_t t_ns)
+{
+	ssize_t n;
+	size_t  used;
+
+	for (;;)
+	{
+		n = read(ep->fd, &ep->buf[ep->len], AGG_BUF_SIZE - ep->len);
+		if (n > 0)
+		{
+			ep->bytes += (unsigned long)n;
+			ep->len   += (size_t)n;
+			used = agg_scan(ep, board, t_ns);
+			if (used == 0 && ep->len == AGG_BUF_SIZE)
+			{
+				ep->errors++;            /* no delimiter in a full buffer */
+				used = ep->len;
+			}
+			if (used != 0)
+			{
+				memmove(ep->buf, &ep->buf[used], ep->len - used);
+				ep->len -= used;
+			}
+			continue;
+		}
+		if ((n < 0) && (errno == EINTR))
+		{
+			continue;
+		}
+		if ((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+		{
+			return;
+		}
+		ep->open = 0;                    /* EOF or hang-up (EIO) */
+		return;
+	}
+}
+
+/**
+ * @fn              static size_t agg_scan(AGG_EP* ep, uint16_t board, uint64_t t_ns)
+ * @fid             [FID605]-[agg_scan]
+ * @fnbrf           Parse the complete records in the endpoint buffer.
+ * @param[in]       board ; uint16_t ; endpoint index
+ * @param[in]       t_ns ; uint64_t ; receive time
+ * @param[in,out]   ep ; AGG_EP* ; endpoint
+ * @retval          used ; size_t ; bytes consumed
+ * @warning         -
+ * @remark          Text never contains 0xA5, so a frame starts where a line would.
+ *                  Lines are found with memchr and parsed in the buffer.
+ */
+static size_t agg_scan(AGG_EP* ep, uint16_t board, uint64_t t_ns)
+{
+	const unsigned char* p   = ep->buf;
+	const unsigned char* end = ep->buf + ep->len;
+	AGG_REC              rec;
+
+	while (p < end)
+	{
+		if (*p == AGG_SYNC0)
+		{
+			long n = agg_frame(p, (size_t)(end - p), &rec);
+
+			if (n == 0)
+			{
+				break;                   /* incomplete frame */
+			}
+			if (n < 0)
+			{
+				ep->errors++;
+				p++;                     /* resynchronise */
+				continue;
+			}
+			ep->frames++;
+			if (rec.type == AGG_TYPE_SAMPLE)
+			{
+				rec.t_ns  = t_ns;
+				rec.board = board;
+				agg_emit(&rec);
+			}
+			else if (rec.type == AGG_TYPE_LOG)
+			{
+				agg_log(p, board, t_ns);
+			}
+			p += n;
+		}
+		else
+		{
+			const unsigned char* nl = (const unsigned char*)memchr(p, '\n', (size_t)(end - p));
+			const unsigned char* sy = (const unsigned char*)memchr(p, AGG_SYNC0, (size_t)(end - p));
+
+			if ((sy != NULL) && ((nl == NULL) || (sy < nl)))
+			{
+				ep->errors++;            /* garbage before a frame */
+				p = sy;
+				continue;
+			}
+			if (nl == NULL)
+			{
+				break;                   /* incomplete line */
+			}
+			if (agg_text(p, nl, &rec) == 0)
+			{
+				ep->lines++;
+				rec.t_ns  = t_ns;
+				rec.board = board;
+				agg_emit(&rec);
+			}
+			else
+			{
+				ep->other++;             /* reports and command replies */
+			}
+			p = nl + 1;
+		}
+	}
+	return (size_t)(p - ep->buf);
+}
+
+/**
+ * @fn              static const unsigned char* agg_fixed(const unsigned char* p, const unsigned char* end, int frac, int32_t* val)
+ * @fid             [FID606]-[agg_fixed]
+ * @fnbrf           Parse a space padded decimal number as value * 10^frac.
+ * @param[in]       p ; const unsigned char* ; first character
+ * @param[in]       end ; const unsigned char* ; end of line
+ * @param[in]       frac ; int ; decimals kept, more are truncated
+ * @param[in,out]   val ; int32_t* ; value
+ * @retval          next ; const unsigned char* ; after the number, NULL on error
+ * @warning         -
+ * @remark          -
+ */
+static const unsigned char* agg_fixed(const unsigned char* p, const unsigned char* end,
+                                      int frac, int32_t* val)
+{
+	int64_t v    = 0;
+	int     neg  = 0;
+	int     dig  = 0;
+	int     dec  = -1;
+
+	while ((p < end) && (*p == ' '))
+	{
+		p++;
+	}
+	if ((p < end) && (*p == '-'))
+	{
+		neg = 1;
+		p++;
+	}
+	for (; p < end; p++)
+	{
+		if ((*p >= '0') && (*p <= '9'))
+		{
+			if (dec < frac)
+			{
+				v = v * 10 + (*p - '0');
+				if (dec >= 0)
+				{
+					dec++;
+				}
+			}
+			dig++;
+		}
+		else if ((*p == '.') && (dec < 0))
+		{
+			dec = 0;
+		}
+		else
+		{
+			break;
+		}
+	}
+	if ((dig == 0) || (dig > 12))
+	{
+		return NULL;
+	}
+	for (dec = (dec < 0) ? 0 : dec; dec < frac; dec++)
+	{
+		v *= 10;
+	}
+	*val = (int32_t)(neg ? -v : v);
+	return p;
+}
+
+/**
+ * @fn              static int agg_text(const unsigned char* p, const unsigned char* end, AGG_REC* rec)
+ * @fid             [FID607]-[agg_text]
+ * @fnbrf           Parse one "Teperature : .." line.
+ * @param[in]       p ; const unsigned char* ; line start
+ * @param[in]       end ; const unsigned char* ; the '\n'
+ * @param[in,out]   rec ; AGG_REC* ; record without time and board
+ * @retval          0 : sample line, -1 : other line
+ * @warning         -
+ * @remark          "Teperature : v\t" for AN0, "Teperature<n> : v\t" for ANn,
+ *                  then "Time stamp : t ms".
+ */
+static int agg_text(const unsigned char* p, const unsigned char* end, AGG_REC* rec)
+{
+	static const char label[] = "Teperature";
+	static const char stamp[] = "Time stamp : ";
+	int               ch;
+
+	memset(rec, 0, sizeof(*rec));
+	rec->type = AGG_TYPE_TEXT;
+
+	while (((size_t)(end - p) > sizeof(label)) && (memcmp(p, label, sizeof(label) - 1) == 0))
+	{
+		p += sizeof(label) - 1;
+		ch = 0;
+		if ((*p >= '0') && (*p < '0' + AGG_CH_MAX))
+		{
+			ch = *p - '0';
+			p++;
+		}
+		if (((end - p) < 3) || (memcmp(p, " : ", 3) != 0))
+		{
+			return -1;
+		}
+		p = agg_fixed(p + 3, end, AGG_TEMP_FRAC, &rec->val[ch]);
+		if ((p == NULL) || (p >= end) || (*p != '\t'))
+		{
+			return -1;
+		}
+		rec->mask |= (uint8_t)(1U << ch);
+		p++;
+	}
+	if ((rec->mask == 0) || ((size_t)(end - p) < sizeof(stamp) - 1) ||
+	    (memcmp(p, stamp, sizeof(stamp) - 1) != 0))
+	{
+		return -1;
+	}
+	p = agg_fixed(p + sizeof(stamp) - 1, end, AGG_TIME_FRAC, &rec->aux);
+	return ((p != NULL) && ((end - p) >= 2) && (p[0] == 'm') && (p[1] == 's')) ? 0 : -1;
+}
+
+/**
+ * @fn              static long agg_frame(const unsigned char* p, size_t len, AGG_REC* rec)
+ * @fid             [FID608]-[agg_frame]
+ * @fnbrf           Check one binary frame.
+ * @param[in]       p ; const unsigned char* ; sync byte
+ * @param[in]       len ; size_t ; bytes available
+ * @param[in,out]   rec ; AGG_REC* ; sample record (type S), type only for B, L, R
+ * @retval          n ; long ; frame length, 0 : incomplete, -1 : not a frame
+ * @warning         -
+ * @remark          A5 5A type payload.. sum0 sum1, Fletcher-16 over type and
+ *                  payload. 'S' : seq mask code.., 'B' : ch frames(2) pre(2)
+ *                  elapsed(4) flags code.., 'L' : n (tick(2) ch code)..
+ *                  'Y' : seq mask code.. sec(4) us(4), an S record.
+ *                  'R' : ms(2), sample period set by ADAPT.
+ */
+static long agg_frame(const unsigned char* p, size_t len, AGG_REC* rec)
+{
+	size_t   need;
+	size_t   i;
+	unsigned s0 = 0;
+	unsigned s1 = 0;
+	int      ch;
+	int      k  = 0;
+
+	if (len < 5)
+	{
+		return 0;
+	}
+	if (p[1] != AGG_SYNC1)
+	{
+		return -1;
+	}
+	if (p[2] == AGG_TYPE_SAMPLE)
+	{
+		need = 5 + 2 + (size_t)__builtin_popcount(p[4] & ((1U << AGG_CH_MAX) - 1));
+	}
+	else if (p[2] == AGG_TYPE_SYNC)
+	{
+		need = 5 + 8 + 2 + (size_t)__builtin_popcount(p[4] & ((1U << AGG_CH_MAX) - 1));
+	}
+	else if (p[2] == AGG_TYPE_BURST)
+	{
+		if (len < AGG_BURST_HEAD)
+		{
+			return 0;
+		}
+		need = AGG_BURST_HEAD + (size_t)p[3] * ((size_t)p[4] | ((size_t)p[5] << 8)) + 2;
+		if (need > AGG_BUF_SIZE)
+		{
+			return -1;                   /* larger than a board can send */
+		}
+	}
+	else if (p[2] == AGG_TYPE_LOG)
+	{
+		need = 4 + (size_t)p[3] * 4 + 2;
+	}
+	else if (p[2] == AGG_TYPE_RATE)
+	{
+		need = 5 + 2;
+	}
+	else
+	{
+		return -1;
+	}
+	if (len < need)
+	{
+		return 0;
+	}
+	for (i = 2; i < need - 2; i++)
+	{
+		s0 = (s0 + p[i]) % 255;
+		s1 = (s1 + s0) % 255;
+	}
+	if ((p[need - 2] != s0) || (p[need - 1] != s1))
+	{
+		return -1;
+	}
+
+	memset(rec, 0, sizeof(*rec));
+	rec->type = (p[2] == AGG_TYPE_SYNC) ? AGG_TYPE_SAMPLE : p[2];
+	if (rec->type == AGG_TYPE_SAMPLE)
+	{
+		rec->aux  = p[3];
+		rec->mask = (uint8_t)(p[4] & ((1U << AGG_CH_MAX) - 1));
+		for (ch = 0; ch < AGG_CH_MAX; ch++)
+		{
+			if ((rec->mask >> ch) & 1U)
+			{
+				rec->val[ch] = p[5 + k++];
+			}
+		}
+	}
+	return (long)need;
+}
+
+/**
+ * @fn              static void agg_log(const unsigned char* p, uint16_t board, uint64_t t_ns)
+ * @fid             [FID616]-[agg_log]
+ * @fnbrf           Emit the records of a checked 'L' frame.
+ * @param[in]       p ; const unsigned char* ; sync byte
+ * @param[in]       board ; uint16_t ; endpoint index
+ * @param[in]       t_ns ; uint64_t ; receive time
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          One record per channel sample. A LOG command dump also
+ *                  repeats samples sent live, board, channel and tick match.
+ */
+static void agg_log(const unsigned char* p, uint16_t board, uint64_t t_ns)
+{
+	const unsigned char* q = p + 4;
+	AGG_REC              rec;
+	unsigned             i;
+	int                  ch;
+
+	for (i = 0; i < p[3]; i++, q += 4)
+	{
+		ch = q[2] & AGG_LOG_CH;
+		if (ch >= AGG_CH_MAX)
+		{
+			continue;
+		}
+		memset(&rec, 0, sizeof(rec));
+		rec.t_ns    = t_ns;
+		rec.board   = board;
+		rec.type    = AGG_TYPE_LOG;
+		rec.mask    = (uint8_t)(1U << ch);
+		rec.val[ch] = q[3];
+		rec.aux     = (int32_t)(q[0] | (q[1] << 8));
+		agg_emit(&rec);
+	}
+}
+
+/**
+ * @fn              static void agg_emit(const AGG_REC* rec)
+ * @fid             [FID609]-[agg_emit]
+ * @fnbrf           Append a record to the merged stream.
+ * @param[in]       rec ; const AGG_REC* ; record
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          Records are emitted in the order of the epoll wake-ups,
+ *                  so t_ns never decreases in the stream.
+ */
+static void agg_emit(const AGG_REC* rec)
+{
+	char* q;
+	int   ch;
+
+	rec_cnt++;
+	if ((store_on != 0) && (rec->type != AGG_TYPE_LOG))
+	{
+		agg_store(rec);
+	}
+	if (out_fp == NULL)
+	{
+		return;
+	}
+	if (out_len + 160 > AGG_OUT_SIZE)
+	{
+		agg_flush();
+	}
+	if (out_bin != 0)
+	{
+		memcpy(&out_buf[out_len], rec, sizeof(*rec));
+		out_len += sizeof(*rec);
+		return;
+	}
+	q = &out_buf[out_len];
+	q += sprintf(q, "%llu\t%u\t%c\t%u", (unsigned long long)(rec->t_ns / 1000U),
+	             rec->board, rec->type, rec->mask);
+	for (ch = 0; ch < AGG_CH_MAX; ch++)
+	{
+		if ((rec->mask >> ch) & 1U)
+		{
+			q += sprintf(q, "\t%ld", (long)rec->val[ch]);
+		}
+	}
+	q += sprintf(q, "\t%ld\n", (long)rec->aux);
+	out_len = (size_t)(q - out_buf);
+}
+
+/**
+ * @fn              static void agg_flush(void)
+ * @fid             [FID610]-[agg_flush]
+ * @fnbrf           Write the output buffer.
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void agg_flush(void)
+{
+	if ((out_fp != NULL) && (out_len != 0))
+	{
+		fwrite(out_buf, 1, out_len, out_fp);
+		fflush(out_fp);
+	}
+	out_len = 0;
+}
+
+/**
+ * @fn              static void agg_store(const AGG_REC* rec)
+ * @fid             [FID615]-[agg_store]
+ * @fnbrf           Append the channels of a record to the columnar store.
+ * @param[in]       rec ; const AGG_REC* ; record
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         The store is switched off on a file error.
+ * @remark          -
+ */
+static void agg_store(const AGG_REC* rec)
+{
+	uint8_t code;
+	int32_t val;
+	int     ch;
+
+	for (ch = 0; ch < AGG_CH_MAX; ch++)
+	{
+		if (((rec->mask >> ch) & 1U) == 0)
+		{
+			continue;
+		}
+		if (rec->type == AGG_TYPE_SAMPLE)
+		{
+			code = (uint8_t)rec->val[ch];
+			val  = (int32_t)adc_table[code];
+		}
+		else
+		{
+			val  = rec->val[ch];
+			code = cs_code_near(adc_table, val);
+		}
+		if (cs_append(&st_store, rec->board, (unsigned)ch, rec->t_ns, code, val) != 0)
+		{
+			fprintf(stderr, "aggd: store off\n");
+			store_on = 0;
+			return;
+		}
+	}
+}
+
+/**
+ * @fn              static void agg_loop(int efd, unsigned long long stop_after)
+ * @fid             [FID611]-[agg_loop]
+ * @fnbrf           Event loop until every endpoint is closed.
+ * @param[in]       efd ; int ; epoll instance with all endpoints
+ * @param[in]       stop_after ; unsigned long long ; records, 0 : no limit
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          Edge triggered, each ready endpoint is drained completely.
+ */
+static void agg_loop(int efd, unsigned long long stop_after)
+{
+	struct epoll_event ev[AGG_EVENT_MAX];
+	unsigned           open_cnt = ep_num;
+	int                n;
+	int                i;
+
+	while (open_cnt != 0)
+	{
+		n = epoll_wait(efd, ev, AGG_EVENT_MAX, (out_len != 0) ? 10 : -1);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			perror("epoll_wait");
+			break;
+		}
+		if (n == 0)
+		{
+			agg_flush();                 /* idle, do not hold records back */
+			continue;
+		}
+		{
+			uint64_t t_ns = agg_now();
+
+			for (i = 0; i < n; i++)
+			{
+				AGG_EP* ep = &ep_tbl[ev[i].data.u32];
+
+				agg_read(ep, (uint16_t)ev[i].data.u32, t_ns);
+				if (ep->open == 0)
+				{
+					epoll_ctl(efd, EPOLL_CTL_DEL, ep->fd, NULL);
+					close(ep->fd);
+					open_cnt--;
+				}
+			}
+		}
+		if ((stop_after != 0) && (rec_cnt >= stop_after))
+		{
+			break;
+		}
+	}
+	agg_flush();
+}
+
+/**
+ * @fn              static void agg_board(int* master, unsigned boards, unsigned long lines, unsigned chunk, int ready_fd, int done_fd)
+ * @fid             [FID612]-[agg_board]
+ * @fnbrf           Board emulator of the benchmark (child process).
+ * @param[in]       master ; int* ; pty master of each board
+ * @param[in]       boards ; unsigned ; number of boards
+ * @param[in]       lines ; unsigned long ; records per board
+ * @param[in]       chunk ; unsigned ; records per write
+ * @param[in]       ready_fd ; int ; readable when the aggregator is ready
+ * @param[in]       done_fd ; int ; readable when the aggregator is done
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         Blocking writes, a board blocks when its pty is full.
+ * @remark          Text in the firmware template layout with adc_table values,
+ *                  binary 'S' frames with two channels on every 4th board.
+ */
+static void agg_board(int* master, unsigned boards, unsigned long lines,
+                      unsigned chunk, int ready_fd, int done_fd)
+{
+	char          buf[AGG_BENCH_CHUNK * 64 * 8];
+	unsigned long sent;
+	unsigned      b;
+	unsigned      k;
+	char          c;
+
+	(void)read(ready_fd, &c, 1);
+	for (sent = 0; sent < lines; sent += chunk)
+	{
+		for (b = 0; b < boards; b++)
+		{
+			size_t len = 0;
+
+			for (k = 0; (k < chunk) && (sent + k < lines); k++)
+			{
+				unsigned v = (unsigned)((sent + k + b) & 0xFF);
+
+				if ((b & 3) == 3)
+				{
+					unsigned char* f  = (unsigned char*)&buf[len];
+					unsigned       s0 = 0;
+					unsigned       s1 = 0;
+					int            i;
+
+					f[0] = AGG_SYNC0;
+					f[1] = AGG_SYNC1;
+					f[2] = AGG_TYPE_SAMPLE;
+					f[3] = (unsigned char)(sent + k);
+					f[4] = 0x03;
+					f[5] = (unsigned char)v;
+					f[6] = (unsigned char)(255 - v);
+					for (i = 2; i < 7; i++)
+					{
+						s0 = (s0 + f[i]) % 255;
+						s1 = (s1 + s0) % 255;
+					}
+					f[7] = (unsigned char)s0;
+					f[8] = (unsigned char)s1;
+					len += 9;
+				}
+				else
+				{
+					long t = adc_table[v];
+
+					len += (size_t)sprintf(&buf[len], "Teperature : %3s%ld.%02ld\tTime stamp : %4d.%02dms\n",
+					                       (t < 0) ? "-" : "", labs(t) / 100, labs(t) % 100, 0, (int)(b % 100));
+				}
+			}
+			if (write(master[b], buf, len) != (ssize_t)len)
+			{
+				_exit(1);
+			}
+		}
+	}
+	(void)read(done_fd, &c, 1);
+	_exit(0);
+}
+
+/**
+ * @fn              static int agg_bench(unsigned boards, unsigned long lines, unsigned chunk)
+ * @fid             [FID613]-[agg_bench]
+ * @fnbrf           Aggregate emulated boards on local ptys and report throughput.
+ * @param[in]       boards ; unsigned ; number of ptys
+ * @param[in]       lines ; unsigned long ; records per board
+ * @param[in]       chunk ; unsigned ; records per write
+ * @param[in,out]   -
+ * @retval          0 : every record received and parsed, 1 : otherwise
+ * @warning         Needs 2 descriptors per board.
+ * @remark          The slave side is put in raw mode before the writer starts.
+ *                  CPU time is the aggregator process only.
+ */
+static int agg_bench(unsigned boards, unsigned long lines, unsigned chunk)
+{
+	int*            master;
+	int             ready[2];
+	int             done[2];
+	int             efd;
+	unsigned        b;
+	pid_t           pid;
+	uint64_t        t0;
+	double          wall;
+	double          cpu;
+	struct rusage   ru0;
+	struct rusage   ru1;
+	struct rlimit   rl;
+	unsigned long   bytes  = 0;
+	unsigned long   errors = 0;
+	unsigned long long expect = (unsigned long long)boards * lines;
+
+	if ((getrlimit(RLIMIT_NOFILE, &rl) == 0) && (rl.rlim_cur < rl.rlim_max))
+	{
+		rl.rlim_cur = rl.rlim_max;
+		(void)setrlimit(RLIMIT_NOFILE, &rl);
+	}
+	master = (int*)calloc(boards, sizeof(int));
+	ep_tbl = (AGG_EP*)calloc(boards, sizeof(AGG_EP));
+	efd    = epoll_create1(0);
+	if ((master == NULL) || (ep_tbl == NULL) || (efd < 0) || (pipe(ready) != 0) || (pipe(done) != 0))
+	{
+		perror("aggd");
+		return 1;
+	}
+	for (b = 0; b < boards; b++)
+	{
+		struct epoll_event ev;
+		int                s;
+
+		master[b] = posix_openpt(O_RDWR | O_NOCTTY);
+		if ((master[b] < 0) || (grantpt(master[b]) != 0) || (unlockpt(master[b]) != 0))
+		{
+			perror("posix_openpt");
+			return 1;
+		}
+		s = agg_open(ptsname(master[b]), 0);
+		if (s < 0)
+		{
+			return 1;
+		}
+		ep_tbl[b].fd   = s;
+		ep_tbl[b].name = "pty";
+		ep_tbl[b].open = 1;
+		ev.events   = EPOLLIN | EPOLLET;
+		ev.data.u32 = b;
+		epoll_ctl(efd, EPOLL_CTL_ADD, s, &ev);
+	}
+	ep_num = boards;
+
+	pid = fork();
+	if (pid == 0)
+	{
+		close(ready[1]);
+		close(done[1]);
+		agg_board(master, boards, lines, chunk, ready[0], done[0]);
+	}
+	close(ready[0]);
+	close(done[0]);
+
+	getrusage(RUSAGE_SELF, &ru0);
+	t0 = agg_now();
+	close(ready[1]);                     /* start the boards */
+	agg_loop(efd, expect);
+	wall = (double)(agg_now() - t0) * 1e-9;
+	getrusage(RUSAGE_SELF, &ru1);
+	close(done[1]);
+	waitpid(pid, NULL, 0);
+
+	cpu = (double)(ru1.ru_utime.tv_sec - ru0.ru_utime.tv_sec + ru1.ru_stime.tv_sec - ru0.ru_stime.tv_sec)
+	    + (double)(ru1.ru_utime.tv_usec - ru0.ru_utime.tv_usec + ru1.ru_stime.tv_usec - ru0.ru_stime.tv_usec) * 1e-6;
+	for (b = 0; b < boards; b++)
+	{
+		bytes  += ep_tbl[b].bytes;
+		errors += ep_tbl[b].errors;
+	}
+	fprintf(stderr, "aggd: %u boards, %llu of %llu records, %lu bytes, %lu errors\n",
+	        boards, rec_cnt, expect, bytes, errors);
+	fprintf(stderr, "aggd: %.3f s wall, %.3f s cpu, %.0f records/s, %.0f records/cpu-s, %.1f MB/cpu-s\n",
+	        wall, cpu, (double)rec_cnt / wall, (cpu > 0.0) ? (double)rec_cnt / cpu : 0.0,
+	        (cpu > 0.0) ? (double)bytes / cpu / 1e6 : 0.0);
+	return ((rec_cnt == expect) && (errors == 0)) ? 0 : 1;
+}
+
+/**
+ * @fn              int main(int argc, char** argv)
+ * @fid             [FID614]-[main]
+ * @fnbrf           Parse options, aggregate devices or run the benchmark.
+ * @param[in]       argc ; int ; argument count
+ * @param[in]       argv ; char** ; arguments
+ * @param[in,out]   -
+ * @retval          0 : done, 1 : usage or error
+ * @warning         -
+ * @remark          -
+ */
+int main(int argc, char** argv)
+{
+	const char*   out_path = NULL;
+	const char*   dir      = NULL;
+	unsigned      boards   = 0;
+	unsigned long lines    = AGG_BENCH_LINES;
+	unsigned      chunk    = AGG_BENCH_CHUNK;
+	speed_t       speed    = B9600;
+	int           efd;
+	int           rc;
+	int           i;
+
+	for (i = 1; i < argc; i++)
+	{
+		const char* arg = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+		if (strcmp(argv[i], "-b") == 0)
+		{
+			out_bin = 1;
+			continue;
+		}
+		if ((argv[i][0] != '-') || (arg == NULL))
+		{
+			break;
+		}
+		if (strcmp(argv[i], "-s") == 0)
+		{
+			switch (atol(arg))
+			{
+				case 2400:   speed = B2400;   break;
+				case 4800:   speed = B4800;   break;
+				case 19200:  speed = B19200;  break;
+				case 38400:  speed = B38400;  break;
+				case 57600:  speed = B57600;  break;
+				case 115200: speed = B115200; break;
+				default:     speed = B9600;   break;
+			}
+		}
+		else if (strcmp(argv[i], "-o") == 0)
+		{
+			out_path = arg;
+		}
+		else if (strcmp(argv[i], "-D") == 0)
+		{
+			dir = arg;
+		}
+		else if (strcmp(argv[i], "-P") == 0)
+		{
+			boards = (unsigned)atoi(arg);
+		}
+		else if (strcmp(argv[i], "-L") == 0)
+		{
+			lines = strtoul(arg, NULL, 0);
+		}
+		else if (strcmp(argv[i], "-k") == 0)
+		{
+			chunk = (unsigned)atoi(arg);
+		}
+		else
+		{
+			i = argc + 1;
+			break;
+		}
+		i++;
+	}
+	if ((i > argc) || ((boards == 0) && (i == argc)) || (chunk == 0) || (chunk > AGG_BENCH_CHUNK * 8) ||
+	    ((boards != 0) && (i != argc)) || (boards > 0xFFFF) || ((unsigned)(argc - i) > 0xFFFF))
+	{
+		fprintf(stderr, "usage: %s [-s baud] [-b] [-o out] [-D dir] device...\n"
+		                "       %s -P boards [-L lines] [-k lines_per_write] [-b] [-o out] [-D dir]\n", argv[0], argv[0]);
+		return 1;
+	}
+	signal(SIGPIPE, SIG_IGN);
+
+	if (out_path != NULL)
+	{
+		out_fp = (strcmp(out_path, "-") == 0) ? stdout : fopen(out_path, "wb");
+		if (out_fp == NULL)
+		{
+			perror(out_path);
+			return 1;
+		}
+	}
+	else if (boards == 0)
+	{
+		out_fp = stdout;
+	}
+
+	if (dir != NULL)
+	{
+		if (cs_open(&st_store, dir, CS_SEG_ROWS_DEFAULT) != 0)
+		{
+			return 1;
+		}
+		store_on = 1;
+	}
+
+	if (boards != 0)
+	{
+		rc = agg_bench(boards, lines, chunk);
+	}
+	else
+	{
+		ep_num = (unsigned)(argc - i);
+		ep_tbl = (AGG_EP*)calloc(ep_num, sizeof(AGG_EP));
+		efd    = epoll_create1(0);
+		if ((ep_tbl == NULL) || (efd < 0))
+		{
+			perror("aggd");
+			return 1;
+		}
+		for (rc = 0; rc < (int)ep_num; rc++)
+		{
+			struct epoll_event ev;
+
+			ep_tbl[rc].name = argv[i + rc];
+			ep_tbl[rc].fd   = agg_open(ep_tbl[rc].name, speed);
+			if (ep_tbl[rc].fd < 0)
+			{
+				return 1;
+			}
+			ep_tbl[rc].open = 1;
+			ev.events   = EPOLLIN | EPOLLET;
+			ev.data.u32 = (uint32_t)rc;
+			epoll_ctl(efd, EPOLL_CTL_ADD, ep_tbl[rc].fd, &ev);
+		}
+		agg_loop(efd, 0);
+		for (rc = 0; rc < (int)ep_num; rc++)
+		{
+			fprintf(stderr, "aggd: %s %lu bytes %lu lines %lu frames %lu other %lu errors\n", ep_tbl[rc].name,
+			        ep_tbl[rc].bytes, ep_tbl[rc].lines, ep_tbl[rc].frames, ep_tbl[rc].other, ep_tbl[rc].errors);
+		}
+		rc = 0;
+	}
+	if ((out_fp != NULL) && (out_fp != stdout))
+	{
+		fclose(out_fp);
+	}
+	cs_close(&st_store);
+	return rc;
+}
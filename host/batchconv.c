@@ -0,0 +1,406 @@
+/**
+ * @file       batchconv.c
+ * @brief      [MID107]-[batchconv]
+ * @details    Converts archived A/D code files to temperature with adcbatch, or
+ * @details    benchmarks the kernels against the firmware s2g_glmap1b_s2pt.
+ * @details    Build : make batchconv, or gcc -O2 -pthread -Ihost -o batchconv host/batchconv.c
+ * @details                host/adcbatch.c host/sim_stub.c com62p.c hal62p.c
+ * @details    Usage : batchconv [-k map|lin] [-f fix|flt] [-B bits] [-j threads]
+ * @details                      [-i scalar|avx2|avx512] [-o out] code_file
+ * @details            batchconv -b [-n MiB] [-r reps] [-j threads] [code_file]
+ * @details    code_file : u8 codes (map) or little endian u16 codes (lin).
+ * @details    out       : int32 0.01 degC (fix) or float degC (flt), host order.
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+
+/**
+ * Include file
+ */
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "adcbatch.h"
+
+/*
+ * adc_table and s2g_glmap1b_s2pt come from the firmware itself,
+ * register access goes to sim_stub.c.
+ */
+#include "../02_mapping_calculation.c"
+#undef main
+
+/**
+ * Data definition
+ */
+#define BC_BENCH_MIB        (64)
+#define BC_BENCH_REPS       (5)
+#define BC_MIB              (1024UL * 1024UL)
+
+/**
+ * fucntion prototype declaration
+ */
+static double bc_now(void);
+static void   bc_reference(int op, unsigned bits, const void* in, void* out, size_t n);
+static int    bc_bench(const void* in, size_t bytes, unsigned reps, unsigned threads);
+static const void* bc_map_file(const char* path, size_t* psize);
+
+/**
+ * Global Variable Definition
+ */
+static ADCB_MAP st_map;
+static const char* const op_name[ADCB_OP_MAX] = { "map fix", "map flt", "lin fix", "lin flt" };
+
+/**
+ * @fn              static double bc_now(void)
+ * @fid             [FID501]-[bc_now]
+ * @fnbrf           Monotonic time in seconds.
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          t ; double ; seconds
+ * @warning         -
+ * @remark          -
+ */
+static double bc_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @fn              static void bc_reference(int op, unsigned bits, const void* in, void* out, size_t n)
+ * @fid             [FID502]-[bc_reference]
+ * @fnbrf           Scalar reference the kernels are checked and timed against.
+ * @param[in]       op ; int ; ADCB_OP_xxx
+ * @param[in]       bits ; unsigned ; code width of ADCB_OP_LIN_xxx
+ * @param[in]       in ; const void* ; codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   out ; void* ; temperatures
+ * @retval          -
+ * @warning         -
+ * @remark          map : firmware s2g_glmap1b_s2pt on adc_table.
+ *                  lin : read_temp arithmetic (integer mV, then / 10).
+ */
+static void bc_reference(int op, unsigned bits, const void* in, void* out, size_t n)
+{
+	const u1* pu1_code = (const u1*)in;
+	const u2* pu2_code = (const u2*)in;
+	u4        u4_fs    = (1UL << bits) - 1;
+	u4        u4_mv    = 0;
+	size_t    i;
+
+	for (i = 0; i < n; i++)
+	{
+		switch (op)
+		{
+			case ADCB_OP_MAP_FIX:
+				((int32_t*)out)[i] = (int32_t)s2g_glmap1b_s2pt(pu1_code[i], &adc_table[0]);
+				break;
+			case ADCB_OP_MAP_FLT:
+				((float*)out)[i] = (float)((f8)s2g_glmap1b_s2pt(pu1_code[i], &adc_table[0]) / 100);
+				break;
+			case ADCB_OP_LIN_FIX:
+				u4_mv = ((u4)pu2_code[i] * 5000) / u4_fs;
+				((int32_t*)out)[i] = ((int32_t)u4_mv - 500) * 10;
+				break;
+			default:
+				u4_mv = ((u4)pu2_code[i] * 5000) / u4_fs;
+				((float*)out)[i] = (float)(((f8)u4_mv - 500) / 10);
+				break;
+		}
+	}
+}
+
+/**
+ * @fn              static int bc_bench(const void* in, size_t bytes, unsigned reps, unsigned threads)
+ * @fid             [FID503]-[bc_bench]
+ * @fnbrf           Time every conversion and kernel set, check the results.
+ * @param[in]       in ; const void* ; codes, read as u8 and as u16
+ * @param[in]       bytes ; size_t ; size of in
+ * @param[in]       reps ; unsigned ; best of reps is reported
+ * @param[in]       threads ; unsigned ; thread count of the multi-thread row
+ * @param[in,out]   -
+ * @retval          0 : all results equal to the reference, 1 : mismatch
+ * @warning         -
+ * @remark          GB/s counts input code bytes.
+ */
+static int bc_bench(const void* in, size_t bytes, unsigned reps, unsigned threads)
+{
+	void*    ref;
+	void*    out;
+	int      best = adcb_isa_best();
+	int      fail = 0;
+	int      op;
+	int      isa;
+	unsigned r;
+	unsigned t;
+
+	ref = malloc(bytes * 4);
+	out = malloc(bytes * 4);
+	if ((ref == NULL) || (out == NULL))
+	{
+		perror("malloc");
+		return 1;
+	}
+	printf("%-8s %-7s %7s %10s %10s %8s  %s\n", "op", "isa", "threads", "GB/s", "Msample/s", "speedup", "check");
+
+	for (op = 0; op < ADCB_OP_MAX; op++)
+	{
+		size_t n        = bytes / adcb_in_size(op);
+		double ref_time = 0.0;
+		double dt;
+
+		for (r = 0; r < reps; r++)
+		{
+			double t0 = bc_now();
+			bc_reference(op, 10, in, ref, n);
+			dt = bc_now() - t0;
+			ref_time = ((r == 0) || (dt < ref_time)) ? dt : ref_time;
+		}
+		printf("%-8s %-7s %7u %10.2f %10.1f %8.2f  %s\n", op_name[op], "ref", 1U,
+		       (double)bytes / ref_time / 1e9, (double)n / ref_time / 1e6, 1.0, "-");
+
+		for (isa = ADCB_ISA_SCALAR; isa <= best; isa++)
+		{
+			(void)adcb_isa_set(isa);
+			for (t = 1; t <= threads; t = (t == threads) ? threads + 1 : threads)
+			{
+				double best_time = 0.0;
+				int    same;
+
+				for (r = 0; r < reps; r++)
+				{
+					double t0 = bc_now();
+					adcb_convert_mt(op, &st_map, 10, in, out, n, t);
+					dt = bc_now() - t0;
+					best_time = ((r == 0) || (dt < best_time)) ? dt : best_time;
+				}
+				same = (memcmp(ref, out, n * adcb_out_size(op)) == 0);
+				fail |= (same == 0);
+				printf("%-8s %-7s %7u %10.2f %10.1f %8.2f  %s\n", op_name[op], adcb_isa_name(isa), t,
+				       (double)bytes / best_time / 1e9, (double)n / best_time / 1e6,
+				       ref_time / best_time, same ? "ok" : "MISMATCH");
+			}
+		}
+	}
+	(void)adcb_isa_set(-1);
+	free(ref);
+	free(out);
+	return fail;
+}
+
+/**
+ * @fn              static const void* bc_map_file(const char* path, size_t* psize)
+ * @fid             [FID504]-[bc_map_file]
+ * @fnbrf           Map a file read only.
+ * @param[in]       path ; const char* ; file
+ * @param[in,out]   psize ; size_t* ; file size
+ * @retval          data ; const void* ; NULL on error
+ * @warning         -
+ * @remark          -
+ */
+static const void* bc_map_file(const char* path, size_t* psize)
+{
+	struct stat st;
+	void*       p;
+	int         fd = open(path, O_RDONLY);
+
+	if ((fd < 0) || (fstat(fd, &st) != 0) || (st.st_size == 0))
+	{
+		perror(path);
+		return NULL;
+	}
+	p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+	{
+		perror(path);
+		return NULL;
+	}
+	(void)posix_madvise(p, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+	*psize = (size_t)st.st_size;
+	return p;
+}
+
+/**
+ * @fn              int main(int argc, char** argv)
+ * @fid             [FID505]-[main]
+ * @fnbrf           Parse options, convert a file or run the benchmark.
+ * @param[in]       argc ; int ; argument count
+ * @param[in]       argv ; char** ; arguments
+ * @param[in,out]   -
+ * @retval          0 : done, 1 : usage, file error or benchmark mismatch
+ * @warning         -
+ * @remark          The output file is written through a shared mapping, each
+ *                  thread stores its own slice.
+ */
+int main(int argc, char** argv)
+{
+	const char*  path     = NULL;
+	const char*  out_path = NULL;
+	const void*  in       = NULL;
+	size_t       bytes    = 0;
+	size_t       n;
+	size_t       out_bytes;
+	void*        out;
+	int          bench    = 0;
+	int          lin      = 0;
+	int          flt      = 0;
+	int          isa      = -1;
+	int          op;
+	unsigned     bits     = 8;
+	unsigned     threads  = 0;
+	unsigned     reps     = BC_BENCH_REPS;
+	unsigned long mib     = BC_BENCH_MIB;
+	double       t0;
+	double       dt;
+	int          fd;
+	int          i;
+
+	for (i = 1; i < argc; i++)
+	{
+		const char* arg = (i + 1 < argc) ? argv[i + 1] : "";
+
+		if (strcmp(argv[i], "-b") == 0)
+		{
+			bench = 1;
+			continue;
+		}
+		if (argv[i][0] != '-')
+		{
+			break;
+		}
+		if (strcmp(argv[i], "-k") == 0)
+		{
+			lin = (strcmp(arg, "lin") == 0);
+		}
+		else if (strcmp(argv[i], "-f") == 0)
+		{
+			flt = (strcmp(arg, "flt") == 0);
+		}
+		else if (strcmp(argv[i], "-B") == 0)
+		{
+			bits = (unsigned)atoi(arg);
+		}
+		else if (strcmp(argv[i], "-j") == 0)
+		{
+			threads = (unsigned)atoi(arg);
+		}
+		else if (strcmp(argv[i], "-i") == 0)
+		{
+			for (isa = 0; (isa < ADCB_ISA_MAX) && (strcmp(arg, adcb_isa_name(isa)) != 0); isa++)
+			{
+			}
+		}
+		else if (strcmp(argv[i], "-o") == 0)
+		{
+			out_path = arg;
+		}
+		else if (strcmp(argv[i], "-n") == 0)
+		{
+			mib = strtoul(arg, NULL, 0);
+		}
+		else if (strcmp(argv[i], "-r") == 0)
+		{
+			reps = (unsigned)atoi(arg);
+		}
+		else
+		{
+			i = argc;
+			break;
+		}
+		i++;
+	}
+	path = (i == argc - 1) ? argv[i] : NULL;
+	if ((i > argc) || ((path == NULL) && ((bench == 0) || (i != argc))) ||
+	    (bits < ADCB_BITS_MIN) || (bits > ADCB_BITS_MAX) || (reps == 0) || (mib == 0))
+	{
+		fprintf(stderr, "usage: %s [-k map|lin] [-f fix|flt] [-B bits] [-j threads] [-i scalar|avx2|avx512] [-o out] code_file\n"
+		                "       %s -b [-n MiB] [-r reps] [-j threads] [code_file]\n", argv[0], argv[0]);
+		return 1;
+	}
+
+	adcb_map_init(&st_map, &adc_table[0]);
+	isa = adcb_isa_set((isa < ADCB_ISA_MAX) ? isa : -1);
+
+	if (path != NULL)
+	{
+		in = bc_map_file(path, &bytes);
+		if (in == NULL)
+		{
+			return 1;
+		}
+	}
+
+	if (bench != 0)
+	{
+		if (in == NULL)
+		{
+			unsigned char* p = (unsigned char*)malloc(mib * BC_MIB);
+			size_t         k;
+
+			if (p == NULL)
+			{
+				perror("malloc");
+				return 1;
+			}
+			srand(1);
+			for (k = 0; k < mib * BC_MIB; k++)
+			{
+				p[k] = (unsigned char)rand();
+			}
+			in    = p;
+			bytes = mib * BC_MIB;
+		}
+		if (threads == 0)
+		{
+			long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+			threads = (cpus > 0) ? (unsigned)cpus : 1;
+		}
+		printf("batchconv: %zu bytes, best isa %s, lin at 10 bits\n", bytes, adcb_isa_name(adcb_isa_best()));
+		return bc_bench(in, bytes & ~(size_t)1, reps, threads);
+	}
+
+	op        = (lin ? ADCB_OP_LIN_FIX : ADCB_OP_MAP_FIX) + flt;
+	n         = bytes / adcb_in_size(op);
+	out_bytes = n * adcb_out_size(op);
+	if (out_path != NULL)
+	{
+		fd = open(out_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if ((fd < 0) || (ftruncate(fd, (off_t)out_bytes) != 0))
+		{
+			perror(out_path);
+			return 1;
+		}
+		out = mmap(NULL, out_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+	}
+	else
+	{
+		out = mmap(NULL, out_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	}
+	if (out == MAP_FAILED)
+	{
+		perror("mmap");
+		return 1;
+	}
+
+	t0 = bc_now();
+	adcb_convert_mt(op, &st_map, bits, in, out, n, threads);
+	dt = bc_now() - t0;
+	munmap(out, out_bytes);
+
+	fprintf(stderr, "batchconv: %s %zu codes, %s, %.3f s, %.2f GB/s in, %.1f Msample/s\n",
+	        op_name[op], n, adcb_isa_name(isa), dt,
+	        (dt > 0.0) ? (double)bytes / dt / 1e9 : 0.0, (dt > 0.0) ? (double)n / dt / 1e6 : 0.0);
+	return 0;
+}
@@ -0,0 +1,612 @@
+/**
+ * @file       bench.c
+ * @brief      [MID111]-[bench]
+ * @details    Conversion benchmark of the three firmware variants (bench.h).
+ * @details    Build : make bench, or gcc -O2 -Wno-unknown-pragmas -Ihost -o bench host/bench.c
+ * @details            host/bench_v01b.c host/bench_v01g.c host/bench_v02.c host/sim_stub.c
+ * @details            com62p.c hal62p.c
+ * @details    Usage : bench [-n reps] [-r runs] [-t ms] [-S variant=sim_binary]..
+ * @details                  [-f variant=object].. [-o result] [-b baseline [-T pct]]
+ * @details    host : every variant over all 256 codes, reps times, best of runs.
+ * @details      conv_ns    : conversion only, ns per sample
+ * @details      path_ns    : A/D result to UART bytes, ns per sample
+ * @details      path_bytes : output bytes per sample
+ * @details      filt_xxx_ns : filter stage only, ns per sample (02_map)
+ * @details    -DCFG_PRESET=n builds 02 in that configuration (cfg62p.h), its variant
+ * @details    name is CFG_NAME and path_xx is not measured for binary frames.
+ * @details    -S   : runs a simulator build of the variant for -t ms
+ * @details           (make sim01b, or gcc -O2 -Ihost -o sim01b 01_temp_calculation_bad_code.c
+ * @details            com62p.c hal62p.c host/sim62p.c)
+ * @details      sim_lines_s, sim_bytes_line, sim_wait_pct
+ * @details    -f   : ROM/RAM of a compiled variant, ELF32 or ELF64 object
+ * @details           (make 01b.o : the program linked -r with com62p.c and hal62p.c,
+ * @details            or a target object)
+ * @details      rom_bytes : .text .rodata .data, ram_bytes : .data .bss
+ * @details    Result : "variant\tmetric\tvalue\tunit\tlower|higher" lines, the last
+ * @details    field tells which direction is better. -b compares with a previous
+ * @details    result and exits with 2 when a metric got worse by more than -T
+ * @details    percent (default 20).
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+
+/**
+ * Include file
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <elf.h>
+#include "bench.h"
+
+/**
+ * Data definition
+ */
+#define BENCH_CODES         (256)
+#define BENCH_REPS          (1024)
+#define BENCH_RUNS          (5)
+#define BENCH_SIM_MS        (2000UL)
+#define BENCH_TOL_PCT       (20.0)
+#define BENCH_NS_MIN        (1.0)     /* smaller time changes are noise     */
+#define BENCH_RES_MAX       (64)
+#define BENCH_ARG_MAX       (8)
+#define BENCH_BANNER_MAX    (256)     /* 01 program text before the loop    */
+
+/**
+ * One result line
+ */
+typedef struct
+{
+	char        var[16];
+	char        metric[24];
+	double      val;
+	char        unit[16];
+	int         higher;               /* 1 : higher is better               */
+} BENCH_RES;
+
+/**
+ * Global Variable Definition
+ * Hooks of bench.h
+ */
+jmp_buf bench_jmp;
+char*   bench_tx;
+size_t  bench_tx_len;
+
+static const unsigned char* bench_code;
+static size_t               bench_code_n;
+static size_t               bench_code_i;
+static size_t               bench_tx_start;
+
+/**
+ * Global Variable Definition
+ * Results
+ */
+static const BENCH_VAR* const var_tbl[] = { &bench_v01b, &bench_v01g, &bench_v02 };
+static BENCH_RES res_tbl[BENCH_RES_MAX];
+static unsigned  res_num;
+
+/**
+ * fucntion prototype declaration
+ */
+static double bench_now(void);
+static void   bench_put(const char* var, const char* metric, double val, const char* unit, int higher);
+static void   bench_host(const BENCH_VAR* var, unsigned long reps, unsigned runs);
+static int    bench_sim(const char* var, const char* bin, unsigned long ms);
+static int    bench_elf(const char* var, const char* path);
+static int    bench_base(const char* path, double tol);
+
+/**
+ * @fn              void bench_feed(const unsigned char* code, size_t n, char* out)
+ * @fid             [FID901]-[bench_feed]
+ * @fnbrf           Set the codes and output buffer of the next main loop run.
+ * @param[in]       code ; const unsigned char* ; A/D codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   out ; char* ; UART bytes
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+void bench_feed(const unsigned char* code, size_t n, char* out)
+{
+	bench_code     = code;
+	bench_code_n   = n;
+	bench_code_i   = 0;
+	bench_tx       = out;
+	bench_tx_len   = 0;
+	bench_tx_start = 0;
+}
+
+/**
+ * @fn              unsigned char bench_ad0(void)
+ * @fid             [FID902]-[bench_ad0]
+ * @fnbrf           AN0 result register of the 01 variants.
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          code ; unsigned char ; next A/D code
+ * @warning         Does not return after the last code (longjmp to bench_jmp).
+ * @remark          Output before the first read is the program text.
+ */
+unsigned char bench_ad0(void)
+{
+	if (bench_code_i == bench_code_n)
+	{
+		longjmp(bench_jmp, 1);
+	}
+	if (bench_code_i == 0)
+	{
+		bench_tx_start = bench_tx_len;
+	}
+	return bench_code[bench_code_i++];
+}
+
+/**
+ * @fn              size_t bench_tx_sample(void)
+ * @fid             [FID903]-[bench_tx_sample]
+ * @fnbrf           UART bytes sent after the first A/D read.
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          bytes ; size_t ; bytes of the sample lines
+ * @warning         -
+ * @remark          -
+ */
+size_t bench_tx_sample(void)
+{
+	return bench_tx_len - bench_tx_start;
+}
+
+/**
+ * @fn              static double bench_now(void)
+ * @fid             [FID904]-[bench_now]
+ * @fnbrf           Monotonic time in seconds.
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          t ; double ; seconds
+ * @warning         -
+ * @remark          -
+ */
+static double bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @fn              static void bench_put(const char* var, const char* metric, double val, const char* unit, int higher)
+ * @fid             [FID905]-[bench_put]
+ * @fnbrf           Add a result.
+ * @param[in]       var ; const char* ; variant
+ * @param[in]       metric ; const char* ; metric
+ * @param[in]       val ; double ; value
+ * @param[in]       unit ; const char* ; unit
+ * @param[in]       higher ; int ; 1 : higher is better
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         Results beyond BENCH_RES_MAX are dropped.
+ * @remark          -
+ */
+static void bench_put(const char* var, const char* metric, double val, const char* unit, int higher)
+{
+	BENCH_RES* r;
+
+	if (res_num == BENCH_RES_MAX)
+	{
+		return;
+	}
+	r = &res_tbl[res_num++];
+	snprintf(r->var, sizeof(r->var), "%s", var);
+	snprintf(r->metric, sizeof(r->metric), "%s", metric);
+	snprintf(r->unit, sizeof(r->unit), "%s", unit);
+	r->val    = val;
+	r->higher = higher;
+}
+
+/**
+ * @fn              static void bench_host(const BENCH_VAR* var, unsigned long reps, unsigned runs)
+ * @fid             [FID906]-[bench_host]
+ * @fnbrf           Host timing of one variant.
+ * @param[in]       var ; const BENCH_VAR* ; variant
+ * @param[in]       reps ; unsigned long ; passes over the 256 codes
+ * @param[in]       runs ; unsigned ; best of
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          Codes run 0..255 in every pass. The 01 register accesses
+ *                  that are not redirected cost a sim_stub.c call each.
+ */
+static void bench_host(const BENCH_VAR* var, unsigned long reps, unsigned runs)
+{
+	size_t         n    = (size_t)BENCH_CODES * reps;
+	unsigned char* code = (unsigned char*)malloc(n);
+	char*          out  = (char*)malloc(n * BENCH_LINE_MAX + BENCH_BANNER_MAX);
+	volatile long  sink = 0;
+	double         best_conv = 1e30;
+	double         best_path = 1e30;
+	double         t;
+	size_t         bytes = 0;
+	size_t         i;
+	unsigned       r;
+	unsigned       f;
+
+	if ((code == NULL) || (out == NULL))
+	{
+		perror("malloc");
+		exit(1);
+	}
+	for (i = 0; i < n; i++)
+	{
+		code[i] = (unsigned char)i;
+	}
+	for (r = 0; r < runs; r++)
+	{
+		t    = bench_now();
+		sink += var->conv(code, n);
+		t    = bench_now() - t;
+		best_conv = (t < best_conv) ? t : best_conv;
+
+		if (var->path != NULL)
+		{
+			t     = bench_now();
+			bytes = var->path(code, n, out);
+			t     = bench_now() - t;
+			best_path = (t < best_path) ? t : best_path;
+		}
+	}
+	(void)sink;
+	bench_put(var->name, "conv_ns", best_conv * 1e9 / (double)n, "ns", 0);
+	if (var->path != NULL)
+	{
+		bench_put(var->name, "path_ns", best_path * 1e9 / (double)n, "ns", 0);
+		bench_put(var->name, "path_bytes", (double)bytes / (double)n, "byte", 0);
+	}
+	for (f = 0; (var->filt_name != NULL) && (var->filt_name[f] != NULL); f++)
+	{
+		best_conv = 1e30;
+		for (r = 0; r < runs; r++)
+		{
+			t    = bench_now();
+			sink += var->filt(f, code, n);
+			t    = bench_now() - t;
+			best_conv = (t < best_conv) ? t : best_conv;
+		}
+		bench_put(var->name, var->filt_name[f], best_conv * 1e9 / (double)n, "ns", 0);
+	}
+	free(code);
+	free(out);
+}
+
+/**
+ * @fn              static int bench_sim(const char* var, const char* bin, unsigned long ms)
+ * @fid             [FID907]-[bench_sim]
+ * @fnbrf           Run a simulator build and take its UART and wait figures.
+ * @param[in]       var ; const char* ; variant
+ * @param[in]       bin ; const char* ; simulator executable
+ * @param[in]       ms ; unsigned long ; simulated time
+ * @param[in,out]   -
+ * @retval          0 : done, -1 : not run or no statistics
+ * @warning         -
+ * @remark          Reads the sim62p statistics lines on stderr; the UART
+ *                  output goes to a temporary file.
+ */
+static int bench_sim(const char* var, const char* bin, unsigned long ms)
+{
+	char          tmp[] = "/tmp/benchXXXXXX";
+	char          cmd[512];
+	char          line[256];
+	unsigned long bytes = 0;
+	unsigned long lines = 0;
+	double        bps   = 0.0;
+	double        lps   = 0.0;
+	double        wait  = -1.0;
+	FILE*         fp;
+	int           fd    = mkstemp(tmp);
+
+	if (fd < 0)
+	{
+		perror(tmp);
+		return -1;
+	}
+	close(fd);
+	snprintf(cmd, sizeof(cmd), "%s -t %lu -o %s 2>&1", bin, ms, tmp);
+	fp = popen(cmd, "r");
+	if (fp == NULL)
+	{
+		perror(bin);
+		unlink(tmp);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		(void)sscanf(line, "sim62p: uart1 %lu bytes %lu lines, %lf bytes/s %lf lines/s",
+		             &bytes, &lines, &bps, &lps);
+		(void)sscanf(line, "sim62p: wait %lf", &wait);
+	}
+	pclose(fp);
+	unlink(tmp);
+	if ((lines == 0) || (wait < 0.0))
+	{
+		fprintf(stderr, "bench: %s gave no statistics\n", bin);
+		return -1;
+	}
+	bench_put(var, "sim_lines_s", lps, "line/s", 1);
+	bench_put(var, "sim_bytes_line", (double)bytes / (double)lines, "byte", 0);
+	bench_put(var, "sim_wait_pct", wait, "%", 1);
+	return 0;
+}
+
+/**
+ * @fn              static int bench_elf(const char* var, const char* path)
+ * @fid             [FID908]-[bench_elf]
+ * @fnbrf           ROM and RAM of an object from its section headers.
+ * @param[in]       var ; const char* ; variant
+ * @param[in]       path ; const char* ; ELF32 or ELF64 file
+ * @param[in,out]   -
+ * @retval          0 : done, -1 : not an ELF file
+ * @warning         Host byte order only.
+ * @remark          Allocated sections : NOBITS is RAM, writable is ROM (initial
+ *                  value) and RAM, the rest is ROM.
+ */
+static int bench_elf(const char* var, const char* path)
+{
+	FILE*          fp   = fopen(path, "rb");
+	unsigned char* img  = NULL;
+	long           size = 0;
+	unsigned long  rom  = 0;
+	unsigned long  ram  = 0;
+	unsigned       i;
+
+	if ((fp != NULL) && (fseek(fp, 0, SEEK_END) == 0))
+	{
+		size = ftell(fp);
+		rewind(fp);
+		img = (unsigned char*)malloc((size_t)size + 1);
+		if ((img != NULL) && (fread(img, 1, (size_t)size, fp) != (size_t)size))
+		{
+			size = 0;
+		}
+	}
+	if (fp != NULL)
+	{
+		fclose(fp);
+	}
+	if ((img == NULL) || (size < EI_NIDENT) || (memcmp(img, ELFMAG, SELFMAG) != 0))
+	{
+		fprintf(stderr, "bench: %s is not an ELF file\n", path);
+		free(img);
+		return -1;
+	}
+	if (img[EI_CLASS] == ELFCLASS64)
+	{
+		const Elf64_Ehdr* eh = (const Elf64_Ehdr*)img;
+
+		for (i = 0; i < eh->e_shnum; i++)
+		{
+			const Elf64_Shdr* sh = (const Elf64_Shdr*)(img + eh->e_shoff + (size_t)i * eh->e_shentsize);
+
+			if ((sh->sh_flags & SHF_ALLOC) == 0)
+			{
+				continue;
+			}
+			ram += (sh->sh_type == SHT_NOBITS || (sh->sh_flags & SHF_WRITE)) ? sh->sh_size : 0;
+			rom += (sh->sh_type != SHT_NOBITS) ? sh->sh_size : 0;
+		}
+	}
+	else
+	{
+		const Elf32_Ehdr* eh = (const Elf32_Ehdr*)img;
+
+		for (i = 0; i < eh->e_shnum; i++)
+		{
+			const Elf32_Shdr* sh = (const Elf32_Shdr*)(img + eh->e_shoff + (size_t)i * eh->e_shentsize);
+
+			if ((sh->sh_flags & SHF_ALLOC) == 0)
+			{
+				continue;
+			}
+			ram += (sh->sh_type == SHT_NOBITS || (sh->sh_flags & SHF_WRITE)) ? sh->sh_size : 0;
+			rom += (sh->sh_type != SHT_NOBITS) ? sh->sh_size : 0;
+		}
+	}
+	free(img);
+	bench_put(var, "rom_bytes", (double)rom, "byte", 0);
+	bench_put(var, "ram_bytes", (double)ram, "byte", 0);
+	return 0;
+}
+
+/**
+ * @fn              static int bench_base(const char* path, double tol)
+ * @fid             [FID909]-[bench_base]
+ * @fnbrf           Compare the results with a baseline file.
+ * @param[in]       path ; const char* ; previous result
+ * @param[in]       tol ; double ; allowed change in percent
+ * @param[in,out]   -
+ * @retval          regressions ; int ; -1 : file error
+ * @warning         -
+ * @remark          Metrics missing on either side are not compared. Time
+ *                  changes below BENCH_NS_MIN are not counted.
+ */
+static int bench_base(const char* path, double tol)
+{
+	FILE*    fp = fopen(path, "r");
+	char     line[256];
+	char     var[16];
+	char     metric[24];
+	char     unit[16];
+	char     dir[8];
+	double   val;
+	double   pct;
+	int      bad = 0;
+	unsigned i;
+
+	if (fp == NULL)
+	{
+		perror(path);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		if ((line[0] == '#') ||
+		    (sscanf(line, "%15s %23s %lf %15s %7s", var, metric, &val, unit, dir) != 5))
+		{
+			continue;
+		}
+		for (i = 0; i < res_num; i++)
+		{
+			if ((strcmp(res_tbl[i].var, var) != 0) || (strcmp(res_tbl[i].metric, metric) != 0))
+			{
+				continue;
+			}
+			pct = (val != 0.0) ? (res_tbl[i].val - val) * 100.0 / val : 0.0;
+			if ((strcmp(unit, "ns") == 0) && (res_tbl[i].val - val < BENCH_NS_MIN) &&
+			    (val - res_tbl[i].val < BENCH_NS_MIN))
+			{
+				continue;
+			}
+			if ((res_tbl[i].higher != 0) ? (pct < -tol) : (pct > tol))
+			{
+				fprintf(stderr, "bench: REGRESSION %s %s %.4g -> %.4g %s (%+.1f %%)\n",
+				        var, metric, val, res_tbl[i].val, unit, pct);
+				bad++;
+			}
+		}
+	}
+	fclose(fp);
+	return bad;
+}
+
+/**
+ * @fn              int main(int argc, char** argv)
+ * @fid             [FID910]-[main]
+ * @fnbrf           Parse options, run the benchmarks and write the result.
+ * @param[in]       argc ; int ; argument count
+ * @param[in]       argv ; char** ; arguments
+ * @param[in,out]   -
+ * @retval          0 : done, 1 : usage or error, 2 : regression
+ * @warning         -
+ * @remark          -
+ */
+int main(int argc, char** argv)
+{
+	const char*   sim_arg[BENCH_ARG_MAX];
+	const char*   elf_arg[BENCH_ARG_MAX];
+	unsigned      sim_num  = 0;
+	unsigned      elf_num  = 0;
+	const char*   out_path = NULL;
+	const char*   base     = NULL;
+	unsigned long reps     = BENCH_REPS;
+	unsigned      runs     = BENCH_RUNS;
+	unsigned long ms       = BENCH_SIM_MS;
+	double        tol      = BENCH_TOL_PCT;
+	FILE*         out      = stdout;
+	int           rc       = 0;
+	unsigned      k;
+	int           i;
+
+	for (i = 1; i < argc - 1; i += 2)
+	{
+		const char* arg = argv[i + 1];
+
+		if (strcmp(argv[i], "-n") == 0)
+		{
+			reps = strtoul(arg, NULL, 0);
+		}
+		else if (strcmp(argv[i], "-r") == 0)
+		{
+			runs = (unsigned)atoi(arg);
+		}
+		else if (strcmp(argv[i], "-t") == 0)
+		{
+			ms = strtoul(arg, NULL, 0);
+		}
+		else if ((strcmp(argv[i], "-S") == 0) && (sim_num < BENCH_ARG_MAX) && (strchr(arg, '=') != NULL))
+		{
+			sim_arg[sim_num++] = arg;
+		}
+		else if ((strcmp(argv[i], "-f") == 0) && (elf_num < BENCH_ARG_MAX) && (strchr(arg, '=') != NULL))
+		{
+			elf_arg[elf_num++] = arg;
+		}
+		else if (strcmp(argv[i], "-o") == 0)
+		{
+			out_path = arg;
+		}
+		else if (strcmp(argv[i], "-b") == 0)
+		{
+			base = arg;
+		}
+		else if (strcmp(argv[i], "-T") == 0)
+		{
+			tol = atof(arg);
+		}
+		else
+		{
+			break;
+		}
+	}
+	if ((i != argc) || (reps == 0) || (runs == 0) || (ms == 0))
+	{
+		fprintf(stderr, "usage: %s [-n reps] [-r runs] [-t ms] [-S variant=sim_binary].. "
+		                "[-f variant=object].. [-o result] [-b baseline [-T pct]]\n", argv[0]);
+		return 1;
+	}
+
+	for (k = 0; k < sizeof(var_tbl) / sizeof(var_tbl[0]); k++)
+	{
+		bench_host(var_tbl[k], reps, runs);
+	}
+	for (k = 0; k < sim_num; k++)
+	{
+		char var[16];
+
+		snprintf(var, sizeof(var), "%.*s", (int)(strchr(sim_arg[k], '=') - sim_arg[k]), sim_arg[k]);
+		rc |= (bench_sim(var, strchr(sim_arg[k], '=') + 1, ms) != 0) ? 1 : 0;
+	}
+	for (k = 0; k < elf_num; k++)
+	{
+		char var[16];
+
+		snprintf(var, sizeof(var), "%.*s", (int)(strchr(elf_arg[k], '=') - elf_arg[k]), elf_arg[k]);
+		rc |= (bench_elf(var, strchr(elf_arg[k], '=') + 1) != 0) ? 1 : 0;
+	}
+
+	if (out_path != NULL)
+	{
+		out = fopen(out_path, "w");
+		if (out == NULL)
+		{
+			perror(out_path);
+			return 1;
+		}
+	}
+	fprintf(out, "# bench : %lu x %d codes, best of %u, sim %lu ms\n", reps, BENCH_CODES, runs, ms);
+	for (k = 0; k < res_num; k++)
+	{
+		fprintf(out, "%s\t%s\t%.4f\t%s\t%s\n", res_tbl[k].var, res_tbl[k].metric, res_tbl[k].val,
+		        res_tbl[k].unit, (res_tbl[k].higher != 0) ? "higher" : "lower");
+	}
+	if (out != stdout)
+	{
+		fclose(out);
+	}
+
+	if (base != NULL)
+	{
+		int bad = bench_base(base, tol);
+
+		if (bad < 0)
+		{
+			return 1;
+		}
+		if (bad > 0)
+		{
+			return 2;
+		}
+	}
+	return rc;
+}
@@ -0,0 +1,58 @@
+/**
+ * @file       bench.h
+ * @brief      [MID111]-[bench]
+ * @details    Conversion benchmark interface to the three firmware variants:
+ * @details      01_bad  : 01_temp_calculation_bad_code.c, inline long arithmetic
+ * @details      01_good : 01_temp_calculation_good_code.c, read_temp + ftoa
+ * @details      02_map  : 02_mapping_calculation.c, adc_table + line template
+ * @details    Each variant is compiled into its own bench_vXX.c with the UART
+ * @details    transmit buffer and AN0 result register redirected to the hooks
+ * @details    below, so the 01 main loops run unchanged over a code array.
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+#include <setjmp.h>
+
+/**
+ * Data definition
+ */
+#define BENCH_LINE_MAX      (192)     /* output bytes per sample, upper bound */
+
+/**
+ * One firmware variant
+ */
+typedef struct
+{
+	const char* name;
+	/* Conversion only, returns a checksum so that nothing is optimised away */
+	long   (*conv)(const unsigned char* code, size_t n);
+	/* A/D result to UART bytes, returns the bytes of the sample lines (NULL : none) */
+	size_t (*path)(const unsigned char* code, size_t n, char* out);
+	/* Filter stage (NULL terminated metric names, NULL : none), returns a checksum */
+	const char* const* filt_name;
+	long   (*filt)(unsigned idx, const unsigned char* code, size_t n);
+} BENCH_VAR;
+
+extern const BENCH_VAR bench_v01b;
+extern const BENCH_VAR bench_v01g;
+extern const BENCH_VAR bench_v02;
+
+/**
+ * Hooks for the 01 main loops : ad0 reads the next code, u1tb appends to
+ * bench_tx, and the read after the last code returns to bench_jmp.
+ */
+extern jmp_buf bench_jmp;
+extern char*   bench_tx;
+extern size_t  bench_tx_len;
+
+void          bench_feed(const unsigned char* code, size_t n, char* out);
+unsigned char bench_ad0(void);
+size_t        bench_tx_sample(void);
+
+#endif /* BENCH_H */
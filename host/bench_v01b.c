@@ -0,0 +1,82 @@
+/**
+ * @file       bench_v01b.c
+ * @brief      [MID112]-[bench_v01b]
+ * @details    01_temp_calculation_bad_code.c for the conversion benchmark.
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+
+/**
+ * Include file
+ */
+#include "sfr62p.h"
+#include "bench.h"
+
+/*
+ * AN0 and the UART1 transmit buffer go to the bench hooks, main() gets a
+ * name of its own. Every other register access goes to sim_stub.c, the
+ * main loop reads ad0 and writes u1tb itself, hal62p.c only initializes.
+ */
+#undef  ad0
+#define ad0                 (bench_ad0())
+#undef  u1tb
+#define u1tb                bench_tx[bench_tx_len++]
+#undef  main
+#define main                v01b_main
+#include "../01_temp_calculation_bad_code.c"
+#undef  main
+
+/**
+ * @fn              static long v01b_conv(const unsigned char* code, size_t n)
+ * @fid             [FID1001]-[v01b_conv]
+ * @fnbrf           Conversion of the 01_bad main loop.
+ * @param[in]       code ; const unsigned char* ; A/D codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   -
+ * @retval          sum ; long ; sum of the temperatures
+ * @warning         -
+ * @remark          The expression is inline in main(), copied here as it is.
+ */
+static long v01b_conv(const unsigned char* code, size_t n)
+{
+	long   sum = 0;
+	long   x;
+	size_t i;
+
+	for (i = 0; i < n; i++)
+	{
+		x = code[i];
+		x = (((x * 5000)/255)-500) / 10;
+		sum += x;
+	}
+	return sum;
+}
+
+/**
+ * @fn              static size_t v01b_path(const unsigned char* code, size_t n, char* out)
+ * @fid             [FID1002]-[v01b_path]
+ * @fnbrf           Run the 01_bad main loop over the codes.
+ * @param[in]       code ; const unsigned char* ; A/D codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   out ; char* ; n * BENCH_LINE_MAX bytes
+ * @retval          bytes ; size_t ; bytes of the sample lines
+ * @warning         -
+ * @remark          -
+ */
+static size_t v01b_path(const unsigned char* code, size_t n, char* out)
+{
+	bench_feed(code, n, out);
+	ti_u1c1 = 1;                         /* transmit buffer always empty */
+	if (setjmp(bench_jmp) == 0)
+	{
+		v01b_main();
+	}
+	return bench_tx_sample();
+}
+
+/**
+ * Global Variable Definition
+ */
+const BENCH_VAR bench_v01b = { "01_bad", v01b_conv, v01b_path, NULL, NULL };
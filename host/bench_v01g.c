@@ -0,0 +1,82 @@
+/**
+ * @file       bench_v01g.c
+ * @brief      [MID113]-[bench_v01g]
+ * @details    01_temp_calculation_good_code.c for the conversion benchmark.
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+
+/**
+ * Include file
+ */
+#include "sfr62p.h"
+#include "bench.h"
+
+/*
+ * AN0 and the UART1 transmit buffer go to the bench hooks, main() gets a
+ * name of its own. ftoa() and read_temp() are the ones of com62p.c, the
+ * HAL is a private copy of hal62p.c so that its A/D read and UART1
+ * transmit see the hooks too.
+ */
+#undef  ad0
+#define ad0                 (bench_ad0())
+#undef  u1tb
+#define u1tb                bench_tx[bench_tx_len++]
+#undef  main
+#define main                v01g_main
+#define HAL_API             static inline
+#include "../01_temp_calculation_good_code.c"
+#include "../hal62p.c"
+#undef  main
+
+/**
+ * @fn              static long v01g_conv(const unsigned char* code, size_t n)
+ * @fid             [FID1011]-[v01g_conv]
+ * @fnbrf           read_temp() over the codes.
+ * @param[in]       code ; const unsigned char* ; A/D codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   -
+ * @retval          sum ; long ; sum of the returned values
+ * @warning         -
+ * @remark          -
+ */
+static long v01g_conv(const unsigned char* code, size_t n)
+{
+	long   sum = 0;
+	size_t i;
+
+	for (i = 0; i < n; i++)
+	{
+		sum += (long)read_temp(code[i]);
+	}
+	return sum;
+}
+
+/**
+ * @fn              static size_t v01g_path(const unsigned char* code, size_t n, char* out)
+ * @fid             [FID1012]-[v01g_path]
+ * @fnbrf           Run the 01_good main loop over the codes.
+ * @param[in]       code ; const unsigned char* ; A/D codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   out ; char* ; n * BENCH_LINE_MAX bytes
+ * @retval          bytes ; size_t ; bytes of the sample lines
+ * @warning         -
+ * @remark          -
+ */
+static size_t v01g_path(const unsigned char* code, size_t n, char* out)
+{
+	bench_feed(code, n, out);
+	ti_u1c1 = 1;                         /* transmit buffer always empty */
+	if (setjmp(bench_jmp) == 0)
+	{
+		v01g_main();
+	}
+	return bench_tx_sample();
+}
+
+/**
+ * Global Variable Definition
+ */
+const BENCH_VAR bench_v01g = { "01_good", v01g_conv, v01g_path, NULL, NULL };
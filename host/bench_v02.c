@@ -0,0 +1,150 @@
+/**
+ * @file       bench_v02.c
+ * @brief      [MID114]-[bench_v02]
+ * @details    02_mapping_calculation.c for the conversion benchmark, in the
+ * @details    configuration of CFG_PRESET (cfg62p.h).
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+
+/**
+ * Include file
+ */
+#include <string.h>
+#include "bench.h"
+#include "../02_mapping_calculation.c"
+#undef main
+
+#if CONV_ON
+/**
+ * @fn              static long v02_conv(const unsigned char* code, size_t n)
+ * @fid             [FID1021]-[v02_conv]
+ * @fnbrf           Conversion engine of the configuration over the codes.
+ * @param[in]       code ; const unsigned char* ; A/D codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   -
+ * @retval          sum ; long ; sum of the temperatures
+ * @warning         -
+ * @remark          -
+ */
+static long v02_conv(const unsigned char* code, size_t n)
+{
+	long   sum = 0;
+	size_t i;
+
+	for (i = 0; i < n; i++)
+	{
+		sum += CONV_TEMP(code[i]);
+	}
+	return sum;
+}
+#else
+/**
+ * @fn              static long v02_conv(const unsigned char* code, size_t n)
+ * @fid             [FID1021]-[v02_conv]
+ * @fnbrf           Raw codes are sent, nothing converted.
+ * @param[in]       code ; const unsigned char* ; A/D codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   -
+ * @retval          sum ; long ; sum of the codes
+ * @warning         -
+ * @remark          -
+ */
+static long v02_conv(const unsigned char* code, size_t n)
+{
+	long   sum = 0;
+	size_t i;
+
+	for (i = 0; i < n; i++)
+	{
+		sum += code[i];
+	}
+	return sum;
+}
+#endif
+
+#if CFG_TEXT_ON
+/**
+ * @fn              static size_t v02_path(const unsigned char* code, size_t n, char* out)
+ * @fid             [FID1022]-[v02_path]
+ * @fnbrf           Sample path of the 02 main loop over the codes.
+ * @param[in]       code ; const unsigned char* ; A/D codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   out ; char* ; n * BENCH_LINE_MAX bytes
+ * @retval          bytes ; size_t ; bytes of the sample lines
+ * @warning         -
+ * @remark          Setting at reset of the configuration (text lines).
+ *                  The line is copied where uart_write() would queue it.
+ */
+static size_t v02_path(const unsigned char* code, size_t n, char* out)
+{
+	s4     s4_temp[ADC_CH_MAX] = { 0 };
+	size_t len = 0;
+	size_t i;
+
+	out_line_build();
+	for (i = 0; i < n; i++)
+	{
+		s4_temp[ADC_CH0] = CONV_TEMP(code[i]);
+#if CFG_DB_ON
+		if (out_deadband(s4_temp) != 0)
+		{
+			continue;
+		}
+#endif
+		out_line_fill(st_out_line.s1_line, s4_temp, 0);
+		memcpy(&out[len], st_out_line.s1_line, st_out_line.u1_len);
+		len += st_out_line.u1_len;
+	}
+	return len;
+}
+#else
+#define v02_path            NULL
+#endif
+
+#if (CFG_FILT != 0)
+/**
+ * Filters timed by v02_filt(), metric name and FILT command setting
+ */
+static const char* const v02_filt_name[] = {
+	"filt_avg16_ns", "filt_med5_ns", "filt_iir4_ns", NULL
+};
+static const u1 v02_filt_type[]  = { FILT_AVG, FILT_MED, FILT_IIR };
+static const u1 v02_filt_param[] = { 4, 5, 4 };
+
+/**
+ * @fn              static long v02_filt(unsigned idx, const unsigned char* code, size_t n)
+ * @fid             [FID1023]-[v02_filt]
+ * @fnbrf           filt_apply() of one filter over the codes.
+ * @param[in]       idx ; unsigned ; index into v02_filt_name
+ * @param[in]       code ; const unsigned char* ; A/D codes
+ * @param[in]       n ; size_t ; number of codes
+ * @param[in,out]   -
+ * @retval          sum ; long ; sum of the filtered codes
+ * @warning         -
+ * @remark          -
+ */
+static long v02_filt(unsigned idx, const unsigned char* code, size_t n)
+{
+	FILT_CH st_f;
+	long    sum = 0;
+	size_t  i;
+
+	filt_set(&st_f, v02_filt_type[idx], v02_filt_param[idx]);
+	for (i = 0; i < n; i++)
+	{
+		sum += filt_apply(&st_f, code[i]);
+	}
+	return sum;
+}
+#else
+#define v02_filt_name       NULL
+#define v02_filt            NULL
+#endif
+
+/**
+ * Global Variable Definition
+ */
+const BENCH_VAR bench_v02 = { CFG_NAME, v02_conv, v02_path, v02_filt_name, v02_filt };
@@ -0,0 +1,433 @@
+/**
+ * @file       colq.c
+ * @brief      [MID110]-[colq]
+ * @details    Queries the columnar store written by aggd -D (colstore.h).
+ * @details    Build : make colq, or gcc -O2 -pthread -Ihost -o colq host/colq.c host/colstore.c
+ * @details                host/adcbatch.c
+ * @details    Usage : colq [-B board] [-c ch] [-t from_us,to_us] [-p]
+ * @details                 [-R table [-w] [-n repeat]] dir
+ * @details    Default : per segment, rows in the time range and value min/max.
+ * @details              Whole blocks use the block index, the two edge blocks
+ * @details              are scanned.
+ * @details    -p      : print the rows "<t_us>\t<board>\t<ch>\t<code>\t<val>".
+ * @details    -R      : convert the raw code column with another table
+ * @details              (cs_table_load format) and report the new min/max,
+ * @details              -w writes the result to the value column and block index.
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+
+/**
+ * Include file
+ */
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include "colstore.h"
+#include "adcbatch.h"
+
+/**
+ * Data definition
+ */
+#define COLQ_CHUNK          (1UL << 14)   /* rows converted per call, -R     */
+
+/**
+ * Query result
+ */
+typedef struct
+{
+	unsigned long long rows;
+	int32_t            v_min;
+	int32_t            v_max;
+} COLQ_SUM;
+
+/**
+ * Global Variable Definition
+ */
+static int32_t colq_buf[COLQ_CHUNK] __attribute__((aligned(64)));
+
+/**
+ * fucntion prototype declaration
+ */
+static double colq_now(void);
+static int    colq_name_cmp(const void* a, const void* b);
+static void   colq_sum_add(COLQ_SUM* sum, int32_t v_min, int32_t v_max, size_t rows);
+static void   colq_stat(const CS_SEG* seg, size_t first, size_t end, COLQ_SUM* sum);
+static void   colq_print(const CS_SEG* seg, size_t first, size_t end);
+static void   colq_conv(CS_SEG* seg, size_t first, size_t end, const ADCB_MAP* map,
+                        int write, COLQ_SUM* sum);
+
+/**
+ * @fn              static double colq_now(void)
+ * @fid             [FID801]-[colq_now]
+ * @fnbrf           Monotonic time in seconds.
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          t ; double ; seconds
+ * @warning         -
+ * @remark          -
+ */
+static double colq_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @fn              static int colq_name_cmp(const void* a, const void* b)
+ * @fid             [FID802]-[colq_name_cmp]
+ * @fnbrf           qsort order of segment names (board, channel, sequence).
+ * @param[in]       a ; const void* ; char**
+ * @param[in]       b ; const void* ; char**
+ * @param[in,out]   -
+ * @retval          strcmp result
+ * @warning         -
+ * @remark          -
+ */
+static int colq_name_cmp(const void* a, const void* b)
+{
+	return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/**
+ * @fn              static void colq_sum_add(COLQ_SUM* sum, int32_t v_min, int32_t v_max, size_t rows)
+ * @fid             [FID803]-[colq_sum_add]
+ * @fnbrf           Merge a min/max over rows into a result.
+ * @param[in]       v_min ; int32_t ; minimum
+ * @param[in]       v_max ; int32_t ; maximum
+ * @param[in]       rows ; size_t ; rows, 0 : nothing to merge
+ * @param[in,out]   sum ; COLQ_SUM* ; result
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void colq_sum_add(COLQ_SUM* sum, int32_t v_min, int32_t v_max, size_t rows)
+{
+	if (rows == 0)
+	{
+		return;
+	}
+	if (sum->rows == 0)
+	{
+		sum->v_min = v_min;
+		sum->v_max = v_max;
+	}
+	sum->v_min = (v_min < sum->v_min) ? v_min : sum->v_min;
+	sum->v_max = (v_max > sum->v_max) ? v_max : sum->v_max;
+	sum->rows += rows;
+}
+
+/**
+ * @fn              static void colq_stat(const CS_SEG* seg, size_t first, size_t end, COLQ_SUM* sum)
+ * @fid             [FID804]-[colq_stat]
+ * @fnbrf           Value min/max of rows first..end-1.
+ * @param[in]       seg ; const CS_SEG* ; segment
+ * @param[in]       first ; size_t ; first row
+ * @param[in]       end ; size_t ; row after the last
+ * @param[in,out]   sum ; COLQ_SUM* ; result
+ * @retval          -
+ * @warning         -
+ * @remark          Blocks inside the range are answered from the index.
+ */
+static void colq_stat(const CS_SEG* seg, size_t first, size_t end, COLQ_SUM* sum)
+{
+	size_t  r = first;
+	size_t  stop;
+	size_t  n;
+	int32_t v_min;
+	int32_t v_max;
+
+	while (r < end)
+	{
+		stop = (r / CS_BLOCK_ROWS + 1) * CS_BLOCK_ROWS;
+		if (((r % CS_BLOCK_ROWS) == 0) && (stop <= end))
+		{
+			const CS_BLK* blk = &seg->idx[r / CS_BLOCK_ROWS];
+
+			colq_sum_add(sum, blk->v_min, blk->v_max, CS_BLOCK_ROWS);
+			r = stop;
+			continue;
+		}
+		stop  = (stop < end) ? stop : end;
+		v_min = seg->val[r];
+		v_max = seg->val[r];
+		for (n = stop - r; r < stop; r++)
+		{
+			v_min = (seg->val[r] < v_min) ? seg->val[r] : v_min;
+			v_max = (seg->val[r] > v_max) ? seg->val[r] : v_max;
+		}
+		colq_sum_add(sum, v_min, v_max, n);
+	}
+}
+
+/**
+ * @fn              static void colq_print(const CS_SEG* seg, size_t first, size_t end)
+ * @fid             [FID805]-[colq_print]
+ * @fnbrf           Print rows first..end-1.
+ * @param[in]       seg ; const CS_SEG* ; segment
+ * @param[in]       first ; size_t ; first row
+ * @param[in]       end ; size_t ; row after the last
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void colq_print(const CS_SEG* seg, size_t first, size_t end)
+{
+	size_t r;
+
+	for (r = first; r < end; r++)
+	{
+		printf("%llu\t%u\t%u\t%u\t%ld\n", (unsigned long long)(seg->t[r] / 1000U),
+		       seg->head->board, seg->head->ch, seg->code[r], (long)seg->val[r]);
+	}
+}
+
+/**
+ * @fn              static void colq_conv(CS_SEG* seg, size_t first, size_t end, const ADCB_MAP* map, int write, COLQ_SUM* sum)
+ * @fid             [FID806]-[colq_conv]
+ * @fnbrf           Convert the raw codes of rows first..end-1 with map.
+ * @param[in]       first ; size_t ; first row
+ * @param[in]       end ; size_t ; row after the last
+ * @param[in]       map ; const ADCB_MAP* ; new table
+ * @param[in]       write ; int ; 1 : store into the value column
+ * @param[in,out]   seg ; CS_SEG* ; segment, writable when write is 1
+ * @param[in,out]   sum ; COLQ_SUM* ; min/max of the new values
+ * @retval          -
+ * @warning         -
+ * @remark          Only the code column is read. Without write the values go
+ *                  through a cache-sized buffer.
+ */
+static void colq_conv(CS_SEG* seg, size_t first, size_t end, const ADCB_MAP* map,
+                      int write, COLQ_SUM* sum)
+{
+	size_t   r;
+	size_t   n;
+	int32_t* out;
+	int32_t  v_min;
+	int32_t  v_max;
+
+	for (r = first; r < end; r += n)
+	{
+		n   = ((end - r) < COLQ_CHUNK) ? (end - r) : COLQ_CHUNK;
+		out = (write != 0) ? &seg->val[r] : colq_buf;
+		adcb_convert(ADCB_OP_MAP_FIX, map, ADCB_BITS_MIN, &seg->code[r], out, n);
+		adcb_minmax(out, n, &v_min, &v_max);
+		colq_sum_add(sum, v_min, v_max, n);
+	}
+	if ((write != 0) && (end > first))
+	{
+		for (r = first / CS_BLOCK_ROWS; r <= (end - 1) / CS_BLOCK_ROWS; r++)
+		{
+			cs_blk_update(seg, r);
+		}
+	}
+}
+
+/**
+ * @fn              int main(int argc, char** argv)
+ * @fid             [FID807]-[main]
+ * @fnbrf           Parse options and run the query on every matching segment.
+ * @param[in]       argc ; int ; argument count
+ * @param[in]       argv ; char** ; arguments
+ * @param[in,out]   -
+ * @retval          0 : done, 1 : usage or file error
+ * @warning         -
+ * @remark          -
+ */
+int main(int argc, char** argv)
+{
+	const char*    dir      = NULL;
+	const char*    tbl_path = NULL;
+	long           board    = -1;
+	long           ch       = -1;
+	uint64_t       t0       = 0;
+	uint64_t       t1       = UINT64_MAX;
+	int            print    = 0;
+	int            write    = 0;
+	unsigned long  repeat   = 1;
+	char**         name     = NULL;
+	size_t         name_num = 0;
+	size_t         k;
+	unsigned long  r;
+	long           table[CS_TABLE_SIZE];
+	static ADCB_MAP st_map;
+	COLQ_SUM       total;
+	unsigned long long code_bytes = 0;
+	double         dt       = 0.0;
+	DIR*           dp;
+	struct dirent* de;
+	int            i;
+
+	for (i = 1; i < argc - 1; i++)
+	{
+		const char* arg = argv[i + 1];
+
+		if (strcmp(argv[i], "-p") == 0)
+		{
+			print = 1;
+			continue;
+		}
+		if (strcmp(argv[i], "-w") == 0)
+		{
+			write = 1;
+			continue;
+		}
+		if (strcmp(argv[i], "-B") == 0)
+		{
+			board = atol(arg);
+		}
+		else if (strcmp(argv[i], "-c") == 0)
+		{
+			ch = atol(arg);
+		}
+		else if (strcmp(argv[i], "-t") == 0)
+		{
+			char* p;
+
+			t0 = strtoull(arg, &p, 0) * 1000U;
+			if (*p == ',')
+			{
+				t1 = strtoull(p + 1, NULL, 0) * 1000U + 999U;
+			}
+		}
+		else if (strcmp(argv[i], "-R") == 0)
+		{
+			tbl_path = arg;
+		}
+		else if (strcmp(argv[i], "-n") == 0)
+		{
+			repeat = strtoul(arg, NULL, 0);
+		}
+		else
+		{
+			break;
+		}
+		i++;
+	}
+	if ((i != argc - 1) || (repeat == 0) || ((write != 0) && (tbl_path == NULL)) ||
+	    ((write != 0) && (repeat != 1)) || ((print != 0) && (tbl_path != NULL)))
+	{
+		fprintf(stderr, "usage: %s [-B board] [-c ch] [-t from_us,to_us] [-p] [-R table [-w] [-n repeat]] dir\n", argv[0]);
+		return 1;
+	}
+	dir = argv[i];
+	if (tbl_path != NULL)
+	{
+		if (cs_table_load(tbl_path, table) != 0)
+		{
+			return 1;
+		}
+		adcb_map_init(&st_map, table);
+	}
+
+	/* Segment names in board, channel, sequence order */
+	dp = opendir(dir);
+	if (dp == NULL)
+	{
+		perror(dir);
+		return 1;
+	}
+	while ((de = readdir(dp)) != NULL)
+	{
+		size_t len = strlen(de->d_name);
+
+		if ((len > 4) && (strcmp(&de->d_name[len - 4], ".seg") == 0))
+		{
+			char** tmp = (char**)realloc(name, (name_num + 1) * sizeof(char*));
+
+			if (tmp == NULL)
+			{
+				return 1;
+			}
+			name = tmp;
+			name[name_num] = (char*)malloc(strlen(dir) + len + 2);
+			if (name[name_num] == NULL)
+			{
+				return 1;
+			}
+			sprintf(name[name_num++], "%s/%s", dir, de->d_name);
+		}
+	}
+	closedir(dp);
+	if (name_num != 0)
+	{
+		qsort(name, name_num, sizeof(char*), colq_name_cmp);
+	}
+
+	memset(&total, 0, sizeof(total));
+	for (k = 0; k < name_num; k++)
+	{
+		CS_SEG   seg;
+		COLQ_SUM sum;
+		size_t   first;
+		size_t   end;
+		double   ts;
+
+		if (cs_seg_map(&seg, name[k], write) != 0)
+		{
+			fprintf(stderr, "%s: not a segment\n", name[k]);
+			continue;
+		}
+		if (((board >= 0) && ((long)seg.head->board != board)) ||
+		    ((ch >= 0) && ((long)seg.head->ch != ch)))
+		{
+			cs_seg_unmap(&seg);
+			continue;
+		}
+		cs_seg_range(&seg, t0, t1, &first, &end);
+		memset(&sum, 0, sizeof(sum));
+		if (print != 0)
+		{
+			colq_print(&seg, first, end);
+		}
+		else if (tbl_path != NULL)
+		{
+			(void)posix_madvise(&seg.code[first], end - first, POSIX_MADV_SEQUENTIAL);
+			ts = colq_now();
+			for (r = 0; r < repeat; r++)
+			{
+				memset(&sum, 0, sizeof(sum));
+				colq_conv(&seg, first, end, &st_map, write, &sum);
+			}
+			dt += colq_now() - ts;
+			code_bytes += (unsigned long long)(end - first) * repeat;
+		}
+		else
+		{
+			colq_stat(&seg, first, end, &sum);
+		}
+		if ((print == 0) && (sum.rows != 0))
+		{
+			printf("b%05u c%u #%06u : %llu rows, min %ld, max %ld\n", seg.head->board,
+			       seg.head->ch, seg.head->seq, sum.rows, (long)sum.v_min, (long)sum.v_max);
+			colq_sum_add(&total, sum.v_min, sum.v_max, (size_t)sum.rows);
+		}
+		cs_seg_unmap(&seg);
+	}
+	for (k = 0; k < name_num; k++)
+	{
+		free(name[k]);
+	}
+	free(name);
+
+	if (print == 0)
+	{
+		printf("total : %llu rows, min %ld, max %ld\n", total.rows, (long)total.v_min, (long)total.v_max);
+	}
+	if ((tbl_path != NULL) && (dt > 0.0))
+	{
+		fprintf(stderr, "colq: %s, %llu codes in %.3f s, %.2f GB/s code column\n",
+		        adcb_isa_name(adcb_isa_best()), code_bytes, dt, (double)code_bytes / dt / 1e9);
+	}
+	return 0;
+}
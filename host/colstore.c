@@ -0,0 +1,582 @@
+/**
+ * @file       colstore.c
+ * @brief      [MID109]-[colstore]
+ * @details    Columnar on-disk store for ingested samples, see colstore.h.
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+
+/**
+ * Include file
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "colstore.h"
+
+/**
+ * fucntion prototype declaration
+ */
+static void    cs_layout(CS_HEAD* head, uint64_t cap);
+static void    cs_seg_path(const CS_STORE* st, unsigned board, unsigned ch, unsigned seq, char* path);
+static int     cs_seg_create(CS_SEG* seg, const char* path, unsigned board, unsigned ch,
+                             unsigned seq, uint64_t cap);
+static CS_SEG* cs_seg_next(CS_STORE* st, unsigned board, unsigned ch);
+static size_t  cs_lower(const CS_SEG* seg, size_t rows, uint64_t t);
+
+/**
+ * @fn              static void cs_layout(CS_HEAD* head, uint64_t cap)
+ * @fid             [FID701]-[cs_layout]
+ * @fnbrf           Column offsets and file size of a segment.
+ * @param[in]       cap ; uint64_t ; rows, multiple of CS_PAGE
+ * @param[in,out]   head ; CS_HEAD* ; header
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void cs_layout(CS_HEAD* head, uint64_t cap)
+{
+	uint64_t idx_size = (cap / CS_BLOCK_ROWS) * sizeof(CS_BLK);
+
+	head->cap        = cap;
+	head->block_rows = CS_BLOCK_ROWS;
+	head->off_t      = CS_PAGE;
+	head->off_code   = head->off_t + cap * sizeof(uint64_t);
+	head->off_val    = head->off_code + cap * sizeof(uint8_t);
+	head->off_idx    = head->off_val + cap * sizeof(int32_t);
+	head->size       = head->off_idx + ((idx_size + CS_PAGE - 1) & ~(uint64_t)(CS_PAGE - 1));
+}
+
+/**
+ * @fn              static void cs_seg_path(const CS_STORE* st, unsigned board, unsigned ch, unsigned seq, char* path)
+ * @fid             [FID702]-[cs_seg_path]
+ * @fnbrf           Segment file name.
+ * @param[in]       st ; const CS_STORE* ; store
+ * @param[in]       board ; unsigned ; board
+ * @param[in]       ch ; unsigned ; channel
+ * @param[in]       seq ; unsigned ; segment number
+ * @param[in,out]   path ; char* ; at least sizeof(st->dir) + 32
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void cs_seg_path(const CS_STORE* st, unsigned board, unsigned ch, unsigned seq, char* path)
+{
+	sprintf(path, "%s/b%05u_c%u_%06u.seg", st->dir, board, ch, seq);
+}
+
+/**
+ * @fn              static int cs_seg_create(CS_SEG* seg, const char* path, unsigned board, unsigned ch, unsigned seq, uint64_t cap)
+ * @fid             [FID703]-[cs_seg_create]
+ * @fnbrf           Create and map an empty segment.
+ * @param[in]       path ; const char* ; new file
+ * @param[in]       board ; unsigned ; board
+ * @param[in]       ch ; unsigned ; channel
+ * @param[in]       seq ; unsigned ; segment number
+ * @param[in]       cap ; uint64_t ; rows
+ * @param[in,out]   seg ; CS_SEG* ; mapped segment
+ * @retval          0 : done, -1 : file error
+ * @warning         -
+ * @remark          The file is sparse, pages are allocated as rows arrive.
+ *                  The magic is written last.
+ */
+static int cs_seg_create(CS_SEG* seg, const char* path, unsigned board, unsigned ch,
+                         unsigned seq, uint64_t cap)
+{
+	CS_HEAD head;
+	int     fd;
+
+	memset(&head, 0, sizeof(head));
+	cs_layout(&head, cap);
+	head.version = CS_VERSION;
+	head.board   = board;
+	head.ch      = ch;
+	head.seq     = seq;
+
+	fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if ((fd < 0) || (ftruncate(fd, (off_t)head.size) != 0))
+	{
+		perror(path);
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+		return -1;
+	}
+	seg->head = (CS_HEAD*)mmap(NULL, head.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if ((void*)seg->head == MAP_FAILED)
+	{
+		perror(path);
+		seg->head = NULL;
+		return -1;
+	}
+	memcpy(seg->head, &head, sizeof(head));
+	__atomic_store_n(&seg->head->magic, (uint32_t)CS_MAGIC, __ATOMIC_RELEASE);
+	seg->size = head.size;
+	seg->t    = (uint64_t*)((char*)seg->head + head.off_t);
+	seg->code = (uint8_t*)((char*)seg->head + head.off_code);
+	seg->val  = (int32_t*)((char*)seg->head + head.off_val);
+	seg->idx  = (CS_BLK*)((char*)seg->head + head.off_idx);
+	return 0;
+}
+
+/**
+ * @fn              int cs_seg_map(CS_SEG* seg, const char* path, int writable)
+ * @fid             [FID704]-[cs_seg_map]
+ * @fnbrf           Map an existing segment.
+ * @param[in]       path ; const char* ; segment file
+ * @param[in]       writable ; int ; 0 : read only
+ * @param[in,out]   seg ; CS_SEG* ; mapped segment
+ * @retval          0 : done, -1 : file error or not a segment
+ * @warning         -
+ * @remark          -
+ */
+int cs_seg_map(CS_SEG* seg, const char* path, int writable)
+{
+	struct stat st;
+	CS_HEAD     chk;
+	int         fd;
+
+	fd = open(path, writable ? O_RDWR : O_RDONLY);
+	if ((fd < 0) || (fstat(fd, &st) != 0) || ((size_t)st.st_size < CS_PAGE))
+	{
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+		return -1;
+	}
+	seg->head = (CS_HEAD*)mmap(NULL, (size_t)st.st_size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+	                           MAP_SHARED, fd, 0);
+	close(fd);
+	if ((void*)seg->head == MAP_FAILED)
+	{
+		seg->head = NULL;
+		return -1;
+	}
+	seg->size = (size_t)st.st_size;
+
+	memset(&chk, 0, sizeof(chk));
+	cs_layout(&chk, seg->head->cap);
+	if ((seg->head->magic != CS_MAGIC) || (seg->head->version != CS_VERSION) ||
+	    (seg->head->block_rows != CS_BLOCK_ROWS) || (seg->head->cap % CS_PAGE != 0) ||
+	    (seg->head->size != chk.size) || (seg->head->off_idx != chk.off_idx) ||
+	    (seg->head->size != (uint64_t)st.st_size) || (seg->head->rows > seg->head->cap))
+	{
+		munmap(seg->head, seg->size);
+		seg->head = NULL;
+		return -1;
+	}
+	seg->t    = (uint64_t*)((char*)seg->head + chk.off_t);
+	seg->code = (uint8_t*)((char*)seg->head + chk.off_code);
+	seg->val  = (int32_t*)((char*)seg->head + chk.off_val);
+	seg->idx  = (CS_BLK*)((char*)seg->head + chk.off_idx);
+	return 0;
+}
+
+/**
+ * @fn              void cs_seg_unmap(CS_SEG* seg)
+ * @fid             [FID705]-[cs_seg_unmap]
+ * @fnbrf           Unmap a segment.
+ * @param[in]       -
+ * @param[in,out]   seg ; CS_SEG* ; mapped segment
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+void cs_seg_unmap(CS_SEG* seg)
+{
+	if (seg->head != NULL)
+	{
+		munmap(seg->head, seg->size);
+		seg->head = NULL;
+	}
+}
+
+/**
+ * @fn              static CS_SEG* cs_seg_next(CS_STORE* st, unsigned board, unsigned ch)
+ * @fid             [FID706]-[cs_seg_next]
+ * @fnbrf           Segment that takes the next row of board/ch.
+ * @param[in]       board ; unsigned ; board
+ * @param[in]       ch ; unsigned ; channel
+ * @param[in,out]   st ; CS_STORE* ; store
+ * @retval          seg ; CS_SEG* ; NULL on error
+ * @warning         -
+ * @remark          First use after cs_open continues the last segment on disk,
+ *                  so a restarted ingest appends instead of overwriting.
+ */
+static CS_SEG* cs_seg_next(CS_STORE* st, unsigned board, unsigned ch)
+{
+	size_t   i    = (size_t)board * CS_CH_MAX + ch;
+	CS_SEG*  seg  = st->seg[i];
+	unsigned seq  = 0;
+	char     path[sizeof(st->dir) + 32];
+
+	if ((seg == NULL) || (seg->head == NULL))
+	{
+		if (seg == NULL)
+		{
+			seg = (CS_SEG*)calloc(1, sizeof(CS_SEG));
+			if (seg == NULL)
+			{
+				return NULL;
+			}
+			st->seg[i] = seg;
+		}
+		for (;;)
+		{
+			cs_seg_path(st, board, ch, seq + 1, path);
+			if (access(path, F_OK) != 0)
+			{
+				break;
+			}
+			seq++;
+		}
+		cs_seg_path(st, board, ch, seq, path);
+		if (access(path, F_OK) == 0)
+		{
+			if (cs_seg_map(seg, path, 1) != 0)
+			{
+				fprintf(stderr, "%s: not a segment\n", path);
+				return NULL;
+			}
+			if (seg->head->rows < seg->head->cap)
+			{
+				return seg;
+			}
+			cs_seg_unmap(seg);
+			seq++;
+		}
+	}
+	else
+	{
+		seq = seg->head->seq + 1;
+		cs_seg_unmap(seg);
+	}
+	cs_seg_path(st, board, ch, seq, path);
+	return (cs_seg_create(seg, path, board, ch, seq, st->seg_rows) == 0) ? seg : NULL;
+}
+
+/**
+ * @fn              int cs_open(CS_STORE* st, const char* dir, uint64_t seg_rows)
+ * @fid             [FID707]-[cs_open]
+ * @fnbrf           Open a store for appending.
+ * @param[in]       dir ; const char* ; directory, created if missing
+ * @param[in]       seg_rows ; uint64_t ; rows per new segment, power of 2
+ * @param[in,out]   st ; CS_STORE* ; store
+ * @retval          0 : done, -1 : bad argument or directory error
+ * @warning         -
+ * @remark          Segments are mapped on the first row of each board/ch.
+ */
+int cs_open(CS_STORE* st, const char* dir, uint64_t seg_rows)
+{
+	memset(st, 0, sizeof(*st));
+	if ((strlen(dir) >= sizeof(st->dir)) || (seg_rows < CS_SEG_ROWS_MIN) ||
+	    ((seg_rows & (seg_rows - 1)) != 0))
+	{
+		fprintf(stderr, "colstore: bad directory name or segment size\n");
+		return -1;
+	}
+	if ((mkdir(dir, 0755) != 0) && (access(dir, W_OK) != 0))
+	{
+		perror(dir);
+		return -1;
+	}
+	strcpy(st->dir, dir);
+	st->seg_rows = seg_rows;
+	return 0;
+}
+
+/**
+ * @fn              int cs_append(CS_STORE* st, unsigned board, unsigned ch, uint64_t t_ns, uint8_t code, int32_t val)
+ * @fid             [FID708]-[cs_append]
+ * @fnbrf           Append one row to board/ch.
+ * @param[in]       board ; unsigned ; board
+ * @param[in]       ch ; unsigned ; channel, < CS_CH_MAX
+ * @param[in]       t_ns ; uint64_t ; time, not less than the previous row
+ * @param[in]       code ; uint8_t ; raw A/D code
+ * @param[in]       val ; int32_t ; temperature, 0.01 degC
+ * @param[in,out]   st ; CS_STORE* ; store
+ * @retval          0 : done, -1 : no segment
+ * @warning         -
+ * @remark          Data and block index are written before rows is advanced.
+ */
+int cs_append(CS_STORE* st, unsigned board, unsigned ch, uint64_t t_ns,
+              uint8_t code, int32_t val)
+{
+	size_t   i = (size_t)board * CS_CH_MAX + ch;
+	CS_SEG*  seg;
+	CS_BLK*  blk;
+	uint64_t r;
+
+	if (i >= st->seg_num)
+	{
+		size_t   num = (i + 1 + CS_CH_MAX * 64);
+		CS_SEG** tbl = (CS_SEG**)realloc(st->seg, num * sizeof(CS_SEG*));
+
+		if (tbl == NULL)
+		{
+			return -1;
+		}
+		memset(&tbl[st->seg_num], 0, (num - st->seg_num) * sizeof(CS_SEG*));
+		st->seg     = tbl;
+		st->seg_num = num;
+	}
+	seg = st->seg[i];
+	if ((seg == NULL) || (seg->head == NULL) || (seg->head->rows == seg->head->cap))
+	{
+		seg = cs_seg_next(st, board, ch);
+		if (seg == NULL)
+		{
+			return -1;
+		}
+	}
+
+	r = seg->head->rows;
+	seg->t[r]    = t_ns;
+	seg->code[r] = code;
+	seg->val[r]  = val;
+	blk = &seg->idx[r / CS_BLOCK_ROWS];
+	if ((r % CS_BLOCK_ROWS) == 0)
+	{
+		blk->t_min = t_ns;
+		blk->v_min = val;
+		blk->v_max = val;
+		blk->c_min = code;
+		blk->c_max = code;
+	}
+	else
+	{
+		blk->v_min = (val < blk->v_min) ? val : blk->v_min;
+		blk->v_max = (val > blk->v_max) ? val : blk->v_max;
+		blk->c_min = (code < blk->c_min) ? code : blk->c_min;
+		blk->c_max = (code > blk->c_max) ? code : blk->c_max;
+	}
+	blk->t_max = t_ns;
+	__atomic_store_n(&seg->head->rows, r + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/**
+ * @fn              void cs_close(CS_STORE* st)
+ * @fid             [FID709]-[cs_close]
+ * @fnbrf           Unmap every segment of the store.
+ * @param[in]       -
+ * @param[in,out]   st ; CS_STORE* ; store
+ * @retval          -
+ * @warning         -
+ * @remark          Shared mappings are written back by the kernel, no msync.
+ */
+void cs_close(CS_STORE* st)
+{
+	size_t i;
+
+	for (i = 0; i < st->seg_num; i++)
+	{
+		if (st->seg[i] != NULL)
+		{
+			cs_seg_unmap(st->seg[i]);
+			free(st->seg[i]);
+		}
+	}
+	free(st->seg);
+	st->seg     = NULL;
+	st->seg_num = 0;
+}
+
+/**
+ * @fn              static size_t cs_lower(const CS_SEG* seg, size_t rows, uint64_t t)
+ * @fid             [FID710]-[cs_lower]
+ * @fnbrf           First row with time >= t.
+ * @param[in]       seg ; const CS_SEG* ; segment
+ * @param[in]       rows ; size_t ; committed rows
+ * @param[in]       t ; uint64_t ; time, ns
+ * @retval          row ; size_t ; rows if none
+ * @warning         -
+ * @remark          Binary search on the block index, then inside one block.
+ */
+static size_t cs_lower(const CS_SEG* seg, size_t rows, uint64_t t)
+{
+	size_t lo = 0;
+	size_t hi = (rows + CS_BLOCK_ROWS - 1) / CS_BLOCK_ROWS;
+	size_t mid;
+
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if (seg->idx[mid].t_max < t)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	hi = (lo + 1) * CS_BLOCK_ROWS;
+	hi = (hi < rows) ? hi : rows;
+	lo = lo * CS_BLOCK_ROWS;
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if (seg->t[mid] < t)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	return (lo < rows) ? lo : rows;
+}
+
+/**
+ * @fn              void cs_seg_range(const CS_SEG* seg, uint64_t t0, uint64_t t1, size_t* first, size_t* end)
+ * @fid             [FID711]-[cs_seg_range]
+ * @fnbrf           Rows of a time range.
+ * @param[in]       seg ; const CS_SEG* ; segment
+ * @param[in]       t0 ; uint64_t ; from, ns
+ * @param[in]       t1 ; uint64_t ; to, ns, inclusive
+ * @param[in,out]   first ; size_t* ; first row
+ * @param[in,out]   end ; size_t* ; row after the last
+ * @retval          -
+ * @warning         -
+ * @remark          Only the index and two blocks of the time column are read.
+ */
+void cs_seg_range(const CS_SEG* seg, uint64_t t0, uint64_t t1, size_t* first, size_t* end)
+{
+	size_t rows = (size_t)__atomic_load_n(&seg->head->rows, __ATOMIC_ACQUIRE);
+
+	*first = cs_lower(seg, rows, t0);
+	*end   = (t1 == UINT64_MAX) ? rows : cs_lower(seg, rows, t1 + 1);
+	*end   = (*end < *first) ? *first : *end;
+}
+
+/**
+ * @fn              void cs_blk_update(CS_SEG* seg, size_t blk)
+ * @fid             [FID712]-[cs_blk_update]
+ * @fnbrf           Recompute the value and code min/max of one block.
+ * @param[in]       blk ; size_t ; block number
+ * @param[in,out]   seg ; CS_SEG* ; writable segment
+ * @retval          -
+ * @warning         -
+ * @remark          After the value column was rewritten.
+ */
+void cs_blk_update(CS_SEG* seg, size_t blk)
+{
+	size_t  r   = blk * CS_BLOCK_ROWS;
+	size_t  end = r + CS_BLOCK_ROWS;
+	CS_BLK* b   = &seg->idx[blk];
+
+	end = (end < seg->head->rows) ? end : seg->head->rows;
+	if (r >= end)
+	{
+		return;
+	}
+	b->v_min = b->v_max = seg->val[r];
+	b->c_min = b->c_max = seg->code[r];
+	for (r++; r < end; r++)
+	{
+		b->v_min = (seg->val[r] < b->v_min) ? seg->val[r] : b->v_min;
+		b->v_max = (seg->val[r] > b->v_max) ? seg->val[r] : b->v_max;
+		b->c_min = (seg->code[r] < b->c_min) ? seg->code[r] : b->c_min;
+		b->c_max = (seg->code[r] > b->c_max) ? seg->code[r] : b->c_max;
+	}
+}
+
+/**
+ * @fn              uint8_t cs_code_near(const long* table, int32_t val)
+ * @fid             [FID713]-[cs_code_near]
+ * @fnbrf           A/D code whose table value is nearest to val.
+ * @param[in]       table ; const long* ; CS_TABLE_SIZE entries, increasing
+ * @param[in]       val ; int32_t ; temperature, 0.01 degC
+ * @param[in,out]   -
+ * @retval          code ; uint8_t ; raw A/D code
+ * @warning         -
+ * @remark          Recovers the code of a text record. Exact for PREC 2 and
+ *                  above, nearest for coarser precision.
+ */
+uint8_t cs_code_near(const long* table, int32_t val)
+{
+	unsigned lo = 0;
+	unsigned hi = CS_TABLE_SIZE - 1;
+	unsigned mid;
+
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if (table[mid] < val)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	if ((lo > 0) && ((long)val - table[lo - 1] < table[lo] - (long)val))
+	{
+		lo--;
+	}
+	return (uint8_t)lo;
+}
+
+/**
+ * @fn              int cs_table_load(const char* path, long* table)
+ * @fid             [FID714]-[cs_table_load]
+ * @fnbrf           Read a conversion table file.
+ * @param[in]       path ; const char* ; CS_TABLE_SIZE integers, 0.01 degC,
+ *                  separated by white space or commas, '#' starts a comment
+ * @param[in,out]   table ; long* ; CS_TABLE_SIZE entries
+ * @retval          0 : done, -1 : file error or wrong count
+ * @warning         -
+ * @remark          Same layout as adc_table in 02_mapping_calculation.c.
+ */
+int cs_table_load(const char* path, long* table)
+{
+	FILE*    fp = fopen(path, "r");
+	unsigned n  = 0;
+	int      c;
+
+	if (fp == NULL)
+	{
+		perror(path);
+		return -1;
+	}
+	while ((c = fgetc(fp)) != EOF)
+	{
+		if (c == '#')
+		{
+			while ((c != EOF) && (c != '\n'))
+			{
+				c = fgetc(fp);
+			}
+		}
+		else if ((c == '-') || ((c >= '0') && (c <= '9')))
+		{
+			ungetc(c, fp);
+			if ((n == CS_TABLE_SIZE) || (fscanf(fp, "%ld", &table[n]) != 1))
+			{
+				n = CS_TABLE_SIZE + 1;
+				break;
+			}
+			n++;
+		}
+	}
+	fclose(fp);
+	if (n != CS_TABLE_SIZE)
+	{
+		fprintf(stderr, "%s: need %d values\n", path, CS_TABLE_SIZE);
+		return -1;
+	}
+	return 0;
+}
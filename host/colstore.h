@@ -0,0 +1,111 @@
+/**
+ * @file       colstore.h
+ * @brief      [MID109]-[colstore]
+ * @details    Columnar on-disk store for ingested samples.
+ * @details    One append-only segment file per board and channel,
+ * @details    "<dir>/b<board>_c<ch>_<seq>.seg", memory mapped:
+ * @details      CS_HEAD (one page)
+ * @details      t    : uint64_t[cap] host receive time, ns, non-decreasing
+ * @details      code : uint8_t[cap]  raw A/D code
+ * @details      val  : int32_t[cap]  temperature, 0.01 degC (adc_table unit)
+ * @details      idx  : CS_BLK[cap / CS_BLOCK_ROWS] min/max of each block
+ * @details    Every column is contiguous and page aligned. A segment is created
+ * @details    sparse at full capacity, and a new one is started when it is full.
+ * @details    Rows are published by CS_HEAD.rows after their data and index.
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+#ifndef COLSTORE_H
+#define COLSTORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Data definition
+ */
+#define CS_MAGIC            (0x5343554BUL)  /* "KUCS"                     */
+#define CS_VERSION          (1)
+#define CS_PAGE             (4096)
+#define CS_BLOCK_ROWS       (1024)          /* rows per index entry       */
+#define CS_SEG_ROWS_MIN     (CS_PAGE)
+#define CS_SEG_ROWS_DEFAULT (1UL << 18)
+#define CS_CH_MAX           (6)
+#define CS_TABLE_SIZE       (256)
+
+/**
+ * Segment header, first page of the file
+ */
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t board;
+	uint32_t ch;
+	uint32_t seq;                     /* segment number of board/ch          */
+	uint32_t block_rows;
+	uint64_t cap;                     /* rows                                */
+	uint64_t rows;                    /* committed rows                      */
+	uint64_t off_t;                   /* column offsets in bytes             */
+	uint64_t off_code;
+	uint64_t off_val;
+	uint64_t off_idx;
+	uint64_t size;                    /* file size                           */
+} CS_HEAD;
+
+/**
+ * Block index entry
+ */
+typedef struct
+{
+	uint64_t t_min;
+	uint64_t t_max;
+	int32_t  v_min;
+	int32_t  v_max;
+	uint8_t  c_min;
+	uint8_t  c_max;
+	uint8_t  pad[6];
+} CS_BLK;
+
+/**
+ * Mapped segment
+ */
+typedef struct
+{
+	CS_HEAD*  head;
+	uint64_t* t;
+	uint8_t*  code;
+	int32_t*  val;
+	CS_BLK*   idx;
+	size_t    size;
+} CS_SEG;
+
+/**
+ * Writer
+ */
+typedef struct
+{
+	char      dir[256];
+	uint64_t  seg_rows;
+	CS_SEG**  seg;                    /* [board * CS_CH_MAX + ch]            */
+	size_t    seg_num;
+} CS_STORE;
+
+/**
+ * Function declaration
+ */
+int     cs_open(CS_STORE* st, const char* dir, uint64_t seg_rows);
+int     cs_append(CS_STORE* st, unsigned board, unsigned ch, uint64_t t_ns,
+                  uint8_t code, int32_t val);
+void    cs_close(CS_STORE* st);
+int     cs_seg_map(CS_SEG* seg, const char* path, int writable);
+void    cs_seg_unmap(CS_SEG* seg);
+void    cs_seg_range(const CS_SEG* seg, uint64_t t0, uint64_t t1,
+                     size_t* first, size_t* end);
+void    cs_blk_update(CS_SEG* seg, size_t blk);
+uint8_t cs_code_near(const long* table, int32_t val);
+int     cs_table_load(const char* path, long* table);
+
+#endif /* COLSTORE_H */
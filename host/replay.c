@@ -0,0 +1,251 @@
+/**
+ * @file       replay.c
+ * @brief      [MID103]-[replay]
+ * @details    Host record/replay harness: streams a recorded A/D code file through
+ * @details    the conversion and text formatting code of 02_mapping_calculation.c,
+ * @details    compiled for the host, and reports the throughput.
+ * @details    Build : make replay, or
+ * @details            gcc -O2 -Ihost -o replay host/replay.c host/sim_stub.c com62p.c hal62p.c
+ * @details    Usage : replay [-m ch_mask] [-p prec] [-d deadband] [-T ns] [-n repeat]
+ * @details                   [-o out] record
+ * @details    record : raw 8-bit A/D codes, one byte per channel of ch_mask in
+ * @details    channel order, samples back to back (memory mapped, read only).
+ * @details    The output is the byte stream the firmware sends for the same codes
+ * @details    with FMT TXT, CH ch_mask, PREC prec, DB deadband; -T is the
+ * @details    processing time printed in the time stamp field.
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+
+/**
+ * Include file
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * The firmware is compiled into this file so that its static conversion
+ * and formatting functions are used as they are. Its main() is fw_main(),
+ * register access goes to sim_stub.c.
+ */
+#include "../02_mapping_calculation.c"
+#undef main
+
+/**
+ * Data definition
+ */
+#define REPLAY_OUT_SIZE     (1UL << 20)   /* output buffer flushed when full */
+
+/**
+ * @fn              static double replay_now(void)
+ * @fid             [FID201]-[replay_now]
+ * @fnbrf           Monotonic time in seconds.
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          t ; double ; seconds
+ * @warning         -
+ * @remark          -
+ */
+static double replay_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @fn              int main(int argc, char** argv)
+ * @fid             [FID202]-[main]
+ * @fnbrf           Parse options, map the record and replay it.
+ * @param[in]       argc ; int ; argument count
+ * @param[in]       argv ; char** ; arguments
+ * @param[in,out]   -
+ * @retval          0 : done, 1 : usage or file error
+ * @warning         -
+ * @remark          Samples inside the deadband produce no output, as on target.
+ */
+int main(int argc, char** argv)
+{
+	const char*    path     = NULL;
+	const char*    out_path = NULL;
+	unsigned long  mask     = 1UL << ADC_CH0;
+	long           prec     = OUT_PREC_DEFAULT;
+	long           deadband = 0;
+	unsigned long long pro_ns = 0;
+	unsigned long  repeat   = 1;
+	unsigned int   ch_list[ADC_CH_MAX];
+	unsigned int   ch_num   = 0;
+	FILE*          out      = NULL;
+	char*          obuf     = NULL;
+	size_t         olen     = 0;
+	unsigned long long out_bytes = 0;
+	unsigned long long samples   = 0;
+	unsigned long long lines     = 0;
+	const unsigned char* rec;
+	struct stat    st;
+	size_t         rec_samples;
+	size_t         n;
+	unsigned long  r;
+	unsigned int   c;
+	s4             s4_temp[ADC_CH_MAX] = { 0 };
+	double         t0;
+	double         dt;
+	int            fd;
+	int            i;
+
+	for (i = 1; i < argc - 1; i += 2)
+	{
+		const char* arg = argv[i + 1];
+
+		if (strcmp(argv[i], "-m") == 0)
+		{
+			mask = strtoul(arg, NULL, 0);
+		}
+		else if (strcmp(argv[i], "-p") == 0)
+		{
+			prec = atol(arg);
+		}
+		else if (strcmp(argv[i], "-d") == 0)
+		{
+			deadband = atol(arg);
+		}
+		else if (strcmp(argv[i], "-T") == 0)
+		{
+			pro_ns = strtoull(arg, NULL, 0);
+		}
+		else if (strcmp(argv[i], "-n") == 0)
+		{
+			repeat = strtoul(arg, NULL, 0);
+		}
+		else if (strcmp(argv[i], "-o") == 0)
+		{
+			out_path = arg;
+		}
+		else
+		{
+			break;
+		}
+	}
+	if ((i != argc - 1) || (mask == 0) || (mask >= (1UL << ADC_CH_MAX)) ||
+	    (prec < 0) || (prec > OUT_PREC_MAX) || (deadband < 0) || (repeat == 0))
+	{
+		fprintf(stderr, "usage: %s [-m ch_mask] [-p prec] [-d deadband] [-T ns] [-n repeat] [-o out] record\n", argv[0]);
+		return 1;
+	}
+	path = argv[i];
+
+	/* Map the record */
+	fd = open(path, O_RDONLY);
+	if ((fd < 0) || (fstat(fd, &st) != 0))
+	{
+		perror(path);
+		return 1;
+	}
+	for (c = 0; c < ADC_CH_MAX; c++)
+	{
+		if ((mask >> c) & 1UL)
+		{
+			ch_list[ch_num++] = c;
+		}
+	}
+	rec_samples = (size_t)st.st_size / ch_num;
+	if (rec_samples == 0)
+	{
+		fprintf(stderr, "%s: no complete sample\n", path);
+		return 1;
+	}
+	rec = (const unsigned char*)mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (rec == MAP_FAILED)
+	{
+		perror(path);
+		return 1;
+	}
+	(void)posix_madvise((void*)rec, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+	close(fd);
+
+	if (out_path != NULL)
+	{
+		out = fopen(out_path, "wb");
+		if (out == NULL)
+		{
+			perror(out_path);
+			return 1;
+		}
+	}
+	obuf = (char*)malloc(REPLAY_OUT_SIZE);
+	if (obuf == NULL)
+	{
+		perror("malloc");
+		return 1;
+	}
+
+	/* Same setting as the commands CH, PREC, DB */
+	st_cfg.u1_ch_mask   = (u1)mask;
+	st_cfg.s2_precision = (s2)prec;
+	st_cfg.s4_deadband  = (s4)deadband;
+	out_line_build();
+
+	t0 = replay_now();
+	for (r = 0; r < repeat; r++)
+	{
+		const unsigned char* p = rec;
+
+		for (n = 0; n < rec_samples; n++)
+		{
+			for (c = 0; c < ch_num; c++)
+			{
+				s4_temp[ch_list[c]] = s2g_glmap1b_s2pt(p[c], &adc_table[0]);
+			}
+			p += ch_num;
+			samples++;
+
+			if (out_deadband(s4_temp) != 0)
+			{
+				continue;
+			}
+			out_line_fill(st_out_line.s1_line, s4_temp, pro_ns);
+			if (olen + st_out_line.u1_len > REPLAY_OUT_SIZE)
+			{
+				if (out != NULL)
+				{
+					fwrite(obuf, 1, olen, out);
+				}
+				olen = 0;
+			}
+			memcpy(&obuf[olen], st_out_line.s1_line, st_out_line.u1_len);
+			olen      += st_out_line.u1_len;
+			out_bytes += st_out_line.u1_len;
+			lines++;
+		}
+	}
+	if ((out != NULL) && (olen != 0))
+	{
+		fwrite(obuf, 1, olen, out);
+	}
+	dt = replay_now() - t0;
+
+	if (out != NULL)
+	{
+		fclose(out);
+	}
+	munmap((void*)rec, (size_t)st.st_size);
+	free(obuf);
+
+	fprintf(stderr, "replay: %llu samples x %u ch, %llu lines, %llu bytes in %.3f s\n",
+	        samples, ch_num, lines, out_bytes, dt);
+	fprintf(stderr, "replay: %.0f samples/s, %.2f bytes/sample, %.1f MB/s output\n",
+	        (dt > 0.0) ? (double)samples / dt : 0.0,
+	        (samples != 0) ? (double)out_bytes / (double)samples : 0.0,
+	        (dt > 0.0) ? (double)out_bytes / dt / 1e6 : 0.0);
+	return 0;
+}
@@ -0,0 +1,256 @@
+/**
+ * @file       sfr62p.h
+ * @brief      [MID101]-[sfr62p host model]
+ * @details    Host stand-in for the NC30 sfr62p.h special function register header.
+ * @details    Every register access goes through sim_sfr(), which advances the
+ * @details    peripheral model in sim62p.c, so the firmware sources compile and
+ * @details    run unchanged on the host:
+ * @details      gcc -O2 -Ihost -o sim02 02_mapping_calculation.c com62p.c hal62p.c host/sim62p.c
+ * @details    Data flash block A is memory, not a register : the firmware reads and
+ * @details    writes it with DFLASH_RD / DFLASH_WR, which map to sim_dflash_rd() and
+ * @details    sim_dflash_wr() here and to plain word accesses on the target.
+ * @details    DMA0 source and destination are host addresses, set with DMA0_SRC /
+ * @details    DMA0_DST, which write SAR0 / DAR0 on the target.
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+#ifndef SFR62P_H
+#define SFR62P_H
+
+/**
+ * Register storage, one 16 bit cell per register or bit
+ */
+typedef volatile unsigned short SIM_REG;
+
+typedef struct
+{
+	SIM_REG mr;      /* TAiMR mode register                 */
+	SIM_REG cnt;     /* TAi counter / reload register       */
+	SIM_REG s;       /* TAiS start flag (tabsr)             */
+	SIM_REG ic;      /* TAiIC interrupt control register    */
+	SIM_REG ir;      /* IR bit of TAiIC                     */
+} SIM_TA;
+
+typedef struct
+{
+	SIM_REG mr;      /* UiMR mode register                  */
+	SIM_REG c0;      /* UiC0 control register 0             */
+	SIM_REG brg;     /* UiBRG bit rate generator            */
+	SIM_REG tb;      /* UiTB transmit buffer                */
+	SIM_REG rb;      /* UiRB receive buffer                 */
+	SIM_REG te;      /* TE bit of UiC1                      */
+	SIM_REG ti;      /* TI bit of UiC1                      */
+	SIM_REG re;      /* RE bit of UiC1                      */
+	SIM_REG ri;      /* RI bit of UiC1                      */
+	SIM_REG irs;     /* UiIRS bit of UCON                   */
+	SIM_REG tic;     /* SiTIC interrupt control register    */
+	SIM_REG tir;     /* IR bit of SiTIC                     */
+	SIM_REG ric;     /* SiRIC interrupt control register    */
+	SIM_REG rir;     /* IR bit of SiRIC                     */
+} SIM_UART;
+
+typedef struct
+{
+	SIM_REG sl;      /* DMiSL request cause select          */
+	SIM_REG con;     /* DMiCON control register             */
+	SIM_REG tcr;     /* TCRi transfer counter               */
+	SIM_REG ic;      /* DMiIC interrupt control register    */
+	SIM_REG ir;      /* IR bit of DMiIC                     */
+} SIM_DMA;
+
+typedef struct
+{
+	SIM_REG p7;
+	SIM_REG pd7;
+	SIM_REG p7_0;
+	SIM_REG adcon0;
+	SIM_REG adcon1;
+	SIM_REG adcon2;
+	SIM_REG adst;
+	SIM_REG ad[8];
+	SIM_REG adic;
+	SIM_REG adir;
+	SIM_TA  ta[5];
+	SIM_REG trgsr;
+	SIM_REG udf;
+	SIM_UART u[3];
+	SIM_DMA dma[1];  /* DMA0, DMA1 is not modelled         */
+	SIM_REG prc1;    /* PRC1 bit of PRCR                    */
+	SIM_REG pm10;    /* PM10 bit of PM1, data flash enable  */
+	SIM_REG fmr00;   /* RY/BY status bit of FMR0            */
+	SIM_REG fmr01;   /* CPU rewrite mode select bit of FMR0 */
+	SIM_REG fmr06;   /* program status bit of FMR0          */
+	SIM_REG fmr07;   /* erase status bit of FMR0            */
+	SIM_REG fmr11;   /* EW1 mode select bit of FMR1         */
+} SIM_SFR;
+
+extern SIM_SFR sim_reg;
+
+SIM_REG* sim_sfr(SIM_REG* reg);
+void     sim_asm(const char* code);
+unsigned short sim_dflash_rd(unsigned int idx);
+void     sim_dflash_wr(unsigned int idx, unsigned short data);
+void     sim_dma_src(int i, const volatile void* src);
+void     sim_dma_dst(int i, volatile void* dst);
+
+#define SIM_SFR_REG(r)      (*sim_sfr(&sim_reg.r))
+
+/*
+ * sim62p.c defines SIM62P_IMPL and works on sim_reg directly.
+ */
+#ifndef SIM62P_IMPL
+
+/**
+ * Port P7
+ */
+#define p7                  SIM_SFR_REG(p7)
+#define pd7                 SIM_SFR_REG(pd7)
+#define p7_0                SIM_SFR_REG(p7_0)
+
+/**
+ * A/D converter
+ */
+#define adcon0              SIM_SFR_REG(adcon0)
+#define adcon1              SIM_SFR_REG(adcon1)
+#define adcon2              SIM_SFR_REG(adcon2)
+#define adst                SIM_SFR_REG(adst)
+#define ad0                 SIM_SFR_REG(ad[0])
+#define ad1                 SIM_SFR_REG(ad[1])
+#define ad2                 SIM_SFR_REG(ad[2])
+#define ad3                 SIM_SFR_REG(ad[3])
+#define ad4                 SIM_SFR_REG(ad[4])
+#define ad5                 SIM_SFR_REG(ad[5])
+#define ad6                 SIM_SFR_REG(ad[6])
+#define ad7                 SIM_SFR_REG(ad[7])
+#define adic                SIM_SFR_REG(adic)
+#define ir_adic             SIM_SFR_REG(adir)
+
+/**
+ * Timer A0 - A4
+ */
+#define ta0mr               SIM_SFR_REG(ta[0].mr)
+#define ta1mr               SIM_SFR_REG(ta[1].mr)
+#define ta2mr               SIM_SFR_REG(ta[2].mr)
+#define ta3mr               SIM_SFR_REG(ta[3].mr)
+#define ta4mr               SIM_SFR_REG(ta[4].mr)
+#define ta0                 SIM_SFR_REG(ta[0].cnt)
+#define ta1                 SIM_SFR_REG(ta[1].cnt)
+#define ta2                 SIM_SFR_REG(ta[2].cnt)
+#define ta3                 SIM_SFR_REG(ta[3].cnt)
+#define ta4                 SIM_SFR_REG(ta[4].cnt)
+#define ta0s                SIM_SFR_REG(ta[0].s)
+#define ta1s                SIM_SFR_REG(ta[1].s)
+#define ta2s                SIM_SFR_REG(ta[2].s)
+#define ta3s                SIM_SFR_REG(ta[3].s)
+#define ta4s                SIM_SFR_REG(ta[4].s)
+#define ta0ic               SIM_SFR_REG(ta[0].ic)
+#define ta1ic               SIM_SFR_REG(ta[1].ic)
+#define ta2ic               SIM_SFR_REG(ta[2].ic)
+#define ta3ic               SIM_SFR_REG(ta[3].ic)
+#define ta4ic               SIM_SFR_REG(ta[4].ic)
+#define ir_ta0ic            SIM_SFR_REG(ta[0].ir)
+#define ir_ta1ic            SIM_SFR_REG(ta[1].ir)
+#define ir_ta2ic            SIM_SFR_REG(ta[2].ir)
+#define ir_ta3ic            SIM_SFR_REG(ta[3].ir)
+#define ir_ta4ic            SIM_SFR_REG(ta[4].ir)
+#define trgsr               SIM_SFR_REG(trgsr)
+#define udf                 SIM_SFR_REG(udf)
+
+/**
+ * UART0 - UART2
+ */
+#define u0mr                SIM_SFR_REG(u[0].mr)
+#define u0c0                SIM_SFR_REG(u[0].c0)
+#define u0brg               SIM_SFR_REG(u[0].brg)
+#define u0tb                SIM_SFR_REG(u[0].tb)
+#define u0rb                SIM_SFR_REG(u[0].rb)
+#define te_u0c1             SIM_SFR_REG(u[0].te)
+#define ti_u0c1             SIM_SFR_REG(u[0].ti)
+#define re_u0c1             SIM_SFR_REG(u[0].re)
+#define ri_u0c1             SIM_SFR_REG(u[0].ri)
+#define u0irs               SIM_SFR_REG(u[0].irs)
+#define s0tic               SIM_SFR_REG(u[0].tic)
+#define ir_s0tic            SIM_SFR_REG(u[0].tir)
+#define s0ric               SIM_SFR_REG(u[0].ric)
+#define ir_s0ric            SIM_SFR_REG(u[0].rir)
+#define u1mr                SIM_SFR_REG(u[1].mr)
+#define u1c0                SIM_SFR_REG(u[1].c0)
+#define u1brg               SIM_SFR_REG(u[1].brg)
+#define u1tb                SIM_SFR_REG(u[1].tb)
+#define u1rb                SIM_SFR_REG(u[1].rb)
+#define te_u1c1             SIM_SFR_REG(u[1].te)
+#define ti_u1c1             SIM_SFR_REG(u[1].ti)
+#define re_u1c1             SIM_SFR_REG(u[1].re)
+#define ri_u1c1             SIM_SFR_REG(u[1].ri)
+#define u1irs               SIM_SFR_REG(u[1].irs)
+#define s1tic               SIM_SFR_REG(u[1].tic)
+#define ir_s1tic            SIM_SFR_REG(u[1].tir)
+#define s1ric               SIM_SFR_REG(u[1].ric)
+#define ir_s1ric            SIM_SFR_REG(u[1].rir)
+#define u2mr                SIM_SFR_REG(u[2].mr)
+#define u2c0                SIM_SFR_REG(u[2].c0)
+#define u2brg               SIM_SFR_REG(u[2].brg)
+#define u2tb                SIM_SFR_REG(u[2].tb)
+#define u2rb                SIM_SFR_REG(u[2].rb)
+#define te_u2c1             SIM_SFR_REG(u[2].te)
+#define ti_u2c1             SIM_SFR_REG(u[2].ti)
+#define re_u2c1             SIM_SFR_REG(u[2].re)
+#define ri_u2c1             SIM_SFR_REG(u[2].ri)
+#define u2irs               SIM_SFR_REG(u[2].irs)
+#define s2tic               SIM_SFR_REG(u[2].tic)
+#define ir_s2tic            SIM_SFR_REG(u[2].tir)
+#define s2ric               SIM_SFR_REG(u[2].ric)
+#define ir_s2ric            SIM_SFR_REG(u[2].rir)
+
+/**
+ * DMA0, SAR0 / DAR0 hold host addresses : DMA0_SRC / DMA0_DST
+ */
+#define dm0sl               SIM_SFR_REG(dma[0].sl)
+#define dm0con              SIM_SFR_REG(dma[0].con)
+#define tcr0                SIM_SFR_REG(dma[0].tcr)
+#define dm0ic               SIM_SFR_REG(dma[0].ic)
+#define ir_dm0ic            SIM_SFR_REG(dma[0].ir)
+#define DMA0_SRC(p)         sim_dma_src(0, (p))
+#define DMA0_DST(p)         sim_dma_dst(0, (p))
+
+/**
+ * Protection, processor mode and flash memory control
+ */
+#define prc1                SIM_SFR_REG(prc1)
+#define pm10                SIM_SFR_REG(pm10)
+#define fmr00               SIM_SFR_REG(fmr00)
+#define fmr01               SIM_SFR_REG(fmr01)
+#define fmr06               SIM_SFR_REG(fmr06)
+#define fmr07               SIM_SFR_REG(fmr07)
+#define fmr11               SIM_SFR_REG(fmr11)
+
+/**
+ * Data flash block A, word index from 0F000h
+ */
+#define DFLASH_RD(i)        sim_dflash_rd(i)
+#define DFLASH_WR(i, d)     sim_dflash_wr((i), (d))
+
+/**
+ * User stack of stack_paint() : the firmware runs on the host stack, host
+ * frames are larger and the interrupt functions are called on it too
+ */
+#define STACK_SIZE          (32768)
+#define STACK_GUARD         (256)   /* includes the x86-64 red zone       */
+
+/**
+ * NC30 language extensions
+ */
+#define _asm(code)          sim_asm(code)
+#define _far
+#define _near
+
+/*
+ * The firmware main() becomes fw_main(), called by the simulator main().
+ */
+#define main                fw_main
+
+#endif /* SIM62P_IMPL */
+
+#endif /* SFR62P_H */
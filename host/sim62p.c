@@ -0,0 +1,1890 @@
+/**
+ * @file       sim62p.c
+ * @brief      [MID102]-[sim62p]
+ * @details    Host peripheral model of the M16C/62P used by the firmware:
+ * @details    Timer A0-A4, A/D converter, UART0-2, DMA0 (UART transmit request),
+ * @details    interrupt controller, WAIT, data flash block A (EW1 mode program / erase).
+ * @details    Time is counted in f1 cycles (6 MHz). Peripheral timing is modelled,
+ * @details    instruction timing is not: every register access costs SIM_ACCESS_CYCLES.
+ * @details    Build : make sim02, or
+ * @details            gcc -O2 -Ihost -o sim02 02_mapping_calculation.c com62p.c hal62p.c host/sim62p.c
+ * @details    Usage : sim02 [-t ms] [-a adc_feed] [-p row_ms] [-o out] [-s sample_log]
+ * @details                  [-r rx_script] [-F dflash_image] [-y ping_ms[,ppm[,offset_ms[,jump_ms,jump_s]]]]
+ * @details                  [-o0 uart0_out] [-o2 uart2_out]
+ * @details    -o is the UART1 output (stdout without it), -o0 / -o2 those of
+ * @details    UART0 / UART2 (striped frames, not kept without them).
+ * @details    rx_script lines "<ms> <text>" are received by UART1 from <ms> on,
+ * @details    at the current UART1 bit rate, each followed by '\n'.
+ * @details    -y sends "SYNC sec us" to UART1 every ping_ms while it receives
+ * @details    nothing else, with the time of a host clock running ppm fast from
+ * @details    offset_ms, stepped by jump_s seconds at jump_ms. The "Sync : sec.us" field of every UART1 line is compared
+ * @details    with the host clock at the end of its A/D sweep.
+ * @details    dflash_image holds block A (4 KB) between runs, loaded at start when
+ * @details    it exists and written back at the end. Without it block A starts erased.
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+
+/**
+ * Include file
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#define SIM62P_IMPL
+#include "sfr62p.h"
+
+/**
+ * Data definition
+ */
+#define SIM_F1_HZ           (6000000UL)
+#define SIM_ACCESS_CYCLES   (1)       /* cost of one register access        */
+#define SIM_NOP_CYCLES      (1)       /* cost of _asm("NOP")                */
+#define SIM_IRQ_CYCLES      (20)      /* interrupt sequence                 */
+#define SIM_REIT_CYCLES     (6)       /* REIT instruction                   */
+#define SIM_TB_EMPTY        (0x8000)  /* UiTB marker : no pending write     */
+#define SIM_NEVER           (~0ULL)
+#define SIM_ADC_CH_MAX      (8)
+#define SIM_TA_MAX          (5)
+#define SIM_UART_MAX        (3)
+#define SIM_RB_OER          (0x1000)  /* UiRB overrun error bit             */
+#define SIM_DF_WORDS        (2048)    /* data flash block A, 4 KB           */
+#define SIM_DF_PROG_CYCLES  (150)     /* word program, 25 us                */
+#define SIM_DF_ERASE_CYCLES (1800000) /* block erase, 0.3 s                 */
+#define SIM_DF_READ         (0xFF)    /* read array command                 */
+#define SIM_DF_STATUS       (0x70)    /* read status register command       */
+#define SIM_DF_CLEAR        (0x50)    /* clear status register command      */
+#define SIM_DF_PROGRAM      (0x40)    /* program command                    */
+#define SIM_DF_ERASE        (0x20)    /* block erase command, then 0xD0     */
+#define SIM_DF_CONFIRM      (0xD0)
+#define SIM_DMA_MAX         (1)       /* DMA0                               */
+#define SIM_DMA_8BIT        (0x01)    /* DMiCON DMBIT                       */
+#define SIM_DMA_REPEAT      (0x02)    /* DMiCON DMASL                       */
+#define SIM_DMA_ENABLE      (0x08)    /* DMiCON DMAE                        */
+#define SIM_DMA_SRC_INC     (0x10)    /* DMiCON DSD                         */
+#define SIM_DMA_DST_INC     (0x20)    /* DMiCON DAD                         */
+#define SIM_SYNC_SWEEPS     (64)      /* A/D sweep ends kept for matching   */
+#define SIM_SYNC_SETTLE     (4)       /* pings before the settled statistic */
+#define SIM_SYNC_LINE_MAX   (256)
+
+typedef unsigned long long SIM_TIME;
+
+typedef void (*SIM_ISR)(void);
+
+/**
+ * DMiSL DSEL of UART0-2 transmit, DMA0
+ */
+static const int dma_cause_tx[3] = { 0x0A, 0x0F, 0x0C };
+
+/**
+ * Interrupt handlers of the firmware, resolved when the firmware defines them
+ */
+extern void ta0_isr(void) __attribute__((weak));
+extern void ta1_isr(void) __attribute__((weak));
+extern void ta2_isr(void) __attribute__((weak));
+extern void ta3_isr(void) __attribute__((weak));
+extern void ta4_isr(void) __attribute__((weak));
+extern void ad_isr(void) __attribute__((weak));
+extern void uart0_tx_isr(void) __attribute__((weak));
+extern void uart0_rx_isr(void) __attribute__((weak));
+extern void uart1_tx_isr(void) __attribute__((weak));
+extern void uart1_rx_isr(void) __attribute__((weak));
+extern void uart2_tx_isr(void) __attribute__((weak));
+extern void uart2_rx_isr(void) __attribute__((weak));
+extern void dma0_isr(void) __attribute__((weak));
+extern void fw_main(void);
+
+/**
+ * Peripheral state
+ */
+typedef struct
+{
+	unsigned short reload;
+	SIM_TIME       phase;    /* cycles since last count */
+} SIM_TA_STATE;
+
+typedef struct
+{
+	int            busy;
+	SIM_TIME       done_at;
+	SIM_TIME       duration;
+} SIM_ADC_STATE;
+
+typedef struct
+{
+	int            shift_busy;
+	SIM_TIME       shift_done;
+	unsigned short shift_byte;
+	int            buf_full;
+	unsigned short buf_byte;
+	FILE*          out;
+	unsigned long  bytes;
+	unsigned long  lines;
+	SIM_TIME       first_byte;
+	SIM_TIME       last_byte;
+	unsigned long  tx_irqs;   /* transmit interrupts accepted */
+	/* receive script */
+	unsigned char* rx_data;
+	SIM_TIME*      rx_at;     /* earliest arrival of each byte */
+	unsigned long  rx_len;
+	unsigned long  rx_pos;
+	SIM_TIME       rx_next;
+	unsigned long  rx_overrun;
+} SIM_UART_STATE;
+
+typedef struct
+{
+	const volatile unsigned char* src;  /* SAR */
+	volatile void* dst;       /* DAR, a UiTB cell or memory */
+	unsigned long  transfers;
+	unsigned long  blocks;    /* transfer counter underflows */
+	unsigned long  irqs;
+} SIM_DMA_STATE;
+
+typedef struct
+{
+	unsigned short mem[SIM_DF_WORDS];
+	int            cmd;       /* SIM_DF_READ, STATUS, PROGRAM or ERASE pending */
+	const char*    path;
+	unsigned long  programs;
+	unsigned long  erases;
+	unsigned long  errors;
+} SIM_DF_STATE;
+
+typedef struct
+{
+	SIM_TIME       period;    /* 0 : no pings */
+	SIM_TIME       next;
+	double         rate;      /* host seconds per second */
+	double         offset;    /* host seconds at 0 */
+	SIM_TIME       jump_at;   /* 0 : no host clock step */
+	double         jump;      /* host seconds added from jump_at */
+	unsigned long  pings;
+	SIM_TIME       sweep[SIM_SYNC_SWEEPS];
+	unsigned long  sweeps;
+	char           line[SIM_SYNC_LINE_MAX];
+	size_t         len;
+	unsigned long  stamps;
+	double         err_sum;
+	double         err_max;
+	unsigned long  settled;   /* stamps after SIM_SYNC_SETTLE pings */
+	double         settled_sum;
+	double         settled_max;
+} SIM_SYNC_STATE;
+
+typedef struct
+{
+	SIM_TIME       now;
+	SIM_TIME       limit;
+	SIM_TIME       wait_cycles;
+	int            ien;       /* I flag       */
+	int            in_isr;
+	SIM_TA_STATE   ta[SIM_TA_MAX];
+	SIM_ADC_STATE  adc;
+	SIM_UART_STATE u[SIM_UART_MAX];
+	SIM_DMA_STATE  dma[SIM_DMA_MAX];
+	SIM_DF_STATE   df;
+	SIM_SYNC_STATE sync;
+	/* A/D feed */
+	unsigned char* feed;
+	unsigned long  feed_rows;
+	unsigned int   feed_cols;
+	SIM_TIME       feed_row_cycles;
+	/* sample instants (A/D start of one-shot / single sweep) */
+	FILE*          sample_log;
+	unsigned long  samples;
+	SIM_TIME       sample_last;
+	SIM_TIME       sample_first;
+	SIM_TIME       period_min;
+	SIM_TIME       period_max;
+	SIM_TIME       period_sum;
+} SIM_STATE;
+
+/**
+ * Global Variable Definition
+ */
+SIM_SFR sim_reg;
+static SIM_SFR   shadow;
+static SIM_STATE sim;
+
+/**
+ * fucntion prototype declaration
+ */
+static void     sim_reset(void);
+static void     sim_access(void);
+static void     sim_writes(void);
+static void     sim_publish(void);
+static void     sim_advance(SIM_TIME dt);
+static SIM_TIME sim_next_event(void);
+static void     sim_step(SIM_TIME dt);
+static int      sim_dispatch(void);
+static void     sim_finish(const char* reason);
+static void     ta_underflow(int i);
+static void     ta_count(int i, unsigned long n);
+static unsigned short ta_div(int i);
+static void     adc_start(void);
+static void     adc_complete(void);
+static unsigned short adc_value(int ch);
+static void     uart_write(int i, unsigned short data);
+static void     uart_shift_done(int i);
+static SIM_TIME uart_char_cycles(int i);
+static void     load_feed(const char* path);
+static void     load_rx_script(int i, const char* path);
+static void     uart_receive(int i);
+static void     df_load(const char* path);
+static void     df_save(void);
+static void     dma_request(int cause);
+static void     dma_transfer(int i);
+static double   sync_host(SIM_TIME t);
+static void     sync_ping(void);
+static void     sync_line(void);
+
+/**
+ * @fn              SIM_REG* sim_sfr(SIM_REG* reg)
+ * @fid             [FID101]-[sim_sfr]
+ * @fnbrf           Register access hook.
+ * @param[in]       reg ; SIM_REG* ; register cell about to be accessed
+ * @param[in,out]   -
+ * @retval          reg ; SIM_REG* ; same register cell
+ * @warning         The access itself happens after return, so writes are
+ *                  detected on the next call by comparing with the shadow copy.
+ * @remark          -
+ */
+SIM_REG* sim_sfr(SIM_REG* reg)
+{
+	int i;
+
+	sim_access();
+
+	/* Reading UiRB clears RI */
+	for (i = 0; i < SIM_UART_MAX; i++)
+	{
+		if (reg == &sim_reg.u[i].rb)
+		{
+			sim_reg.u[i].ri = 0;
+		}
+	}
+
+	sim_publish();
+	return reg;
+}
+
+/**
+ * @fn              static void sim_access(void)
+ * @fid             [FID124]-[sim_access]
+ * @fnbrf           Common part of every memory mapped access.
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          Applies pending writes, costs SIM_ACCESS_CYCLES and
+ *                  serves the interrupts that became due.
+ */
+static void sim_access(void)
+{
+	sim_writes();
+	sim_advance(SIM_ACCESS_CYCLES);
+	while (sim_dispatch())
+	{
+	}
+}
+
+/**
+ * @fn              unsigned short sim_dflash_rd(unsigned int idx)
+ * @fid             [FID125]-[sim_dflash_rd]
+ * @fnbrf           Data flash read access.
+ * @param[in]       idx ; unsigned int ; word index from 0F000h
+ * @param[in,out]   -
+ * @retval          data ; unsigned short ; array word, or status in read status mode
+ * @warning         -
+ * @remark          Status : bit 7 ready, bit 5 erase error, bit 4 program error.
+ */
+unsigned short sim_dflash_rd(unsigned int idx)
+{
+	unsigned short data;
+
+	sim_access();
+	if (sim.df.cmd == SIM_DF_STATUS)
+	{
+		data = (unsigned short)(0x80 | (sim_reg.fmr07 ? 0x20 : 0) | (sim_reg.fmr06 ? 0x10 : 0));
+	}
+	else
+	{
+		data = sim.df.mem[idx % SIM_DF_WORDS];
+	}
+	sim_publish();
+	return data;
+}
+
+/**
+ * @fn              void sim_dflash_wr(unsigned int idx, unsigned short data)
+ * @fid             [FID126]-[sim_dflash_wr]
+ * @fnbrf           Data flash write access, software command sequence.
+ * @param[in]       idx ; unsigned int ; word index from 0F000h
+ * @param[in]       data ; unsigned short ; command or program data
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         Ignored unless FMR01 (CPU rewrite mode) is set.
+ * @remark          EW1 mode : the CPU is held while the flash is busy, so
+ *                  program and erase time passes before the call returns,
+ *                  peripherals run but no interrupt is accepted. Program
+ *                  can only clear bits, FMR06 reports a word that did not
+ *                  take the data.
+ */
+void sim_dflash_wr(unsigned int idx, unsigned short data)
+{
+	unsigned short* cell = &sim.df.mem[idx % SIM_DF_WORDS];
+
+	sim_access();
+	if (sim_reg.fmr01 == 0)
+	{
+		sim_publish();
+		return;
+	}
+	switch (sim.df.cmd)
+	{
+	case SIM_DF_PROGRAM:
+		*cell &= data;
+		if (*cell != data)
+		{
+			sim_reg.fmr06 = 1;
+			sim.df.errors++;
+		}
+		sim.df.programs++;
+		sim.df.cmd = SIM_DF_READ;
+		sim_advance(SIM_DF_PROG_CYCLES);
+		break;
+
+	case SIM_DF_ERASE:
+		if ((data & 0xFF) == SIM_DF_CONFIRM)
+		{
+			memset(sim.df.mem, 0xFF, sizeof(sim.df.mem));
+			sim.df.erases++;
+			sim_advance(SIM_DF_ERASE_CYCLES);
+		}
+		else
+		{
+			sim_reg.fmr07 = 1;    /* command sequence error */
+			sim.df.errors++;
+		}
+		sim.df.cmd = SIM_DF_READ;
+		break;
+
+	default:
+		switch (data & 0xFF)
+		{
+		case SIM_DF_PROGRAM:
+		case SIM_DF_ERASE:
+		case SIM_DF_STATUS:
+		case SIM_DF_READ:
+			sim.df.cmd = data & 0xFF;
+			break;
+		case SIM_DF_CLEAR:
+			sim_reg.fmr06 = 0;
+			sim_reg.fmr07 = 0;
+			break;
+		default:
+			break;
+		}
+		break;
+	}
+	sim_publish();
+}
+
+/**
+ * @fn              void sim_dma_src(int i, const volatile void* src)
+ * @fid             [FID129]-[sim_dma_src]
+ * @fnbrf           Firmware wrote SARi (DMAi_SRC).
+ * @param[in]       i ; int ; DMA channel
+ * @param[in]       src ; const volatile void* ; source address
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+void sim_dma_src(int i, const volatile void* src)
+{
+	sim_access();
+	sim.dma[i].src = (const volatile unsigned char*)src;
+	sim_publish();
+}
+
+/**
+ * @fn              void sim_dma_dst(int i, volatile void* dst)
+ * @fid             [FID130]-[sim_dma_dst]
+ * @fnbrf           Firmware wrote DARi (DMAi_DST).
+ * @param[in]       i ; int ; DMA channel
+ * @param[in]       dst ; volatile void* ; destination address, &UiTB or memory
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+void sim_dma_dst(int i, volatile void* dst)
+{
+	sim_access();
+	sim.dma[i].dst = dst;
+	sim_publish();
+}
+
+/**
+ * @fn              void sim_asm(const char* code)
+ * @fid             [FID102]-[sim_asm]
+ * @fnbrf           Inline assembler hook (FSET I, FCLR I, NOP, WAIT).
+ * @param[in]       code ; const char* ; instruction text
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+void sim_asm(const char* code)
+{
+	char op[16];
+	int  n = 0;
+
+	while ((*code != '\0') && (n < (int)sizeof(op) - 1))
+	{
+		op[n++] = (char)toupper((unsigned char)*code++);
+	}
+	op[n] = '\0';
+
+	sim_writes();
+
+	if (strstr(op, "FSET") && strchr(op + 4, 'I'))
+	{
+		sim.ien = 1;
+	}
+	else if (strstr(op, "FCLR") && strchr(op + 4, 'I'))
+	{
+		sim.ien = 0;
+	}
+	else if (strstr(op, "WAIT"))
+	{
+		/* sleep until an enabled interrupt is requested */
+		while (!sim.ien || !sim_dispatch())
+		{
+			SIM_TIME dt = sim_next_event();
+
+			if (dt == SIM_NEVER)
+			{
+				sim_finish("WAIT without wake-up source");
+			}
+			sim.wait_cycles += dt;
+			sim_step(dt);
+		}
+	}
+	else
+	{
+		sim_advance(SIM_NOP_CYCLES);
+	}
+
+	while (sim_dispatch())
+	{
+	}
+	sim_publish();
+}
+
+/**
+ * @fn              static void sim_reset(void)
+ * @fid             [FID103]-[sim_reset]
+ * @fnbrf           Register reset values.
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void sim_reset(void)
+{
+	int i;
+
+	memset((void*)&sim_reg, 0, sizeof(sim_reg));
+	for (i = 0; i < SIM_UART_MAX; i++)
+	{
+		sim_reg.u[i].tb = SIM_TB_EMPTY;
+		sim_reg.u[i].ti = 1;
+		sim.u[i].out    = NULL;
+	}
+	sim.u[1].out    = stdout;
+	sim_reg.fmr00   = 1;          /* flash ready */
+	memset(sim.df.mem, 0xFF, sizeof(sim.df.mem));
+	sim.df.cmd      = SIM_DF_READ;
+	sim.period_min  = SIM_NEVER;
+	sim.limit       = 10ULL * SIM_F1_HZ;
+	sim_publish();
+}
+
+/**
+ * @fn              static void sim_writes(void)
+ * @fid             [FID104]-[sim_writes]
+ * @fnbrf           Apply register writes made by the firmware since the last hook.
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void sim_writes(void)
+{
+	int i;
+
+	/* Timer A */
+	for (i = 0; i < SIM_TA_MAX; i++)
+	{
+		SIM_TA* r = &sim_reg.ta[i];
+		SIM_TA* s = &shadow.ta[i];
+
+		if (r->cnt != s->cnt)
+		{
+			sim.ta[i].reload = r->cnt;
+			if (r->s != 0 && s->s != 0)
+			{
+				r->cnt = s->cnt;   /* running : write goes to reload only */
+			}
+		}
+		if (r->s != 0 && s->s == 0)
+		{
+			sim.ta[i].phase = 0;
+		}
+		if (r->ic != s->ic)
+		{
+			r->ir = (r->ic >> 3) & 1;
+		}
+		else if (r->ir != s->ir)
+		{
+			r->ic = (unsigned short)((r->ic & ~0x08) | ((r->ir & 1) << 3));
+		}
+	}
+
+	/* A/D converter */
+	if (sim_reg.adic != shadow.adic)
+	{
+		sim_reg.adir = (sim_reg.adic >> 3) & 1;
+	}
+	else if (sim_reg.adir != shadow.adir)
+	{
+		sim_reg.adic = (unsigned short)((sim_reg.adic & ~0x08) | ((sim_reg.adir & 1) << 3));
+	}
+	if (sim_reg.adst != 0 && !sim.adc.busy)
+	{
+		adc_start();
+	}
+	else if (sim_reg.adst == 0 && sim.adc.busy)
+	{
+		sim.adc.busy = 0;
+	}
+
+	/* UART */
+	for (i = 0; i < SIM_UART_MAX; i++)
+	{
+		SIM_UART* r = &sim_reg.u[i];
+		SIM_UART* s = &shadow.u[i];
+
+		if (r->tic != s->tic)
+		{
+			r->tir = (r->tic >> 3) & 1;
+		}
+		else if (r->tir != s->tir)
+		{
+			r->tic = (unsigned short)((r->tic & ~0x08) | ((r->tir & 1) << 3));
+		}
+		if (r->ric != s->ric)
+		{
+			r->rir = (r->ric >> 3) & 1;
+		}
+		else if (r->rir != s->rir)
+		{
+			r->ric = (unsigned short)((r->ric & ~0x08) | ((r->rir & 1) << 3));
+		}
+		if (r->tb != SIM_TB_EMPTY)
+		{
+			unsigned short data = r->tb;
+
+			r->tb = SIM_TB_EMPTY;
+			uart_write(i, data);
+		}
+	}
+
+	/* DMA */
+	for (i = 0; i < SIM_DMA_MAX; i++)
+	{
+		SIM_DMA* r = &sim_reg.dma[i];
+		SIM_DMA* s = &shadow.dma[i];
+
+		if (r->ic != s->ic)
+		{
+			r->ir = (r->ic >> 3) & 1;
+		}
+		else if (r->ir != s->ir)
+		{
+			r->ic = (unsigned short)((r->ic & ~0x08) | ((r->ir & 1) << 3));
+		}
+	}
+}
+
+/**
+ * @fn              static void sim_publish(void)
+ * @fid             [FID105]-[sim_publish]
+ * @fnbrf           Remember register values seen by the firmware.
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void sim_publish(void)
+{
+	memcpy((void*)&shadow, (const void*)&sim_reg, sizeof(shadow));
+}
+
+/**
+ * @fn              static void sim_advance(SIM_TIME dt)
+ * @fid             [FID106]-[sim_advance]
+ * @fnbrf           Advance simulated time event by event.
+ * @param[in]       dt ; SIM_TIME ; cycles
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void sim_advance(SIM_TIME dt)
+{
+	while (dt > 0)
+	{
+		SIM_TIME step = sim_next_event();
+
+		if (step > dt)
+		{
+			step = dt;
+		}
+		sim_step(step);
+		dt -= step;
+	}
+}
+
+/**
+ * @fn              static SIM_TIME sim_next_event(void)
+ * @fid             [FID107]-[sim_next_event]
+ * @fnbrf           Cycles until the next peripheral event.
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          dt ; SIM_TIME ; cycles, SIM_NEVER if none
+ * @warning         -
+ * @remark          -
+ */
+static SIM_TIME sim_next_event(void)
+{
+	SIM_TIME dt = SIM_NEVER;
+	SIM_TIME t;
+	int      i;
+
+	for (i = 0; i < SIM_TA_MAX; i++)
+	{
+		if (sim_reg.ta[i].s && ((sim_reg.ta[i].mr & 0x03) == 0x00))
+		{
+			t = ((SIM_TIME)sim_reg.ta[i].cnt + 1) * ta_div(i) - sim.ta[i].phase;
+			if (t < dt)
+			{
+				dt = t;
+			}
+		}
+	}
+	if (sim.adc.busy)
+	{
+		t = sim.adc.done_at - sim.now;
+		if (t < dt)
+		{
+			dt = t;
+		}
+	}
+	for (i = 0; i < SIM_UART_MAX; i++)
+	{
+		if (sim.u[i].shift_busy)
+		{
+			t = sim.u[i].shift_done - sim.now;
+			if (t < dt)
+			{
+				dt = t;
+			}
+		}
+		if (sim.u[i].rx_pos < sim.u[i].rx_len)
+		{
+			t = (sim.u[i].rx_next > sim.now) ? (sim.u[i].rx_next - sim.now) : 0;
+			if (t < dt)
+			{
+				dt = t;
+			}
+		}
+	}
+	if (sim.sync.period != 0)
+	{
+		t = (sim.sync.next > sim.now) ? (sim.sync.next - sim.now) : 0;
+		if (t < dt)
+		{
+			dt = t;
+		}
+	}
+	if ((dt != SIM_NEVER) && (sim.now + dt > sim.limit))
+	{
+		dt = (sim.limit > sim.now) ? (sim.limit - sim.now) : 1;
+	}
+	if (dt == 0)
+	{
+		dt = 1;
+	}
+	return dt;
+}
+
+/**
+ * @fn              static void sim_step(SIM_TIME dt)
+ * @fid             [FID108]-[sim_step]
+ * @fnbrf           Advance at most up to the next event and process it.
+ * @param[in]       dt ; SIM_TIME ; cycles
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void sim_step(SIM_TIME dt)
+{
+	int i;
+
+	sim.now += dt;
+
+	for (i = 0; i < SIM_TA_MAX; i++)
+	{
+		if (sim_reg.ta[i].s && ((sim_reg.ta[i].mr & 0x03) == 0x00))
+		{
+			SIM_TIME total = sim.ta[i].phase + dt;
+
+			sim.ta[i].phase = total % ta_div(i);
+			ta_count(i, (unsigned long)(total / ta_div(i)));
+		}
+	}
+	if (sim.adc.busy && (sim.now >= sim.adc.done_at))
+	{
+		adc_complete();
+	}
+	for (i = 0; i < SIM_UART_MAX; i++)
+	{
+		if (sim.u[i].shift_busy && (sim.now >= sim.u[i].shift_done))
+		{
+			uart_shift_done(i);
+		}
+		if ((sim.u[i].rx_pos < sim.u[i].rx_len) && (sim.now >= sim.u[i].rx_next))
+		{
+			uart_receive(i);
+		}
+	}
+	if ((sim.sync.period != 0) && (sim.now >= sim.sync.next))
+	{
+		sync_ping();
+	}
+	if (sim.now >= sim.limit)
+	{
+		sim_finish("time limit");
+	}
+}
+
+/**
+ * @fn              static int sim_dispatch(void)
+ * @fid             [FID109]-[sim_dispatch]
+ * @fnbrf           Accept the highest priority pending interrupt.
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          1 if an interrupt was accepted
+ * @warning         -
+ * @remark          -
+ */
+static int sim_dispatch(void)
+{
+	SIM_REG* ic[SIM_TA_MAX + 1 + SIM_DMA_MAX + SIM_UART_MAX * 2];
+	SIM_REG* ir[SIM_TA_MAX + 1 + SIM_DMA_MAX + SIM_UART_MAX * 2];
+	SIM_ISR  isr[SIM_TA_MAX + 1 + SIM_DMA_MAX + SIM_UART_MAX * 2];
+	unsigned long* cnt[SIM_TA_MAX + 1 + SIM_DMA_MAX + SIM_UART_MAX * 2];
+	int      n    = 0;
+	int      best = -1;
+	int      i;
+
+	if (!sim.ien || sim.in_isr)
+	{
+		return 0;
+	}
+
+	for (i = 0; i < SIM_TA_MAX; i++)
+	{
+		ic[n] = &sim_reg.ta[i].ic;
+		ir[n] = &sim_reg.ta[i].ir;
+		cnt[n] = NULL;
+		n++;
+	}
+	isr[0] = ta0_isr;
+	isr[1] = ta1_isr;
+	isr[2] = ta2_isr;
+	isr[3] = ta3_isr;
+	isr[4] = ta4_isr;
+	ic[n] = &sim_reg.adic;
+	ir[n] = &sim_reg.adir;
+	cnt[n] = NULL;
+	isr[n++] = ad_isr;
+	ic[n] = &sim_reg.dma[0].ic;
+	ir[n] = &sim_reg.dma[0].ir;
+	cnt[n] = &sim.dma[0].irqs;
+	isr[n++] = dma0_isr;
+	for (i = 0; i < SIM_UART_MAX; i++)
+	{
+		ic[n] = &sim_reg.u[i].tic;
+		ir[n] = &sim_reg.u[i].tir;
+		cnt[n] = &sim.u[i].tx_irqs;
+		n++;
+		ic[n] = &sim_reg.u[i].ric;
+		ir[n] = &sim_reg.u[i].rir;
+		cnt[n] = NULL;
+		n++;
+	}
+	isr[n - 6] = uart0_tx_isr;
+	isr[n - 5] = uart0_rx_isr;
+	isr[n - 4] = uart1_tx_isr;
+	isr[n - 3] = uart1_rx_isr;
+	isr[n - 2] = uart2_tx_isr;
+	isr[n - 1] = uart2_rx_isr;
+
+	for (i = 0; i < n; i++)
+	{
+		if (*ir[i] && (*ic[i] & 0x07))
+		{
+			if ((best < 0) || ((*ic[i] & 0x07) > (*ic[best] & 0x07)))
+			{
+				best = i;
+			}
+		}
+	}
+	if (best < 0)
+	{
+		return 0;
+	}
+
+	*ir[best] = 0;
+	*ic[best] = (unsigned short)(*ic[best] & ~0x08);
+	if (cnt[best] != NULL)
+	{
+		(*cnt[best])++;
+	}
+	sim.ien    = 0;
+	sim.in_isr = 1;
+	sim_advance(SIM_IRQ_CYCLES);
+	sim_publish();
+	if (isr[best] != NULL)
+	{
+		isr[best]();
+	}
+	sim_writes();
+	sim_advance(SIM_REIT_CYCLES);
+	sim.in_isr = 0;
+	sim.ien    = 1;
+	return 1;
+}
+
+/**
+ * @fn              static void sim_finish(const char* reason)
+ * @fid             [FID110]-[sim_finish]
+ * @fnbrf           Print the run summary and stop.
+ * @param[in]       reason ; const char* ; why the run ended
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void sim_finish(const char* reason)
+{
+	double        sec   = (double)sim.now / SIM_F1_HZ;
+	unsigned long total = 0;
+	int           links = 0;
+	int           i;
+
+	fflush(NULL);
+	fprintf(stderr, "sim62p: %s at %.6f s\n", reason, sec);
+	for (i = 0; i < SIM_UART_MAX; i++)
+	{
+		SIM_UART_STATE* u = &sim.u[i];
+
+		if (u->bytes != 0)
+		{
+			double span = (double)(u->last_byte - u->first_byte) / SIM_F1_HZ;
+
+			fprintf(stderr, "sim62p: uart%d %lu bytes %lu lines, %.1f bytes/s %.2f lines/s\n",
+			        i, u->bytes, u->lines,
+			        (span > 0) ? u->bytes / span : 0.0,
+			        (span > 0) ? u->lines / span : 0.0);
+			fprintf(stderr, "sim62p: uart%d %lu transmit interrupts, %.2f per line\n",
+			        i, u->tx_irqs, (u->lines != 0) ? (double)u->tx_irqs / u->lines : 0.0);
+			total += u->bytes;
+			links++;
+		}
+		if (u->rx_len != 0)
+		{
+			fprintf(stderr, "sim62p: uart%d received %lu of %lu bytes, %lu overrun\n",
+			        i, u->rx_pos, u->rx_len, u->rx_overrun);
+		}
+	}
+	if (links > 1)
+	{
+		fprintf(stderr, "sim62p: uart0-2 %lu bytes, %.1f bytes/s over the run\n",
+		        total, (sec > 0) ? total / sec : 0.0);
+	}
+	for (i = 0; i < SIM_DMA_MAX; i++)
+	{
+		if (sim.dma[i].transfers != 0)
+		{
+			fprintf(stderr, "sim62p: dma%d %lu transfers, %lu blocks, %lu interrupts\n",
+			        i, sim.dma[i].transfers, sim.dma[i].blocks, sim.dma[i].irqs);
+		}
+	}
+	if (sim.sync.period != 0)
+	{
+		fprintf(stderr, "sim62p: sync %lu pings, host clock %+.1f ppm, %lu stamps, error mean %.1f us max %.1f us\n",
+		        sim.sync.pings, (sim.sync.rate - 1.0) * 1e6, sim.sync.stamps,
+		        (sim.sync.stamps != 0) ? sim.sync.err_sum / sim.sync.stamps : 0.0, sim.sync.err_max);
+		fprintf(stderr, "sim62p: sync after %d pings %lu stamps, error mean %.1f us max %.1f us\n",
+		        SIM_SYNC_SETTLE, sim.sync.settled,
+		        (sim.sync.settled != 0) ? sim.sync.settled_sum / sim.sync.settled : 0.0,
+		        sim.sync.settled_max);
+	}
+	if ((sim.df.programs != 0) || (sim.df.erases != 0) || (sim.df.errors != 0))
+	{
+		fprintf(stderr, "sim62p: dflash %lu words programmed, %lu erases, %lu errors\n",
+		        sim.df.programs, sim.df.erases, sim.df.errors);
+	}
+	df_save();
+	fprintf(stderr, "sim62p: wait %.2f %% of cycles\n",
+	        (sim.now != 0) ? 100.0 * (double)sim.wait_cycles / (double)sim.now : 0.0);
+	if (sim.samples != 0)
+	{
+		fprintf(stderr, "sim62p: first A/D start at %.3f ms\n",
+		        1000.0 * (double)sim.sample_first / SIM_F1_HZ);
+	}
+	if (sim.samples > 1)
+	{
+		fprintf(stderr, "sim62p: samples %lu, period mean %.3f ms min %.3f ms max %.3f ms\n",
+		        sim.samples,
+		        1000.0 * (double)sim.period_sum / (double)(sim.samples - 1) / SIM_F1_HZ,
+		        1000.0 * (double)sim.period_min / SIM_F1_HZ,
+		        1000.0 * (double)sim.period_max / SIM_F1_HZ);
+	}
+	exit(0);
+}
+
+/**
+ * @fn              static unsigned short ta_div(int i)
+ * @fid             [FID111]-[ta_div]
+ * @fnbrf           Timer Ai count source in f1 cycles.
+ * @param[in]       i ; int ; timer number
+ * @param[in,out]   -
+ * @retval          div ; unsigned short ; cycles per count
+ * @warning         -
+ * @remark          -
+ */
+static unsigned short ta_div(int i)
+{
+	static const unsigned short div[4] = { 1, 8, 32, 5859 }; /* f1, f8, f32, fc32 */
+
+	return div[(sim_reg.ta[i].mr >> 6) & 0x03];
+}
+
+/**
+ * @fn              static void ta_count(int i, unsigned long n)
+ * @fid             [FID112]-[ta_count]
+ * @fnbrf           Apply n counts to timer Ai.
+ * @param[in]       i ; int ; timer number
+ * @param[in]       n ; unsigned long ; counts
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          Timer mode counts down, event counter mode follows udf.
+ */
+static void ta_count(int i, unsigned long n)
+{
+	SIM_TA* r  = &sim_reg.ta[i];
+	int     up = ((r->mr & 0x03) == 0x01) && ((sim_reg.udf >> i) & 1);
+
+	while (n > 0)
+	{
+		if (up)
+		{
+			unsigned long room = 0xFFFFUL - r->cnt;
+
+			if (n <= room)
+			{
+				r->cnt = (unsigned short)(r->cnt + n);
+				n = 0;
+			}
+			else
+			{
+				n -= room + 1;
+				r->cnt = sim.ta[i].reload;
+				ta_underflow(i);
+			}
+		}
+		else
+		{
+			if (n <= r->cnt)
+			{
+				r->cnt = (unsigned short)(r->cnt - n);
+				n = 0;
+			}
+			else
+			{
+				n -= (unsigned long)r->cnt + 1;
+				r->cnt = sim.ta[i].reload;
+				ta_underflow(i);
+			}
+		}
+	}
+}
+
+/**
+ * @fn              static void ta_underflow(int i)
+ * @fid             [FID113]-[ta_underflow]
+ * @fnbrf           Timer Ai underflow / overflow.
+ * @param[in]       i ; int ; timer number
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          Event sources per trgsr : TA4 <- TA3 ("10") or TA0 ("11").
+ */
+static void ta_underflow(int i)
+{
+	sim_reg.ta[i].ir = 1;
+	sim_reg.ta[i].ic |= 0x08;
+
+	if ((i == 3) || (i == 0))
+	{
+		unsigned short sel = (sim_reg.trgsr >> 6) & 0x03;
+
+		if ((sim_reg.ta[4].s != 0) && ((sim_reg.ta[4].mr & 0x03) == 0x01) &&
+		    (((i == 3) && (sel == 0x02)) || ((i == 0) && (sel == 0x03))))
+		{
+			ta_count(4, 1);
+		}
+	}
+}
+
+/**
+ * @fn              static void adc_start(void)
+ * @fid             [FID114]-[adc_start]
+ * @fnbrf           A/D conversion start.
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          28 (8 bit) / 33 (10 bit) phiAD cycles per channel.
+ */
+static void adc_start(void)
+{
+	unsigned short md    = (sim_reg.adcon0 >> 3) & 0x03;
+	unsigned short div   = 4;
+	unsigned short conv  = (sim_reg.adcon1 & 0x08) ? 33 : 28;
+	unsigned short chans = 1;
+
+	if (sim_reg.adcon1 & 0x20)
+	{
+		div = 1;
+	}
+	else if (sim_reg.adcon0 & 0x80)
+	{
+		div = 2;
+	}
+	if (md >= 2)
+	{
+		chans = (unsigned short)(((sim_reg.adcon1 & 0x03) + 1) * 2);
+	}
+
+	sim.adc.busy     = 1;
+	sim.adc.duration = (SIM_TIME)conv * div * chans;
+	sim.adc.done_at  = sim.now + sim.adc.duration;
+
+	if ((md & 0x01) == 0)
+	{
+		/* one-shot / single sweep : one sample per start */
+		if (sim.samples != 0)
+		{
+			SIM_TIME period = sim.now - sim.sample_last;
+
+			sim.period_sum += period;
+			if (period < sim.period_min)
+			{
+				sim.period_min = period;
+			}
+			if (period > sim.period_max)
+			{
+				sim.period_max = period;
+			}
+		}
+		else
+		{
+			sim.sample_first = sim.now;
+		}
+		if (sim.sample_log != NULL)
+		{
+			fprintf(sim.sample_log, "%llu\n", sim.now);
+		}
+		sim.sample_last = sim.now;
+		sim.samples++;
+	}
+}
+
+/**
+ * @fn              static void adc_complete(void)
+ * @fid             [FID115]-[adc_complete]
+ * @fnbrf           A/D conversion complete.
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void adc_complete(void)
+{
+	unsigned short md = (sim_reg.adcon0 >> 3) & 0x03;
+	int            ch;
+
+	if (md >= 2)
+	{
+		for (ch = 0; ch < (int)(((sim_reg.adcon1 & 0x03) + 1) * 2); ch++)
+		{
+			sim_reg.ad[ch] = adc_value(ch);
+		}
+	}
+	else
+	{
+		ch = sim_reg.adcon0 & 0x07;
+		sim_reg.ad[ch] = adc_value(ch);
+	}
+
+	if (md & 0x01)
+	{
+		/* repeat modes : keep converting */
+		sim.adc.done_at += sim.adc.duration;
+	}
+	else
+	{
+		sim.adc.busy     = 0;
+		sim_reg.adst     = 0;
+		sim_reg.adir     = 1;
+		sim_reg.adic    |= 0x08;
+		sim.sync.sweep[sim.sync.sweeps++ % SIM_SYNC_SWEEPS] = sim.now;
+	}
+}
+
+/**
+ * @fn              static unsigned short adc_value(int ch)
+ * @fid             [FID116]-[adc_value]
+ * @fnbrf           Analog input of channel ch at the current time.
+ * @param[in]       ch ; int ; channel
+ * @param[in,out]   -
+ * @retval          code ; unsigned short ; conversion result
+ * @warning         -
+ * @remark          Without a feed file a slow triangle wave is applied.
+ */
+static unsigned short adc_value(int ch)
+{
+	unsigned short code;
+
+	if (sim.feed != NULL)
+	{
+		unsigned long row = (unsigned long)(sim.now / sim.feed_row_cycles);
+
+		if (row >= sim.feed_rows)
+		{
+			sim_finish("end of A/D feed");
+		}
+		if (ch >= (int)sim.feed_cols)
+		{
+			ch = (int)sim.feed_cols - 1;
+		}
+		code = sim.feed[row * sim.feed_cols + (unsigned long)ch];
+	}
+	else
+	{
+		/* 20 s triangle, 40 codes peak to peak */
+		unsigned long phase = (unsigned long)((sim.now / (SIM_F1_HZ / 4)) % 80);
+
+		code = (unsigned short)(60 + ch * 10 + ((phase < 40) ? phase : (80 - phase)));
+	}
+
+	if (sim_reg.adcon1 & 0x08)
+	{
+		code = (unsigned short)(code << 2);   /* 10 bit */
+	}
+	return code;
+}
+
+/**
+ * @fn              static SIM_TIME uart_char_cycles(int i)
+ * @fid             [FID117]-[uart_char_cycles]
+ * @fnbrf           One UARTi frame in f1 cycles.
+ * @param[in]       i ; int ; UART number
+ * @param[in,out]   -
+ * @retval          cycles ; SIM_TIME ; frame time
+ * @warning         -
+ * @remark          bit time = 16 * (n + 1) / f(UiBRG count source)
+ */
+static SIM_TIME uart_char_cycles(int i)
+{
+	static const unsigned short div[4] = { 1, 8, 32, 32 };   /* f1, f8, f32 */
+	unsigned short mr   = sim_reg.u[i].mr;
+	unsigned short bits = 1;
+
+	switch (mr & 0x07)
+	{
+		case 0x04: bits += 7; break;
+		case 0x06: bits += 9; break;
+		default:   bits += 8; break;
+	}
+	bits = (unsigned short)(bits + ((mr & 0x40) ? 1 : 0) + ((mr & 0x10) ? 2 : 1));
+
+	return (SIM_TIME)bits * 16 * ((SIM_TIME)sim_reg.u[i].brg + 1) * div[sim_reg.u[i].c0 & 0x03];
+}
+
+/**
+ * @fn              static void uart_write(int i, unsigned short data)
+ * @fid             [FID118]-[uart_write]
+ * @fnbrf           Firmware wrote UiTB.
+ * @param[in]       i ; int ; UART number
+ * @param[in]       data ; unsigned short ; written value
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void uart_write(int i, unsigned short data)
+{
+	SIM_UART_STATE* u = &sim.u[i];
+
+	if (!sim_reg.u[i].te)
+	{
+		return;
+	}
+	if (!u->shift_busy)
+	{
+		u->shift_busy = 1;
+		u->shift_byte = data;
+		u->shift_done = sim.now + uart_char_cycles(i);
+		sim_reg.u[i].ti = 1;
+		if (sim_reg.u[i].irs == 0)
+		{
+			sim_reg.u[i].tir = 1;
+			sim_reg.u[i].tic |= 0x08;
+			dma_request(dma_cause_tx[i]);
+		}
+	}
+	else
+	{
+		/* overwriting a full buffer loses the old byte, as on the chip */
+		u->buf_full = 1;
+		u->buf_byte = data;
+		sim_reg.u[i].ti = 0;
+	}
+}
+
+/**
+ * @fn              static void uart_shift_done(int i)
+ * @fid             [FID119]-[uart_shift_done]
+ * @fnbrf           UARTi finished shifting out a frame.
+ * @param[in]       i ; int ; UART number
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void uart_shift_done(int i)
+{
+	SIM_UART_STATE* u = &sim.u[i];
+	unsigned char   c = (unsigned char)u->shift_byte;
+
+	if (u->out != NULL)
+	{
+		fputc(c, u->out);
+	}
+	if (u->bytes == 0)
+	{
+		u->first_byte = sim.now;
+	}
+	u->last_byte = sim.now;
+	u->bytes++;
+	if (c == '\n')
+	{
+		u->lines++;
+	}
+	if ((i == 1) && (sim.sync.period != 0))
+	{
+		if (c == '\n')
+		{
+			sim.sync.line[sim.sync.len] = '\0';
+			sync_line();
+			sim.sync.len = 0;
+		}
+		else if (sim.sync.len < SIM_SYNC_LINE_MAX - 1)
+		{
+			sim.sync.line[sim.sync.len++] = (char)c;
+		}
+	}
+
+	if (u->buf_full)
+	{
+		u->buf_full   = 0;
+		u->shift_byte = u->buf_byte;
+		u->shift_done = sim.now + uart_char_cycles(i);
+		sim_reg.u[i].ti = 1;
+		if (sim_reg.u[i].irs == 0)
+		{
+			sim_reg.u[i].tir = 1;
+			sim_reg.u[i].tic |= 0x08;
+			dma_request(dma_cause_tx[i]);
+		}
+	}
+	else
+	{
+		u->shift_busy = 0;
+		if (sim_reg.u[i].irs != 0)
+		{
+			sim_reg.u[i].tir = 1;
+			sim_reg.u[i].tic |= 0x08;
+			dma_request(dma_cause_tx[i]);
+		}
+	}
+}
+
+/**
+ * @fn              static void dma_request(int cause)
+ * @fid             [FID131]-[dma_request]
+ * @fnbrf           A peripheral raised a request, DMA channels selecting it transfer.
+ * @param[in]       cause ; int ; DMiSL DSEL value of the request
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         A request while DMAE is 0 is lost, the firmware has to
+ *                  enable the channel before the request it waits for.
+ * @remark          -
+ */
+static void dma_request(int cause)
+{
+	int i;
+
+	for (i = 0; i < SIM_DMA_MAX; i++)
+	{
+		if ((sim_reg.dma[i].con & SIM_DMA_ENABLE) && ((sim_reg.dma[i].sl & 0x1F) == cause))
+		{
+			dma_transfer(i);
+		}
+	}
+}
+
+/**
+ * @fn              static void dma_transfer(int i)
+ * @fid             [FID132]-[dma_transfer]
+ * @fnbrf           One DMAi transfer.
+ * @param[in]       i ; int ; DMA channel
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          8 bit unit, single transfer mode : the channel stops and
+ *                  requests its interrupt when TCRi underflows. Repeat mode
+ *                  and 16 bit unit are not modelled, nor the bus cycles taken.
+ *                  A write to UiTB goes to the UART as a firmware write does.
+ */
+static void dma_transfer(int i)
+{
+	SIM_DMA*       r    = &sim_reg.dma[i];
+	SIM_DMA_STATE* d    = &sim.dma[i];
+	unsigned char  data = *d->src;
+	volatile void* dst  = d->dst;
+	int            u;
+
+	if (r->con & SIM_DMA_SRC_INC)
+	{
+		d->src++;
+	}
+	if (r->con & SIM_DMA_DST_INC)
+	{
+		d->dst = (volatile unsigned char*)d->dst + 1;
+	}
+	d->transfers++;
+	if (r->tcr == 0)
+	{
+		r->con = (unsigned short)(r->con & ~SIM_DMA_ENABLE);
+		r->ir  = 1;
+		r->ic |= 0x08;
+		d->blocks++;
+	}
+	else
+	{
+		r->tcr--;
+	}
+
+	for (u = 0; u < SIM_UART_MAX; u++)
+	{
+		if (dst == (volatile void*)&sim_reg.u[u].tb)
+		{
+			uart_write(u, data);
+			return;
+		}
+	}
+	*(volatile unsigned char*)dst = data;
+}
+
+/**
+ * @fn              static void uart_receive(int i)
+ * @fid             [FID122]-[uart_receive]
+ * @fnbrf           Next byte of the receive script arrives at UARTi.
+ * @param[in]       i ; int ; UART number
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          A byte arriving while RI is still set overruns.
+ */
+static void uart_receive(int i)
+{
+	SIM_UART_STATE* u    = &sim.u[i];
+	unsigned short  data = u->rx_data[u->rx_pos++];
+
+	if (sim_reg.u[i].re)
+	{
+		if (sim_reg.u[i].ri)
+		{
+			data |= SIM_RB_OER;
+			u->rx_overrun++;
+		}
+		sim_reg.u[i].rb  = data;
+		sim_reg.u[i].ri  = 1;
+		sim_reg.u[i].rir = 1;
+		sim_reg.u[i].ric |= 0x08;
+	}
+	if (u->rx_pos < u->rx_len)
+	{
+		u->rx_next = sim.now + uart_char_cycles(i);
+		if (u->rx_at[u->rx_pos] > u->rx_next)
+		{
+			u->rx_next = u->rx_at[u->rx_pos];
+		}
+	}
+}
+
+/**
+ * @fn              static double sync_host(SIM_TIME t)
+ * @fid             [FID133]-[sync_host]
+ * @fnbrf           Host clock of the -y option.
+ * @param[in]       t ; SIM_TIME ; simulated time
+ * @param[in,out]   -
+ * @retval          sec ; double ; host time
+ * @warning         -
+ * @remark          -
+ */
+static double sync_host(SIM_TIME t)
+{
+	double host = sim.sync.offset + sim.sync.rate * ((double)t / SIM_F1_HZ);
+
+	if ((sim.sync.jump_at != 0) && (t >= sim.sync.jump_at))
+	{
+		host += sim.sync.jump;
+	}
+	return host;
+}
+
+/**
+ * @fn              static void sync_ping(void)
+ * @fid             [FID134]-[sync_ping]
+ * @fnbrf           Send "SYNC sec us" to UART1 with the host time of its start.
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          The ping goes in front of the rest of the receive script
+ *                  when the line is idle until it ends, else it waits one
+ *                  character. Its first byte is received one character
+ *                  after the host time it carries.
+ */
+static void sync_ping(void)
+{
+	SIM_UART_STATE* u    = &sim.u[1];
+	SIM_TIME        ch   = uart_char_cycles(1);
+	double          host = sync_host(sim.now);
+	unsigned long   sec  = (unsigned long)host;
+	char            text[48];
+	size_t          n;
+	size_t          k;
+
+	n = (size_t)sprintf(text, "SYNC %lu %lu\n", sec,
+	                    (unsigned long)((host - (double)sec) * 1e6));
+	if ((u->rx_pos < u->rx_len) && (u->rx_next <= sim.now + (n + 1) * ch))
+	{
+		sim.sync.next = sim.now + ch;
+		return;
+	}
+	u->rx_data = (unsigned char*)realloc(u->rx_data, u->rx_len + n);
+	u->rx_at   = (SIM_TIME*)realloc(u->rx_at, (u->rx_len + n) * sizeof(SIM_TIME));
+	memmove(u->rx_data + u->rx_pos + n, u->rx_data + u->rx_pos, u->rx_len - u->rx_pos);
+	memmove(u->rx_at + u->rx_pos + n, u->rx_at + u->rx_pos, (u->rx_len - u->rx_pos) * sizeof(SIM_TIME));
+	memcpy(u->rx_data + u->rx_pos, text, n);
+	for (k = 0; k < n; k++)
+	{
+		u->rx_at[u->rx_pos + k] = sim.now;
+	}
+	u->rx_len += n;
+	u->rx_next = sim.now + ch;
+	sim.sync.pings++;
+	sim.sync.next += sim.sync.period;
+}
+
+/**
+ * @fn              static void sync_line(void)
+ * @fid             [FID135]-[sync_line]
+ * @fnbrf           Alignment error of the "Sync : sec.us" field of a UART1 line.
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          The sample is the kept A/D sweep end nearest in host time.
+ */
+static void sync_line(void)
+{
+	const char* p = strstr(sim.sync.line, "\tSync : ");
+	char*       end;
+	double      v;
+	double      err;
+	double      best = 0.0;
+	unsigned long k;
+	unsigned long n;
+
+	if ((p == NULL) || (sim.sync.sweeps == 0))
+	{
+		return;
+	}
+	v = (double)strtoul(p + 8, &end, 10);
+	if (*end != '.')
+	{
+		return;
+	}
+	v += (double)strtoul(end + 1, NULL, 10) * 1e-6;
+	n = (sim.sync.sweeps < SIM_SYNC_SWEEPS) ? sim.sync.sweeps : SIM_SYNC_SWEEPS;
+	for (k = 0; k < n; k++)
+	{
+		err = 1e6 * (v - sync_host(sim.sync.sweep[k]));
+		if ((k == 0) || (err * err < best * best))
+		{
+			best = err;
+		}
+	}
+	err = (best < 0) ? -best : best;
+	sim.sync.stamps++;
+	sim.sync.err_sum += err;
+	if (err > sim.sync.err_max)
+	{
+		sim.sync.err_max = err;
+	}
+	if (sim.sync.pings > SIM_SYNC_SETTLE)
+	{
+		sim.sync.settled++;
+		sim.sync.settled_sum += err;
+		if (err > sim.sync.settled_max)
+		{
+			sim.sync.settled_max = err;
+		}
+	}
+}
+
+/**
+ * @fn              static void load_rx_script(int i, const char* path)
+ * @fid             [FID123]-[load_rx_script]
+ * @fnbrf           Load a receive script : "<ms> <text>" per line.
+ * @param[in]       i ; int ; UART number
+ * @param[in]       path ; const char* ; text file
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void load_rx_script(int i, const char* path)
+{
+	SIM_UART_STATE* u  = &sim.u[i];
+	FILE*           fp = fopen(path, "r");
+	char            line[256];
+
+	if (fp == NULL)
+	{
+		perror(path);
+		exit(1);
+	}
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		char*    text;
+		double   ms = strtod(line, &text);
+		SIM_TIME at = (SIM_TIME)(ms * (SIM_F1_HZ / 1000.0));
+		size_t   n;
+
+		if (text == line)
+		{
+			continue;
+		}
+		while (*text == ' ')
+		{
+			text++;
+		}
+		n = strcspn(text, "\r\n");
+		text[n++] = '\n';
+		u->rx_data = (unsigned char*)realloc(u->rx_data, u->rx_len + n);
+		u->rx_at   = (SIM_TIME*)realloc(u->rx_at, (u->rx_len + n) * sizeof(SIM_TIME));
+		memcpy(u->rx_data + u->rx_len, text, n);
+		while (n-- > 0)
+		{
+			u->rx_at[u->rx_len++] = at;
+		}
+	}
+	fclose(fp);
+	if (u->rx_len != 0)
+	{
+		u->rx_next = u->rx_at[0];
+	}
+}
+
+/**
+ * @fn              static void load_feed(const char* path)
+ * @fid             [FID120]-[load_feed]
+ * @fnbrf           Load an A/D feed : one row per line, one code per channel.
+ * @param[in]       path ; const char* ; text file
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void load_feed(const char* path)
+{
+	FILE*         fp = fopen(path, "r");
+	char          line[256];
+	unsigned long cap = 0;
+
+	if (fp == NULL)
+	{
+		perror(path);
+		exit(1);
+	}
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		unsigned int  vals[SIM_ADC_CH_MAX];
+		unsigned int  cols = 0;
+		char*         p    = line;
+		char*         end;
+		unsigned int  c;
+
+		while (cols < SIM_ADC_CH_MAX)
+		{
+			unsigned long v = strtoul(p, &end, 0);
+
+			if (end == p)
+			{
+				break;
+			}
+			vals[cols++] = (unsigned int)v;
+			p = end;
+		}
+		if (cols == 0)
+		{
+			continue;
+		}
+		if (sim.feed_cols == 0)
+		{
+			sim.feed_cols = cols;
+		}
+		if (sim.feed_rows == cap)
+		{
+			cap = (cap != 0) ? cap * 2 : 1024;
+			sim.feed = (unsigned char*)realloc(sim.feed, cap * sim.feed_cols);
+		}
+		for (c = 0; c < sim.feed_cols; c++)
+		{
+			sim.feed[sim.feed_rows * sim.feed_cols + c] =
+				(unsigned char)vals[(c < cols) ? c : (cols - 1)];
+		}
+		sim.feed_rows++;
+	}
+	fclose(fp);
+}
+
+/**
+ * @fn              static void df_load(const char* path)
+ * @fid             [FID127]-[df_load]
+ * @fnbrf           Load the data flash image.
+ * @param[in]       path ; const char* ; image file, written back by df_save
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          A missing or short file leaves the rest erased.
+ */
+static void df_load(const char* path)
+{
+	FILE*         fp = fopen(path, "rb");
+	unsigned char b[2];
+	int           i;
+
+	sim.df.path = path;
+	if (fp == NULL)
+	{
+		return;
+	}
+	for (i = 0; (i < SIM_DF_WORDS) && (fread(b, 1, 2, fp) == 2); i++)
+	{
+		sim.df.mem[i] = (unsigned short)(b[0] | (b[1] << 8)); /* little endian, as the M16C */
+	}
+	fclose(fp);
+}
+
+/**
+ * @fn              static void df_save(void)
+ * @fid             [FID128]-[df_save]
+ * @fnbrf           Write the data flash image back.
+ * @param[in]       -
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+static void df_save(void)
+{
+	FILE*         fp;
+	unsigned char b[2];
+	int           i;
+
+	if (sim.df.path == NULL)
+	{
+		return;
+	}
+	fp = fopen(sim.df.path, "wb");
+	if (fp == NULL)
+	{
+		perror(sim.df.path);
+		return;
+	}
+	for (i = 0; i < SIM_DF_WORDS; i++)
+	{
+		b[0] = (unsigned char)sim.df.mem[i];
+		b[1] = (unsigned char)(sim.df.mem[i] >> 8);
+		(void)fwrite(b, 1, 2, fp);
+	}
+	fclose(fp);
+}
+
+/**
+ * @fn              int main(int argc, char** argv)
+ * @fid             [FID121]-[main]
+ * @fnbrf           Parse options and run the firmware.
+ * @param[in]       argc ; int ; argument count
+ * @param[in]       argv ; char** ; arguments
+ * @param[in,out]   -
+ * @retval          0
+ * @warning         -
+ * @remark          -
+ */
+int main(int argc, char** argv)
+{
+	const char* feed   = NULL;
+	double      row_ms = 100.0;
+	int         i;
+
+	sim_reset();
+
+	for (i = 1; i < argc; i++)
+	{
+		const char* arg = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+		if (arg == NULL)
+		{
+			break;
+		}
+		if (strcmp(argv[i], "-t") == 0)
+		{
+			sim.limit = (SIM_TIME)(atof(arg) * (SIM_F1_HZ / 1000.0));
+		}
+		else if (strcmp(argv[i], "-a") == 0)
+		{
+			feed = arg;
+		}
+		else if (strcmp(argv[i], "-p") == 0)
+		{
+			row_ms = atof(arg);
+		}
+		else if (strcmp(argv[i], "-o") == 0)
+		{
+			sim.u[1].out = fopen(arg, "wb");
+		}
+		else if (strcmp(argv[i], "-o0") == 0)
+		{
+			sim.u[0].out = fopen(arg, "wb");
+		}
+		else if (strcmp(argv[i], "-o2") == 0)
+		{
+			sim.u[2].out = fopen(arg, "wb");
+		}
+		else if (strcmp(argv[i], "-s") == 0)
+		{
+			sim.sample_log = fopen(arg, "w");
+		}
+		else if (strcmp(argv[i], "-r") == 0)
+		{
+			load_rx_script(1, arg);
+		}
+		else if (strcmp(argv[i], "-F") == 0)
+		{
+			df_load(arg);
+		}
+		else if (strcmp(argv[i], "-y") == 0)
+		{
+			char* p;
+
+			sim.sync.period = (SIM_TIME)(strtod(arg, &p) * (SIM_F1_HZ / 1000.0));
+			sim.sync.next   = sim.sync.period;
+			sim.sync.rate   = 1.0;
+			if (*p == ',')
+			{
+				sim.sync.rate += strtod(p + 1, &p) * 1e-6;
+			}
+			if (*p == ',')
+			{
+				sim.sync.offset = strtod(p + 1, &p) / 1000.0;
+			}
+			if (*p == ',')
+			{
+				sim.sync.jump_at = (SIM_TIME)(strtod(p + 1, &p) * (SIM_F1_HZ / 1000.0));
+			}
+			if (*p == ',')
+			{
+				sim.sync.jump = strtod(p + 1, &p);
+			}
+		}
+		else
+		{
+			break;
+		}
+		i++;
+	}
+	if (i < argc)
+	{
+		fprintf(stderr, "usage: %s [-t ms] [-a adc_feed] [-p row_ms] [-o out] [-s sample_log] [-r rx_script] [-F dflash_image] [-y ping_ms[,ppm[,offset_ms[,jump_ms,jump_s]]]] [-o0 uart0_out] [-o2 uart2_out]\n", argv[0]);
+		return 1;
+	}
+
+	if (feed != NULL)
+	{
+		load_feed(feed);
+		sim.feed_row_cycles = (SIM_TIME)(row_ms * (SIM_F1_HZ / 1000.0));
+		if (sim.feed_row_cycles == 0)
+		{
+			sim.feed_row_cycles = 1;
+		}
+	}
+
+	fw_main();
+	sim_finish("firmware returned");
+	return 0;
+}
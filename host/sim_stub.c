@@ -0,0 +1,120 @@
+/**
+ * @file       sim_stub.c
+ * @brief      [MID104]-[sim_stub]
+ * @details    Register access without the peripheral model, for host tools that
+ * @details    compile the firmware only to call its conversion and formatting
+ * @details    code (replay.c, batchconv.c). Link instead of sim62p.c.
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+
+/**
+ * Include file
+ */
+#define SIM62P_IMPL
+#include "sfr62p.h"
+
+/**
+ * Global Variable Definition
+ * Register accesses are plain memory accesses.
+ */
+SIM_SFR sim_reg;
+
+/**
+ * @fn              SIM_REG* sim_sfr(SIM_REG* reg)
+ * @fid             [FID301]-[sim_sfr]
+ * @fnbrf           Register access hook, no peripheral model.
+ * @param[in]       reg ; SIM_REG* ; register cell
+ * @param[in,out]   -
+ * @retval          reg ; SIM_REG* ; same register cell
+ * @warning         -
+ * @remark          -
+ */
+SIM_REG* sim_sfr(SIM_REG* reg)
+{
+	return reg;
+}
+
+/**
+ * @fn              void sim_asm(const char* code)
+ * @fid             [FID302]-[sim_asm]
+ * @fnbrf           Inline assembler, ignored.
+ * @param[in]       code ; const char* ; instruction
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+void sim_asm(const char* code)
+{
+	(void)code;
+}
+
+/**
+ * @fn              unsigned short sim_dflash_rd(unsigned int idx)
+ * @fid             [FID303]-[sim_dflash_rd]
+ * @fnbrf           Data flash read, always erased.
+ * @param[in]       idx ; unsigned int ; word index
+ * @param[in,out]   -
+ * @retval          0xFFFF
+ * @warning         -
+ * @remark          -
+ */
+unsigned short sim_dflash_rd(unsigned int idx)
+{
+	(void)idx;
+	return 0xFFFF;
+}
+
+/**
+ * @fn              void sim_dflash_wr(unsigned int idx, unsigned short data)
+ * @fid             [FID304]-[sim_dflash_wr]
+ * @fnbrf           Data flash write, ignored.
+ * @param[in]       idx ; unsigned int ; word index
+ * @param[in]       data ; unsigned short ; command or data
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+void sim_dflash_wr(unsigned int idx, unsigned short data)
+{
+	(void)idx;
+	(void)data;
+}
+
+/**
+ * @fn              void sim_dma_src(int i, const volatile void* src)
+ * @fid             [FID305]-[sim_dma_src]
+ * @fnbrf           DMA source address, ignored.
+ * @param[in]       i ; int ; DMA channel
+ * @param[in]       src ; const volatile void* ; source address
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+void sim_dma_src(int i, const volatile void* src)
+{
+	(void)i;
+	(void)src;
+}
+
+/**
+ * @fn              void sim_dma_dst(int i, volatile void* dst)
+ * @fid             [FID306]-[sim_dma_dst]
+ * @fnbrf           DMA destination address, ignored.
+ * @param[in]       i ; int ; DMA channel
+ * @param[in]       dst ; volatile void* ; destination address
+ * @param[in,out]   -
+ * @retval          -
+ * @warning         -
+ * @remark          -
+ */
+void sim_dma_dst(int i, volatile void* dst)
+{
+	(void)i;
+	(void)dst;
+}
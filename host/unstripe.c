@@ -0,0 +1,306 @@
+/**
+ * @file       unstripe.c
+ * @brief      [MID115]-[unstripe]
+ * @details    Reassembler of the striped output (STRIPE n): merges the sample
+ * @details    frames ('S' / 'Y') captured on UART1, UART2 and UART0 back into
+ * @details    seq order, in one byte stream with the rest of UART1.
+ * @details    Build : make unstripe, or gcc -O2 -o unstripe host/unstripe.c
+ * @details    Usage : unstripe [-o out] uart1 uart2 [uart0]
+ * @details    The UART1 bytes other than sample frames (text lines, 'L', 'B'..
+ * @details    frames) are written as they came, each sample frame of UART1
+ * @details    where it was. Bytes of UART2 / UART0 other than sample frames
+ * @details    are counted and dropped.
+ * @details    The frames of one link are in seq order. The merge takes the
+ * @details    link whose next frame is nearest after the last frame written
+ * @details    (8 bit seq), the links have to stay within 127 samples of each
+ * @details    other (the firmware queues hold a few frames).
+ * @details    Test : sim02 -r script -o u1 -o2 u2 -o0 u0, script with FMT BIN
+ * @details           and STRIPE 2 or 3.
+ * @copyright  -
+ * @author     -
+ * @version    00.01
+ * @date       2019-01-22
+ */
+
+/**
+ * Include file
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Data definition
+ */
+#define UNS_LINK_MAX        (3)       /* UART1, UART2, UART0                */
+#define UNS_CH_MAX          (6)       /* mask bits of a sample frame        */
+#define UNS_SYNC0           (0xA5)
+#define UNS_SYNC1           (0x5A)
+#define UNS_TYPE_SAMPLE     ('S')
+#define UNS_TYPE_SYNC       ('Y')     /* 'S' + host time sec(4) us(4)       */
+
+/**
+ * One captured link
+ */
+typedef struct
+{
+	const char*    name;
+	unsigned char* data;
+	size_t         len;
+	size_t         pos;               /* next byte to scan                  */
+	size_t         head;              /* next sample frame, len : none      */
+	size_t         head_len;
+	unsigned       head_seq;
+	unsigned long  frames;
+	unsigned long  other;             /* bytes outside sample frames        */
+} UNS_LINK;
+
+/**
+ * Global Variable Definition
+ */
+static UNS_LINK uns_link[UNS_LINK_MAX];
+
+/**
+ * fucntion prototype declaration
+ */
+static size_t uns_frame(const unsigned char* p, size_t len);
+static void   uns_load(UNS_LINK* l, const char* path);
+static void   uns_next(UNS_LINK* l);
+
+/**
+ * @fn              static size_t uns_frame(const unsigned char* p, size_t len)
+ * @fid             [FID1101]-[uns_frame]
+ * @fnbrf           Length of the sample frame at p.
+ * @param[in]       p ; const unsigned char* ; byte to check
+ * @param[in]       len ; size_t ; bytes available
+ * @param[in,out]   -
+ * @retval          n ; size_t ; frame length, 0 : not a complete sample frame
+ * @warning         -
+ * @remark          A5 5A 'S' seq mask code.. sum0 sum1, 'Y' adds sec(4) us(4)
+ *                  before the sum, Fletcher-16 over type and payload.
+ */
+static size_t uns_frame(const unsigned char* p, size_t len)
+{
+	size_t   need;
+	size_t   i;
+	unsigned s0 = 0;
+	unsigned s1 = 0;
+
+	if ((len < 5) || (p[0] != UNS_SYNC0) || (p[1] != UNS_SYNC1) ||
+	    ((p[2] != UNS_TYPE_SAMPLE) && (p[2] != UNS_TYPE_SYNC)))
+	{
+		return 0;
+	}
+	need = 5 + 2 + (size_t)__builtin_popcount(p[4] & ((1U << UNS_CH_MAX) - 1));
+	if (p[2] == UNS_TYPE_SYNC)
+	{
+		need += 8;
+	}
+	if (len < need)
+	{
+		return 0;
+	}
+	for (i = 2; i < need - 2; i++)
+	{
+		s0 = (s0 + p[i]) % 255;
+		s1 = (s1 + s0) % 255;
+	}
+	return ((p[need - 2] == s0) && (p[need - 1] == s1)) ? need : 0;
+}
+
+/**
+ * @fn              static void uns_load(UNS_LINK* l, const char* path)
+ * @fid             [FID1102]-[uns_load]
+ * @fnbrf           Read a capture and find its first sample frame.
+ * @param[in]       path ; const char* ; file
+ * @param[in,out]   l ; UNS_LINK* ; link
+ * @retval          -
+ * @warning         Exits on a file error.
+ * @remark          -
+ */
+static void uns_load(UNS_LINK* l, const char* path)
+{
+	FILE* fp = fopen(path, "rb");
+	long  n;
+
+	if ((fp == NULL) || (fseek(fp, 0, SEEK_END) != 0) || ((n = ftell(fp)) < 0))
+	{
+		perror(path);
+		exit(1);
+	}
+	rewind(fp);
+	l->name = path;
+	l->len  = (size_t)n;
+	l->data = (unsigned char*)malloc(l->len + 1);
+	if ((l->data == NULL) || (fread(l->data, 1, l->len, fp) != l->len))
+	{
+		perror(path);
+		exit(1);
+	}
+	fclose(fp);
+	uns_next(l);
+}
+
+/**
+ * @fn              static void uns_next(UNS_LINK* l)
+ * @fid             [FID1103]-[uns_next]
+ * @fnbrf           Find the next sample frame of a link from l->pos on.
+ * @param[in]       -
+ * @param[in,out]   l ; UNS_LINK* ; link, head = len when there is none
+ * @retval          -
+ * @warning         -
+ * @remark          l->pos is left at the frame, the bytes before it stay
+ *                  for the caller (UART1 writes them).
+ */
+static void uns_next(UNS_LINK* l)
+{
+	size_t i;
+
+	for (i = l->pos; i < l->len; i++)
+	{
+		if (l->data[i] != UNS_SYNC0)
+		{
+			continue;
+		}
+		l->head_len = uns_frame(&l->data[i], l->len - i);
+		if (l->head_len != 0)
+		{
+			l->head     = i;
+			l->head_seq = l->data[i + 3];
+			return;
+		}
+	}
+	l->head     = l->len;
+	l->head_len = 0;
+}
+
+/**
+ * @fn              int main(int argc, char** argv)
+ * @fid             [FID1104]-[main]
+ * @fnbrf           Merge the links and report the order restored.
+ * @param[in]       argc ; int ; argument count
+ * @param[in]       argv ; char** ; arguments
+ * @param[in,out]   -
+ * @retval          0 : done, 1 : usage or file error
+ * @warning         -
+ * @remark          seq steps above 1 are samples not sent live (deadband,
+ *                  link behind : the sample log backfills them on UART1).
+ *                  A frame behind the last written one is written as it is
+ *                  and counted late.
+ */
+int main(int argc, char** argv)
+{
+	FILE*         out     = stdout;
+	unsigned long merged  = 0;
+	unsigned long missing = 0;
+	unsigned long late    = 0;
+	unsigned long bytes   = 0;
+	unsigned      last    = 0;
+	int           links   = 0;
+	int           best;
+	int           d;
+	int           d_best;
+	int           i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "-o") == 0) && (i + 1 < argc))
+		{
+			out = fopen(argv[++i], "wb");
+			if (out == NULL)
+			{
+				perror(argv[i]);
+				return 1;
+			}
+		}
+		else if ((argv[i][0] != '-') && (links < UNS_LINK_MAX))
+		{
+			uns_load(&uns_link[links++], argv[i]);
+		}
+		else
+		{
+			links = 0;
+			break;
+		}
+	}
+	if (links < 2)
+	{
+		fprintf(stderr, "usage: %s [-o out] uart1 uart2 [uart0]\n", argv[0]);
+		return 1;
+	}
+
+	for (;;)
+	{
+		/* nearest next frame after the last one written */
+		best   = -1;
+		d_best = 0;
+		for (i = 0; i < links; i++)
+		{
+			if (uns_link[i].head_len == 0)
+			{
+				continue;
+			}
+			d = (merged == 0) ? 0 : (signed char)(unsigned char)(uns_link[i].head_seq - last);
+			if ((best < 0) || (d < d_best))
+			{
+				best   = i;
+				d_best = d;
+			}
+		}
+		if (best < 0)
+		{
+			break;
+		}
+
+		{
+			UNS_LINK* l = &uns_link[best];
+
+			if (best == 0)
+			{
+				fwrite(&l->data[l->pos], 1, l->head - l->pos, out);
+				bytes += (unsigned long)(l->head - l->pos);
+			}
+			else
+			{
+				l->other += (unsigned long)(l->head - l->pos);
+			}
+			fwrite(&l->data[l->head], 1, l->head_len, out);
+			bytes += (unsigned long)l->head_len;
+			if (merged != 0)
+			{
+				if (d_best <= 0)
+				{
+					late++;
+				}
+				else
+				{
+					missing += (unsigned long)(d_best - 1);
+				}
+			}
+			merged++;
+			last   = l->head_seq;
+			l->frames++;
+			l->pos = l->head + l->head_len;
+			uns_next(l);
+		}
+	}
+	fwrite(&uns_link[0].data[uns_link[0].pos], 1, uns_link[0].len - uns_link[0].pos, out);
+	bytes += (unsigned long)(uns_link[0].len - uns_link[0].pos);
+	for (i = 1; i < links; i++)
+	{
+		uns_link[i].other += (unsigned long)(uns_link[i].len - uns_link[i].pos);
+	}
+	if (out != stdout)
+	{
+		fclose(out);
+	}
+
+	for (i = 0; i < links; i++)
+	{
+		fprintf(stderr, "unstripe: %s %lu bytes, %lu sample frames, %lu other bytes\n",
+		        uns_link[i].name, (unsigned long)uns_link[i].len, uns_link[i].frames, uns_link[i].other);
+	}
+	fprintf(stderr, "unstripe: %lu frames merged, %lu bytes out, %lu seq missing, %lu late\n",
+	        merged, bytes, missing, late);
+	return 0;
+}